@@ -0,0 +1,110 @@
+// HttpServer request handling on loopback: connect, request, full response.
+
+#include "http_server.hpp"
+
+#include <benchmark/benchmark.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace fs = std::filesystem;
+
+namespace ss::bench {
+
+static constexpr uint16_t bench_http_port = 18081;
+
+namespace {
+
+// Size of the debug viewer page
+constexpr size_t index_size = 40 * 1024;
+
+fs::path make_web_root() {
+    fs::path root = fs::temp_directory_path() / "stream-server-bench-web";
+    fs::create_directories(root);
+    std::ofstream(root / "index.html") << std::string(index_size, 'x');
+    return root;
+}
+
+// One request on a fresh connection (the server closes after each response)
+size_t http_get(const std::string& request) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return 0;
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(bench_http_port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return 0;
+    }
+
+    send(fd, request.data(), request.size(), 0);
+    char buf[16 * 1024];
+    size_t total = 0;
+    ssize_t n;
+    while ((n = recv(fd, buf, sizeof(buf), 0)) > 0) {
+        total += static_cast<size_t>(n);
+    }
+    close(fd);
+    return total;
+}
+
+} // namespace
+
+static void BM_HttpStaticFile(benchmark::State& state) {
+    HttpServer server(bench_http_port, make_web_root().string());
+    if (!server.start()) {
+        state.SkipWithError("HTTP server did not start");
+        return;
+    }
+
+    const std::string request = "GET /index.html HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    size_t bytes = 0;
+    for (auto _ : state) {
+        size_t n = http_get(request);
+        if (n < index_size) {
+            state.SkipWithError("short response");
+            break;
+        }
+        bytes += n;
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(bytes));
+    server.stop();
+}
+BENCHMARK(BM_HttpStaticFile)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+static void BM_HttpRoute(benchmark::State& state) {
+    HttpServer server(bench_http_port, make_web_root().string());
+    server.add_route("/api/", [](const HttpRequest& request) {
+        HttpResponse response;
+        response.body = R"({"path":")" + request.path + R"("})";
+        return response;
+    });
+    if (!server.start()) {
+        state.SkipWithError("HTTP server did not start");
+        return;
+    }
+
+    // Authenticated JSON POST, as the admin API receives it
+    const std::string body = R"({"bitrate_kbps":1500})";
+    const std::string request =
+        "POST /api/encoder HTTP/1.1\r\nHost: localhost\r\n"
+        "Authorization: Bearer 0123456789abcdef\r\n"
+        "Content-Type: application/json\r\n"
+        "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+    for (auto _ : state) {
+        if (http_get(request) == 0) {
+            state.SkipWithError("no response");
+            break;
+        }
+    }
+    server.stop();
+}
+BENCHMARK(BM_HttpRoute)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+} // namespace ss::bench
@@ -0,0 +1,45 @@
+// stream-server-bench — microbenchmarks for the media and control hot paths.
+//
+// Defaults favour stable, comparable numbers: 5 repetitions reported as
+// mean/median/stddev only. Any --benchmark_* flag overrides them, e.g.
+//
+//   stream-server-bench --benchmark_out=before.json --benchmark_out_format=json
+//   compare.py benchmarks before.json after.json   (from Google Benchmark tools)
+//
+// For fleet comparisons run on an idle device with the CPU governor fixed.
+
+#include <benchmark/benchmark.h>
+#include <spdlog/spdlog.h>
+#include <rtc/rtc.hpp>
+#include <gst/gst.h>
+#include <cstring>
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv) {
+    std::vector<char*> args(argv, argv + argc);
+
+    auto has_flag = [&](const char* name) {
+        for (int i = 1; i < argc; i++) {
+            if (std::strncmp(argv[i], name, std::strlen(name)) == 0) return true;
+        }
+        return false;
+    };
+
+    std::string repetitions = "--benchmark_repetitions=5";
+    std::string aggregates = "--benchmark_report_aggregates_only=true";
+    if (!has_flag("--benchmark_repetitions")) args.push_back(repetitions.data());
+    if (!has_flag("--benchmark_report_aggregates_only")) args.push_back(aggregates.data());
+
+    // Logging inside the measured code would dominate the numbers
+    spdlog::set_level(spdlog::level::warn);
+    rtc::InitLogger(rtc::LogLevel::Warning);
+    gst_init(nullptr, nullptr);
+
+    int bench_argc = static_cast<int>(args.size());
+    benchmark::Initialize(&bench_argc, args.data());
+    if (benchmark::ReportUnrecognizedArguments(bench_argc, args.data())) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,110 @@
+// Per-peer send path without a network: the same handler chain PeerConnection
+// builds, feeding a mock track sink that only counts packets.
+
+#include "synthetic_h264.hpp"
+#include "media_clock.hpp"
+#include "pacer.hpp"
+
+#include <benchmark/benchmark.h>
+#include <rtc/rtc.hpp>
+#include <cstring>
+
+namespace ss::bench {
+
+namespace {
+
+struct Chain {
+    std::shared_ptr<rtc::RtpPacketizationConfig> rtp_config;
+    std::shared_ptr<rtc::H264RtpPacketizer> packetizer;
+    std::shared_ptr<Pacer> pacer;
+};
+
+// H264RtpPacketizer → RtcpSrReporter → RtcpNackResponder [→ Pacer]
+Chain make_chain(bool paced) {
+    Chain chain;
+    chain.rtp_config = std::make_shared<rtc::RtpPacketizationConfig>(
+        42, "video-stream", 96, rtc::H264RtpPacketizer::defaultClockRate);
+    chain.packetizer = std::make_shared<rtc::H264RtpPacketizer>(
+        rtc::NalUnit::Separator::LongStartSequence, chain.rtp_config);
+    chain.packetizer->addToChain(std::make_shared<rtc::RtcpSrReporter>(chain.rtp_config));
+    chain.packetizer->addToChain(std::make_shared<rtc::RtcpNackResponder>());
+    if (paced) {
+        // Rate far above the offered load: measures queueing overhead, not delay
+        chain.pacer = std::make_shared<Pacer>(1'000'000, std::chrono::milliseconds(40));
+        chain.packetizer->addToChain(chain.pacer);
+    }
+    return chain;
+}
+
+struct MockTrackSink {
+    uint64_t packets = 0;
+    uint64_t bytes = 0;
+
+    void consume(rtc::message_vector& messages) {
+        for (auto& m : messages) {
+            if (!m) continue;
+            packets++;
+            bytes += m->size();
+        }
+        messages.clear();
+    }
+};
+
+void run_chain(benchmark::State& state, bool paced) {
+    auto au = make_access_unit(static_cast<size_t>(state.range(0)), state.range(0) >= 16 * 1024);
+    Chain chain = make_chain(paced);
+    MockTrackSink sink;
+    rtc::message_callback send = [&sink](rtc::message_ptr m) {
+        if (m) {
+            sink.packets++;
+            sink.bytes += m->size();
+        }
+    };
+
+    uint64_t media_us = 0;
+    for (auto _ : state) {
+        chain.rtp_config->timestamp = MediaClock::to_rtp(media_us, rtc::H264RtpPacketizer::defaultClockRate);
+        media_us += 33'333;
+
+        auto message = rtc::make_message(au.size());
+        std::memcpy(message->data(), au.data(), au.size());
+        rtc::message_vector messages{message};
+        chain.packetizer->mediaChainOutgoing(messages, send);
+        sink.consume(messages);
+    }
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(au.size()));
+    state.counters["packets_per_au"] = benchmark::Counter(
+        static_cast<double>(sink.packets), benchmark::Counter::kAvgIterations);
+}
+
+} // namespace
+
+static void BM_PacketizerChain(benchmark::State& state) {
+    run_chain(state, false);
+}
+BENCHMARK(BM_PacketizerChain)
+    ->ArgName("au_bytes")
+    ->Arg(static_cast<int64_t>(small_p_au_size))
+    ->Arg(static_cast<int64_t>(p_au_size))
+    ->Arg(static_cast<int64_t>(idr_au_size));
+
+static void BM_PacketizerChainPaced(benchmark::State& state) {
+    run_chain(state, true);
+}
+BENCHMARK(BM_PacketizerChainPaced)
+    ->ArgName("au_bytes")
+    ->Arg(static_cast<int64_t>(p_au_size))
+    ->Arg(static_cast<int64_t>(idr_au_size));
+
+static void BM_MediaClockOnFrame(benchmark::State& state) {
+    MediaClock clock;
+    uint64_t pts_us = 1'000'000;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(clock.on_frame(pts_us));
+        pts_us += 33'333;
+    }
+}
+BENCHMARK(BM_MediaClockOnFrame);
+
+} // namespace ss::bench
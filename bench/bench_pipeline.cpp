@@ -0,0 +1,72 @@
+// Appsink video path: sample → map → NAL callback → stats, and the same
+// feeding WebRtcServer::broadcast_nal with no peers attached.
+
+#include "synthetic_h264.hpp"
+#include "rtsp_pipeline.hpp"
+#include "webrtc_server.hpp"
+
+#include <benchmark/benchmark.h>
+#include <gst/gst.h>
+
+namespace ss::bench {
+
+namespace {
+
+// Sample that wraps the AU without copying it
+GstSample* make_sample(std::vector<uint8_t>& au) {
+    GstBuffer* buffer = gst_buffer_new_wrapped_full(
+        GST_MEMORY_FLAG_READONLY, au.data(), au.size(), 0, au.size(), nullptr, nullptr);
+    GST_BUFFER_PTS(buffer) = 0;
+    GstSample* sample = gst_sample_new(buffer, nullptr, nullptr, nullptr);
+    gst_buffer_unref(buffer);
+    return sample;
+}
+
+} // namespace
+
+static void BM_DeliverVideoSample(benchmark::State& state) {
+    auto au = make_access_unit(static_cast<size_t>(state.range(0)), state.range(0) >= 16 * 1024);
+    AppConfig config;
+    RtspPipeline pipeline(config);
+
+    uint64_t delivered = 0;
+    pipeline.set_nal_callback([&delivered](const uint8_t* data, size_t size, uint64_t, uint64_t) {
+        benchmark::DoNotOptimize(data);
+        delivered += size;
+    });
+
+    GstSample* sample = make_sample(au);
+    for (auto _ : state) {
+        pipeline.deliver_video_sample(sample);
+    }
+    gst_sample_unref(sample);
+
+    benchmark::DoNotOptimize(delivered);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(au.size()));
+}
+BENCHMARK(BM_DeliverVideoSample)
+    ->ArgName("au_bytes")
+    ->Arg(static_cast<int64_t>(p_au_size))
+    ->Arg(static_cast<int64_t>(idr_au_size));
+
+static void BM_DeliverToBroadcastNoPeers(benchmark::State& state) {
+    auto au = make_access_unit(p_au_size, false);
+    AppConfig config;
+    RtspPipeline pipeline(config);
+    WebRtcServer server(config);
+
+    uint64_t pts_us = 0;
+    pipeline.set_nal_callback([&server, &pts_us](const uint8_t* data, size_t size, uint64_t, uint64_t) {
+        server.broadcast_nal(data, size, pts_us);
+        pts_us += 33'333;
+    });
+
+    GstSample* sample = make_sample(au);
+    for (auto _ : state) {
+        pipeline.deliver_video_sample(sample);
+    }
+    gst_sample_unref(sample);
+}
+BENCHMARK(BM_DeliverToBroadcastNoPeers);
+
+} // namespace ss::bench
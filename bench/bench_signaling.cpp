@@ -0,0 +1,119 @@
+// Signaling JSON handling through a real SignalingServer on loopback:
+// WebSocket frame in → parse → dispatch → reply out.
+
+#include "signaling_server.hpp"
+
+#include <benchmark/benchmark.h>
+#include <rtc/rtc.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace ss::bench {
+
+static constexpr uint16_t bench_signaling_port = 18080;
+
+namespace {
+
+struct SignalingFixture {
+    AppConfig config;
+    std::unique_ptr<WebRtcServer> webrtc;
+    std::unique_ptr<SignalingServer> signaling;
+    std::shared_ptr<rtc::WebSocket> ws;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    uint64_t pongs = 0;
+    std::atomic<uint64_t> bitrate_requests{0};
+
+    bool start() {
+        config.server.signaling_port = bench_signaling_port;
+        config.webrtc.stun_server.clear();
+        webrtc = std::make_unique<WebRtcServer>(config);
+        signaling = std::make_unique<SignalingServer>(config, *webrtc);
+        signaling->set_bitrate_callback([this](const std::string&, int) { bitrate_requests.fetch_add(1); });
+        webrtc->start();
+        if (!signaling->start()) return false;
+
+        std::atomic<bool> open{false};
+        ws = std::make_shared<rtc::WebSocket>();
+        ws->onOpen([&open]() { open.store(true); });
+        ws->onMessage([this](rtc::message_variant data) {
+            auto* text = std::get_if<std::string>(&data);
+            if (text && text->find("\"pong\"") != std::string::npos) {
+                std::lock_guard<std::mutex> lock(mutex);
+                pongs++;
+                cv.notify_one();
+            }
+        });
+        ws->open("ws://127.0.0.1:" + std::to_string(bench_signaling_port));
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (!open.load() && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        ws->onOpen(nullptr);
+        return open.load();
+    }
+
+    ~SignalingFixture() {
+        if (ws) ws->close();
+        if (signaling) signaling->stop();
+        if (webrtc) webrtc->stop();
+    }
+};
+
+} // namespace
+
+static void BM_SignalingPingRoundTrip(benchmark::State& state) {
+    SignalingFixture fixture;
+    if (!fixture.start()) {
+        state.SkipWithError("signaling server did not start");
+        return;
+    }
+
+    const std::string ping = R"({"type":"ping"})";
+    uint64_t expected = 0;
+    for (auto _ : state) {
+        fixture.ws->send(ping);
+        expected++;
+        std::unique_lock<std::mutex> lock(fixture.mutex);
+        if (!fixture.cv.wait_for(lock, std::chrono::seconds(2),
+                                 [&]() { return fixture.pongs >= expected; })) {
+            state.SkipWithError("pong timed out");
+            break;
+        }
+    }
+}
+BENCHMARK(BM_SignalingPingRoundTrip)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+static void BM_SignalingSetBitrate(benchmark::State& state) {
+    SignalingFixture fixture;
+    if (!fixture.start()) {
+        state.SkipWithError("signaling server did not start");
+        return;
+    }
+
+    // ABR message as the web viewer sends it, in batches to measure throughput
+    constexpr int batch = 64;
+    const std::string message = R"({"type":"set_bitrate","bitrate_kbps":1500})";
+    uint64_t expected = 0;
+    for (auto _ : state) {
+        for (int i = 0; i < batch; i++) fixture.ws->send(message);
+        expected += batch;
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+        while (fixture.bitrate_requests.load() < expected) {
+            if (std::chrono::steady_clock::now() > deadline) {
+                state.SkipWithError("set_bitrate messages not handled");
+                return;
+            }
+            std::this_thread::yield();
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * batch);
+}
+BENCHMARK(BM_SignalingSetBitrate)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+} // namespace ss::bench
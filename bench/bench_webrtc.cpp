@@ -0,0 +1,73 @@
+// broadcast_nal fan-out to real peers: packetization, SRTP and UDP send to
+// viewers on loopback. The per-AU time divided by peers is the per-peer
+// send_h264_nal cost.
+
+#include "synthetic_h264.hpp"
+#include "loopback_viewer.hpp"
+
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace ss::bench {
+
+static void BM_BroadcastNal(benchmark::State& state) {
+    const int peers = static_cast<int>(state.range(0));
+
+    // Viewers outlive the server: its peers call back into them until stopped
+    std::vector<std::unique_ptr<LoopbackViewer>> viewers;
+
+    AppConfig config;
+    config.webrtc.stun_server.clear();
+    config.webrtc.max_peers = peers;
+    WebRtcServer server(config);
+    server.start();
+
+    for (int i = 0; i < peers; i++) {
+        viewers.push_back(std::make_unique<LoopbackViewer>(server));
+        if (!viewers.back()->start()) {
+            state.SkipWithError("failed to create peer");
+            return;
+        }
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(15);
+    while (server.get_stats().connected_peers < static_cast<size_t>(peers)) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            state.SkipWithError("peers did not connect over loopback");
+            return;
+        }
+        for (auto& v : viewers) v->pump();
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    // Let the tracks open after DTLS completes
+    for (int i = 0; i < 40; i++) {
+        for (auto& v : viewers) v->pump();
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+
+    auto gop = make_gop();
+    uint64_t pts_us = 0;
+    size_t frame = 0;
+    int64_t bytes = 0;
+    for (auto _ : state) {
+        const auto& au = gop[frame++ % gop.size()];
+        server.broadcast_nal(au.data(), au.size(), pts_us);
+        pts_us += 33'333;
+        bytes += static_cast<int64_t>(au.size());
+    }
+
+    state.SetBytesProcessed(bytes * peers);
+    uint64_t received = 0;
+    for (auto& v : viewers) received += v->bytes_received();
+    state.counters["rx_bytes"] = static_cast<double>(received);
+}
+BENCHMARK(BM_BroadcastNal)
+    ->ArgName("peers")
+    ->Arg(1)->Arg(4)->Arg(8)
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
+
+} // namespace ss::bench
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "webrtc_server.hpp"
+
+#include <rtc/rtc.hpp>
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace ss::bench {
+
+// In-process viewer connected to a WebRtcServer over loopback, with the
+// signaling messages passed directly instead of through a WebSocket.
+//
+// Every signaling step is queued and run from pump() on the benchmark
+// thread: the server may invoke its signaling callback while holding its
+// peer lock, so answering from inside the callback would deadlock.
+class LoopbackViewer {
+public:
+    explicit LoopbackViewer(WebRtcServer& server) : server_(server) {}
+
+    ~LoopbackViewer() {
+        if (pc_) pc_->close();
+    }
+
+    bool start() {
+        pc_ = std::make_shared<rtc::PeerConnection>(rtc::Configuration{});
+
+        pc_->onLocalDescription([this](rtc::Description description) {
+            std::string sdp(description);
+            post([this, sdp]() { server_.handle_answer(peer_id_, sdp); });
+        });
+        pc_->onLocalCandidate([this](rtc::Candidate candidate) {
+            std::string cand(candidate);
+            std::string mid = candidate.mid();
+            post([this, cand, mid]() { server_.handle_candidate(peer_id_, cand, mid); });
+        });
+        pc_->onTrack([this](std::shared_ptr<rtc::Track> track) {
+            track->setMediaHandler(std::make_shared<rtc::RtcpReceivingSession>());
+            track->onMessage([this](rtc::binary data) { bytes_.fetch_add(data.size()); },
+                             nullptr);
+            std::lock_guard<std::mutex> lock(mutex_);
+            tracks_.push_back(std::move(track));
+        });
+
+        peer_id_ = server_.create_peer([this](const std::string& type, const std::string& payload) {
+            post([this, type, payload]() { on_signaling(type, payload); });
+        });
+        if (peer_id_.empty()) return false;
+
+        server_.start_offer(peer_id_);
+        return true;
+    }
+
+    // Run queued signaling steps, returns the number run
+    size_t pump() {
+        std::deque<std::function<void()>> tasks;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks.swap(tasks_);
+        }
+        for (auto& task : tasks) task();
+        return tasks.size();
+    }
+
+    uint64_t bytes_received() const { return bytes_.load(); }
+
+private:
+    void post(std::function<void()> task) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.push_back(std::move(task));
+    }
+
+    void on_signaling(const std::string& type, const std::string& payload) {
+        if (type == "offer") {
+            pc_->setRemoteDescription(rtc::Description(payload, "offer"));
+        } else if (type == "candidate") {
+            auto data = nlohmann::json::parse(payload, nullptr, false);
+            if (data.is_discarded()) return;
+            pc_->addRemoteCandidate(rtc::Candidate(data.value("candidate", ""),
+                                                   data.value("sdpMid", "0")));
+        }
+    }
+
+    WebRtcServer& server_;
+    std::string peer_id_;
+    std::shared_ptr<rtc::PeerConnection> pc_;
+    std::vector<std::shared_ptr<rtc::Track>> tracks_;
+    std::atomic<uint64_t> bytes_{0};
+
+    std::mutex mutex_;
+    std::deque<std::function<void()>> tasks_;
+};
+
+} // namespace ss::bench
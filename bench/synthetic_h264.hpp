@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace ss::bench {
+
+// Access unit sizes for 720p30 at ~2 Mbps, as seen from our cameras
+constexpr size_t idr_au_size = 48 * 1024;
+constexpr size_t p_au_size = 7 * 1024;
+constexpr size_t small_p_au_size = 1500;
+
+// Annex-B access unit: 4-byte start codes, valid NAL headers and payload
+// bytes that never form a start code, so the packetizer sees realistic
+// NAL boundaries
+inline std::vector<uint8_t> make_access_unit(size_t size, bool idr, uint32_t seed = 1) {
+    std::vector<uint8_t> au;
+    au.reserve(size);
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<int> byte_dist(1, 255);
+
+    auto add_nal = [&](uint8_t header, size_t payload) {
+        au.insert(au.end(), {0x00, 0x00, 0x00, 0x01, header});
+        for (size_t i = 0; i < payload; i++) {
+            au.push_back(static_cast<uint8_t>(byte_dist(gen)));
+        }
+    };
+
+    if (idr) {
+        add_nal(0x67, 12);  // SPS
+        add_nal(0x68, 4);   // PPS
+    }
+    size_t used = au.size() + 5;
+    add_nal(idr ? 0x65 : 0x41, size > used ? size - used : 1);
+    return au;
+}
+
+// One second of video: an IDR followed by P-frames
+inline std::vector<std::vector<uint8_t>> make_gop(int frames = 30) {
+    std::vector<std::vector<uint8_t>> gop;
+    gop.push_back(make_access_unit(idr_au_size, true, 0));
+    for (int i = 1; i < frames; i++) {
+        gop.push_back(make_access_unit(p_au_size, false, static_cast<uint32_t>(i)));
+    }
+    return gop;
+}
+
+} // namespace ss::bench
@@ -0,0 +1,118 @@
+#include "abs_capture_time.hpp"
+#include "capture_clock.hpp"
+#include <array>
+
+namespace ss {
+
+namespace {
+
+constexpr uint8_t rtcp_sender_report = 200;
+constexpr uint16_t one_byte_profile = 0xBEDE;
+
+uint32_t read_be32(const std::byte* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+uint16_t read_be16(const std::byte* p) {
+    return static_cast<uint16_t>((static_cast<uint16_t>(p[0]) << 8) | static_cast<uint16_t>(p[1]));
+}
+
+void write_be64(std::byte* p, uint64_t value) {
+    for (int i = 7; i >= 0; i--) {
+        p[i] = static_cast<std::byte>(value & 0xFF);
+        value >>= 8;
+    }
+}
+
+} // namespace
+
+AbsCaptureTime::AbsCaptureTime(const MediaClock& clock, uint32_t clock_rate)
+    : clock_(clock)
+    , clock_rate_(clock_rate)
+{
+}
+
+void AbsCaptureTime::outgoing(rtc::message_vector& messages, const rtc::message_callback& /*send*/) {
+    for (auto& message : messages) {
+        if (!message) continue;
+        if (message->type == rtc::Message::Control) {
+            stamp_report(*message);
+        } else {
+            stamp_packet(*message);
+        }
+    }
+}
+
+bool AbsCaptureTime::capture_time(uint32_t rtp_timestamp, uint64_t& capture_us) const {
+    // RTP timestamps are the media time at clock_rate_, wrapped: take the
+    // wrap nearest the current media time
+    uint64_t expected = clock_.now_us() * clock_rate_ / 1'000'000;
+    auto ticks = static_cast<int64_t>(expected) +
+                 static_cast<int32_t>(rtp_timestamp - static_cast<uint32_t>(expected));
+    if (ticks < 0) return false;
+
+    uint64_t media_us = static_cast<uint64_t>(ticks) * 1'000'000 / clock_rate_;
+    return clock_.capture_time(media_us, capture_us);
+}
+
+void AbsCaptureTime::stamp_packet(rtc::Message& packet) {
+    if (packet.size() < 12) return;
+    std::byte* data = packet.data();
+    auto first = static_cast<uint8_t>(data[0]);
+    if ((first >> 6) != 2) return;
+
+    // Packets of a frame share its timestamp: only the first is stamped
+    uint32_t timestamp = read_be32(data + 4);
+    if (has_last_ && timestamp == last_timestamp_) return;
+    has_last_ = true;
+    last_timestamp_ = timestamp;
+
+    uint64_t capture_us = 0;
+    if (!capture_time(timestamp, capture_us)) return;
+
+    // One-byte element (ID, length 8 - 1) with the 64-bit NTP capture time,
+    // padded to a word
+    std::array<std::byte, 12> element{};
+    element[0] = static_cast<std::byte>((extension_id << 4) | 7);
+    write_be64(element.data() + 1, CaptureClock::unix_us_to_ntp(capture_us));
+
+    size_t header = 12 + 4 * static_cast<size_t>(first & 0x0F);
+    if (packet.size() < header) return;
+
+    if (first & 0x10) {
+        // Extend an existing one-byte extension block; leave other forms alone
+        if (packet.size() < header + 4 || read_be16(data + header) != one_byte_profile) return;
+        uint16_t words = static_cast<uint16_t>(read_be16(data + header + 2) + element.size() / 4);
+        data[header + 2] = static_cast<std::byte>(words >> 8);
+        data[header + 3] = static_cast<std::byte>(words & 0xFF);
+        packet.insert(packet.begin() + static_cast<std::ptrdiff_t>(header + 4), element.begin(), element.end());
+        return;
+    }
+
+    data[0] = static_cast<std::byte>(first | 0x10);
+    const std::array<std::byte, 4> block{
+        std::byte{0xBE}, std::byte{0xDE}, std::byte{0x00}, static_cast<std::byte>(element.size() / 4)};
+    auto at = packet.insert(packet.begin() + static_cast<std::ptrdiff_t>(header), block.begin(), block.end());
+    packet.insert(at + static_cast<std::ptrdiff_t>(block.size()), element.begin(), element.end());
+}
+
+void AbsCaptureTime::stamp_report(rtc::Message& report) {
+    // Compound RTCP: the SR's NTP time is 8 bytes in, its RTP timestamp 16
+    size_t offset = 0;
+    while (offset + 4 <= report.size()) {
+        std::byte* data = report.data() + offset;
+        if ((static_cast<uint8_t>(data[0]) >> 6) != 2) return;
+        size_t length = (static_cast<size_t>(read_be16(data + 2)) + 1) * 4;
+        if (offset + length > report.size()) return;
+
+        uint64_t capture_us = 0;
+        if (static_cast<uint8_t>(data[1]) == rtcp_sender_report && length >= 28 &&
+            capture_time(read_be32(data + 16), capture_us)) {
+            write_be64(data + 8, CaptureClock::unix_us_to_ntp(capture_us));
+        }
+        offset += length;
+    }
+}
+
+} // namespace ss
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "media_clock.hpp"
+#include <rtc/rtc.hpp>
+#include <cstdint>
+
+namespace ss {
+
+// Stamps a track's outgoing media with the camera's capture time
+// (rtsp.capture_clock), right after its RtcpSrReporter:
+//
+//   RTP  the abs-capture-time header extension on the first packet of
+//        each frame (RFC 8285 one-byte form)
+//   SR   the NTP time of each sender report, which becomes the capture
+//        time of the report's RTP timestamp
+//
+// With both, a browser's capture-to-render delay covers the camera link
+// and this server, not just the last hop. Everything passes untouched while
+// the media clock has no capture times.
+class AbsCaptureTime final : public rtc::MediaHandler {
+public:
+    static constexpr const char* uri = "http://www.webrtc.org/experiments/rtp-hdrext/abs-capture-time";
+    static constexpr int extension_id = 8;     // as offered in the SDP
+
+    AbsCaptureTime(const MediaClock& clock, uint32_t clock_rate);
+
+    void outgoing(rtc::message_vector& messages, const rtc::message_callback& send) override;
+
+private:
+    bool capture_time(uint32_t rtp_timestamp, uint64_t& capture_us) const;
+    void stamp_packet(rtc::Message& packet);
+    void stamp_report(rtc::Message& report);
+
+    const MediaClock& clock_;
+    uint32_t clock_rate_;
+
+    // Only touched from the chain, which the track runs one call at a time
+    bool has_last_ = false;
+    uint32_t last_timestamp_ = 0;
+};
+
+} // namespace ss
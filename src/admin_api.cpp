@@ -0,0 +1,459 @@
+#include "admin_api.hpp"
+#include "bitrate_policy.hpp"
+#include "config_reloader.hpp"
+#include "mosaic_stream.hpp"
+#include "rtsp_pipeline.hpp"
+#include "signaling_server.hpp"
+#include "webrtc_server.hpp"
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+
+using json = nlohmann::json;
+
+namespace ss {
+
+static const std::string api_prefix = "/api/";
+
+static HttpResponse json_response(int status, const std::string& status_text, const json& body) {
+    HttpResponse response;
+    response.status = status;
+    response.status_text = status_text;
+    response.body = body.dump();
+    return response;
+}
+
+static HttpResponse ok(const json& body) {
+    return json_response(200, "OK", body);
+}
+
+static HttpResponse error(int status, const std::string& status_text, const std::string& message) {
+    return json_response(status, status_text, {{"error", message}});
+}
+
+// Keep camera credentials out of API responses
+static std::string redact_url(const std::string& url) {
+    auto scheme = url.find("://");
+    auto at = url.find('@');
+    if (scheme == std::string::npos || at == std::string::npos || at < scheme) return url;
+    return url.substr(0, scheme + 3) + "***@" + url.substr(at + 1);
+}
+
+// Compare without an early exit so timing does not leak the token
+static bool token_equal(const std::string& a, const std::string& b) {
+    if (a.size() != b.size()) return false;
+    unsigned char diff = 0;
+    for (size_t i = 0; i < a.size(); i++) {
+        diff |= static_cast<unsigned char>(a[i] ^ b[i]);
+    }
+    return diff == 0;
+}
+
+AdminApi::AdminApi(WebRtcServer& webrtc, SignalingServer& signaling, RtspPipeline& pipeline,
+                   BitratePolicy& bitrate, ConfigReloader& reloader, MosaicStream& mosaic)
+    : webrtc_(webrtc)
+    , signaling_(signaling)
+    , pipeline_(pipeline)
+    , bitrate_(bitrate)
+    , reloader_(reloader)
+    , mosaic_(mosaic)
+{
+}
+
+bool AdminApi::authorized(const HttpRequest& request) const {
+    // Token is read per request so a config reload can rotate it
+    std::string token = reloader_.current().admin.token;
+    if (token.empty()) return false;
+
+    std::string auth = request.header("authorization");
+    const std::string bearer = "Bearer ";
+    if (auth.compare(0, bearer.size(), bearer) != 0) return false;
+    return token_equal(auth.substr(bearer.size()), token);
+}
+
+HttpResponse AdminApi::handle(const HttpRequest& request) {
+    if (!reloader_.current().admin.enabled) {
+        return error(404, "Not Found", "admin API disabled");
+    }
+    if (!authorized(request)) {
+        spdlog::warn("Admin: Rejected unauthorized {} {}", request.method, request.path);
+        return error(401, "Unauthorized", "missing or invalid bearer token");
+    }
+
+    std::string route = request.path.substr(api_prefix.size());
+    const std::string& method = request.method;
+    spdlog::info("Admin: {} {}", method, request.path);
+
+    try {
+        if (route == "peers" && method == "GET") return list_peers();
+        if (route.compare(0, 6, "peers/") == 0 && method == "DELETE") {
+            return evict_peer(route.substr(6));
+        }
+        if (route == "keyframe" && method == "POST") return force_keyframe();
+        if (route == "encoder" && method == "GET") return get_encoder();
+        if (route == "encoder" && method == "POST") return set_encoder(request.body);
+        if (route == "source" && method == "POST") return switch_source(request.body);
+        if (route == "webrtc" && method == "GET") return session_setup();
+        if (route == "webrtc" && method == "POST") return set_session_setup(request.body);
+        if (route == "pipeline" && method == "GET") return pipeline_state();
+        if (route == "pipeline/restart" && method == "POST") return restart_pipeline();
+        if (route == "process" && method == "GET") return process_state();
+        if (route == "reload" && method == "POST") return reload();
+    } catch (const json::exception& e) {
+        return error(400, "Bad Request", e.what());
+    } catch (const std::exception& e) {
+        // e.g. no usable encoder while switching source
+        spdlog::error("Admin: {} {} failed: {}", method, request.path, e.what());
+        return error(500, "Internal Server Error", e.what());
+    }
+
+    return error(404, "Not Found", "unknown endpoint " + method + " " + request.path);
+}
+
+HttpResponse AdminApi::list_peers() {
+    json peers = json::array();
+    for (auto& [id, ps] : webrtc_.get_peer_stats()) {
+        json setup = {{"pooled", ps.pooled}};
+        for (size_t i = 0; i < PeerConnection::phase_count; i++) {
+            auto phase = static_cast<PeerConnection::Phase>(i);
+            setup[PeerConnection::phase_name(phase)] = ps.phases_ms[i];
+        }
+        peers.push_back({
+            {"id", id},
+            {"state", ps.state},
+            {"rtp_packets_sent", ps.rtp_packets_sent},
+            {"bytes_sent", ps.bytes_sent},
+            {"audio_packets_sent", ps.audio_packets_sent},
+            {"telemetry_sent", ps.telemetry_sent},
+            {"telemetry_dropped", ps.telemetry_dropped},
+            {"control_received", ps.control_received},
+            {"control_rtt_ms", ps.control_rtt_avg_ms},
+            {"plis_received", ps.plis_received},
+            {"video_profile", ps.video_profile},
+            {"answered_profile", ps.answered_profile},
+            {"renegotiations", ps.renegotiations},
+            {"transport", {
+                {"bytes_sent", ps.transport_bytes_sent},
+                {"bytes_received", ps.transport_bytes_received},
+                {"rtt_ms", ps.transport_rtt_ms},
+                {"local", ps.local_candidate},
+                {"remote", ps.remote_candidate},
+            }},
+            {"impairment", {
+                {"lost", ps.impairment_lost},
+                {"queue_drops", ps.impairment_queue_drops},
+            }},
+            {"setup", setup},
+        });
+    }
+    return ok({{"peers", peers}});
+}
+
+HttpResponse AdminApi::evict_peer(const std::string& peer_id) {
+    if (!webrtc_.has_peer(peer_id)) {
+        return error(404, "Not Found", "unknown peer " + peer_id);
+    }
+    if (!signaling_.disconnect_peer(peer_id)) {
+        // No signaling session left, drop the connection directly
+        webrtc_.remove_peer(peer_id);
+    }
+    spdlog::warn("Admin: Evicted peer {}", peer_id);
+    return ok({{"evicted", peer_id}});
+}
+
+HttpResponse AdminApi::force_keyframe() {
+    if (!pipeline_.request_keyframe()) {
+        return error(503, "Service Unavailable", "pipeline not running or request not handled");
+    }
+    return ok({{"requested", true}});
+}
+
+HttpResponse AdminApi::get_encoder() {
+    auto stats = pipeline_.get_stats();
+    auto content = bitrate_.content_state();
+    AppConfig config = reloader_.current();
+    return ok({
+        {"policy", BitratePolicy::mode_name(bitrate_.mode())},
+        {"requested_kbps", bitrate_.current_kbps()},
+        {"encoder_kbps", stats.encoder_bitrate_kbps},
+        {"content_adaptive", {
+            {"enabled", content.enabled},
+            {"complexity", stats.complexity.valid ? json(stats.complexity.score) : json(nullptr)},
+            {"p_frame_ratio", stats.complexity.p_ratio},
+            {"p_frame_bytes", static_cast<int64_t>(stats.complexity.p_frame_bytes)},
+            {"idr_bytes", static_cast<int64_t>(stats.complexity.idr_bytes)},
+            {"content_kbps", content.content_kbps},
+            {"abr_kbps", content.abr_kbps},
+        }},
+        {"latency_budget", {
+            {"budget_ms", config.encoding.latency_budget_ms},
+            {"max_frame_bytes", stats.frame_budget_bytes},
+            {"frames_over", stats.frames_over_budget},
+            {"keyframes_over", stats.keyframes_over_budget},
+        }},
+        {"passthrough", config.encoding.passthrough},
+    });
+}
+
+HttpResponse AdminApi::set_encoder(const std::string& body) {
+    json request = json::parse(body);
+
+    // A bitrate pins the rate, i.e. means fixed: asking for adaptive with
+    // one is a contradiction, not a precedence question
+    BitratePolicy::Mode mode = BitratePolicy::Mode::Fixed;
+    bool has_mode = request.contains("policy");
+    if (has_mode && !BitratePolicy::parse_mode(request["policy"].get<std::string>(), mode)) {
+        return error(400, "Bad Request", "policy must be adaptive or fixed");
+    }
+    int kbps = 0;
+    if (request.contains("bitrate_kbps")) {
+        kbps = request["bitrate_kbps"].get<int>();
+        if (kbps <= 0) {
+            return error(400, "Bad Request", "bitrate_kbps must be positive");
+        }
+        if (has_mode && mode == BitratePolicy::Mode::Adaptive) {
+            return error(400, "Bad Request", "bitrate_kbps sets a fixed rate, it cannot go with policy adaptive");
+        }
+    }
+
+    if (kbps > 0) {
+        bitrate_.set_fixed(kbps);
+    } else if (has_mode) {
+        bitrate_.set_mode(mode);
+    }
+
+    return get_encoder();
+}
+
+HttpResponse AdminApi::switch_source(const std::string& body) {
+    json request = json::parse(body);
+
+    AppConfig next = reloader_.current();
+    if (request.contains("url")) next.rtsp.url = request["url"].get<std::string>();
+    if (request.contains("replay_file")) next.replay.file = request["replay_file"].get<std::string>();
+    if (request.contains("replay_speed")) next.replay.speed = request["replay_speed"].get<double>();
+    if (request.contains("passthrough")) next.encoding.passthrough = request["passthrough"].get<bool>();
+    if (request.contains("hw_encode")) next.encoding.hw_encode = request["hw_encode"].get<bool>();
+    if (request.contains("encoder")) next.encoding.encoder = request["encoder"].get<std::string>();
+    if (request.contains("intra_refresh")) next.encoding.intra_refresh = request["intra_refresh"].get<bool>();
+    if (request.contains("per_peer")) next.encoding.per_peer.enabled = request["per_peer"].get<bool>();
+    if (request.contains("latency_budget_ms")) {
+        int budget = request["latency_budget_ms"].get<int>();
+        if (budget < 0) {
+            return error(400, "Bad Request", "latency_budget_ms must not be negative");
+        }
+        next.encoding.latency_budget_ms = budget;
+    }
+    if (!launch_value_safe(next.rtsp.url) || !launch_value_safe(next.replay.file)) {
+        return error(400, "Bad Request", "url and replay_file must not contain quotes, '!' or whitespace");
+    }
+
+    spdlog::warn("Admin: Switching source to {} ({})",
+                 !next.replay.file.empty() ? "replay " + next.replay.file
+                 : next.rtsp.url.empty() ? std::string("(test mode)") : redact_url(next.rtsp.url),
+                 next.encoding.passthrough ? "passthrough" : "re-encode");
+    reloader_.apply(next);
+    return pipeline_state();
+}
+
+HttpResponse AdminApi::set_session_setup(const std::string& body) {
+    json request = json::parse(body);
+
+    AppConfig next = reloader_.current();
+    if (request.contains("trickle_ice")) next.webrtc.trickle_ice = request["trickle_ice"].get<bool>();
+    if (request.contains("gop_cache")) next.webrtc.gop_cache = request["gop_cache"].get<bool>();
+    if (request.contains("peer_pool_size")) {
+        int size = request["peer_pool_size"].get<int>();
+        if (size < 0) {
+            return error(400, "Bad Request", "peer_pool_size must not be negative");
+        }
+        next.webrtc.peer_pool_size = size;
+    }
+
+    spdlog::warn("Admin: Session setup: trickle ICE {}, GOP cache {}, peer pool {}",
+                 next.webrtc.trickle_ice ? "on" : "off", next.webrtc.gop_cache ? "on" : "off",
+                 next.webrtc.peer_pool_size);
+    reloader_.apply(next);
+    return session_setup();
+}
+
+HttpResponse AdminApi::session_setup() {
+    AppConfig config = reloader_.current();
+    return ok({
+        {"trickle_ice", config.webrtc.trickle_ice},
+        {"gop_cache", config.webrtc.gop_cache},
+        {"peer_pool_size", config.webrtc.peer_pool_size},
+        {"pooled_peers", webrtc_.pooled_count()},
+    });
+}
+
+HttpResponse AdminApi::pipeline_state() {
+    AppConfig config = reloader_.current();
+    auto stats = pipeline_.get_stats();
+    auto server = webrtc_.get_stats();
+
+    std::string mode = config.encoding.passthrough ? "passthrough"
+                     : stats.encoder_hardware ? "hw-encode" : "sw-encode";
+
+    // CPU per encode resolution: compare rungs to see what scaling saves
+    json scale_times = json::array();
+    for (auto& t : stats.scale_times) {
+        scale_times.push_back({
+            {"resolution", t.resolution},
+            {"seconds", t.seconds},
+            {"cpu_percent", t.seconds > 0 ? t.cpu_seconds / t.seconds * 100.0 : 0.0},
+        });
+    }
+
+    auto roi = pipeline_.roi_streams().get_stats();
+    json roi_streams = json::array();
+    for (auto& r : roi.streams) {
+        roi_streams.push_back({
+            {"stream", r.stream},
+            {"crop", r.crop},
+            {"output", r.output},
+            {"viewers", r.viewers},
+            {"frames", r.frames},
+            {"bytes", r.bytes},
+        });
+    }
+    auto per_peer = pipeline_.peer_encoders().get_stats();
+    json peer_encoders = json::array();
+    for (auto& e : per_peer.encoders) {
+        peer_encoders.push_back({
+            {"peer_id", e.peer_id},
+            {"bitrate_kbps", e.bitrate_kbps},
+            {"frames", e.frames},
+            {"bytes", e.bytes},
+        });
+    }
+    auto preview = pipeline_.preview().get_stats();
+    auto mosaic = mosaic_.get_stats();
+    return ok({
+        {"running", pipeline_.is_running()},
+        {"reconnecting", pipeline_.reconnecting()},
+        {"connected", stats.connected},
+        {"source", !config.replay.file.empty() ? "replay:" + config.replay.file
+                   : config.rtsp.url.empty() ? std::string("test") : redact_url(config.rtsp.url)},
+        {"transport", config.rtsp.transport},
+        {"mode", mode},
+        {"encoder", stats.encoder},
+        {"encoder_kbps", stats.encoder_bitrate_kbps},
+        {"scaling", {
+            {"enabled", config.encoding.scaling.enabled},
+            {"resolution", stats.encode_resolution.empty() ? "source" : stats.encode_resolution},
+            {"time", scale_times},
+        }},
+        {"roi", {
+            {"enabled", roi.enabled},
+            {"max_encodes", roi.max_encodes},
+            {"streams", roi_streams},
+            {"created", roi.branches_created},
+            {"retargeted", roi.branches_retargeted},
+            {"removed", roi.branches_removed},
+            {"rejected", roi.rejected},
+        }},
+        {"per_peer", {
+            {"enabled", per_peer.enabled},
+            {"max_encoders", per_peer.max_encoders},
+            {"cpu_budget_percent", per_peer.cpu_budget_percent},
+            {"cpu_percent", per_peer.cpu_percent},
+            {"encoder_cost_percent", per_peer.encoder_cost_percent},
+            {"encoders", peer_encoders},
+            {"admitted", per_peer.admitted},
+            {"returned", per_peer.returned},
+        }},
+        {"timestamps", {
+            {"mode", stats.timestamps.mode},
+            {"interval_ms", stats.timestamps.interval_ms},
+            {"input_jitter_ms", stats.timestamps.input_jitter_ms},
+            {"output_jitter_ms", stats.timestamps.output_jitter_ms},
+            {"offset_ms", stats.timestamps.offset_ms},
+            {"resyncs", stats.timestamps.resyncs},
+        }},
+        {"capture_clock", {
+            {"mode", stats.capture.mode},
+            {"synced", stats.capture.synced},
+            {"sender_reports", stats.capture.sender_reports},
+            {"camera_offset_ms", stats.capture.camera_offset_ms},
+            {"delay_ms", stats.capture.delay_ms},
+        }},
+        {"preview", {
+            {"enabled", preview.enabled},
+            {"source", preview.source},
+            {"running", preview.running},
+            {"output", preview.output},
+            {"viewers", preview.viewers},
+            {"builds", preview.builds},
+            {"frames", preview.frames},
+            {"bytes", preview.bytes},
+        }},
+        {"mosaic", {
+            {"enabled", mosaic.enabled},
+            {"running", mosaic.running},
+            {"tiles", mosaic.tiles},
+            {"tiles_down", mosaic.tiles_down},
+            {"tile_size", mosaic.tile_size},
+            {"viewers", mosaic.viewers},
+            {"builds", mosaic.builds},
+            {"frames", mosaic.frames},
+            {"bytes", mosaic.bytes},
+        }},
+        {"frames_received", stats.frames_received},
+        {"bytes_received", stats.bytes_received},
+        {"audio_frames", stats.audio_frames},
+        {"reconnect_count", stats.reconnect_count},
+        {"stalls", stats.stalls},
+        {"keyframe_requests", stats.keyframe_requests},
+        {"keyframe_requests_from_peers", server.keyframe_requests},
+        {"keyframes_forced_for_peers", server.keyframes_forced},
+        {"source_format", stats.source_format},
+        {"format_changes", stats.format_changes},
+        {"renegotiations", server.renegotiations},
+        {"intra_refresh", config.encoding.intra_refresh},
+        {"replay_loops", stats.replay_loops},
+        {"peers", server.total_peers},
+        {"connected_peers", server.connected_peers},
+    });
+}
+
+HttpResponse AdminApi::restart_pipeline() {
+    // Same restart the watchdog gives a dead pipeline thread
+    spdlog::warn("Admin: Restarting pipeline");
+    if (!pipeline_.restart()) {
+        return error(500, "Internal Server Error", "pipeline failed to start, watchdog will retry");
+    }
+    return pipeline_state();
+}
+
+HttpResponse AdminApi::process_state() {
+    ProcStats::Sample sample;
+    {
+        std::lock_guard<std::mutex> lock(process_mutex_);
+        sample = process_.sample();
+    }
+    auto heap = ProcStats::heap();
+
+    json body = {
+        {"cpu_percent", sample.cpu_percent},
+        {"rss_kb", sample.rss_kb},
+        {"threads", sample.threads},
+        {"open_fds", sample.open_fds},
+    };
+    if (heap.valid) {
+        body["heap"] = {
+            {"in_use_kb", heap.in_use_kb},
+            {"free_kb", heap.free_kb},
+            {"mmap_kb", heap.mmap_kb},
+        };
+    }
+    return ok(body);
+}
+
+HttpResponse AdminApi::reload() {
+    if (!reloader_.reload()) {
+        return error(500, "Internal Server Error", "config reload failed, see logs");
+    }
+    return ok({{"reloaded", true}});
+}
+
+} // namespace ss
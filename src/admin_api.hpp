@@ -0,0 +1,74 @@
+#pragma once
+
+#include "http_server.hpp"
+#include "proc_stats.hpp"
+#include <mutex>
+#include <string>
+
+namespace ss {
+
+class WebRtcServer;
+class SignalingServer;
+class RtspPipeline;
+class BitratePolicy;
+class ConfigReloader;
+class MosaicStream;
+
+// Authenticated JSON endpoints for inspecting and steering a running server.
+// Mounted on the HTTP server under /api/:
+//
+//   GET    /api/peers              peers with media and transport stats
+//   DELETE /api/peers/<id>         evict a peer
+//   POST   /api/keyframe           force an IDR
+//   GET    /api/encoder            bitrate policy, current rate and frame budget
+//   POST   /api/encoder            {"bitrate_kbps": N} (pins it: policy fixed) or
+//                                   {"policy": "adaptive"|"fixed"}; a bitrate
+//                                   with "adaptive" is a 400
+//   POST   /api/source             {"url", "replay_file", "replay_speed", "passthrough",
+//                                   "hw_encode", "encoder", "intra_refresh",
+//                                   "latency_budget_ms"} — rebuilds the pipeline
+//   GET    /api/webrtc             session setup for new peers and idle pooled peers
+//   POST   /api/webrtc             {"trickle_ice", "gop_cache", "peer_pool_size"}
+//   GET    /api/pipeline           pipeline state and counters
+//   POST   /api/pipeline/restart   tear the pipeline down and rebuild it
+//   GET    /api/process            RSS, fds, threads, CPU and allocator stats
+//   POST   /api/reload             re-read the config file
+class AdminApi {
+public:
+    AdminApi(WebRtcServer& webrtc, SignalingServer& signaling, RtspPipeline& pipeline,
+             BitratePolicy& bitrate, ConfigReloader& reloader, MosaicStream& mosaic);
+
+    // Non-copyable
+    AdminApi(const AdminApi&) = delete;
+    AdminApi& operator=(const AdminApi&) = delete;
+
+    HttpResponse handle(const HttpRequest& request);
+
+private:
+    bool authorized(const HttpRequest& request) const;
+
+    HttpResponse list_peers();
+    HttpResponse evict_peer(const std::string& peer_id);
+    HttpResponse force_keyframe();
+    HttpResponse get_encoder();
+    HttpResponse set_encoder(const std::string& body);
+    HttpResponse switch_source(const std::string& body);
+    HttpResponse session_setup();
+    HttpResponse set_session_setup(const std::string& body);
+    HttpResponse pipeline_state();
+    HttpResponse restart_pipeline();
+    HttpResponse process_state();
+    HttpResponse reload();
+
+    WebRtcServer& webrtc_;
+    SignalingServer& signaling_;
+    RtspPipeline& pipeline_;
+    BitratePolicy& bitrate_;
+    ConfigReloader& reloader_;
+    MosaicStream& mosaic_;
+
+    std::mutex process_mutex_;
+    ProcStats process_;         // CPU is measured between calls
+};
+
+} // namespace ss
@@ -0,0 +1,136 @@
+#include "bitrate_policy.hpp"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace ss {
+
+// Complexity-driven changes smaller than this are not worth an encoder
+// reconfiguration (and with scaling, possibly a resolution change)
+static constexpr double min_content_step = 0.05;
+
+BitratePolicy::BitratePolicy(const AppConfig& config, ApplyCallback apply)
+    : apply_(std::move(apply))
+    , current_kbps_(config.webrtc.video.bitrate_kbps)
+    , nominal_kbps_(config.webrtc.video.bitrate_kbps)
+    , max_kbps_(config.webrtc.video.max_bitrate_kbps)
+    , content_(config.encoding.content_adaptive)
+{
+}
+
+int BitratePolicy::content_kbps() const {
+    if (!content_.enabled || !scored_) return 0;
+    double factor = content_.static_factor +
+                    score_ * (content_.motion_factor - content_.static_factor);
+    return static_cast<int>(std::lround(nominal_kbps_ * factor));
+}
+
+int BitratePolicy::adaptive_target() const {
+    int content_kbps = this->content_kbps();
+    if (content_kbps <= 0) return abr_kbps_ > 0 ? abr_kbps_ : nominal_kbps_;
+
+    // The ABR estimate is the budget; before the first one, max_bitrate_kbps is
+    int budget = abr_kbps_ > 0 ? abr_kbps_ : max_kbps_;
+    return std::min(content_kbps, budget);
+}
+
+void BitratePolicy::on_peer_request(int bitrate_kbps) {
+    int target;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (mode_ != Mode::Adaptive) return;
+        abr_kbps_ = bitrate_kbps;
+        target = adaptive_target();
+        current_kbps_ = target;
+    }
+    if (apply_) apply_(target);
+}
+
+void BitratePolicy::on_complexity(double score) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    score_ = score;
+    scored_ = true;
+    score_pending_ = true;
+}
+
+void BitratePolicy::tick() {
+    int target;
+    double score;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!score_pending_) return;
+        score_pending_ = false;
+        if (mode_ != Mode::Adaptive || !content_.enabled) return;
+        target = adaptive_target();
+        if (std::abs(target - current_kbps_) < current_kbps_ * min_content_step) return;
+        current_kbps_ = target;
+        score = score_;
+    }
+    spdlog::debug("Bitrate policy: scene complexity {:.2f} → {} kbps", score, target);
+    if (apply_) apply_(target);
+}
+
+void BitratePolicy::set_fixed(int bitrate_kbps) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        mode_ = Mode::Fixed;
+        current_kbps_ = bitrate_kbps;
+    }
+    spdlog::info("Bitrate policy: fixed at {} kbps", bitrate_kbps);
+    if (apply_) apply_(bitrate_kbps);
+}
+
+void BitratePolicy::set_mode(Mode mode) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (mode_ == mode) return;
+    mode_ = mode;
+    spdlog::info("Bitrate policy: {}", mode_name(mode));
+}
+
+BitratePolicy::Mode BitratePolicy::mode() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return mode_;
+}
+
+void BitratePolicy::update_config(const AppConfig& config) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    nominal_kbps_ = config.webrtc.video.bitrate_kbps;
+    max_kbps_ = config.webrtc.video.max_bitrate_kbps;
+    if (content_.enabled != config.encoding.content_adaptive.enabled) {
+        spdlog::info("Bitrate policy: content-adaptive {}",
+                     config.encoding.content_adaptive.enabled ? "on" : "off");
+    }
+    content_ = config.encoding.content_adaptive;
+}
+
+int BitratePolicy::current_kbps() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return current_kbps_;
+}
+
+BitratePolicy::ContentState BitratePolicy::content_state() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ContentState state;
+    state.enabled = content_.enabled;
+    state.score = score_;
+    state.content_kbps = content_kbps();
+    state.abr_kbps = abr_kbps_;
+    return state;
+}
+
+const char* BitratePolicy::mode_name(Mode mode) {
+    switch (mode) {
+        case Mode::Adaptive: return "adaptive";
+        case Mode::Fixed:    return "fixed";
+    }
+    return "unknown";
+}
+
+bool BitratePolicy::parse_mode(const std::string& name, Mode& mode) {
+    if (name == "adaptive") { mode = Mode::Adaptive; return true; }
+    if (name == "fixed")    { mode = Mode::Fixed; return true; }
+    return false;
+}
+
+} // namespace ss
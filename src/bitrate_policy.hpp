@@ -0,0 +1,85 @@
+#pragma once
+
+#include "config.hpp"
+#include <functional>
+#include <mutex>
+#include <string>
+
+namespace ss {
+
+// Decides the encoder bitrate. Browser ABR requests and operator overrides
+// both go through here, so an operator can pin the rate without a viewer's
+// next ABR request undoing it.
+//
+// With encoding.content_adaptive the adaptive rate also follows the scene:
+// bitrate_kbps is scaled from static_factor (nothing moves) to
+// motion_factor (full motion), never above the last ABR request, which
+// stays the network's budget.
+class BitratePolicy {
+public:
+    enum class Mode {
+        Adaptive,  // follow browser ABR requests (and scene complexity)
+        Fixed,     // hold the operator's rate, ignore ABR requests
+    };
+
+    using ApplyCallback = std::function<void(int bitrate_kbps)>;
+
+    BitratePolicy(const AppConfig& config, ApplyCallback apply);
+
+    // Non-copyable
+    BitratePolicy(const BitratePolicy&) = delete;
+    BitratePolicy& operator=(const BitratePolicy&) = delete;
+
+    // ABR request from a viewer
+    void on_peer_request(int bitrate_kbps);
+
+    // Scene complexity estimate, 0 = static … 1 = full motion. Only
+    // recorded: it arrives on a GStreamer streaming thread, which must not
+    // reconfigure the encoder it is feeding.
+    void on_complexity(double score);
+
+    // Apply the latest complexity estimate, if any; called from the main loop
+    void tick();
+
+    // Operator override: switches to Fixed and applies the rate
+    void set_fixed(int bitrate_kbps);
+
+    void set_mode(Mode mode);
+    Mode mode() const;
+
+    // Nominal rate and content_adaptive settings
+    void update_config(const AppConfig& config);
+
+    // Last rate handed to the encoder (before the pipeline's min/max clamp)
+    int current_kbps() const;
+
+    struct ContentState {
+        bool enabled = false;
+        double score = 0.0;       // last complexity estimate
+        int content_kbps = 0;     // rate the scene asks for, 0 = no estimate yet
+        int abr_kbps = 0;         // last ABR request, 0 = none yet
+    };
+    ContentState content_state() const;
+
+    static const char* mode_name(Mode mode);
+    static bool parse_mode(const std::string& name, Mode& mode);
+
+private:
+    int content_kbps() const;      // mutex_ held, 0 = no estimate
+    int adaptive_target() const;   // mutex_ held
+
+    ApplyCallback apply_;
+
+    mutable std::mutex mutex_;
+    Mode mode_ = Mode::Adaptive;
+    int current_kbps_;
+    int nominal_kbps_;
+    int max_kbps_;
+    ContentAdaptiveConfig content_;
+    double score_ = 0.0;
+    bool scored_ = false;
+    bool score_pending_ = false;   // estimate not yet applied by tick()
+    int abr_kbps_ = 0;
+};
+
+} // namespace ss
@@ -0,0 +1,206 @@
+#include "branch_tap.hpp"
+#include <gst/video/video.h>
+#include <spdlog/spdlog.h>
+
+namespace ss {
+
+// ─── Removal ───────────────────────────────────────────────────────────────────
+
+namespace {
+
+// A branch or the passthrough decoder being unlinked from its tee. The idle
+// probe runs once no buffer is passing through the tee pad, possibly on a
+// streaming thread, so it owns everything it touches.
+struct Removal {
+    GstElement* pipeline;
+    GstElement* tee;
+    GstElement* bin;
+    GstElement* downstream;         // decoder: the tee it feeds, removed along with it
+    std::shared_ptr<void> keep;     // what the branch's appsink callback points at
+
+    Removal(GstElement* p, GstElement* t, GstElement* b, GstElement* d, std::shared_ptr<void> k)
+        : pipeline(static_cast<GstElement*>(gst_object_ref(p)))
+        , tee(static_cast<GstElement*>(gst_object_ref(t)))
+        , bin(b)
+        , downstream(d)
+        , keep(std::move(k))
+    {
+    }
+
+    ~Removal() {
+        gst_object_unref(tee);
+        gst_object_unref(pipeline);
+    }
+};
+
+GstPadProbeReturn unlink_when_idle(GstPad* pad, GstPadProbeInfo*, gpointer user_data) {
+    auto* removal = static_cast<Removal*>(user_data);
+    GstPad* sink = gst_element_get_static_pad(removal->bin, "sink");
+    if (sink) {
+        gst_pad_unlink(pad, sink);
+        gst_object_unref(sink);
+    }
+    gst_element_release_request_pad(removal->tee, pad);
+    gst_object_unref(pad);  // the reference request_pad_simple returned
+
+    gst_element_set_state(removal->bin, GST_STATE_NULL);
+    gst_bin_remove(GST_BIN(removal->pipeline), removal->bin);
+    if (removal->downstream) {
+        gst_element_set_state(removal->downstream, GST_STATE_NULL);
+        gst_bin_remove(GST_BIN(removal->pipeline), removal->downstream);
+    }
+    return GST_PAD_PROBE_REMOVE;
+}
+
+// Idle branches stop feeding their encoder until they are reused
+GstPadProbeReturn drop_while_paused(GstPad*, GstPadProbeInfo*, gpointer user_data) {
+    auto* paused = static_cast<std::atomic<bool>*>(user_data);
+    return paused->load(std::memory_order_relaxed) ? GST_PAD_PROBE_DROP : GST_PAD_PROBE_OK;
+}
+
+} // namespace
+
+BranchTap::~BranchTap() {
+    detach();
+}
+
+// ─── Pipeline lifecycle ────────────────────────────────────────────────────────
+
+void BranchTap::attach(GstElement* pipeline, const std::string& decoder) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pipeline_ = pipeline;
+    decoder_desc_ = decoder;
+    links_ = 0;
+    tee_ = gst_bin_get_by_name(GST_BIN(pipeline_), "branchtee");
+    if (tee_) gst_object_unref(tee_);   // owned by the pipeline
+}
+
+void BranchTap::detach() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pipeline_ = nullptr;
+    tee_ = nullptr;
+    decoder_ = nullptr;
+    decoded_tee_ = nullptr;
+    if (decoder_pad_) {
+        gst_object_unref(decoder_pad_);
+        decoder_pad_ = nullptr;
+    }
+    links_ = 0;
+}
+
+bool BranchTap::attached() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pipeline_ && tee_;
+}
+
+Resolution BranchTap::source_resolution() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Resolution source;
+    if (!tee_) return source;
+    GstPad* pad = gst_element_get_static_pad(tee_, "sink");
+    if (!pad) return source;
+    GstCaps* caps = gst_pad_get_current_caps(pad);
+    if (caps) {
+        // h264parse puts the coded size on the caps too
+        GstStructure* s = gst_caps_get_structure(caps, 0);
+        gst_structure_get_int(s, "width", &source.width);
+        gst_structure_get_int(s, "height", &source.height);
+        gst_caps_unref(caps);
+    }
+    gst_object_unref(pad);
+    return source;
+}
+
+// ─── Branches ──────────────────────────────────────────────────────────────────
+
+GstElement* BranchTap::raw_tee() const {
+    return decoder_desc_.empty() ? tee_ : decoded_tee_;
+}
+
+bool BranchTap::attach_decoder() {
+    if (decoder_) return true;
+
+    GError* error = nullptr;
+    std::string desc = "queue leaky=downstream max-size-buffers=5 max-size-bytes=0 max-size-time=0 ! " +
+                       decoder_desc_;
+    decoder_ = gst_parse_bin_from_description(desc.c_str(), TRUE, &error);
+    if (error) {
+        spdlog::error("Branch decoder: {}", error->message);
+        g_error_free(error);
+        decoder_ = nullptr;
+        return false;
+    }
+    decoded_tee_ = gst_element_factory_make("tee", nullptr);
+    g_object_set(G_OBJECT(decoded_tee_), "allow-not-linked", TRUE, nullptr);
+    gst_bin_add(GST_BIN(pipeline_), decoder_);
+    gst_bin_add(GST_BIN(pipeline_), decoded_tee_);
+
+    GstPad* decoded = gst_element_get_static_pad(decoder_, "src");
+    GstPad* tee_sink = gst_element_get_static_pad(decoded_tee_, "sink");
+    gst_pad_link(decoded, tee_sink);
+    gst_object_unref(tee_sink);
+    gst_object_unref(decoded);
+
+    decoder_pad_ = gst_element_request_pad_simple(tee_, "src_%u");
+    GstPad* decoder_sink = gst_element_get_static_pad(decoder_, "sink");
+    gst_pad_link(decoder_pad_, decoder_sink);
+    gst_object_unref(decoder_sink);
+
+    gst_element_sync_state_with_parent(decoded_tee_);
+    gst_element_sync_state_with_parent(decoder_);
+
+    // The decoder starts mid-GOP; ask the camera for an IDR rather than
+    // wait out its keyframe interval
+    gst_pad_send_event(decoder_pad_, gst_video_event_new_upstream_force_key_unit(
+        GST_CLOCK_TIME_NONE, TRUE, 0));
+    spdlog::info("Branch tap: decoder added for passthrough source");
+    return true;
+}
+
+bool BranchTap::link(GstElement* bin, std::atomic<bool>* paused, GstPad*& tee_pad) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!pipeline_ || !tee_) return false;
+    if (!decoder_desc_.empty() && !attach_decoder()) return false;
+
+    gst_bin_add(GST_BIN(pipeline_), bin);
+    tee_pad = gst_element_request_pad_simple(raw_tee(), "src_%u");
+    if (paused) {
+        gst_pad_add_probe(tee_pad, GST_PAD_PROBE_TYPE_BUFFER, &drop_while_paused, paused, nullptr);
+    }
+    GstPad* sink = gst_element_get_static_pad(bin, "sink");
+    gst_pad_link(tee_pad, sink);
+    gst_object_unref(sink);
+    gst_element_sync_state_with_parent(bin);
+    links_++;
+    return true;
+}
+
+void BranchTap::unlink(GstPad* tee_pad, GstElement* bin, std::shared_ptr<void> keep,
+                       std::vector<Unlink>& unlinks) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!pipeline_) {
+        // Detached: the bin went down with the pipeline
+        if (tee_pad) gst_object_unref(tee_pad);
+        return;
+    }
+    unlinks.push_back({tee_pad, new Removal(pipeline_, raw_tee(), bin, nullptr, std::move(keep))});
+    if (links_ > 0) links_--;
+
+    if (links_ == 0 && decoder_) {
+        unlinks.push_back({decoder_pad_, new Removal(pipeline_, tee_, decoder_, decoded_tee_, nullptr)});
+        decoder_ = nullptr;
+        decoded_tee_ = nullptr;
+        decoder_pad_ = nullptr;
+        spdlog::info("Branch tap: decoder removed");
+    }
+}
+
+void BranchTap::run(std::vector<Unlink>& unlinks) {
+    for (auto& unlink : unlinks) {
+        gst_pad_add_probe(unlink.pad, GST_PAD_PROBE_TYPE_IDLE, &unlink_when_idle, unlink.removal,
+                          [](gpointer p) { delete static_cast<Removal*>(p); });
+    }
+    unlinks.clear();
+}
+
+} // namespace ss
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "config.hpp"
+#include "scaling_policy.hpp"
+#include "video_encoder.hpp"
+#include <gst/gst.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace ss {
+
+// How extra encoders (ROI crops, per-peer encodes) are built for the
+// current pipeline
+struct BranchEncode {
+    EncodingConfig encoding;
+    VideoConfig video;
+    VideoEncoder encoder;
+    bool nvmm = false;              // tap carries Jetson NVMM frames
+};
+
+// Where extra encoders tap the decoded video: the pipeline's "branchtee".
+// In passthrough the tee carries H.264, and a decoder is added behind it
+// while at least one branch is linked, so every branch shares one decode.
+//
+// Branches are bins added to the running pipeline and fed through a tee
+// request pad; removing one waits until no buffer is passing through it.
+class BranchTap {
+public:
+    BranchTap() = default;
+    ~BranchTap();
+
+    // Non-copyable
+    BranchTap(const BranchTap&) = delete;
+    BranchTap& operator=(const BranchTap&) = delete;
+
+    // A pipeline was built; `decoder` is the passthrough decoder fragment
+    // ("" = the tee already carries raw frames). No tee, nothing to tap.
+    void attach(GstElement* pipeline, const std::string& decoder);
+
+    // The pipeline is about to be torn down (branches and decoder go with it)
+    void detach();
+
+    bool attached() const;
+
+    // Size of the video at the tee, empty until caps are negotiated
+    Resolution source_resolution() const;
+
+    // Add `bin` (one sink pad) to the pipeline and feed it decoded frames.
+    // Frames are dropped at the tee while `*paused` is set. `tee_pad` gets
+    // a reference the caller hands back to unlink().
+    bool link(GstElement* bin, std::atomic<bool>* paused, GstPad*& tee_pad);
+
+    // A pad whose idle probe removes a linked bin
+    struct Unlink {
+        GstPad* pad;
+        void* removal;
+    };
+
+    // Queue removal of a linked bin; `keep` lives until it is gone (e.g.
+    // what its appsink callback points at). The last one takes the
+    // passthrough decoder along.
+    void unlink(GstPad* tee_pad, GstElement* bin, std::shared_ptr<void> keep,
+                std::vector<Unlink>& unlinks);
+
+    // Start queued removals. Call without holding any lock a branch's
+    // streaming thread takes: the probe may run right away and stop it.
+    static void run(std::vector<Unlink>& unlinks);
+
+private:
+    GstElement* raw_tee() const;    // mutex_ held
+    bool attach_decoder();          // mutex_ held
+
+    mutable std::mutex mutex_;
+    GstElement* pipeline_ = nullptr;
+    GstElement* tee_ = nullptr;             // "branchtee", owned by the pipeline
+    std::string decoder_desc_;
+    GstElement* decoder_ = nullptr;         // passthrough: tee_ → decoder → decoded_tee_
+    GstElement* decoded_tee_ = nullptr;
+    GstPad* decoder_pad_ = nullptr;
+    size_t links_ = 0;
+};
+
+} // namespace ss
@@ -0,0 +1,168 @@
+#include "capture_clock.hpp"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+
+namespace ss {
+
+// Seconds from the NTP epoch (1900) to the Unix epoch
+static constexpr uint64_t ntp_unix_offset_s = 2'208'988'800ULL;
+
+static int64_t to_unix_us(std::chrono::system_clock::time_point t) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(t.time_since_epoch()).count();
+}
+
+CaptureClock::CaptureClock(const RtspConfig& config)
+    : config_(config)
+{
+    reset();
+}
+
+void CaptureClock::update_config(const RtspConfig& config) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    config_ = config;
+}
+
+void CaptureClock::reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    mode_ = config_.capture_clock;
+    if (mode_ != "off" && mode_ != "camera" && mode_ != "aligned") {
+        spdlog::warn("Unknown rtsp.capture_clock '{}', turning it off", mode_);
+        mode_ = "off";
+    }
+    reports_.clear();
+    has_video_ssrc_ = false;
+    has_window_ = false;
+    has_previous_ = false;
+    has_delay_ = false;
+    delay_us_ = 0.0;
+}
+
+bool CaptureClock::enabled() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return mode_ != "off";
+}
+
+uint64_t CaptureClock::ntp_to_unix_us(uint64_t ntp_time) {
+    uint64_t seconds = ntp_time >> 32;
+    uint64_t fraction = ntp_time & 0xFFFFFFFFULL;
+    if (seconds < ntp_unix_offset_s) return 0;
+    return (seconds - ntp_unix_offset_s) * 1'000'000 + ((fraction * 1'000'000) >> 32);
+}
+
+uint64_t CaptureClock::unix_us_to_ntp(uint64_t unix_us) {
+    uint64_t seconds = unix_us / 1'000'000 + ntp_unix_offset_s;
+    uint64_t fraction = ((unix_us % 1'000'000) << 32) / 1'000'000;
+    return (seconds << 32) | fraction;
+}
+
+// ─── Camera clock ──────────────────────────────────────────────────────────────
+
+void CaptureClock::on_sender_report(uint32_t ssrc, uint64_t ntp_time, uint32_t rtp_timestamp) {
+    uint64_t unix_us = ntp_to_unix_us(ntp_time);
+    if (unix_us == 0) return;   // no wall clock on the camera
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (mode_ == "off") return;
+
+    auto it = reports_.find(ssrc);
+    if (it != reports_.end() && it->second.unix_us == static_cast<int64_t>(unix_us) &&
+        it->second.rtp_timestamp == rtp_timestamp) {
+        return;     // the same report again
+    }
+    if (it == reports_.end()) {
+        spdlog::info("Sender reports from camera SSRC {:08x}", ssrc);
+    }
+    reports_[ssrc] = {static_cast<int64_t>(unix_us), rtp_timestamp};
+    sender_reports_++;
+}
+
+bool CaptureClock::camera_time(uint32_t rtp_timestamp, int64_t& camera_us) const {
+    if (!has_video_ssrc_) return false;
+    auto it = reports_.find(video_ssrc_);
+    if (it == reports_.end()) return false;
+
+    // RTP timestamps wrap; frames are within seconds of the report
+    auto ticks = static_cast<int64_t>(static_cast<int32_t>(rtp_timestamp - it->second.rtp_timestamp));
+    camera_us = it->second.unix_us + ticks * 1'000'000 / rtp_clock_rate;
+    return true;
+}
+
+int64_t CaptureClock::offset_us() const {
+    if (mode_ != "aligned") return 0;
+    return has_previous_ ? std::min(window_min_us_, previous_min_us_) : window_min_us_;
+}
+
+void CaptureClock::on_rtp(uint32_t ssrc, uint32_t rtp_timestamp,
+                          std::chrono::system_clock::time_point arrival) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (mode_ == "off") return;
+
+    if (!has_video_ssrc_ || ssrc != video_ssrc_) {
+        // New video source: its clock has nothing to do with the last one
+        video_ssrc_ = ssrc;
+        has_video_ssrc_ = true;
+        has_window_ = false;
+        has_previous_ = false;
+    }
+
+    int64_t camera_us = 0;
+    if (!camera_time(rtp_timestamp, camera_us)) return;
+
+    // The least delayed packet bounds the offset: camera clock error plus
+    // the network's minimum transit
+    int64_t now_us = to_unix_us(arrival);
+    int64_t difference = now_us - camera_us;
+    if (!has_window_ || now_us - window_start_us_ >= offset_window_us) {
+        if (has_window_) {
+            previous_min_us_ = window_min_us_;
+            has_previous_ = true;
+        }
+        window_start_us_ = now_us;
+        window_min_us_ = difference;
+        has_window_ = true;
+    } else {
+        window_min_us_ = std::min(window_min_us_, difference);
+    }
+}
+
+// ─── Frames ────────────────────────────────────────────────────────────────────
+
+bool CaptureClock::capture_time(uint32_t rtp_timestamp, uint64_t& capture_us,
+                                std::chrono::system_clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (mode_ == "off") return false;
+
+    int64_t camera_us = 0;
+    if (!camera_time(rtp_timestamp, camera_us)) return false;
+    if (mode_ == "aligned" && !has_window_) return false;
+
+    int64_t capture = camera_us + offset_us();
+    if (capture <= 0) return false;
+
+    double delay = static_cast<double>(to_unix_us(now) - capture);
+    if (!has_delay_) {
+        delay_us_ = delay;
+        has_delay_ = true;
+    } else {
+        delay_us_ += (delay - delay_us_) / 16.0;
+    }
+
+    capture_us = static_cast<uint64_t>(capture);
+    return true;
+}
+
+CaptureClock::Stats CaptureClock::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats;
+    stats.mode = mode_;
+    stats.synced = has_video_ssrc_ && reports_.count(video_ssrc_) > 0;
+    stats.sender_reports = sender_reports_;
+    if (has_window_) {
+        auto offset = has_previous_ ? std::min(window_min_us_, previous_min_us_) : window_min_us_;
+        stats.camera_offset_ms = static_cast<double>(offset) / 1000.0;
+    }
+    stats.delay_ms = delay_us_ / 1000.0;
+    return stats;
+}
+
+} // namespace ss
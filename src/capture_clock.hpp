@@ -0,0 +1,91 @@
+#pragma once
+
+#include "config.hpp"
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace ss {
+
+// Wall-clock capture time of camera frames (rtsp.capture_clock), from the
+// NTP↔RTP pairs in the camera's RTCP sender reports.
+//
+//   camera   the camera's NTP clock as is (NTP synced cameras)
+//   aligned  the camera's clock moved onto the host's by the smallest
+//            arrival-minus-capture difference over the last 10-20 s, so
+//            the fastest packet reads as having no transit delay at all
+//
+// Sender reports arrive on rtpbin's RTCP thread, packets at the
+// depayloader and frames at the appsink, each on a thread of its own.
+class CaptureClock {
+public:
+    struct Stats {
+        std::string mode;
+        bool synced = false;            // a sender report for the video
+        uint64_t sender_reports = 0;
+        double camera_offset_ms = 0.0;  // smallest arrival minus camera capture time
+        double delay_ms = 0.0;          // appsink delivery minus capture, smoothed
+    };
+
+    explicit CaptureClock(const RtspConfig& config);
+
+    // Takes effect at the next reset()
+    void update_config(const RtspConfig& config);
+
+    // New pipeline: forget the camera's reports and offset
+    void reset();
+
+    bool enabled() const;
+
+    // A sender report from `ssrc`: its 64-bit NTP time and RTP timestamp
+    void on_sender_report(uint32_t ssrc, uint64_t ntp_time, uint32_t rtp_timestamp);
+
+    // A video RTP packet at the depayloader; feeds the clock offset
+    void on_rtp(uint32_t ssrc, uint32_t rtp_timestamp,
+                std::chrono::system_clock::time_point arrival = std::chrono::system_clock::now());
+
+    // Capture time (µs since the Unix epoch) of the video frame with this
+    // RTP timestamp, delivered at `now`; false until the video has a
+    // sender report
+    bool capture_time(uint32_t rtp_timestamp, uint64_t& capture_us,
+                      std::chrono::system_clock::time_point now = std::chrono::system_clock::now());
+
+    Stats stats() const;
+
+    // 64-bit NTP time ↔ µs since the Unix epoch
+    static uint64_t ntp_to_unix_us(uint64_t ntp_time);
+    static uint64_t unix_us_to_ntp(uint64_t unix_us);
+
+private:
+    static constexpr uint32_t rtp_clock_rate = 90000;
+    static constexpr int64_t offset_window_us = 10'000'000;
+
+    struct SenderReport {
+        int64_t unix_us;
+        uint32_t rtp_timestamp;
+    };
+
+    bool camera_time(uint32_t rtp_timestamp, int64_t& camera_us) const;   // mutex_ held
+    int64_t offset_us() const;                                            // mutex_ held
+
+    mutable std::mutex mutex_;
+    RtspConfig config_;
+    std::string mode_;
+    std::unordered_map<uint32_t, SenderReport> reports_;    // latest per SSRC
+    uint32_t video_ssrc_ = 0;
+    bool has_video_ssrc_ = false;
+    uint64_t sender_reports_ = 0;
+
+    // Arrival minus camera capture: minimum of this window and the last
+    int64_t window_start_us_ = 0;
+    int64_t window_min_us_ = 0;
+    int64_t previous_min_us_ = 0;
+    bool has_window_ = false;
+    bool has_previous_ = false;
+    double delay_us_ = 0.0;
+    bool has_delay_ = false;
+};
+
+} // namespace ss
@@ -1,7 +1,10 @@
 #include "config.hpp"
 #include <yaml-cpp/yaml.h>
+#include <algorithm>
+#include <cctype>
 #include <cstdlib>
 #include <stdexcept>
+#include <tuple>
 
 namespace ss {
 
@@ -39,6 +42,22 @@ AppConfig load_config(const std::string& path) {
         cfg.rtsp.latency_ms = r["latency_ms"].as<int>(cfg.rtsp.latency_ms);
         cfg.rtsp.reconnect_interval_ms = r["reconnect_interval_ms"].as<int>(cfg.rtsp.reconnect_interval_ms);
         cfg.rtsp.reconnect_max_attempts = r["reconnect_max_attempts"].as<int>(cfg.rtsp.reconnect_max_attempts);
+        cfg.rtsp.reconnect_strategy = r["reconnect_strategy"].as<std::string>(cfg.rtsp.reconnect_strategy);
+        cfg.rtsp.reconnect_max_interval_ms = r["reconnect_max_interval_ms"].as<int>(cfg.rtsp.reconnect_max_interval_ms);
+        cfg.rtsp.stall_timeout_ms = r["stall_timeout_ms"].as<int>(cfg.rtsp.stall_timeout_ms);
+        cfg.rtsp.timestamps = r["timestamps"].as<std::string>(cfg.rtsp.timestamps);
+        cfg.rtsp.max_correction_percent = r["max_correction_percent"].as<double>(cfg.rtsp.max_correction_percent);
+        cfg.rtsp.capture_clock = r["capture_clock"].as<std::string>(cfg.rtsp.capture_clock);
+    }
+
+    // Replay
+    if (auto r = root["replay"]) {
+        cfg.replay.file = r["file"].as<std::string>("");
+        cfg.replay.codec = r["codec"].as<std::string>(cfg.replay.codec);
+        cfg.replay.speed = r["speed"].as<double>(cfg.replay.speed);
+        cfg.replay.loop = r["loop"].as<bool>(cfg.replay.loop);
+        cfg.replay.pcap_port = r["pcap_port"].as<uint16_t>(cfg.replay.pcap_port);
+        cfg.replay.pcap_payload_type = r["pcap_payload_type"].as<int>(cfg.replay.pcap_payload_type);
     }
 
     // WebRTC
@@ -48,6 +67,9 @@ AppConfig load_config(const std::string& path) {
         cfg.webrtc.turn_username = w["turn_username"].as<std::string>("");
         cfg.webrtc.turn_credential = w["turn_credential"].as<std::string>("");
         cfg.webrtc.max_peers = w["max_peers"].as<int>(cfg.webrtc.max_peers);
+        cfg.webrtc.trickle_ice = w["trickle_ice"].as<bool>(cfg.webrtc.trickle_ice);
+        cfg.webrtc.gop_cache = w["gop_cache"].as<bool>(cfg.webrtc.gop_cache);
+        cfg.webrtc.peer_pool_size = w["peer_pool_size"].as<int>(cfg.webrtc.peer_pool_size);
 
         if (auto v = w["video"]) {
             cfg.webrtc.video.codec = v["codec"].as<std::string>(cfg.webrtc.video.codec);
@@ -58,15 +80,135 @@ AppConfig load_config(const std::string& path) {
             cfg.webrtc.video.min_bitrate_kbps = v["min_bitrate_kbps"].as<int>(cfg.webrtc.video.min_bitrate_kbps);
             cfg.webrtc.video.fps = v["fps"].as<int>(cfg.webrtc.video.fps);
         }
+
+        if (auto p = w["pacing"]) {
+            cfg.webrtc.pacing.enabled = p["enabled"].as<bool>(cfg.webrtc.pacing.enabled);
+            cfg.webrtc.pacing.rate_factor = p["rate_factor"].as<double>(cfg.webrtc.pacing.rate_factor);
+            cfg.webrtc.pacing.burst_ms = p["burst_ms"].as<int>(cfg.webrtc.pacing.burst_ms);
+        }
+
+        if (auto i = w["impairment"]) {
+            cfg.webrtc.impairment.enabled = i["enabled"].as<bool>(cfg.webrtc.impairment.enabled);
+            cfg.webrtc.impairment.seed = i["seed"].as<uint32_t>(cfg.webrtc.impairment.seed);
+            cfg.webrtc.impairment.loss_model = i["loss_model"].as<std::string>(cfg.webrtc.impairment.loss_model);
+            cfg.webrtc.impairment.loss_percent = i["loss_percent"].as<double>(cfg.webrtc.impairment.loss_percent);
+            cfg.webrtc.impairment.burst_length = i["burst_length"].as<double>(cfg.webrtc.impairment.burst_length);
+            cfg.webrtc.impairment.delay_ms = i["delay_ms"].as<int>(cfg.webrtc.impairment.delay_ms);
+            cfg.webrtc.impairment.jitter_ms = i["jitter_ms"].as<int>(cfg.webrtc.impairment.jitter_ms);
+            cfg.webrtc.impairment.rate_kbps = i["rate_kbps"].as<int>(cfg.webrtc.impairment.rate_kbps);
+            cfg.webrtc.impairment.queue_ms = i["queue_ms"].as<int>(cfg.webrtc.impairment.queue_ms);
+        }
     }
 
     // Encoding
     if (auto e = root["encoding"]) {
         cfg.encoding.hw_encode = e["hw_encode"].as<bool>(cfg.encoding.hw_encode);
+        cfg.encoding.encoder = e["encoder"].as<std::string>(cfg.encoding.encoder);
         cfg.encoding.passthrough = e["passthrough"].as<bool>(cfg.encoding.passthrough);
         cfg.encoding.preset = e["preset"].as<std::string>(cfg.encoding.preset);
         cfg.encoding.idr_interval = e["idr_interval"].as<int>(cfg.encoding.idr_interval);
         cfg.encoding.insert_sps_pps = e["insert_sps_pps"].as<bool>(cfg.encoding.insert_sps_pps);
+        cfg.encoding.intra_refresh = e["intra_refresh"].as<bool>(cfg.encoding.intra_refresh);
+        cfg.encoding.latency_budget_ms = e["latency_budget_ms"].as<int>(cfg.encoding.latency_budget_ms);
+        if (auto s = e["scaling"]) {
+            auto& scaling = cfg.encoding.scaling;
+            scaling.enabled = s["enabled"].as<bool>(scaling.enabled);
+            scaling.ladder = s["ladder"].as<std::vector<std::string>>(scaling.ladder);
+            scaling.min_bits_per_pixel = s["min_bits_per_pixel"].as<double>(scaling.min_bits_per_pixel);
+            scaling.up_bits_per_pixel = s["up_bits_per_pixel"].as<double>(scaling.up_bits_per_pixel);
+        }
+        if (auto c = e["content_adaptive"]) {
+            auto& content = cfg.encoding.content_adaptive;
+            content.enabled = c["enabled"].as<bool>(content.enabled);
+            content.static_ratio = c["static_ratio"].as<double>(content.static_ratio);
+            content.motion_ratio = c["motion_ratio"].as<double>(content.motion_ratio);
+            content.static_factor = c["static_factor"].as<double>(content.static_factor);
+            content.motion_factor = c["motion_factor"].as<double>(content.motion_factor);
+            content.window_ms = c["window_ms"].as<int>(content.window_ms);
+        }
+        if (auto r = e["roi"]) {
+            auto& roi = cfg.encoding.roi;
+            roi.enabled = r["enabled"].as<bool>(roi.enabled);
+            roi.max_encodes = r["max_encodes"].as<int>(roi.max_encodes);
+            roi.max_width = r["max_width"].as<int>(roi.max_width);
+            roi.max_height = r["max_height"].as<int>(roi.max_height);
+            roi.bitrate_kbps = r["bitrate_kbps"].as<int>(roi.bitrate_kbps);
+            roi.grid = r["grid"].as<int>(roi.grid);
+            roi.idle_ms = r["idle_ms"].as<int>(roi.idle_ms);
+        }
+        if (auto p = e["per_peer"]) {
+            auto& per_peer = cfg.encoding.per_peer;
+            per_peer.enabled = p["enabled"].as<bool>(per_peer.enabled);
+            per_peer.max_encoders = p["max_encoders"].as<int>(per_peer.max_encoders);
+            per_peer.cpu_budget_percent = p["cpu_budget_percent"].as<double>(per_peer.cpu_budget_percent);
+            per_peer.settle_ms = p["settle_ms"].as<int>(per_peer.settle_ms);
+        }
+        if (auto p = e["preview"]) {
+            auto& preview = cfg.encoding.preview;
+            preview.enabled = p["enabled"].as<bool>(preview.enabled);
+            preview.width = p["width"].as<int>(preview.width);
+            preview.height = p["height"].as<int>(preview.height);
+            preview.fps = p["fps"].as<int>(preview.fps);
+            preview.bitrate_kbps = p["bitrate_kbps"].as<int>(preview.bitrate_kbps);
+            preview.idle_ms = p["idle_ms"].as<int>(preview.idle_ms);
+            preview.url = p["url"].as<std::string>(preview.url);
+        }
+    }
+
+    // Mosaic
+    if (auto m = root["mosaic"]) {
+        auto& mosaic = cfg.mosaic;
+        mosaic.enabled = m["enabled"].as<bool>(mosaic.enabled);
+        mosaic.sources = m["sources"].as<std::vector<std::string>>(mosaic.sources);
+        mosaic.include_main = m["include_main"].as<bool>(mosaic.include_main);
+        mosaic.width = m["width"].as<int>(mosaic.width);
+        mosaic.height = m["height"].as<int>(mosaic.height);
+        mosaic.fps = m["fps"].as<int>(mosaic.fps);
+        mosaic.bitrate_kbps = m["bitrate_kbps"].as<int>(mosaic.bitrate_kbps);
+        mosaic.idle_ms = m["idle_ms"].as<int>(mosaic.idle_ms);
+    }
+
+    // Audio
+    if (auto a = root["audio"]) {
+        cfg.audio.enabled = a["enabled"].as<bool>(cfg.audio.enabled);
+        cfg.audio.source_codec = a["source_codec"].as<std::string>(cfg.audio.source_codec);
+        cfg.audio.bitrate_kbps = a["bitrate_kbps"].as<int>(cfg.audio.bitrate_kbps);
+        cfg.audio.payload_type = a["payload_type"].as<int>(cfg.audio.payload_type);
+    }
+
+    // Telemetry
+    if (auto t = root["telemetry"]) {
+        cfg.telemetry.enabled = t["enabled"].as<bool>(cfg.telemetry.enabled);
+        cfg.telemetry.ingest = t["ingest"].as<std::string>(cfg.telemetry.ingest);
+        cfg.telemetry.udp_bind = t["udp_bind"].as<std::string>(cfg.telemetry.udp_bind);
+        cfg.telemetry.udp_port = t["udp_port"].as<uint16_t>(cfg.telemetry.udp_port);
+        cfg.telemetry.unix_path = t["unix_path"].as<std::string>(cfg.telemetry.unix_path);
+    }
+
+    // Control
+    if (auto c = root["control"]) {
+        cfg.control.enabled = c["enabled"].as<bool>(cfg.control.enabled);
+        cfg.control.backend_path = c["backend_path"].as<std::string>(cfg.control.backend_path);
+        cfg.control.reply_path = c["reply_path"].as<std::string>(cfg.control.reply_path);
+        cfg.control.max_retransmits = c["max_retransmits"].as<int>(cfg.control.max_retransmits);
+        cfg.control.max_packet_lifetime_ms = c["max_packet_lifetime_ms"].as<int>(cfg.control.max_packet_lifetime_ms);
+        cfg.control.ordered = c["ordered"].as<bool>(cfg.control.ordered);
+        cfg.control.ping_interval_ms = c["ping_interval_ms"].as<int>(cfg.control.ping_interval_ms);
+        cfg.control.embed_origins = c["embed_origins"].as<std::vector<std::string>>(cfg.control.embed_origins);
+    }
+
+    // Admin API
+    if (auto a = root["admin"]) {
+        cfg.admin.enabled = a["enabled"].as<bool>(cfg.admin.enabled);
+        cfg.admin.token = a["token"].as<std::string>("");
+    }
+
+    // Startup
+    if (auto st = root["startup"]) {
+        cfg.startup.ready_on_first_frame = st["ready_on_first_frame"].as<bool>(cfg.startup.ready_on_first_frame);
+        cfg.startup.gst_registry = st["gst_registry"].as<std::string>("");
+        cfg.startup.gst_registry_update = st["gst_registry_update"].as<bool>(cfg.startup.gst_registry_update);
+        cfg.startup.gst_plugin_path = st["gst_plugin_path"].as<std::string>("");
     }
 
     // Logging
@@ -79,6 +221,7 @@ AppConfig load_config(const std::string& path) {
 
     // Environment variable overrides (Docker / systemd)
     cfg.rtsp.url = env_or("RTSP_URL", cfg.rtsp.url);
+    cfg.replay.file = env_or("REPLAY_FILE", cfg.replay.file);
     cfg.server.signaling_port = static_cast<uint16_t>(
         env_int_or("SIGNALING_PORT", cfg.server.signaling_port));
     cfg.webrtc.stun_server = env_or("STUN_SERVER", cfg.webrtc.stun_server);
@@ -88,8 +231,145 @@ AppConfig load_config(const std::string& path) {
     cfg.webrtc.video.bitrate_kbps = env_int_or("VIDEO_BITRATE_KBPS", cfg.webrtc.video.bitrate_kbps);
     cfg.webrtc.video.max_bitrate_kbps = env_int_or("VIDEO_MAX_BITRATE_KBPS", cfg.webrtc.video.max_bitrate_kbps);
     cfg.logging.level = env_or("LOG_LEVEL", cfg.logging.level);
+    cfg.admin.token = env_or("ADMIN_TOKEN", cfg.admin.token);
 
     return cfg;
 }
 
+// ─── Field-wise comparison (the structs have no operator==) ─────────────────
+
+static auto tie_fields(const VideoConfig& v) {
+    return std::tie(v.codec, v.clock_rate, v.payload_type, v.bitrate_kbps,
+                    v.max_bitrate_kbps, v.min_bitrate_kbps, v.fps);
+}
+
+static auto tie_fields(const PacingConfig& p) {
+    return std::tie(p.enabled, p.rate_factor, p.burst_ms);
+}
+
+static auto tie_fields(const ImpairmentConfig& i) {
+    return std::tie(i.enabled, i.seed, i.loss_model, i.loss_percent, i.burst_length,
+                    i.delay_ms, i.jitter_ms, i.rate_kbps, i.queue_ms);
+}
+
+static auto tie_fields(const ReplayConfig& r) {
+    return std::tie(r.file, r.codec, r.speed, r.loop, r.pcap_port, r.pcap_payload_type);
+}
+
+static auto tie_fields(const ScalingConfig& s) {
+    return std::tie(s.enabled, s.ladder, s.min_bits_per_pixel, s.up_bits_per_pixel);
+}
+
+static auto tie_fields(const ContentAdaptiveConfig& c) {
+    return std::tie(c.enabled, c.static_ratio, c.motion_ratio, c.static_factor,
+                    c.motion_factor, c.window_ms);
+}
+
+static auto tie_fields(const RoiConfig& r) {
+    return std::tie(r.enabled, r.max_encodes, r.max_width, r.max_height, r.bitrate_kbps,
+                    r.grid, r.idle_ms);
+}
+
+static auto tie_fields(const PerPeerConfig& p) {
+    return std::tie(p.enabled, p.max_encoders, p.cpu_budget_percent, p.settle_ms);
+}
+
+static auto tie_fields(const PreviewConfig& p) {
+    return std::tie(p.enabled, p.width, p.height, p.fps, p.bitrate_kbps, p.idle_ms, p.url);
+}
+
+static auto tie_fields(const EncodingConfig& e) {
+    return std::tie(e.hw_encode, e.encoder, e.passthrough, e.preset, e.idr_interval, e.insert_sps_pps,
+                    e.intra_refresh, e.latency_budget_ms);
+}
+
+static auto tie_fields(const AudioConfig& a) {
+    return std::tie(a.enabled, a.source_codec, a.bitrate_kbps, a.payload_type);
+}
+
+static auto tie_fields(const TelemetryConfig& t) {
+    return std::tie(t.enabled, t.ingest, t.udp_bind, t.udp_port, t.unix_path);
+}
+
+static auto tie_fields(const MosaicConfig& m) {
+    return std::tie(m.enabled, m.sources, m.include_main, m.width, m.height, m.fps,
+                    m.bitrate_kbps, m.idle_ms);
+}
+
+static auto tie_fields(const ControlConfig& c) {
+    return std::tie(c.enabled, c.backend_path, c.reply_path, c.max_retransmits,
+                    c.max_packet_lifetime_ms, c.ordered, c.ping_interval_ms, c.embed_origins);
+}
+
+bool launch_value_safe(const std::string& value) {
+    return std::none_of(value.begin(), value.end(), [](unsigned char c) {
+        return c == '"' || c == '\'' || c == '!' || std::isspace(c) || std::iscntrl(c);
+    });
+}
+
+ConfigDiff diff_config(const AppConfig& running, const AppConfig& next) {
+    ConfigDiff diff;
+
+    diff.logging_level = running.logging.level != next.logging.level;
+    diff.logging_sinks = running.logging.file != next.logging.file ||
+                         running.logging.max_file_size_mb != next.logging.max_file_size_mb ||
+                         running.logging.max_files != next.logging.max_files;
+
+    const auto& rw = running.webrtc;
+    const auto& nw = next.webrtc;
+    diff.webrtc = rw.stun_server != nw.stun_server ||
+                  rw.turn_server != nw.turn_server ||
+                  rw.turn_username != nw.turn_username ||
+                  rw.turn_credential != nw.turn_credential ||
+                  rw.max_peers != nw.max_peers ||
+                  rw.trickle_ice != nw.trickle_ice ||
+                  rw.gop_cache != nw.gop_cache ||
+                  rw.peer_pool_size != nw.peer_pool_size ||
+                  rw.keyframe_min_interval_ms != nw.keyframe_min_interval_ms ||
+                  tie_fields(rw.video) != tie_fields(nw.video) ||
+                  tie_fields(rw.pacing) != tie_fields(nw.pacing) ||
+                  tie_fields(rw.impairment) != tie_fields(nw.impairment);
+
+    diff.reconnect = running.rtsp.reconnect_interval_ms != next.rtsp.reconnect_interval_ms ||
+                     running.rtsp.reconnect_max_attempts != next.rtsp.reconnect_max_attempts ||
+                     running.rtsp.reconnect_strategy != next.rtsp.reconnect_strategy ||
+                     running.rtsp.reconnect_max_interval_ms != next.rtsp.reconnect_max_interval_ms ||
+                     running.rtsp.stall_timeout_ms != next.rtsp.stall_timeout_ms;
+
+    diff.bitrate = tie_fields(running.encoding.content_adaptive) !=
+                   tie_fields(next.encoding.content_adaptive);
+
+    diff.admin = running.admin.enabled != next.admin.enabled ||
+                 running.admin.token != next.admin.token;
+
+    diff.pipeline = running.rtsp.url != next.rtsp.url ||
+                    running.rtsp.transport != next.rtsp.transport ||
+                    running.rtsp.latency_ms != next.rtsp.latency_ms ||
+                    running.rtsp.timestamps != next.rtsp.timestamps ||
+                    running.rtsp.max_correction_percent != next.rtsp.max_correction_percent ||
+                    running.rtsp.capture_clock != next.rtsp.capture_clock ||
+                    tie_fields(running.replay) != tie_fields(next.replay) ||
+                    tie_fields(running.encoding) != tie_fields(next.encoding) ||
+                    tie_fields(running.encoding.scaling) != tie_fields(next.encoding.scaling) ||
+                    tie_fields(running.encoding.roi) != tie_fields(next.encoding.roi) ||
+                    tie_fields(running.encoding.per_peer) != tie_fields(next.encoding.per_peer) ||
+                    tie_fields(running.encoding.preview) != tie_fields(next.encoding.preview) ||
+                    tie_fields(running.audio) != tie_fields(next.audio);
+
+    diff.signaling = running.server.signaling_port != next.server.signaling_port;
+    diff.http = running.server.http_port != next.server.http_port ||
+                running.server.web_root != next.server.web_root;
+
+    diff.telemetry = tie_fields(running.telemetry) != tie_fields(next.telemetry);
+    diff.control = tie_fields(running.control) != tie_fields(next.control);
+    // The main camera is a tile, and tiles use the main encoder settings
+    diff.mosaic = tie_fields(running.mosaic) != tie_fields(next.mosaic) ||
+                  running.rtsp.url != next.rtsp.url ||
+                  running.rtsp.transport != next.rtsp.transport ||
+                  running.rtsp.latency_ms != next.rtsp.latency_ms ||
+                  tie_fields(running.encoding) != tie_fields(next.encoding);
+
+    return diff;
+}
+
 } // namespace ss
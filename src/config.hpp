@@ -2,6 +2,7 @@
 
 #include <string>
 #include <cstdint>
+#include <vector>
 
 namespace ss {
 
@@ -17,6 +18,12 @@ struct RtspConfig {
     int latency_ms = 0;
     int reconnect_interval_ms = 3000;
     int reconnect_max_attempts = 0; // 0 = unlimited
+    std::string reconnect_strategy = "fixed"; // fixed or backoff (doubles per failed attempt)
+    int reconnect_max_interval_ms = 30000;    // backoff ceiling
+    int stall_timeout_ms = 5000;    // no frames for this long = reconnect (0 = off)
+    std::string timestamps = "arrival";     // arrival (as delivered), rtp (camera clock) or nominal (frame rate)
+    double max_correction_percent = 5.0;    // drift correction per frame, % of a frame interval
+    std::string capture_clock = "off";      // off, camera (sender report NTP) or aligned (onto the host clock)
 };
 
 struct VideoConfig {
@@ -29,21 +36,167 @@ struct VideoConfig {
     int fps = 30;
 };
 
+struct PacingConfig {
+    bool enabled = false;
+    double rate_factor = 2.5;   // pacing rate = factor × max_bitrate_kbps
+    int burst_ms = 40;          // bucket depth
+};
+
+// Test only: impair outgoing media in-process (see Impairment)
+struct ImpairmentConfig {
+    bool enabled = false;
+    uint32_t seed = 1;              // same seed + same traffic = same pattern
+    std::string loss_model = "random"; // random, burst (Gilbert-Elliott) or periodic
+    double loss_percent = 0.0;
+    double burst_length = 3.0;      // burst model: mean packets lost in a row
+    int delay_ms = 0;
+    int jitter_ms = 0;              // uniform ± around delay_ms (reorders)
+    int rate_kbps = 0;              // token-bucket cap (0 = unlimited)
+    int queue_ms = 200;             // rate cap: drop-tail queue limit
+};
+
+struct ReplayConfig {
+    std::string file;               // recording to play instead of the camera (empty = live)
+    std::string codec = "auto";     // auto (from extension), h264 or h265
+    double speed = 1.0;             // 1 = original timing, N = N× faster, 0 = unpaced
+    bool loop = true;
+    uint16_t pcap_port = 0;         // pcap: only RTP sent to this UDP port (0 = any)
+    int pcap_payload_type = 96;
+};
+
 struct WebRtcConfig {
     std::string stun_server = "stun:stun.cloudflare.com:3478";
     std::string turn_server;
     std::string turn_username;
     std::string turn_credential;
     int max_peers = 4;
+    bool trickle_ice = true;        // false: one offer with every candidate, sent once gathered
+    bool gop_cache = false;         // start new peers on the cached GOP, not the next IDR
+    int peer_pool_size = 0;         // peers created and gathered before a client asks
+    int keyframe_min_interval_ms = 500; // PLI / new-viewer IDR requests coalesce within this
     VideoConfig video;
+    PacingConfig pacing;
+    ImpairmentConfig impairment;
+};
+
+// Re-encode only: step the encode resolution down as the bitrate drops
+// (see ScalingPolicy)
+struct ScalingConfig {
+    bool enabled = false;
+    std::vector<std::string> ladder = {"1920x1080", "1280x720", "960x540", "640x360"};
+    double min_bits_per_pixel = 0.04;   // step down below this
+    double up_bits_per_pixel = 0.07;    // step up once the larger rung gets this
+};
+
+// Re-encode only: scale the target bitrate with scene complexity estimated
+// from encoded frame sizes (see SceneComplexity)
+struct ContentAdaptiveConfig {
+    bool enabled = false;
+    double static_ratio = 0.05;     // mean P-frame / IDR size at or below: static scene
+    double motion_ratio = 0.30;     // at or above: full motion
+    double static_factor = 0.5;     // × bitrate_kbps for a static scene
+    double motion_factor = 1.5;     // × bitrate_kbps for full motion (≤ max_bitrate_kbps)
+    int window_ms = 2000;           // frames per estimate
+};
+
+// Per-peer region of interest (digital zoom): each distinct crop gets a
+// crop → scale → encode branch, shared by every peer viewing it
+struct RoiConfig {
+    bool enabled = false;
+    int max_encodes = 2;            // ROI branches at once, idle ones included
+    int max_width = 1280;           // output box; crops are never upscaled
+    int max_height = 720;
+    int bitrate_kbps = 1200;
+    int grid = 32;                  // crops snap to 1/grid of the frame, so near-equal zooms share
+    int idle_ms = 10000;            // unused branch kept for the next crop, then removed
+};
+
+// Small audiences: each viewer gets its own full-frame encoder off the
+// shared decode, driven by its own ABR requests, while CPU allows
+struct PerPeerConfig {
+    bool enabled = false;
+    int max_encoders = 4;               // viewers beyond this share the main encode
+    double cpu_budget_percent = 200.0;  // process CPU (100 = one core) to stay under
+    int settle_ms = 3000;               // after adding an encoder, before judging its cost
+};
+
+// Thumbnail rendition for dashboard tiles, offered as stream "preview"
+struct PreviewConfig {
+    bool enabled = false;
+    int width = 320;
+    int height = 180;
+    int fps = 5;
+    int bitrate_kbps = 150;
+    int idle_ms = 10000;                // encoder kept this long after the last viewer leaves
+    std::string url;                    // camera substream (H.264 RTSP) instead of an encode
 };
 
 struct EncodingConfig {
     bool hw_encode = false;
+    std::string encoder = "auto";   // auto (benchmarked), x264, openh264, va, nvv4l2
     bool passthrough = true;
     std::string preset = "UltraFastPreset";
-    int idr_interval = 30;
+    int idr_interval = 30;          // with intra_refresh: frames per refresh wave
     bool insert_sps_pps = true;
+    bool intra_refresh = false;     // rolling intra refresh, IDRs only on request
+    int latency_budget_ms = 0;      // queuing a frame may add at the target rate (0 = encoder default VBV)
+    ScalingConfig scaling;
+    ContentAdaptiveConfig content_adaptive;
+    RoiConfig roi;
+    PerPeerConfig per_peer;
+    PreviewConfig preview;
+};
+
+// Composite of several cameras tiled into one frame, offered as stream
+// "mosaic" (see MosaicStream)
+struct MosaicConfig {
+    bool enabled = false;
+    std::vector<std::string> sources;   // RTSP URLs, or test:<pattern> for a test tile
+    bool include_main = true;           // the main camera as the first tile
+    int width = 1280;                   // composite frame, tiles fitted in a grid
+    int height = 720;
+    int fps = 15;
+    int bitrate_kbps = 1500;
+    int idle_ms = 10000;                // torn down this long after the last viewer leaves
+};
+
+struct AudioConfig {
+    bool enabled = false;
+    std::string source_codec = "aac"; // aac, aac-latm (transcoded to Opus) or opus (passthrough)
+    int bitrate_kbps = 32;            // Opus bitrate when transcoding
+    int payload_type = 111;
+};
+
+struct TelemetryConfig {
+    bool enabled = false;           // open a "telemetry" DataChannel per peer
+    std::string ingest = "udp";     // udp or unix
+    std::string udp_bind = "127.0.0.1";
+    uint16_t udp_port = 9870;
+    std::string unix_path = "/tmp/stream-server-telemetry.sock";
+};
+
+struct ControlConfig {
+    bool enabled = false;           // open a "control" DataChannel per peer
+    std::string backend_path = "/tmp/robot-control.sock";        // robot backend listens here
+    std::string reply_path = "/tmp/stream-server-control.sock";  // backend replies here
+    int max_retransmits = -1;       // -1 = fully reliable
+    int max_packet_lifetime_ms = 0; // 0 = no lifetime limit
+    bool ordered = true;
+    int ping_interval_ms = 1000;    // RTT probes on the control channel
+    std::vector<std::string> embed_origins;  // host pages allowed to drive embed.html
+};
+
+struct AdminConfig {
+    bool enabled = false;           // JSON API under /api/ on the HTTP server
+    std::string token;              // required as "Authorization: Bearer <token>"
+};
+
+// Boot behaviour, read at start only (not reloadable)
+struct StartupConfig {
+    bool ready_on_first_frame = false; // sd_notify READY=1 waits for video, else for listeners
+    std::string gst_registry;          // registry cache file, "" = GStreamer's default
+    bool gst_registry_update = true;   // false: trust an existing cache, skip the plugin rescan
+    std::string gst_plugin_path;       // scan only this directory, "" = system plugin dirs
 };
 
 struct LoggingConfig {
@@ -56,12 +209,49 @@ struct LoggingConfig {
 struct AppConfig {
     ServerConfig server;
     RtspConfig rtsp;
+    ReplayConfig replay;
     WebRtcConfig webrtc;
     EncodingConfig encoding;
+    MosaicConfig mosaic;
+    AudioConfig audio;
+    TelemetryConfig telemetry;
+    ControlConfig control;
+    AdminConfig admin;
+    StartupConfig startup;
     LoggingConfig logging;
 };
 
 // Load configuration from YAML file, with environment variable overrides
 AppConfig load_config(const std::string& path);
 
+// Whether a URL or path can be spliced into a gst_parse_launch description:
+// a quote, '!' or whitespace would end the value and let the rest add
+// elements of its own
+bool launch_value_safe(const std::string& value);
+
+// Which parts of a running server a config change touches
+struct ConfigDiff {
+    // Applied in place
+    bool logging_level = false;
+    bool webrtc = false;         // ICE servers, max_peers, bitrate limits, pacing, impairment (new peers)
+    bool reconnect = false;      // RTSP reconnect strategy / interval / stall timeout
+    bool bitrate = false;        // content-adaptive bitrate
+    bool admin = false;          // admin API switch / token (read per request)
+    // Require restarting one subsystem
+    bool logging_sinks = false;  // log file / rotation
+    bool pipeline = false;       // source, replay, transport, encoding, ROI, audio
+    bool signaling = false;      // signaling port
+    bool http = false;           // HTTP port or web root
+    bool telemetry = false;
+    bool control = false;
+    bool mosaic = false;         // mosaic sources/layout (rebuilt if running)
+
+    bool any() const {
+        return logging_level || webrtc || reconnect || bitrate || admin || logging_sinks || pipeline ||
+               signaling || http || telemetry || control || mosaic;
+    }
+};
+
+ConfigDiff diff_config(const AppConfig& running, const AppConfig& next);
+
 } // namespace ss
@@ -0,0 +1,148 @@
+#include "config_reloader.hpp"
+#include "logger.hpp"
+#include "webrtc_server.hpp"
+#include "signaling_server.hpp"
+#include "rtsp_pipeline.hpp"
+#include "http_server.hpp"
+#include "telemetry_ingest.hpp"
+#include "control_forwarder.hpp"
+#include "bitrate_policy.hpp"
+#include "mosaic_stream.hpp"
+
+#include <spdlog/spdlog.h>
+
+namespace ss {
+
+ConfigReloader::ConfigReloader(std::string config_path, const AppConfig& running, Components components)
+    : config_path_(std::move(config_path))
+    , components_(components)
+    , running_(running)
+{
+}
+
+bool ConfigReloader::reload() {
+    AppConfig next;
+    try {
+        next = load_config(config_path_);
+    } catch (const std::exception& e) {
+        spdlog::error("Config reload failed, keeping running config: {}", e.what());
+        return false;
+    }
+
+    apply(next);
+    return true;
+}
+
+void ConfigReloader::apply(const AppConfig& next) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    ConfigDiff diff = diff_config(running_, next);
+    if (!diff.any()) {
+        // Fields read straight from current() still take the new values
+        running_ = next;
+        spdlog::info("Config reload: no changes");
+        return;
+    }
+
+    // ─── Logging ──────────────────────────────────────────────────────────
+    if (diff.logging_sinks) {
+        init_logger(next.logging);
+        spdlog::info("Config reload: log sinks reopened");
+    } else if (diff.logging_level) {
+        spdlog::default_logger()->set_level(parse_log_level(next.logging.level));
+        spdlog::info("Config reload: log level → {}", next.logging.level);
+    }
+
+    // ─── In place ─────────────────────────────────────────────────────────
+    // WebRTC settings are read when a peer is created, so existing peers keep
+    // their ICE servers and only pick up the new limits and pacing rate
+    if (diff.webrtc) {
+        components_.webrtc.update_config(next);
+        components_.signaling.update_config(next);
+        spdlog::info("Config reload: WebRTC settings updated (max peers {}, bitrate {}-{} kbps)",
+                     next.webrtc.max_peers,
+                     next.webrtc.video.min_bitrate_kbps,
+                     next.webrtc.video.max_bitrate_kbps);
+    }
+
+    // The admin API reads its switch and token from current() per request
+    if (diff.admin) {
+        spdlog::info("Config reload: admin API {}{}", next.admin.enabled ? "enabled" : "disabled",
+                     running_.admin.token != next.admin.token ? ", token rotated" : "");
+    }
+
+    if (!diff.pipeline && (diff.webrtc || diff.reconnect || diff.bitrate)) {
+        components_.pipeline.update_config(next);
+    }
+
+    // The nominal rate comes from webrtc.video, the scene scaling from encoding
+    if (diff.webrtc || diff.bitrate || diff.pipeline) {
+        components_.bitrate.update_config(next);
+    }
+
+    // ─── Subsystem restarts ───────────────────────────────────────────────
+    if (diff.pipeline) {
+        // Peers stay connected and resume at the next keyframe
+        spdlog::info("Config reload: restarting pipeline");
+        components_.webrtc.update_config(next);
+        if (!components_.pipeline.restart(next)) {
+            spdlog::error("Config reload: pipeline failed to start, watchdog will retry");
+        }
+    }
+
+    if (diff.mosaic) {
+        // A running mosaic is rebuilt by its next tick
+        spdlog::info("Config reload: mosaic settings updated");
+        components_.mosaic.update_config(next);
+    }
+
+    if (diff.signaling) {
+        // Only the listening socket moves: open sessions and their peers stay
+        spdlog::info("Config reload: moving signaling to port {}", next.server.signaling_port);
+        components_.signaling.update_config(next);
+        if (!components_.signaling.rebind()) {
+            spdlog::error("Config reload: signaling failed to listen on port {}",
+                          next.server.signaling_port);
+        }
+    }
+
+    if (diff.http) {
+        spdlog::info("Config reload: restarting HTTP server on port {}", next.server.http_port);
+        components_.http.stop();
+        components_.http.update_config(next.server.http_port, next.server.web_root);
+        if (!components_.http.start()) {
+            spdlog::warn("Config reload: HTTP server failed to start on port {}",
+                         next.server.http_port);
+        }
+    }
+
+    if (diff.telemetry) {
+        components_.telemetry.stop();
+        components_.telemetry.update_config(next.telemetry);
+        if (next.telemetry.enabled && !components_.telemetry.start()) {
+            spdlog::warn("Config reload: telemetry ingest failed to start");
+        }
+        spdlog::info("Config reload: telemetry {}", next.telemetry.enabled ? "restarted" : "disabled");
+    }
+
+    if (diff.control) {
+        // New sessions get the embed origins in their welcome
+        components_.signaling.update_config(next);
+        components_.control.stop();
+        components_.control.update_config(next.control);
+        if (next.control.enabled && !components_.control.start()) {
+            spdlog::warn("Config reload: control forwarding failed to start");
+        }
+        spdlog::info("Config reload: control {}", next.control.enabled ? "restarted" : "disabled");
+    }
+
+    running_ = next;
+    spdlog::info("Config reload complete");
+}
+
+AppConfig ConfigReloader::current() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return running_;
+}
+
+} // namespace ss
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "config.hpp"
+#include <mutex>
+#include <string>
+
+namespace ss {
+
+class WebRtcServer;
+class SignalingServer;
+class RtspPipeline;
+class HttpServer;
+class TelemetryIngest;
+class ControlForwarder;
+class BitratePolicy;
+class MosaicStream;
+
+// Re-reads the config file and applies the difference to the running
+// components. Live fields are updated in place; fields that need a rebuild
+// restart only the subsystem that owns them, so connected peers stay up.
+class ConfigReloader {
+public:
+    struct Components {
+        WebRtcServer& webrtc;
+        SignalingServer& signaling;
+        RtspPipeline& pipeline;
+        HttpServer& http;
+        TelemetryIngest& telemetry;
+        ControlForwarder& control;
+        BitratePolicy& bitrate;
+        MosaicStream& mosaic;
+    };
+
+    ConfigReloader(std::string config_path, const AppConfig& running, Components components);
+
+    // Non-copyable
+    ConfigReloader(const ConfigReloader&) = delete;
+    ConfigReloader& operator=(const ConfigReloader&) = delete;
+
+    // Load the config file again and apply it. On a parse error the running
+    // config is kept and false is returned.
+    bool reload();
+
+    // Apply an already loaded config
+    void apply(const AppConfig& next);
+
+    AppConfig current() const;
+
+private:
+    std::string config_path_;
+    Components components_;
+
+    mutable std::mutex mutex_;
+    AppConfig running_;
+};
+
+} // namespace ss
@@ -0,0 +1,163 @@
+#include "control_forwarder.hpp"
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+
+using json = nlohmann::json;
+
+namespace ss {
+
+// Commands never acknowledged are forgotten after this long
+static constexpr auto pending_timeout = std::chrono::seconds(10);
+
+ControlForwarder::ControlForwarder(const ControlConfig& config) : config_(config) {}
+
+ControlForwarder::~ControlForwarder() {
+    stop();
+}
+
+bool ControlForwarder::start() {
+    sockaddr_un addr{};
+    if (config_.backend_path.size() >= sizeof(addr.sun_path) ||
+        config_.reply_path.size() >= sizeof(addr.sun_path)) {
+        spdlog::error("Control: Socket path too long");
+        return false;
+    }
+
+    fd_ = socket(AF_UNIX, SOCK_DGRAM, 0);
+    if (fd_ < 0) {
+        spdlog::error("Control: Failed to create unix socket");
+        return false;
+    }
+
+    // Bind our own address so the backend can reply to the sender
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, config_.reply_path.c_str(), sizeof(addr.sun_path) - 1);
+    unlink(config_.reply_path.c_str());
+    if (bind(fd_, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        spdlog::error("Control: Failed to bind to {}", config_.reply_path);
+        close(fd_);
+        fd_ = -1;
+        return false;
+    }
+
+    timeval tv{};
+    tv.tv_usec = 500 * 1000;
+    setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    running_.store(true);
+    thread_ = std::thread(&ControlForwarder::reply_thread, this);
+    spdlog::info("Control forwarding to unix://{} (replies on {})",
+                 config_.backend_path, config_.reply_path);
+    return true;
+}
+
+void ControlForwarder::stop() {
+    running_.store(false);
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+        unlink(config_.reply_path.c_str());
+    }
+}
+
+bool ControlForwarder::forward(const std::string& peer_id, int64_t seq, const std::string& command) {
+    if (fd_ < 0) return false;
+
+    json msg;
+    msg["peer"] = peer_id;
+    msg["seq"] = seq;
+    msg["command"] = json::parse(command, nullptr, false);
+    if (msg["command"].is_discarded()) {
+        msg["command"] = command;
+    }
+    std::string datagram = msg.dump();
+
+    sockaddr_un dest{};
+    dest.sun_family = AF_UNIX;
+    std::strncpy(dest.sun_path, config_.backend_path.c_str(), sizeof(dest.sun_path) - 1);
+
+    // Non-blocking: a stalled backend must not stall the SCTP receive thread
+    ssize_t n = sendto(fd_, datagram.data(), datagram.size(), MSG_DONTWAIT,
+                       (sockaddr*)&dest, sizeof(dest));
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (n < 0) {
+        stats_.failed++;
+        return false;
+    }
+
+    stats_.forwarded++;
+    auto now = std::chrono::steady_clock::now();
+    // Commands without a seq (-1) share one key, so a reply could not say
+    // which was delivered: they go untracked
+    if (seq >= 0) pending_[{peer_id, seq}] = now;
+
+    // Expire commands the backend never acknowledged
+    for (auto it = pending_.begin(); it != pending_.end();) {
+        if (now - it->second > pending_timeout) {
+            it = pending_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    return true;
+}
+
+ControlForwarder::Stats ControlForwarder::get_stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void ControlForwarder::reply_thread() {
+    std::string buf(64 * 1024, '\0');
+
+    while (running_.load()) {
+        ssize_t n = recv(fd_, buf.data(), buf.size(), 0);
+        if (n <= 0) {
+            continue;
+        }
+
+        std::string reply = buf.substr(0, static_cast<size_t>(n));
+        auto msg = json::parse(reply, nullptr, false);
+        if (msg.is_discarded() || !msg.is_object()) {
+            spdlog::debug("Control: Ignoring malformed backend reply");
+            continue;
+        }
+
+        std::string peer_id = msg.value("peer", "");
+        int64_t seq = msg.value("seq", int64_t{-1});
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = seq >= 0 ? pending_.find({peer_id, seq}) : pending_.end();
+            if (it != pending_.end()) {
+                double ms = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - it->second).count();
+                pending_.erase(it);
+
+                stats_.acked++;
+                // Running mean over all acknowledged commands
+                stats_.delivery_avg_ms += (ms - stats_.delivery_avg_ms) / static_cast<double>(stats_.acked);
+                stats_.delivery_max_ms = std::max(stats_.delivery_max_ms, ms);
+            }
+        }
+
+        if (reply_cb_ && !peer_id.empty()) {
+            json out;
+            out["type"] = "reply";
+            out["seq"] = seq;
+            out["data"] = msg;
+            reply_cb_(peer_id, out.dump());
+        }
+    }
+}
+
+} // namespace ss
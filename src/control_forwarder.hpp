@@ -0,0 +1,71 @@
+#pragma once
+
+#include "config.hpp"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+namespace ss {
+
+// Forwards teleop commands from the control DataChannels to the robot
+// backend over a unix datagram socket, and tracks delivery latency using
+// the backend's acknowledgements.
+//
+// Outgoing datagram:  {"peer": "...", "seq": N, "command": {...}}
+// Backend reply:      {"peer": "...", "seq": N, ...}  (sent back to our socket)
+// Relayed to peer:    {"type": "reply", "seq": N, "data": {...}}
+class ControlForwarder {
+public:
+    // Backend acknowledged a command; reply is ready to send to the peer
+    using ReplyCallback = std::function<void(const std::string& peer_id, const std::string& reply)>;
+
+    explicit ControlForwarder(const ControlConfig& config);
+    ~ControlForwarder();
+
+    // Non-copyable
+    ControlForwarder(const ControlForwarder&) = delete;
+    ControlForwarder& operator=(const ControlForwarder&) = delete;
+
+    void set_reply_callback(ReplyCallback cb) { reply_cb_ = std::move(cb); }
+
+    bool start();
+    void stop();
+
+    // Replace settings (call while stopped)
+    void update_config(const ControlConfig& config) { config_ = config; }
+
+    // Send one command to the backend, returns false if the socket send failed
+    bool forward(const std::string& peer_id, int64_t seq, const std::string& command);
+
+    struct Stats {
+        uint64_t forwarded = 0;
+        uint64_t failed = 0;
+        uint64_t acked = 0;
+        double delivery_avg_ms = 0.0; // forward → backend ack
+        double delivery_max_ms = 0.0;
+    };
+    Stats get_stats() const;
+
+private:
+    void reply_thread();
+
+    ControlConfig config_;
+    ReplyCallback reply_cb_;
+
+    int fd_ = -1;
+    std::atomic<bool> running_{false};
+    std::thread thread_;
+
+    mutable std::mutex mutex_;
+    Stats stats_;
+    // (peer, seq) → forward time, for commands awaiting a backend ack
+    // (only those with a seq)
+    std::map<std::pair<std::string, int64_t>, std::chrono::steady_clock::time_point> pending_;
+};
+
+} // namespace ss
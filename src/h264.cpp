@@ -0,0 +1,263 @@
+#include "h264.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace ss::h264 {
+
+// Offset of the next start code at or after `pos`, or `size` if none
+static size_t find_start_code(const uint8_t* data, size_t size, size_t pos, size_t& code_len) {
+    for (size_t i = pos; i + 2 < size; i++) {
+        if (data[i] != 0 || data[i + 1] != 0) continue;
+        if (data[i + 2] == 1) {
+            code_len = 3;
+            return i;
+        }
+        if (i + 3 < size && data[i + 2] == 0 && data[i + 3] == 1) {
+            code_len = 4;
+            return i;
+        }
+    }
+    code_len = 0;
+    return size;
+}
+
+bool contains_idr(const uint8_t* data, size_t size) {
+    // All slices of an access unit have the same type, so the first one
+    // decides and the slice data itself is never scanned
+    size_t code_len = 0;
+    for (size_t pos = find_start_code(data, size, 0, code_len); pos < size;
+         pos = find_start_code(data, size, pos + code_len, code_len)) {
+        size_t header = pos + code_len;
+        if (header >= size) break;
+        uint8_t type = data[header] & 0x1F;
+        if (type >= NalSlice && type <= NalIdr) return type == NalIdr;
+    }
+    return false;
+}
+
+bool find_nal(const uint8_t* data, size_t size, NalType type, const uint8_t*& nal, size_t& nal_size) {
+    size_t code_len = 0;
+    for (size_t pos = find_start_code(data, size, 0, code_len); pos < size;) {
+        size_t header = pos + code_len;
+        if (header >= size) break;
+        uint8_t found = data[header] & 0x1F;
+        if (found >= NalSlice && found <= NalIdr) break;
+
+        size_t next_len = 0;
+        size_t next = find_start_code(data, size, header, next_len);
+        if (found == type) {
+            nal = data + header;
+            nal_size = next - header;
+            return true;
+        }
+        pos = next;
+        code_len = next_len;
+    }
+    return false;
+}
+
+// ─── Sequence parameter set ────────────────────────────────────────────────────
+
+namespace {
+
+// Exp-Golomb reader over the RBSP (emulation prevention bytes removed)
+class BitReader {
+public:
+    explicit BitReader(std::vector<uint8_t> rbsp) : rbsp_(std::move(rbsp)) {}
+
+    bool ok() const { return ok_; }
+
+    uint32_t bits(int count) {
+        uint32_t value = 0;
+        for (int i = 0; i < count; i++) {
+            if (pos_ >= rbsp_.size() * 8) {
+                ok_ = false;
+                return 0;
+            }
+            value = (value << 1) | ((rbsp_[pos_ / 8] >> (7 - pos_ % 8)) & 1);
+            pos_++;
+        }
+        return value;
+    }
+
+    uint32_t ue() {
+        int zeros = 0;
+        while (bits(1) == 0) {
+            if (!ok_ || ++zeros > 31) {
+                ok_ = false;
+                return 0;
+            }
+        }
+        return ((1u << zeros) - 1) + bits(zeros);
+    }
+
+    int32_t se() {
+        uint32_t code = ue();
+        return (code & 1) ? static_cast<int32_t>((code + 1) / 2) : -static_cast<int32_t>(code / 2);
+    }
+
+private:
+    std::vector<uint8_t> rbsp_;
+    size_t pos_ = 0;
+    bool ok_ = true;
+};
+
+void skip_scaling_list(BitReader& reader, int size) {
+    int last = 8, next = 8;
+    for (int i = 0; i < size && reader.ok(); i++) {
+        if (next != 0) next = (last + reader.se() + 256) % 256;
+        last = next == 0 ? last : next;
+    }
+}
+
+// Profiles as WebRTC tells them apart (profile_idc and constraint flags)
+enum class Profile { ConstrainedBaseline, Baseline, Main, ConstrainedHigh, High, Other };
+
+Profile classify(uint8_t profile_idc, uint8_t constraints) {
+    // Flags that must be clear (set4, set5 and the reserved bits) differ per profile
+    auto matches = [constraints](uint8_t mask, uint8_t value) { return (constraints & mask) == value; };
+    switch (profile_idc) {
+        case 0x42: return matches(0x4F, 0x40) ? Profile::ConstrainedBaseline
+                        : matches(0x4F, 0x00) ? Profile::Baseline : Profile::Other;
+        case 0x4D: return matches(0x8F, 0x80) ? Profile::ConstrainedBaseline
+                        : matches(0xAF, 0x00) ? Profile::Main : Profile::Other;
+        case 0x58: return matches(0xCF, 0xC0) ? Profile::ConstrainedBaseline
+                        : matches(0xCF, 0x80) ? Profile::Baseline : Profile::Other;
+        case 0x64: return constraints == 0x00 ? Profile::High
+                        : constraints == 0x0C ? Profile::ConstrainedHigh : Profile::Other;
+        default:   return Profile::Other;
+    }
+}
+
+// Levels in order, level_idc doubled so 1b fits between 1 and 1.1. Baseline,
+// Main and Extended signal 1b as level 1.1 plus constraint_set3; the other
+// profiles as level_idc 9.
+int level_rank(uint8_t profile_idc, uint8_t constraints, uint8_t level_idc) {
+    bool set3_1b = (profile_idc == 0x42 || profile_idc == 0x4D || profile_idc == 0x58) &&
+                   level_idc == 11 && (constraints & 0x10);
+    if (set3_1b || level_idc == 9) return 21;
+    return level_idc * 2;
+}
+
+} // namespace
+
+bool parse_sps(const uint8_t* nal, size_t size, Sps& sps) {
+    if (size < 4 || (nal[0] & 0x1F) != NalSps) return false;
+
+    std::vector<uint8_t> rbsp;
+    rbsp.reserve(size);
+    for (size_t i = 1; i < size; i++) {
+        if (i + 2 < size && nal[i] == 0 && nal[i + 1] == 0 && nal[i + 2] == 3) {
+            rbsp.push_back(0);
+            rbsp.push_back(0);
+            i += 2;
+            continue;
+        }
+        rbsp.push_back(nal[i]);
+    }
+
+    BitReader reader(std::move(rbsp));
+    Sps parsed;
+    parsed.profile_idc = static_cast<uint8_t>(reader.bits(8));
+    parsed.constraint_flags = static_cast<uint8_t>(reader.bits(8));
+    parsed.level_idc = static_cast<uint8_t>(reader.bits(8));
+    reader.ue();    // seq_parameter_set_id
+
+    uint32_t chroma_format_idc = 1;
+    bool separate_colour_planes = false;
+    switch (parsed.profile_idc) {
+        case 100: case 110: case 122: case 244: case 44: case 83:
+        case 86: case 118: case 128: case 138: case 139: case 134: case 135:
+            chroma_format_idc = reader.ue();
+            if (chroma_format_idc == 3) separate_colour_planes = reader.bits(1) != 0;
+            reader.ue();        // bit_depth_luma_minus8
+            reader.ue();        // bit_depth_chroma_minus8
+            reader.bits(1);     // qpprime_y_zero_transform_bypass_flag
+            if (reader.bits(1)) {
+                for (int i = 0; i < (chroma_format_idc != 3 ? 8 : 12); i++) {
+                    if (reader.bits(1)) skip_scaling_list(reader, i < 6 ? 16 : 64);
+                }
+            }
+            break;
+        default:
+            break;
+    }
+
+    reader.ue();        // log2_max_frame_num_minus4
+    uint32_t pic_order_cnt_type = reader.ue();
+    if (pic_order_cnt_type == 0) {
+        reader.ue();    // log2_max_pic_order_cnt_lsb_minus4
+    } else if (pic_order_cnt_type == 1) {
+        reader.bits(1); // delta_pic_order_always_zero_flag
+        reader.se();    // offset_for_non_ref_pic
+        reader.se();    // offset_for_top_to_bottom_field
+        uint32_t cycle = reader.ue();
+        for (uint32_t i = 0; i < cycle && reader.ok(); i++) reader.se();
+    }
+    reader.ue();        // max_num_ref_frames
+    reader.bits(1);     // gaps_in_frame_num_value_allowed_flag
+
+    uint32_t width_mbs = reader.ue() + 1;
+    uint32_t height_map_units = reader.ue() + 1;
+    uint32_t frame_mbs_only = reader.bits(1);
+    if (!frame_mbs_only) reader.bits(1);   // mb_adaptive_frame_field_flag
+    reader.bits(1);     // direct_8x8_inference_flag
+
+    uint32_t crop_left = 0, crop_right = 0, crop_top = 0, crop_bottom = 0;
+    if (reader.bits(1)) {
+        crop_left = reader.ue();
+        crop_right = reader.ue();
+        crop_top = reader.ue();
+        crop_bottom = reader.ue();
+    }
+    if (!reader.ok()) return false;
+
+    // Cropping is in chroma sample units
+    uint32_t crop_x = 1, crop_y = 2 - frame_mbs_only;
+    if (!separate_colour_planes && chroma_format_idc != 0) {
+        crop_x = chroma_format_idc == 3 ? 1 : 2;
+        crop_y *= chroma_format_idc == 1 ? 2 : 1;
+    }
+    int64_t width = static_cast<int64_t>(width_mbs) * 16 - crop_x * (crop_left + crop_right);
+    int64_t height = static_cast<int64_t>(2 - frame_mbs_only) * height_map_units * 16 -
+                     crop_y * (crop_top + crop_bottom);
+    if (width <= 0 || height <= 0 || width > 16384 || height > 16384) return false;
+
+    parsed.width = static_cast<int>(width);
+    parsed.height = static_cast<int>(height);
+    sps = parsed;
+    return true;
+}
+
+std::string profile_level_id(const Sps& sps) {
+    char id[7];
+    std::snprintf(id, sizeof(id), "%02x%02x%02x", sps.profile_idc, sps.constraint_flags, sps.level_idc);
+    return id;
+}
+
+bool profile_compatible(const std::string& profile_level_id, const Sps& sps) {
+    if (profile_level_id.size() != 6) return false;
+    char* end = nullptr;
+    unsigned long id = std::strtoul(profile_level_id.c_str(), &end, 16);
+    if (*end != '\0') return false;
+
+    auto profile_idc = static_cast<uint8_t>(id >> 16);
+    auto constraints = static_cast<uint8_t>(id >> 8);
+    auto level_idc = static_cast<uint8_t>(id);
+    if (level_rank(sps.profile_idc, sps.constraint_flags, sps.level_idc) >
+        level_rank(profile_idc, constraints, level_idc)) {
+        return false;
+    }
+
+    Profile negotiated = classify(profile_idc, constraints);
+    Profile stream = classify(sps.profile_idc, sps.constraint_flags);
+    if (negotiated == Profile::Other || stream == Profile::Other) {
+        return profile_idc == sps.profile_idc && constraints == sps.constraint_flags;
+    }
+    // Constrained Baseline decodes as anything; High decoders take Main too
+    return stream == negotiated || stream == Profile::ConstrainedBaseline ||
+           (negotiated == Profile::High && (stream == Profile::Main || stream == Profile::ConstrainedHigh));
+}
+
+} // namespace ss::h264
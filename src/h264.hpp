@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace ss::h264 {
+
+// NAL unit types the server looks at
+enum NalType : uint8_t {
+    NalSlice = 1,
+    NalIdr = 5,
+    NalSei = 6,
+    NalSps = 7,
+    NalPps = 8,
+    NalAud = 9,
+};
+
+// True if an Annex-B access unit holds an IDR slice
+bool contains_idr(const uint8_t* data, size_t size);
+
+// First NAL unit of `type` ahead of the slices of an Annex-B access unit
+// (where parameter sets go), header byte first without its start code
+bool find_nal(const uint8_t* data, size_t size, NalType type, const uint8_t*& nal, size_t& nal_size);
+
+// What the server needs from a sequence parameter set
+struct Sps {
+    uint8_t profile_idc = 0;
+    uint8_t constraint_flags = 0;   // constraint_set0..5, as in profile-level-id
+    uint8_t level_idc = 0;
+    int width = 0;                  // after cropping
+    int height = 0;
+};
+
+// Parse an SPS NAL unit (header byte first)
+bool parse_sps(const uint8_t* nal, size_t size, Sps& sps);
+
+// SDP profile-level-id of the stream, e.g. "42e01f"
+std::string profile_level_id(const Sps& sps);
+
+// Whether the stream may be sent on a session negotiated with
+// `profile_level_id`: its profile is the same or a subset, its level no
+// higher (RFC 6184 profile matching, as browsers do it)
+bool profile_compatible(const std::string& profile_level_id, const Sps& sps);
+
+} // namespace ss::h264
@@ -12,6 +12,9 @@ namespace fs = std::filesystem;
 
 namespace ss {
 
+static constexpr size_t max_header_size = 16 * 1024;
+static constexpr size_t max_body_size = 64 * 1024;
+
 const std::unordered_map<std::string, std::string> HttpServer::mime_types_ = {
     {".html", "text/html"},
     {".css",  "text/css"},
@@ -85,6 +88,11 @@ void HttpServer::stop() {
     }
 }
 
+void HttpServer::update_config(uint16_t port, const std::string& web_root) {
+    port_ = port;
+    web_root_ = web_root;
+}
+
 void HttpServer::server_thread() {
     while (running_.load()) {
         sockaddr_in client_addr{};
@@ -106,36 +114,102 @@ void HttpServer::server_thread() {
     }
 }
 
-void HttpServer::handle_client(int client_fd) {
-    // Read request (small buffer is fine for HTTP headers)
+void HttpServer::add_route(const std::string& prefix, RouteHandler handler) {
+    routes_.emplace_back(prefix, std::move(handler));
+}
+
+bool HttpServer::read_request(int client_fd, HttpRequest& request) {
+    // Read until the end of the headers
+    std::string raw;
     char buf[4096];
-    ssize_t n = recv(client_fd, buf, sizeof(buf) - 1, 0);
-    if (n <= 0) return;
-    buf[n] = '\0';
+    size_t header_end = std::string::npos;
+    while (header_end == std::string::npos) {
+        ssize_t n = recv(client_fd, buf, sizeof(buf), 0);
+        if (n <= 0) return false;
+        raw.append(buf, static_cast<size_t>(n));
+        header_end = raw.find("\r\n\r\n");
+        if (header_end == std::string::npos && raw.size() > max_header_size) return false;
+    }
 
     // Parse first line: "GET /path HTTP/1.1"
-    std::string request(buf);
-    auto first_line_end = request.find("\r\n");
-    if (first_line_end == std::string::npos) return;
+    auto first_line_end = raw.find("\r\n");
+    std::string first_line = raw.substr(0, first_line_end);
+    auto method_end = first_line.find(' ');
+    if (method_end == std::string::npos) return false;
+    auto path_end = first_line.find(' ', method_end + 1);
+    request.method = first_line.substr(0, method_end);
+    std::string uri = first_line.substr(method_end + 1, path_end - method_end - 1);
+
+    // Split off query string
+    auto query = uri.find('?');
+    if (query != std::string::npos) {
+        request.query = uri.substr(query + 1);
+        uri = uri.substr(0, query);
+    }
+    request.path = uri;
+
+    // Headers
+    size_t pos = first_line_end + 2;
+    while (pos < header_end) {
+        auto line_end = raw.find("\r\n", pos);
+        std::string line = raw.substr(pos, line_end - pos);
+        pos = line_end + 2;
+
+        auto colon = line.find(':');
+        if (colon == std::string::npos) continue;
+        std::string name = line.substr(0, colon);
+        std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+        auto value_start = line.find_first_not_of(' ', colon + 1);
+        request.headers[name] = value_start == std::string::npos ? "" : line.substr(value_start);
+    }
 
-    std::string first_line = request.substr(0, first_line_end);
-    if (first_line.substr(0, 4) != "GET ") {
-        send_response(client_fd, 405, "Method Not Allowed", "text/plain", "Only GET supported");
-        return;
+    // Body (only what Content-Length announces)
+    size_t content_length = 0;
+    try {
+        std::string cl = request.header("content-length");
+        if (!cl.empty()) content_length = std::stoul(cl);
+    } catch (...) {
+        return false;
     }
+    if (content_length > max_body_size) return false;
 
-    auto path_start = first_line.find(' ') + 1;
-    auto path_end = first_line.find(' ', path_start);
-    std::string uri = first_line.substr(path_start, path_end - path_start);
+    request.body = raw.substr(header_end + 4);
+    while (request.body.size() < content_length) {
+        ssize_t n = recv(client_fd, buf, sizeof(buf), 0);
+        if (n <= 0) return false;
+        request.body.append(buf, static_cast<size_t>(n));
+    }
+    request.body.resize(content_length);
+    return true;
+}
 
-    // Strip query string
-    auto query = uri.find('?');
-    if (query != std::string::npos) {
-        uri = uri.substr(0, query);
+void HttpServer::handle_client(int client_fd) {
+    HttpRequest request;
+    if (!read_request(client_fd, request)) return;
+
+    for (auto& [prefix, handler] : routes_) {
+        if (request.path.compare(0, prefix.size(), prefix) == 0) {
+            // An exception escaping the client thread would terminate the process
+            HttpResponse response;
+            try {
+                response = handler(request);
+            } catch (const std::exception& e) {
+                spdlog::error("HTTP: {} {} failed: {}", request.method, request.path, e.what());
+                response = {500, "Internal Server Error", "text/plain", "Internal Server Error"};
+            }
+            send_response(client_fd, response.status, response.status_text,
+                          response.content_type, response.body);
+            return;
+        }
+    }
+
+    if (request.method != "GET") {
+        send_response(client_fd, 405, "Method Not Allowed", "text/plain", "Only GET supported");
+        return;
     }
 
     // Resolve file path
-    std::string file_path = resolve_path(uri);
+    std::string file_path = resolve_path(request.path);
     if (file_path.empty()) {
         send_response(client_fd, 404, "Not Found", "text/html",
             "<html><body><h1>404 Not Found</h1></body></html>");
@@ -3,23 +3,57 @@
 #include <string>
 #include <thread>
 #include <atomic>
+#include <functional>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace ss {
 
-// Minimal HTTP file server for serving the web viewer
+struct HttpRequest {
+    std::string method;
+    std::string path;     // without the query string
+    std::string query;
+    std::unordered_map<std::string, std::string> headers; // lower-case names
+    std::string body;
+
+    std::string header(const std::string& name) const {
+        auto it = headers.find(name);
+        return it != headers.end() ? it->second : "";
+    }
+};
+
+struct HttpResponse {
+    int status = 200;
+    std::string status_text = "OK";
+    std::string content_type = "application/json";
+    std::string body;
+};
+
+// Minimal HTTP file server for serving the web viewer.
+// Routes registered with add_route take precedence over files.
 class HttpServer {
 public:
+    using RouteHandler = std::function<HttpResponse(const HttpRequest& request)>;
+
     HttpServer(uint16_t port, const std::string& web_root);
     ~HttpServer();
 
+    // Send every request whose path starts with prefix to handler
+    // (any method). Call before start().
+    void add_route(const std::string& prefix, RouteHandler handler);
+
     bool start();
     void stop();
     bool is_running() const { return running_.load(); }
 
+    // Change port / web root (call while stopped)
+    void update_config(uint16_t port, const std::string& web_root);
+
 private:
     void server_thread();
     void handle_client(int client_fd);
+    bool read_request(int client_fd, HttpRequest& request);
     std::string resolve_path(const std::string& uri) const;
     std::string get_mime_type(const std::string& path) const;
     void send_response(int fd, int status, const std::string& status_text,
@@ -31,6 +65,7 @@ private:
     int server_fd_ = -1;
     std::atomic<bool> running_{false};
     std::thread thread_;
+    std::vector<std::pair<std::string, RouteHandler>> routes_;
 
     static const std::unordered_map<std::string, std::string> mime_types_;
 };
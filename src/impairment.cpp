@@ -0,0 +1,136 @@
+#include "impairment.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace ss {
+
+// Token bucket depth of the rate cap, in send time
+static constexpr double bucket_ms = 20.0;
+
+Impairment::Impairment(const ImpairmentConfig& config, uint32_t stream_index)
+    : config_(config)
+    , rng_(config.seed + stream_index * 0x9E3779B9u)
+    , last_refill_(Clock::now())
+{
+    tokens_ = config_.rate_kbps * 1000.0 / 8.0 * bucket_ms / 1000.0;
+}
+
+void Impairment::outgoing(rtc::message_vector& messages, const rtc::message_callback& send) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    send_ = send;
+
+    auto now = Clock::now();
+    for (auto& message : messages) {
+        if (message) {
+            admit(std::move(message), now);
+        }
+    }
+    messages.clear();
+    release(now);
+}
+
+void Impairment::submit(rtc::message_ptr message) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto now = Clock::now();
+    admit(std::move(message), now);
+    release(now);
+}
+
+void Impairment::flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (delayed_.empty() && rate_queue_.empty()) return;
+    release(Clock::now());
+}
+
+void Impairment::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    rate_queue_.clear();
+    rate_queued_bytes_ = 0;
+    delayed_ = {};
+    send_ = nullptr;
+}
+
+Impairment::Stats Impairment::get_stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void Impairment::admit(rtc::message_ptr message, Clock::time_point now) {
+    stats_.packets++;
+    if (lose()) {
+        stats_.lost++;
+        return;
+    }
+
+    if (config_.rate_kbps <= 0) {
+        schedule(std::move(message), now);
+        return;
+    }
+
+    // Drop-tail: a full bottleneck queue loses the newest packet
+    double limit = config_.rate_kbps * 1000.0 / 8.0 * config_.queue_ms / 1000.0;
+    if (rate_queued_bytes_ + message->size() > limit) {
+        stats_.queue_drops++;
+        return;
+    }
+    rate_queued_bytes_ += message->size();
+    rate_queue_.push_back(std::move(message));
+}
+
+bool Impairment::lose() {
+    double p = std::clamp(config_.loss_percent / 100.0, 0.0, 1.0);
+    if (p <= 0.0) return false;
+
+    if (config_.loss_model == "periodic") {
+        auto every = std::max<uint64_t>(1, static_cast<uint64_t>(std::llround(1.0 / p)));
+        return ++periodic_count_ % every == 0;
+    }
+
+    if (config_.loss_model == "burst" && p < 1.0) {
+        // Gilbert-Elliott with every packet lost in the bad state: leaving
+        // it sets the mean burst length, entering it the average loss
+        double exit = 1.0 / std::max(1.0, config_.burst_length);
+        double enter = p * exit / (1.0 - p);
+        double u = uniform_(rng_);
+        burst_active_ = burst_active_ ? u >= exit : u < enter;
+        return burst_active_;
+    }
+
+    return uniform_(rng_) < p;
+}
+
+void Impairment::schedule(rtc::message_ptr message, Clock::time_point now) {
+    double delay_ms = config_.delay_ms;
+    if (config_.jitter_ms > 0) {
+        delay_ms += (uniform_(rng_) * 2.0 - 1.0) * config_.jitter_ms;
+    }
+    auto delay = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double, std::milli>(std::max(0.0, delay_ms)));
+    delayed_.push(Delayed{now + delay, order_++, std::move(message)});
+}
+
+void Impairment::release(Clock::time_point now) {
+    if (config_.rate_kbps > 0) {
+        double bytes_per_sec = config_.rate_kbps * 1000.0 / 8.0;
+        double elapsed_s = std::chrono::duration<double>(now - last_refill_).count();
+        last_refill_ = now;
+        tokens_ = std::min(bytes_per_sec * bucket_ms / 1000.0, tokens_ + elapsed_s * bytes_per_sec);
+
+        while (!rate_queue_.empty() && tokens_ > 0) {
+            auto message = std::move(rate_queue_.front());
+            rate_queue_.pop_front();
+            rate_queued_bytes_ -= message->size();
+            tokens_ -= static_cast<double>(message->size());
+            schedule(std::move(message), now);
+        }
+    }
+
+    if (!send_) return;
+    while (!delayed_.empty() && delayed_.top().due <= now) {
+        auto message = delayed_.top().message;
+        delayed_.pop();
+        send_(std::move(message));
+    }
+}
+
+} // namespace ss
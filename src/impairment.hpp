@@ -0,0 +1,85 @@
+#pragma once
+
+#include "config.hpp"
+#include <rtc/rtc.hpp>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <vector>
+
+namespace ss {
+
+// Network impairment at the very end of a track's media handler chain, for
+// reproducible QoE tests without netem or root.
+//
+// Every outgoing packet (RTP, retransmissions and RTCP) goes through three
+// stages: loss (random, Gilbert-Elliott bursts or periodic), a token-bucket
+// rate cap with a drop-tail queue, then a fixed delay plus uniform jitter.
+// Jitter reorders packets the way netem does. All randomness comes from one
+// seeded generator, so the same seed and traffic give the same pattern.
+class Impairment final : public rtc::MediaHandler {
+public:
+    // stream_index is mixed into the seed so audio and video differ
+    Impairment(const ImpairmentConfig& config, uint32_t stream_index);
+
+    void outgoing(rtc::message_vector& messages, const rtc::message_callback& send) override;
+
+    // Entry point for packets released outside the chain (by the Pacer)
+    void submit(rtc::message_ptr message);
+
+    // Release packets whose delay has passed (called by a ticker)
+    void flush();
+
+    // Drop everything held back (peer is going away)
+    void clear();
+
+    struct Stats {
+        uint64_t packets = 0;       // offered
+        uint64_t lost = 0;          // dropped by the loss model
+        uint64_t queue_drops = 0;   // dropped by the rate cap's queue limit
+    };
+    Stats get_stats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Delayed {
+        Clock::time_point due;
+        uint64_t order;             // FIFO among equal due times
+        rtc::message_ptr message;
+        bool operator>(const Delayed& other) const {
+            return due != other.due ? due > other.due : order > other.order;
+        }
+    };
+
+    void admit(rtc::message_ptr message, Clock::time_point now);
+    bool lose();
+    void schedule(rtc::message_ptr message, Clock::time_point now);
+    void release(Clock::time_point now);
+
+    ImpairmentConfig config_;
+
+    mutable std::mutex mutex_;
+    rtc::message_callback send_;
+    std::mt19937 rng_;
+    std::uniform_real_distribution<double> uniform_{0.0, 1.0};
+
+    // Loss model state
+    bool burst_active_ = false;
+    uint64_t periodic_count_ = 0;
+
+    // Rate cap
+    std::deque<rtc::message_ptr> rate_queue_;
+    size_t rate_queued_bytes_ = 0;
+    double tokens_ = 0.0;
+    Clock::time_point last_refill_;
+
+    std::priority_queue<Delayed, std::vector<Delayed>, std::greater<Delayed>> delayed_;
+    uint64_t order_ = 0;
+
+    Stats stats_;
+};
+
+} // namespace ss
@@ -0,0 +1,114 @@
+#include "admin_client.hpp"
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace ss::loadgen {
+
+// Admin calls like a pipeline restart block until the work is done
+static constexpr int request_timeout_s = 30;
+
+AdminClient::AdminClient(const std::string& base_url, std::string token)
+    : token_(std::move(token))
+{
+    const std::string scheme = "http://";
+    if (base_url.compare(0, scheme.size(), scheme) != 0) return;
+
+    std::string authority = base_url.substr(scheme.size());
+    authority = authority.substr(0, authority.find('/'));
+    auto colon = authority.rfind(':');
+    host_ = authority.substr(0, colon);
+    int port = colon == std::string::npos ? 80 : std::atoi(authority.c_str() + colon + 1);
+    if (port > 0 && port < 65536) port_ = static_cast<uint16_t>(port);
+}
+
+bool AdminClient::get(const std::string& path, nlohmann::json& response, std::string& error) {
+    return request("GET", path, "", response, error);
+}
+
+bool AdminClient::post(const std::string& path, const nlohmann::json& body,
+                       nlohmann::json& response, std::string& error) {
+    return request("POST", path, body.dump(), response, error);
+}
+
+bool AdminClient::request(const std::string& method, const std::string& path,
+                          const std::string& body, nlohmann::json& response,
+                          std::string& error) {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* addrs = nullptr;
+    if (getaddrinfo(host_.c_str(), std::to_string(port_).c_str(), &hints, &addrs) != 0 || !addrs) {
+        error = "cannot resolve " + host_;
+        return false;
+    }
+
+    int fd = socket(addrs->ai_family, addrs->ai_socktype, addrs->ai_protocol);
+    bool connected = fd >= 0 && connect(fd, addrs->ai_addr, addrs->ai_addrlen) == 0;
+    freeaddrinfo(addrs);
+    if (!connected) {
+        error = "cannot connect to " + host_ + ":" + std::to_string(port_);
+        if (fd >= 0) close(fd);
+        return false;
+    }
+
+    timeval tv{request_timeout_s, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    std::string req = method + " " + path + " HTTP/1.0\r\n"
+                      "Host: " + host_ + "\r\n"
+                      "Authorization: Bearer " + token_ + "\r\n"
+                      "Content-Type: application/json\r\n"
+                      "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                      "Connection: close\r\n\r\n" + body;
+    size_t sent = 0;
+    while (sent < req.size()) {
+        ssize_t n = send(fd, req.data() + sent, req.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) {
+            error = std::string("send failed: ") + std::strerror(errno);
+            close(fd);
+            return false;
+        }
+        sent += static_cast<size_t>(n);
+    }
+
+    // The server closes the connection after the response
+    std::string raw;
+    char buf[4096];
+    ssize_t n;
+    while ((n = recv(fd, buf, sizeof(buf), 0)) > 0) {
+        raw.append(buf, static_cast<size_t>(n));
+    }
+    close(fd);
+
+    auto header_end = raw.find("\r\n\r\n");
+    int status = 0;
+    if (header_end == std::string::npos || std::sscanf(raw.c_str(), "HTTP/%*s %d", &status) != 1) {
+        error = "malformed response";
+        return false;
+    }
+
+    std::string payload = raw.substr(header_end + 4);
+    response = nlohmann::json::parse(payload, nullptr, false);
+    if (status < 200 || status >= 300) {
+        error = "HTTP " + std::to_string(status);
+        if (response.is_object() && response.contains("error")) {
+            error += ": " + response["error"].get<std::string>();
+        }
+        return false;
+    }
+    if (response.is_discarded()) {
+        error = "response is not JSON";
+        return false;
+    }
+    return true;
+}
+
+} // namespace ss::loadgen
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+#include <string>
+
+namespace ss::loadgen {
+
+// Minimal blocking client for the server's admin API (plain HTTP/1.0,
+// one connection per request). Enough for a test harness on localhost.
+class AdminClient {
+public:
+    // base_url like "http://127.0.0.1:8081"
+    AdminClient(const std::string& base_url, std::string token);
+
+    bool valid() const { return port_ != 0; }
+
+    // Returns false on transport errors or a non-2xx status; `error` says why
+    bool get(const std::string& path, nlohmann::json& response, std::string& error);
+    bool post(const std::string& path, const nlohmann::json& body,
+              nlohmann::json& response, std::string& error);
+
+private:
+    bool request(const std::string& method, const std::string& path, const std::string& body,
+                 nlohmann::json& response, std::string& error);
+
+    std::string host_;
+    uint16_t port_ = 0;
+    std::string token_;
+};
+
+} // namespace ss::loadgen
@@ -0,0 +1,187 @@
+#include "encoder_sweep.hpp"
+#include "admin_client.hpp"
+#include "synthetic_viewer.hpp"
+
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using json = nlohmann::json;
+
+namespace ss::loadgen {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Step {
+    bool per_peer = false;
+    int viewers = 0;
+    int receiving = 0;
+    int dedicated = 0;              // viewers on their own encoder
+    double cpu_percent = 0.0;       // server process, 100 = one core
+    double kbps = 0.0;              // mean per receiving viewer
+};
+
+bool sleep_for(std::chrono::milliseconds duration, const std::atomic<bool>& interrupted) {
+    auto end = Clock::now() + duration;
+    while (Clock::now() < end) {
+        if (interrupted.load()) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    return true;
+}
+
+const char* mode_name(bool per_peer) {
+    return per_peer ? "per-peer" : "shared";
+}
+
+// Server CPU over `duration`: /api/process reports usage since its
+// previous call, so the first read only starts the window
+bool measure_cpu(AdminClient& admin, std::chrono::seconds duration,
+                 const std::atomic<bool>& interrupted, double& cpu_percent) {
+    json response;
+    std::string error;
+    if (!admin.get("/api/process", response, error)) return false;
+    if (!sleep_for(duration, interrupted)) return false;
+    if (!admin.get("/api/process", response, error)) return false;
+    cpu_percent = response.value("cpu_percent", 0.0);
+    return true;
+}
+
+int dedicated_encoders(AdminClient& admin) {
+    json response;
+    std::string error;
+    if (!admin.get("/api/pipeline", response, error) || !response.contains("per_peer")) return 0;
+    return static_cast<int>(response["per_peer"].value("encoders", json::array()).size());
+}
+
+} // namespace
+
+int run_encoder_sweep(const EncoderSweepOptions& opts, const std::atomic<bool>& interrupted) {
+    AdminClient admin(opts.admin_url, opts.admin_token);
+    json response;
+    std::string error;
+    if (!admin.valid() || !admin.get("/api/pipeline", response, error)) {
+        spdlog::error("Encoder sweep needs the admin API ({})",
+                      admin.valid() ? error : "admin URL must look like http://host:port");
+        return 2;
+    }
+    if (!response.contains("per_peer")) {
+        spdlog::error("Encoder sweep: the server has no per-peer encoders");
+        return 2;
+    }
+    bool original = response["per_peer"].value("enabled", false);
+
+    auto apply = [&](bool per_peer) {
+        if (!admin.post("/api/source", json{{"per_peer", per_peer}}, response, error)) {
+            spdlog::error("Encoder sweep: cannot switch to {}: {}", mode_name(per_peer), error);
+            return false;
+        }
+        return true;
+    };
+
+    bool failed = false;
+    std::vector<Step> steps;
+    for (bool per_peer : {false, true}) {
+        if (interrupted.load()) break;
+        if (!apply(per_peer)) {
+            failed = true;
+            break;
+        }
+        // The pipeline restarts; let it settle before the idle baseline
+        sleep_for(std::chrono::seconds(opts.settle_s), interrupted);
+        spdlog::info("──── Encoder sweep: {} encode, 0 → {} viewer(s) ────",
+                     mode_name(per_peer), opts.peers);
+
+        std::vector<std::unique_ptr<SyntheticViewer>> viewers;
+        for (int n = 0; n <= opts.peers && !interrupted.load(); n++) {
+            if (n > 0) {
+                viewers.push_back(std::make_unique<SyntheticViewer>(
+                    n - 1, opts.url, std::chrono::milliseconds(opts.stall_ms)));
+                auto& viewer = viewers.back();
+                viewer->start();
+                auto deadline = Clock::now() + std::chrono::seconds(opts.timeout_s);
+                while (Clock::now() < deadline && !interrupted.load() &&
+                       !viewer->has_first_frame() && !viewer->finished()) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                }
+                // Per-peer encoders are admitted one per settle period
+                sleep_for(std::chrono::seconds(opts.settle_s), interrupted);
+            }
+
+            Step step;
+            step.per_peer = per_peer;
+            step.viewers = n;
+            if (!measure_cpu(admin, std::chrono::seconds(opts.duration_s), interrupted,
+                             step.cpu_percent)) {
+                if (!interrupted.load()) spdlog::error("Encoder sweep: /api/process failed");
+                failed = true;
+                break;
+            }
+            step.dedicated = dedicated_encoders(admin);
+            for (auto& v : viewers) {
+                if (!v->has_first_frame()) continue;
+                step.receiving++;
+                step.kbps += v->result().receive_kbps;
+            }
+            if (step.receiving > 0) step.kbps /= step.receiving;
+            failed = failed || step.receiving < n;
+            steps.push_back(step);
+
+            if (opts.json_output) {
+                std::cout << json{
+                    {"type", "encoder_sweep"}, {"mode", mode_name(per_peer)},
+                    {"viewers", step.viewers}, {"receiving", step.receiving},
+                    {"dedicated", step.dedicated}, {"cpu_percent", step.cpu_percent},
+                    {"kbps", step.kbps},
+                }.dump() << std::endl;
+            }
+        }
+        for (auto& v : viewers) v->stop();
+        if (failed) break;
+    }
+
+    if (!apply(original)) failed = true;
+
+    if (!opts.json_output && !steps.empty()) {
+        std::printf("\n%-9s %7s %5s %9s %8s %8s %9s\n", "mode", "viewers", "recv", "dedicated",
+                    "cpu_%", "delta_%", "kbps");
+        const Step* previous = nullptr;
+        for (auto& step : steps) {
+            char delta[16] = "-";
+            if (previous && previous->per_peer == step.per_peer) {
+                std::snprintf(delta, sizeof(delta), "%+.1f", step.cpu_percent - previous->cpu_percent);
+            }
+            std::printf("%-9s %7d %5d %9d %8.1f %8s %9.1f\n", mode_name(step.per_peer),
+                        step.viewers, step.receiving, step.dedicated, step.cpu_percent, delta,
+                        step.kbps);
+            previous = &step;
+        }
+
+        // Mean slope from the idle baseline, per mode
+        std::printf("\n");
+        for (bool per_peer : {false, true}) {
+            const Step* base = nullptr;
+            const Step* last = nullptr;
+            for (auto& step : steps) {
+                if (step.per_peer != per_peer) continue;
+                if (!base) base = &step;
+                last = &step;
+            }
+            if (!base || last == base) continue;
+            std::printf("%s encode: %+.1f%% CPU per added viewer\n", mode_name(per_peer),
+                        (last->cpu_percent - base->cpu_percent) / (last->viewers - base->viewers));
+        }
+        std::fflush(stdout);
+    }
+    return failed ? 1 : 0;
+}
+
+} // namespace ss::loadgen
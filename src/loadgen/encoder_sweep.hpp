@@ -0,0 +1,27 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+
+namespace ss::loadgen {
+
+struct EncoderSweepOptions {
+    std::string url = "ws://127.0.0.1:8080";
+    std::string admin_url = "http://127.0.0.1:8081";
+    std::string admin_token;
+    int peers = 4;                  // viewers added one at a time
+    int duration_s = 10;            // CPU measured over this, per step
+    int settle_s = 5;               // after each viewer joins (≥ per_peer.settle_ms)
+    int stall_ms = 200;
+    int timeout_s = 15;             // for the first frame
+    bool json_output = false;
+};
+
+// CPU per added viewer, shared encode against per-peer encoders. Switches
+// the server's encoding.per_peer through the admin API, then adds viewers
+// one at a time and reads the server's CPU from /api/process after each,
+// along with how many viewers got their own encoder. Restores the original
+// setting. Returns the process exit status.
+int run_encoder_sweep(const EncoderSweepOptions& opts, const std::atomic<bool>& interrupted);
+
+} // namespace ss::loadgen
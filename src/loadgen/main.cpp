@@ -0,0 +1,427 @@
+// stream-server-loadgen — headless synthetic viewers for capacity testing.
+//
+// Opens N WebRTC viewer sessions against a running stream-server, receives
+// and depacketizes the video, and reports per-viewer time-to-first-frame,
+// receive bitrate, frame gaps and delay along with the server's CPU and RSS.
+// With --soak it instead cycles viewers for hours and checks for drift, and
+// with --phases it breaks time-to-first-frame down by session setup phase.
+// --refresh-compare measures periodic IDRs against intra refresh, and
+// --encoder-sweep the CPU each added viewer costs with per-peer encoders.
+
+#include "synthetic_viewer.hpp"
+#include "soak.hpp"
+#include "phases.hpp"
+#include "refresh.hpp"
+#include "encoder_sweep.hpp"
+#include "proc_stats.hpp"
+
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using json = nlohmann::json;
+using ss::loadgen::SyntheticViewer;
+
+static constexpr int max_viewers = 64;
+
+static std::atomic<bool> g_interrupted{false};
+
+static void signal_handler(int) {
+    g_interrupted.store(true);
+}
+
+struct Options {
+    std::string url = "ws://127.0.0.1:8080";
+    std::vector<int> peer_counts = {1};
+    int duration_s = 20;
+    int ramp_ms = 100;
+    int stall_ms = 200;
+    int first_frame_timeout_s = 15;
+    pid_t server_pid = 0;
+    bool json_output = false;
+    bool soak = false;
+    ss::loadgen::SoakOptions soak_opts;
+    bool phases = false;
+    ss::loadgen::PhaseOptions phase_opts;
+    bool refresh_compare = false;
+    bool encoder_sweep = false;
+};
+
+struct ServerUsage {
+    bool valid = false;
+    double cpu_avg = 0.0;
+    double cpu_max = 0.0;
+    uint64_t rss_start_kb = 0;
+    uint64_t rss_max_kb = 0;
+};
+
+static void print_usage() {
+    std::cout << "Usage: stream-server-loadgen [options]\n"
+              << "Options:\n"
+              << "  -u, --url <ws-url>       Signaling URL (default: ws://127.0.0.1:8080)\n"
+              << "  -n, --peers <N>          Concurrent viewers, 1-64 (default: 1)\n"
+              << "  -s, --sweep <N,N,...>    One run per peer count, e.g. 1,2,4,8,16,32,64\n"
+              << "  -d, --duration <sec>     Receive time once all viewers started (default: 20)\n"
+              << "      --ramp-ms <ms>       Delay between viewer starts (default: 100)\n"
+              << "      --stall-ms <ms>      Frame gap counted as a stall (default: 200)\n"
+              << "      --server-pid <pid>   Server process to sample (default: find stream-server)\n"
+              << "      --json               One JSON report per run on stdout\n"
+              << "  -h, --help               Show this help\n"
+              << "\nSoak mode (needs the admin API):\n"
+              << "      --soak <min>         Cycle -n viewers for this long, then check trends\n"
+              << "      --cycle-s <sec>      Viewers connected per cycle (default: 60)\n"
+              << "      --settle-s <sec>     Idle time before sampling the server (default: 5)\n"
+              << "      --fail-every <N>     Restart the source mid-cycle every N cycles (default: 3)\n"
+              << "      --warmup-cycles <N>  Cycles left out of the trend fit (default: 3)\n"
+              << "      --replay <file>      Switch the server to this recording first\n"
+              << "      --admin-url <url>    Admin API (default: http://127.0.0.1:8081)\n"
+              << "      --admin-token <tok>  Bearer token (default: $ADMIN_TOKEN)\n"
+              << "      --limit <m=N,...>    Max upward trend per hour: rss_mb (16), heap_mb (16),\n"
+              << "                           fds (2), threads (2), delay_ms (20), ttff_ms (200)\n"
+              << "\nSetup phase mode:\n"
+              << "      --phases <N>         N sequential sessions, TTFF per setup phase\n"
+              << "      --phase-matrix       Repeat for trickle × GOP cache × pool (admin API)\n"
+              << "      --pool-size <N>      Pool size for the pooled runs (default: 2)\n"
+              << "      --gap-ms <ms>        Pause between sessions (default: 500)\n"
+              << "\nIntra refresh comparison (needs the admin API, re-encode mode):\n"
+              << "      --refresh-compare    -n viewers for -d seconds with periodic IDRs, then\n"
+              << "                           with intra refresh; frame size CV and delay p99\n"
+              << "\nPer-peer encoder cost (needs the admin API):\n"
+              << "      --encoder-sweep      Add -n viewers one at a time, shared encode then\n"
+              << "                           per-peer encoders; server CPU over -d seconds\n"
+              << "                           after each, and the cost per added viewer\n"
+              << "\nExit status is 1 if any admitted viewer never received a frame\n"
+              << "(soak: or any metric trended up past its limit).\n";
+}
+
+static bool parse_peer_list(const std::string& list, std::vector<int>& out) {
+    out.clear();
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        int n = std::stoi(item);
+        if (n < 1 || n > max_viewers) return false;
+        out.push_back(n);
+    }
+    return !out.empty();
+}
+
+static bool parse_limits(const std::string& list, ss::loadgen::SoakOptions& soak) {
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        auto eq = item.find('=');
+        if (eq == std::string::npos) return false;
+        std::string metric = item.substr(0, eq);
+        double limit = std::stod(item.substr(eq + 1));
+        if (metric == "rss_mb") soak.max_rss_mb_per_h = limit;
+        else if (metric == "heap_mb") soak.max_heap_mb_per_h = limit;
+        else if (metric == "fds") soak.max_fds_per_h = limit;
+        else if (metric == "threads") soak.max_threads_per_h = limit;
+        else if (metric == "delay_ms") soak.max_delay_ms_per_h = limit;
+        else if (metric == "ttff_ms") soak.max_ttff_ms_per_h = limit;
+        else return false;
+    }
+    return true;
+}
+
+static bool parse_args(int argc, char* argv[], Options& opts) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto next = [&]() -> std::string {
+            if (i + 1 >= argc) throw std::invalid_argument("missing value for " + arg);
+            return argv[++i];
+        };
+
+        if (arg == "-u" || arg == "--url") {
+            opts.url = next();
+        } else if (arg == "-n" || arg == "--peers" || arg == "-s" || arg == "--sweep") {
+            if (!parse_peer_list(next(), opts.peer_counts)) {
+                throw std::invalid_argument("peer counts must be between 1 and 64");
+            }
+        } else if (arg == "-d" || arg == "--duration") {
+            opts.duration_s = std::stoi(next());
+        } else if (arg == "--ramp-ms") {
+            opts.ramp_ms = std::stoi(next());
+        } else if (arg == "--stall-ms") {
+            opts.stall_ms = std::stoi(next());
+        } else if (arg == "--server-pid") {
+            opts.server_pid = static_cast<pid_t>(std::stoi(next()));
+        } else if (arg == "--json") {
+            opts.json_output = true;
+        } else if (arg == "--soak") {
+            opts.soak = true;
+            opts.soak_opts.duration_min = std::stoi(next());
+        } else if (arg == "--cycle-s") {
+            opts.soak_opts.cycle_s = std::stoi(next());
+        } else if (arg == "--settle-s") {
+            opts.soak_opts.settle_s = std::stoi(next());
+        } else if (arg == "--fail-every") {
+            opts.soak_opts.fail_every = std::stoi(next());
+        } else if (arg == "--warmup-cycles") {
+            opts.soak_opts.warmup_cycles = std::stoi(next());
+        } else if (arg == "--replay") {
+            opts.soak_opts.replay_file = next();
+        } else if (arg == "--admin-url") {
+            opts.soak_opts.admin_url = next();
+        } else if (arg == "--admin-token") {
+            opts.soak_opts.admin_token = next();
+        } else if (arg == "--limit") {
+            if (!parse_limits(next(), opts.soak_opts)) {
+                throw std::invalid_argument("limits look like rss_mb=16,fds=2");
+            }
+        } else if (arg == "--phases") {
+            opts.phases = true;
+            opts.phase_opts.joins = std::stoi(next());
+        } else if (arg == "--phase-matrix") {
+            opts.phase_opts.matrix = true;
+        } else if (arg == "--pool-size") {
+            opts.phase_opts.pool_size = std::stoi(next());
+        } else if (arg == "--gap-ms") {
+            opts.phase_opts.gap_ms = std::stoi(next());
+        } else if (arg == "--refresh-compare") {
+            opts.refresh_compare = true;
+        } else if (arg == "--encoder-sweep") {
+            opts.encoder_sweep = true;
+        } else if (arg == "-h" || arg == "--help") {
+            print_usage();
+            return false;
+        } else {
+            throw std::invalid_argument("unknown option " + arg);
+        }
+    }
+    return true;
+}
+
+static bool sleep_interruptible(std::chrono::milliseconds duration) {
+    auto end = std::chrono::steady_clock::now() + duration;
+    while (std::chrono::steady_clock::now() < end) {
+        if (g_interrupted.load()) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    return true;
+}
+
+// Returns true if every admitted viewer received at least one frame
+static bool run(const Options& opts, int peers) {
+    spdlog::info("──── {} viewer(s) → {} ────", peers, opts.url);
+
+    std::unique_ptr<ss::ProcStats> server_proc;
+    if (opts.server_pid > 0) {
+        server_proc = std::make_unique<ss::ProcStats>(opts.server_pid);
+    } else if (pid_t pid = ss::ProcStats::find_by_name("stream-server")) {
+        server_proc = std::make_unique<ss::ProcStats>(pid);
+    } else {
+        spdlog::warn("stream-server process not found, server usage will not be reported");
+    }
+
+    ServerUsage usage;
+    uint64_t cpu_samples = 0;
+    auto sample_server = [&]() {
+        if (!server_proc) return;
+        auto s = server_proc->sample();
+        if (!s.valid) return;
+        if (!usage.valid) {
+            usage.valid = true;
+            usage.rss_start_kb = s.rss_kb;
+        } else {
+            usage.cpu_avg += (s.cpu_percent - usage.cpu_avg) / static_cast<double>(++cpu_samples);
+            usage.cpu_max = std::max(usage.cpu_max, s.cpu_percent);
+        }
+        usage.rss_max_kb = std::max(usage.rss_max_kb, s.rss_kb);
+    };
+    sample_server();
+
+    std::vector<std::unique_ptr<SyntheticViewer>> viewers;
+    for (int i = 0; i < peers && !g_interrupted.load(); i++) {
+        viewers.push_back(std::make_unique<SyntheticViewer>(
+            i, opts.url, std::chrono::milliseconds(opts.stall_ms)));
+        viewers.back()->start();
+        sleep_interruptible(std::chrono::milliseconds(opts.ramp_ms));
+    }
+
+    // Wait for every viewer to get video (or give up), then measure
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(opts.first_frame_timeout_s);
+    while (std::chrono::steady_clock::now() < deadline && !g_interrupted.load()) {
+        bool all_ready = std::all_of(viewers.begin(), viewers.end(), [](auto& v) {
+            return v->has_first_frame() || v->finished();
+        });
+        if (all_ready) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    for (int s = 0; s < opts.duration_s && !g_interrupted.load(); s++) {
+        sleep_interruptible(std::chrono::seconds(1));
+        sample_server();
+    }
+
+    for (auto& v : viewers) v->stop();
+
+    // ─── Report ───────────────────────────────────────────────────────────
+    std::vector<SyntheticViewer::Result> results;
+    for (auto& v : viewers) results.push_back(v->result());
+
+    int admitted = 0, receiving = 0, rejected = 0;
+    double ttff_max = 0.0, kbps_total = 0.0, gap_max = 0.0, delay_p95_max = 0.0;
+    for (auto& r : results) {
+        if (r.rejected) { rejected++; continue; }
+        admitted++;
+        if (r.frames > 0) {
+            receiving++;
+            ttff_max = std::max(ttff_max, r.ttff_idr_ms >= 0 ? r.ttff_idr_ms : r.ttff_ms);
+            kbps_total += r.receive_kbps;
+            gap_max = std::max(gap_max, r.max_gap_ms);
+            delay_p95_max = std::max(delay_p95_max, r.delay_p95_ms);
+        }
+    }
+
+    if (opts.json_output) {
+        json report;
+        report["url"] = opts.url;
+        report["peers"] = peers;
+        report["admitted"] = admitted;
+        report["receiving"] = receiving;
+        report["rejected"] = rejected;
+        report["duration_s"] = opts.duration_s;
+        json list = json::array();
+        for (auto& r : results) {
+            list.push_back({
+                {"index", r.index}, {"peer_id", r.peer_id}, {"rejected", r.rejected},
+                {"connected", r.connected}, {"error", r.error},
+                {"ttff_ms", r.ttff_ms}, {"ttff_idr_ms", r.ttff_idr_ms},
+                {"frames", r.frames}, {"bytes", r.bytes}, {"receive_kbps", r.receive_kbps},
+                {"max_gap_ms", r.max_gap_ms}, {"stalls", r.stalls},
+                {"delay_p50_ms", r.delay_p50_ms}, {"delay_p95_ms", r.delay_p95_ms},
+                {"delay_p99_ms", r.delay_p99_ms}, {"delay_max_ms", r.delay_max_ms},
+                {"idr_frames", r.idr_frames}, {"frame_bytes_mean", r.frame_bytes_mean},
+                {"frame_bytes_cv", r.frame_bytes_cv}, {"frame_bytes_max", r.frame_bytes_max},
+            });
+        }
+        report["viewers"] = list;
+        if (usage.valid) {
+            report["server"] = {
+                {"cpu_avg_percent", usage.cpu_avg}, {"cpu_max_percent", usage.cpu_max},
+                {"rss_start_kb", usage.rss_start_kb}, {"rss_max_kb", usage.rss_max_kb},
+            };
+        }
+        std::cout << report.dump() << std::endl;
+    } else {
+        std::printf("%-4s %-14s %9s %9s %8s %10s %9s %7s %9s %9s %9s %7s  %s\n",
+                    "#", "peer", "ttff_ms", "idr_ms", "frames", "kbps", "gap_ms",
+                    "stalls", "dly_p50", "dly_p95", "dly_p99", "size_cv", "status");
+        for (auto& r : results) {
+            std::string status = r.rejected ? "rejected"
+                               : r.frames > 0 ? "ok"
+                               : r.error.empty() ? "no video" : r.error;
+            std::printf("%-4d %-14s %9.1f %9.1f %8llu %10.1f %9.1f %7llu %9.1f %9.1f %9.1f %7.2f  %s\n",
+                        r.index, r.peer_id.c_str(), r.ttff_ms, r.ttff_idr_ms,
+                        static_cast<unsigned long long>(r.frames), r.receive_kbps, r.max_gap_ms,
+                        static_cast<unsigned long long>(r.stalls),
+                        r.delay_p50_ms, r.delay_p95_ms, r.delay_p99_ms, r.frame_bytes_cv,
+                        status.c_str());
+        }
+        std::printf("\n%d/%d receiving, %d rejected | worst TTFF %.1f ms | total %.1f kbps | "
+                    "worst gap %.1f ms | worst delay p95 %.1f ms\n",
+                    receiving, admitted, rejected, ttff_max, kbps_total, gap_max, delay_p95_max);
+        if (usage.valid) {
+            std::printf("server: CPU %.1f%% avg / %.1f%% max | RSS %.1f → %.1f MB\n",
+                        usage.cpu_avg, usage.cpu_max,
+                        usage.rss_start_kb / 1024.0, usage.rss_max_kb / 1024.0);
+        }
+        std::fflush(stdout);
+    }
+
+    return receiving == admitted;
+}
+
+int main(int argc, char* argv[]) {
+    Options opts;
+    try {
+        if (!parse_args(argc, argv, opts)) return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "ERROR: " << e.what() << "\n\n";
+        print_usage();
+        return 2;
+    }
+
+    // Progress on stderr so stdout stays parseable
+    spdlog::set_default_logger(spdlog::stderr_color_mt("loadgen"));
+    spdlog::set_pattern("[%H:%M:%S.%e] [%^%l%$] %v");
+    rtc::InitLogger(rtc::LogLevel::Warning);
+
+    std::signal(SIGINT, signal_handler);
+    std::signal(SIGTERM, signal_handler);
+
+    if (opts.soak_opts.admin_token.empty()) {
+        if (const char* token = std::getenv("ADMIN_TOKEN")) opts.soak_opts.admin_token = token;
+    }
+
+    if (opts.soak) {
+        auto& soak = opts.soak_opts;
+        soak.url = opts.url;
+        soak.peers = opts.peer_counts.front();
+        soak.stall_ms = opts.stall_ms;
+        soak.server_pid = opts.server_pid;
+        soak.json_output = opts.json_output;
+        return ss::loadgen::run_soak(soak, g_interrupted);
+    }
+
+    if (opts.phases) {
+        auto& phases = opts.phase_opts;
+        phases.url = opts.url;
+        phases.admin_url = opts.soak_opts.admin_url;
+        phases.admin_token = opts.soak_opts.admin_token;
+        phases.timeout_s = opts.first_frame_timeout_s;
+        phases.json_output = opts.json_output;
+        return ss::loadgen::run_phases(phases, g_interrupted);
+    }
+
+    if (opts.refresh_compare) {
+        ss::loadgen::RefreshOptions refresh;
+        refresh.url = opts.url;
+        refresh.admin_url = opts.soak_opts.admin_url;
+        refresh.admin_token = opts.soak_opts.admin_token;
+        refresh.peers = opts.peer_counts.front();
+        refresh.duration_s = opts.duration_s;
+        refresh.settle_s = opts.soak_opts.settle_s;
+        refresh.stall_ms = opts.stall_ms;
+        refresh.timeout_s = opts.first_frame_timeout_s;
+        refresh.json_output = opts.json_output;
+        return ss::loadgen::run_refresh_compare(refresh, g_interrupted);
+    }
+
+    if (opts.encoder_sweep) {
+        ss::loadgen::EncoderSweepOptions sweep;
+        sweep.url = opts.url;
+        sweep.admin_url = opts.soak_opts.admin_url;
+        sweep.admin_token = opts.soak_opts.admin_token;
+        sweep.peers = opts.peer_counts.front();
+        sweep.duration_s = opts.duration_s;
+        sweep.settle_s = opts.soak_opts.settle_s;
+        sweep.stall_ms = opts.stall_ms;
+        sweep.timeout_s = opts.first_frame_timeout_s;
+        sweep.json_output = opts.json_output;
+        return ss::loadgen::run_encoder_sweep(sweep, g_interrupted);
+    }
+
+    bool ok = true;
+    for (int peers : opts.peer_counts) {
+        if (g_interrupted.load()) break;
+        ok = run(opts, peers) && ok;
+        // Let the server clean up the previous run's peers
+        if (&peers != &opts.peer_counts.back()) {
+            sleep_interruptible(std::chrono::seconds(3));
+        }
+    }
+    return ok ? 0 : 1;
+}
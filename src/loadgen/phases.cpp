@@ -0,0 +1,202 @@
+#include "phases.hpp"
+#include "admin_client.hpp"
+#include "synthetic_viewer.hpp"
+
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using json = nlohmann::json;
+
+namespace ss::loadgen {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct SetupConfig {
+    std::string name;
+    bool trickle_ice = true;
+    bool gop_cache = false;
+    int peer_pool_size = 0;
+};
+
+struct Distribution {
+    size_t n = 0;
+    double p50 = 0.0;
+    double p95 = 0.0;
+    double max = 0.0;
+};
+
+// Report order: the viewer's WebSocket open, the server's phases (ms since
+// it accepted that WebSocket), then the viewer's first decoded frame
+const std::vector<std::string> phase_order = {
+    "ws_open", "peer_created", "offer_sent", "answer_received", "ice_connected",
+    "dtls_connected", "track_open", "first_keyframe", "first_frame",
+};
+
+bool sleep_for(std::chrono::milliseconds duration, const std::atomic<bool>& interrupted) {
+    auto end = Clock::now() + duration;
+    while (Clock::now() < end) {
+        if (interrupted.load()) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    return true;
+}
+
+Distribution distribution(std::vector<double> values) {
+    Distribution d;
+    d.n = values.size();
+    if (values.empty()) return d;
+    std::sort(values.begin(), values.end());
+    d.p50 = values[static_cast<size_t>(0.50 * static_cast<double>(values.size() - 1))];
+    d.p95 = values[static_cast<size_t>(0.95 * static_cast<double>(values.size() - 1))];
+    d.max = values.back();
+    return d;
+}
+
+std::string describe(const SetupConfig& c) {
+    return std::string(c.trickle_ice ? "trickle" : "no-trickle") +
+           (c.gop_cache ? " gop-cache" : " no-gop-cache") +
+           " pool=" + std::to_string(c.peer_pool_size);
+}
+
+} // namespace
+
+int run_phases(const PhaseOptions& opts, const std::atomic<bool>& interrupted) {
+    AdminClient admin(opts.admin_url, opts.admin_token);
+    json response;
+    std::string error;
+
+    std::vector<SetupConfig> configs;
+    SetupConfig original{"current"};
+    if (opts.matrix) {
+        if (!admin.valid() || !admin.get("/api/webrtc", response, error)) {
+            spdlog::error("Phases: the matrix needs the admin API ({})",
+                          admin.valid() ? error : "admin URL must look like http://host:port");
+            return 2;
+        }
+        original.trickle_ice = response.value("trickle_ice", true);
+        original.gop_cache = response.value("gop_cache", false);
+        original.peer_pool_size = response.value("peer_pool_size", 0);
+
+        for (bool trickle : {true, false}) {
+            for (bool gop : {false, true}) {
+                for (int pool : {0, opts.pool_size}) {
+                    SetupConfig c{"", trickle, gop, pool};
+                    c.name = describe(c);
+                    configs.push_back(c);
+                }
+            }
+        }
+    } else {
+        configs.push_back(original);
+    }
+
+    auto apply = [&](const SetupConfig& c) {
+        json body = {{"trickle_ice", c.trickle_ice}, {"gop_cache", c.gop_cache},
+                     {"peer_pool_size", c.peer_pool_size}};
+        if (!admin.post("/api/webrtc", body, response, error)) {
+            spdlog::error("Phases: cannot apply {}: {}", describe(c), error);
+            return false;
+        }
+        // The server fills its pool one peer per 100 ms
+        sleep_for(std::chrono::milliseconds(500 + 150 * c.peer_pool_size), interrupted);
+        return true;
+    };
+
+    bool failed = false;
+    std::vector<std::pair<std::string, std::map<std::string, Distribution>>> table;
+
+    for (auto& config : configs) {
+        if (interrupted.load()) break;
+        if (opts.matrix && !apply(config)) {
+            failed = true;
+            break;
+        }
+        spdlog::info("──── Phases: {} × {} ────", config.name, opts.joins);
+
+        std::map<std::string, std::vector<double>> samples;
+        int ok = 0, pooled = 0;
+        for (int j = 0; j < opts.joins && !interrupted.load(); j++) {
+            // One session at a time, so phases are not skewed by each other
+            auto viewer = std::make_unique<SyntheticViewer>(j, opts.url, std::chrono::milliseconds(200));
+            viewer->start();
+            auto deadline = Clock::now() + std::chrono::seconds(opts.timeout_s);
+            while (Clock::now() < deadline && !interrupted.load() && !viewer->finished() &&
+                   !(viewer->has_first_frame() && viewer->has_timeline())) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+            viewer->stop();
+            auto r = viewer->result();
+
+            if (r.frames == 0) {
+                spdlog::warn("Phases: session {} got no video{}", j,
+                             r.error.empty() ? "" : " (" + r.error + ")");
+            } else {
+                ok++;
+                samples["first_frame"].push_back(r.ttff_ms);
+            }
+            if (r.ws_open_ms >= 0) samples["ws_open"].push_back(r.ws_open_ms);
+            for (auto& [phase, ms] : r.server_phases) {
+                if (ms >= 0) samples[phase].push_back(ms);
+            }
+            if (r.pooled) pooled++;
+
+            sleep_for(std::chrono::milliseconds(opts.gap_ms), interrupted);
+        }
+        failed = failed || ok < opts.joins;
+
+        std::map<std::string, Distribution> dists;
+        for (auto& phase : phase_order) dists[phase] = distribution(samples[phase]);
+        table.emplace_back(config.name, dists);
+
+        if (opts.json_output) {
+            json phases = json::object();
+            for (auto& phase : phase_order) {
+                auto& d = dists[phase];
+                phases[phase] = {{"n", d.n}, {"p50_ms", d.p50}, {"p95_ms", d.p95}, {"max_ms", d.max}};
+            }
+            std::cout << json{
+                {"type", "phases"}, {"config", config.name},
+                {"trickle_ice", config.trickle_ice}, {"gop_cache", config.gop_cache},
+                {"peer_pool_size", config.peer_pool_size}, {"joins", opts.joins},
+                {"receiving", ok}, {"pooled", pooled}, {"phases", phases},
+            }.dump() << std::endl;
+        } else {
+            std::printf("\n%s: %d/%d with video, %d pooled\n", config.name.c_str(), ok,
+                        opts.joins, pooled);
+            std::printf("%-16s %4s %9s %9s %9s\n", "phase", "n", "p50_ms", "p95_ms", "max_ms");
+            for (auto& phase : phase_order) {
+                auto& d = dists[phase];
+                std::printf("%-16s %4zu %9.1f %9.1f %9.1f\n", phase.c_str(), d.n, d.p50, d.p95, d.max);
+            }
+            std::fflush(stdout);
+        }
+    }
+
+    if (opts.matrix) {
+        if (!apply(original)) failed = true;
+
+        if (!opts.json_output && !table.empty()) {
+            std::printf("\n%-34s %12s %12s %12s %12s\n", "configuration",
+                        "keyframe_p50", "keyframe_p95", "frame_p50", "frame_p95");
+            for (auto& [name, dists] : table) {
+                std::printf("%-34s %12.1f %12.1f %12.1f %12.1f\n", name.c_str(),
+                            dists["first_keyframe"].p50, dists["first_keyframe"].p95,
+                            dists["first_frame"].p50, dists["first_frame"].p95);
+            }
+            std::fflush(stdout);
+        }
+    }
+    return failed ? 1 : 0;
+}
+
+} // namespace ss::loadgen
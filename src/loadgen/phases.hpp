@@ -0,0 +1,29 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+
+namespace ss::loadgen {
+
+struct PhaseOptions {
+    std::string url = "ws://127.0.0.1:8080";
+    std::string admin_url = "http://127.0.0.1:8081";
+    std::string admin_token;
+    int joins = 20;                 // sequential sessions per configuration
+    int gap_ms = 500;               // between sessions, lets the pool refill
+    int timeout_s = 15;             // per session, for the first frame
+    bool matrix = false;            // sweep trickle × GOP cache × pool via the admin API
+    int pool_size = 2;              // peer_pool_size for the pooled configurations
+    bool json_output = false;
+};
+
+// Time-to-first-frame broken down by setup phase. Opens one viewer at a
+// time, collects the server's timeline (WebSocket accept → peer created →
+// offer sent → answer received → ICE connected → DTLS done → track open →
+// first keyframe sent) plus the viewer's own WebSocket open and first
+// decoded frame, and reports p50/p95/max per phase. With `matrix` every
+// session setup combination is measured in turn and the server's settings
+// are restored afterwards. Returns the process exit status.
+int run_phases(const PhaseOptions& opts, const std::atomic<bool>& interrupted);
+
+} // namespace ss::loadgen
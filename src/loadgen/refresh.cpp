@@ -0,0 +1,176 @@
+#include "refresh.hpp"
+#include "admin_client.hpp"
+#include "synthetic_viewer.hpp"
+
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using json = nlohmann::json;
+
+namespace ss::loadgen {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct ModeResult {
+    bool intra_refresh = false;
+    int receiving = 0;
+    double seconds = 0.0;
+    uint64_t frames = 0;
+    uint64_t idr_frames = 0;
+    double kbps = 0.0;              // mean per viewer
+    double frame_bytes_cv = 0.0;    // frame-weighted over viewers
+    uint64_t frame_bytes_max = 0;
+    double delay_p95_ms = 0.0;      // worst viewer
+    double delay_p99_ms = 0.0;
+    uint64_t keyframes_forced = 0;  // server side, during the run
+};
+
+bool sleep_for(std::chrono::milliseconds duration, const std::atomic<bool>& interrupted) {
+    auto end = Clock::now() + duration;
+    while (Clock::now() < end) {
+        if (interrupted.load()) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    return true;
+}
+
+const char* mode_name(bool intra_refresh) {
+    return intra_refresh ? "intra-refresh" : "periodic-idr";
+}
+
+uint64_t keyframes_forced(AdminClient& admin) {
+    json response;
+    std::string error;
+    if (!admin.get("/api/pipeline", response, error)) return 0;
+    return response.value("keyframes_forced_for_peers", uint64_t{0});
+}
+
+} // namespace
+
+int run_refresh_compare(const RefreshOptions& opts, const std::atomic<bool>& interrupted) {
+    AdminClient admin(opts.admin_url, opts.admin_token);
+    json response;
+    std::string error;
+    if (!admin.valid() || !admin.get("/api/pipeline", response, error)) {
+        spdlog::error("Refresh compare needs the admin API ({})",
+                      admin.valid() ? error : "admin URL must look like http://host:port");
+        return 2;
+    }
+    if (response.value("mode", "") == "passthrough") {
+        spdlog::error("Refresh compare: the server relays the camera's GOP (passthrough), "
+                      "switch it to re-encode first");
+        return 2;
+    }
+    bool original = response.value("intra_refresh", false);
+
+    auto apply = [&](bool intra_refresh) {
+        if (!admin.post("/api/source", json{{"intra_refresh", intra_refresh}}, response, error)) {
+            spdlog::error("Refresh compare: cannot switch to {}: {}", mode_name(intra_refresh), error);
+            return false;
+        }
+        return true;
+    };
+
+    bool failed = false;
+    std::vector<ModeResult> results;
+    for (bool intra_refresh : {false, true}) {
+        if (interrupted.load()) break;
+        if (!apply(intra_refresh)) {
+            failed = true;
+            break;
+        }
+        // The pipeline restarts; let the encoder settle before measuring
+        sleep_for(std::chrono::seconds(opts.settle_s), interrupted);
+        spdlog::info("──── Refresh compare: {} × {} viewer(s), {} s ────",
+                     mode_name(intra_refresh), opts.peers, opts.duration_s);
+
+        std::vector<std::unique_ptr<SyntheticViewer>> viewers;
+        for (int i = 0; i < opts.peers; i++) {
+            viewers.push_back(std::make_unique<SyntheticViewer>(
+                i, opts.url, std::chrono::milliseconds(opts.stall_ms)));
+            viewers.back()->start();
+        }
+        auto deadline = Clock::now() + std::chrono::seconds(opts.timeout_s);
+        while (Clock::now() < deadline && !interrupted.load() &&
+               !std::all_of(viewers.begin(), viewers.end(),
+                            [](auto& v) { return v->has_first_frame() || v->finished(); })) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+
+        // Joins force IDRs under intra refresh; only count the steady state
+        uint64_t forced_before = keyframes_forced(admin);
+        auto start = Clock::now();
+        sleep_for(std::chrono::seconds(opts.duration_s), interrupted);
+        ModeResult m;
+        m.intra_refresh = intra_refresh;
+        m.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        m.keyframes_forced = keyframes_forced(admin) - forced_before;
+        for (auto& v : viewers) v->stop();
+
+        double cv_weighted = 0.0;
+        for (auto& v : viewers) {
+            auto r = v->result();
+            if (r.frames == 0) continue;
+            m.receiving++;
+            m.frames += r.frames;
+            m.idr_frames += r.idr_frames;
+            m.kbps += r.receive_kbps;
+            cv_weighted += r.frame_bytes_cv * static_cast<double>(r.frames);
+            m.frame_bytes_max = std::max(m.frame_bytes_max, r.frame_bytes_max);
+            m.delay_p95_ms = std::max(m.delay_p95_ms, r.delay_p95_ms);
+            m.delay_p99_ms = std::max(m.delay_p99_ms, r.delay_p99_ms);
+        }
+        if (m.receiving > 0) {
+            m.kbps /= m.receiving;
+            m.frame_bytes_cv = cv_weighted / static_cast<double>(m.frames);
+        }
+        failed = failed || m.receiving < opts.peers;
+        results.push_back(m);
+
+        if (opts.json_output) {
+            std::cout << json{
+                {"type", "refresh"}, {"mode", mode_name(m.intra_refresh)},
+                {"peers", opts.peers}, {"receiving", m.receiving}, {"seconds", m.seconds},
+                {"frames", m.frames}, {"idr_frames", m.idr_frames}, {"kbps", m.kbps},
+                {"frame_bytes_cv", m.frame_bytes_cv}, {"frame_bytes_max", m.frame_bytes_max},
+                {"delay_p95_ms", m.delay_p95_ms}, {"delay_p99_ms", m.delay_p99_ms},
+                {"keyframes_forced", m.keyframes_forced},
+            }.dump() << std::endl;
+        }
+    }
+
+    if (!apply(original)) failed = true;
+
+    if (!opts.json_output && !results.empty()) {
+        std::printf("\n%-14s %5s %8s %9s %8s %10s %9s %9s %7s\n", "mode", "recv", "idr", "kbps",
+                    "size_cv", "max_bytes", "dly_p95", "dly_p99", "forced");
+        for (auto& m : results) {
+            std::printf("%-14s %5d %8llu %9.1f %8.2f %10llu %9.1f %9.1f %7llu\n",
+                        mode_name(m.intra_refresh), m.receiving,
+                        static_cast<unsigned long long>(m.idr_frames), m.kbps, m.frame_bytes_cv,
+                        static_cast<unsigned long long>(m.frame_bytes_max),
+                        m.delay_p95_ms, m.delay_p99_ms,
+                        static_cast<unsigned long long>(m.keyframes_forced));
+        }
+        if (results.size() == 2 && results[0].frame_bytes_cv > 0) {
+            auto& idr = results[0];
+            auto& refresh = results[1];
+            std::printf("\nintra refresh: frame size CV %+.0f%%, delay p99 %+.1f ms\n",
+                        (refresh.frame_bytes_cv / idr.frame_bytes_cv - 1.0) * 100.0,
+                        refresh.delay_p99_ms - idr.delay_p99_ms);
+        }
+        std::fflush(stdout);
+    }
+    return failed ? 1 : 0;
+}
+
+} // namespace ss::loadgen
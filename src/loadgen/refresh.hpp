@@ -0,0 +1,28 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+
+namespace ss::loadgen {
+
+struct RefreshOptions {
+    std::string url = "ws://127.0.0.1:8080";
+    std::string admin_url = "http://127.0.0.1:8081";
+    std::string admin_token;
+    int peers = 4;
+    int duration_s = 30;            // per mode, once every viewer has video
+    int settle_s = 5;               // after the pipeline rebuild
+    int stall_ms = 200;
+    int timeout_s = 15;             // for the first frame
+    bool json_output = false;
+};
+
+// Periodic IDRs against intra refresh on the same source. Switches the
+// server's encoding.intra_refresh through the admin API (the pipeline is
+// re-encoding), receives with `peers` viewers in each mode and compares
+// frame-size variation (coefficient of variation, largest frame) and the
+// delay tail (p95/p99), then restores the original setting. Returns the
+// process exit status.
+int run_refresh_compare(const RefreshOptions& opts, const std::atomic<bool>& interrupted);
+
+} // namespace ss::loadgen
@@ -0,0 +1,296 @@
+#include "soak.hpp"
+#include "admin_client.hpp"
+#include "synthetic_viewer.hpp"
+#include "proc_stats.hpp"
+
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using json = nlohmann::json;
+
+namespace ss::loadgen {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct CycleSample {
+    int cycle = 0;
+    double elapsed_h = 0.0;
+    bool restarted = false;
+    // Server, sampled idle after the wave
+    bool server_valid = false;
+    double rss_mb = 0.0;
+    double heap_mb = -1.0;          // -1 = allocator stats unavailable
+    double fds = 0.0;
+    double threads = 0.0;
+    // Viewers, worst over the wave
+    int admitted = 0;
+    int receiving = 0;
+    double ttff_ms = 0.0;
+    double delay_p50_ms = 0.0;
+    double delay_p95_ms = 0.0;
+    uint64_t stalls = 0;
+};
+
+struct Trend {
+    std::string metric;
+    double slope_per_h = 0.0;
+    double limit_per_h = 0.0;
+    bool fitted = false;
+    bool failed = false;
+};
+
+bool sleep_for(std::chrono::milliseconds duration, const std::atomic<bool>& interrupted) {
+    auto end = Clock::now() + duration;
+    while (Clock::now() < end) {
+        if (interrupted.load()) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    return true;
+}
+
+// Least-squares slope of y over x; false with fewer than two distinct x
+bool fit_slope(const std::vector<double>& x, const std::vector<double>& y, double& slope) {
+    size_t n = x.size();
+    if (n < 2) return false;
+    double mx = 0, my = 0;
+    for (size_t i = 0; i < n; i++) {
+        mx += x[i];
+        my += y[i];
+    }
+    mx /= n;
+    my /= n;
+    double sxx = 0, sxy = 0;
+    for (size_t i = 0; i < n; i++) {
+        sxx += (x[i] - mx) * (x[i] - mx);
+        sxy += (x[i] - mx) * (y[i] - my);
+    }
+    if (sxx <= 0) return false;
+    slope = sxy / sxx;
+    return true;
+}
+
+// Fewer points than this make a trend meaningless
+constexpr size_t min_fit_samples = 4;
+
+} // namespace
+
+int run_soak(const SoakOptions& opts, const std::atomic<bool>& interrupted) {
+    AdminClient admin(opts.admin_url, opts.admin_token);
+    if (!admin.valid()) {
+        spdlog::error("Soak: admin URL must look like http://host:port");
+        return 2;
+    }
+
+    json response;
+    std::string error;
+    if (!opts.replay_file.empty()) {
+        if (!admin.post("/api/source", {{"replay_file", opts.replay_file}}, response, error)) {
+            spdlog::error("Soak: cannot switch the server to {}: {}", opts.replay_file, error);
+            return 2;
+        }
+        spdlog::info("Soak: server now replays {}", opts.replay_file);
+    }
+
+    // Allocator stats only come from the admin API; /proc is the fallback
+    bool admin_process = admin.get("/api/process", response, error);
+    std::unique_ptr<ProcStats> server_proc;
+    if (!admin_process) {
+        spdlog::warn("Soak: /api/process unavailable ({}), reading /proc without heap stats", error);
+        pid_t pid = opts.server_pid > 0 ? opts.server_pid : ProcStats::find_by_name("stream-server");
+        if (pid > 0) server_proc = std::make_unique<ProcStats>(pid);
+    }
+    if (!admin_process && !server_proc) {
+        spdlog::warn("Soak: server process not found, only viewer metrics are tracked");
+    }
+
+    auto sample_server = [&](CycleSample& s) {
+        if (admin_process && admin.get("/api/process", response, error)) {
+            s.server_valid = true;
+            s.rss_mb = response.value("rss_kb", 0.0) / 1024.0;
+            s.fds = response.value("open_fds", 0.0);
+            s.threads = response.value("threads", 0.0);
+            if (response.contains("heap")) {
+                s.heap_mb = response["heap"].value("in_use_kb", 0.0) / 1024.0;
+            }
+        } else if (server_proc) {
+            auto p = server_proc->sample();
+            if (!p.valid) return;
+            s.server_valid = true;
+            s.rss_mb = p.rss_kb / 1024.0;
+            s.fds = static_cast<double>(p.open_fds);
+            s.threads = static_cast<double>(p.threads);
+        }
+    };
+
+    spdlog::info("──── Soak: {} min, {} viewer(s) per {}s cycle, source restart every {} ────",
+                 opts.duration_min, opts.peers, opts.cycle_s,
+                 opts.fail_every > 0 ? std::to_string(opts.fail_every) + " cycles" : "never");
+
+    if (!opts.json_output) {
+        std::printf("%-5s %7s %8s %8s %5s %7s %7s %9s %9s %9s %6s  %s\n",
+                    "cycle", "min", "rss_mb", "heap_mb", "fds", "threads", "video",
+                    "ttff_ms", "dly_p50", "dly_p95", "stalls", "note");
+        std::fflush(stdout);
+    }
+
+    std::vector<CycleSample> samples;
+    int cycles_without_video = 0;
+    auto start = Clock::now();
+    auto end = start + std::chrono::minutes(opts.duration_min);
+
+    for (int cycle = 1; Clock::now() < end && !interrupted.load(); cycle++) {
+        CycleSample s;
+        s.cycle = cycle;
+        s.restarted = opts.fail_every > 0 && cycle % opts.fail_every == 0;
+
+        std::vector<std::unique_ptr<SyntheticViewer>> viewers;
+        for (int i = 0; i < opts.peers && !interrupted.load(); i++) {
+            viewers.push_back(std::make_unique<SyntheticViewer>(
+                i, opts.url, std::chrono::milliseconds(opts.stall_ms)));
+            viewers.back()->start();
+            sleep_for(std::chrono::milliseconds(100), interrupted);
+        }
+
+        // Fail the source halfway through, while viewers are watching
+        auto half = std::chrono::milliseconds(opts.cycle_s * 500);
+        sleep_for(half, interrupted);
+        if (s.restarted && !interrupted.load()) {
+            if (!admin.post("/api/pipeline/restart", json::object(), response, error)) {
+                spdlog::warn("Soak: source restart failed: {}", error);
+            }
+        }
+        sleep_for(half, interrupted);
+
+        for (auto& v : viewers) v->stop();
+        for (auto& v : viewers) {
+            auto r = v->result();
+            if (r.rejected) continue;
+            s.admitted++;
+            if (r.frames == 0) continue;
+            s.receiving++;
+            s.ttff_ms = std::max(s.ttff_ms, r.ttff_idr_ms >= 0 ? r.ttff_idr_ms : r.ttff_ms);
+            s.delay_p50_ms = std::max(s.delay_p50_ms, r.delay_p50_ms);
+            s.delay_p95_ms = std::max(s.delay_p95_ms, r.delay_p95_ms);
+            s.stalls += r.stalls;
+        }
+        viewers.clear();
+        if (s.receiving < s.admitted) cycles_without_video++;
+
+        // Let the server drop the peers before measuring its footprint
+        sleep_for(std::chrono::seconds(opts.settle_s), interrupted);
+        sample_server(s);
+        s.elapsed_h = std::chrono::duration<double, std::ratio<3600>>(Clock::now() - start).count();
+        samples.push_back(s);
+
+        std::string note = cycle <= opts.warmup_cycles ? "warmup" : "";
+        if (s.restarted) note += note.empty() ? "restart" : ",restart";
+
+        if (opts.json_output) {
+            std::cout << json{
+                {"type", "cycle"}, {"cycle", s.cycle}, {"elapsed_h", s.elapsed_h},
+                {"restarted", s.restarted}, {"server_valid", s.server_valid},
+                {"rss_mb", s.rss_mb}, {"heap_mb", s.heap_mb}, {"fds", s.fds},
+                {"threads", s.threads}, {"admitted", s.admitted}, {"receiving", s.receiving},
+                {"ttff_ms", s.ttff_ms}, {"delay_p50_ms", s.delay_p50_ms},
+                {"delay_p95_ms", s.delay_p95_ms}, {"stalls", s.stalls},
+            }.dump() << std::endl;
+        } else {
+            std::printf("%-5d %7.1f %8.1f %8.1f %5.0f %7.0f %3d/%-3d %9.1f %9.1f %9.1f %6llu  %s\n",
+                        s.cycle, s.elapsed_h * 60.0, s.rss_mb, s.heap_mb, s.fds, s.threads,
+                        s.receiving, s.admitted, s.ttff_ms, s.delay_p50_ms, s.delay_p95_ms,
+                        static_cast<unsigned long long>(s.stalls), note.c_str());
+            std::fflush(stdout);
+        }
+    }
+
+    // ─── Verdict ─────────────────────────────────────────────────────────────
+    std::vector<CycleSample> fit;
+    for (auto& s : samples) {
+        if (s.cycle > opts.warmup_cycles) fit.push_back(s);
+    }
+
+    auto trend = [&](const std::string& metric, double limit,
+                     const std::function<bool(const CycleSample&, double&)>& value) {
+        Trend t;
+        t.metric = metric;
+        t.limit_per_h = limit;
+        std::vector<double> x, y;
+        for (auto& s : fit) {
+            double v;
+            if (!value(s, v)) continue;
+            x.push_back(s.elapsed_h);
+            y.push_back(v);
+        }
+        if (x.size() >= min_fit_samples && fit_slope(x, y, t.slope_per_h)) {
+            t.fitted = true;
+            t.failed = t.slope_per_h > limit;
+        }
+        return t;
+    };
+
+    std::vector<Trend> trends = {
+        trend("rss_mb", opts.max_rss_mb_per_h, [](auto& s, double& v) {
+            v = s.rss_mb; return s.server_valid; }),
+        trend("heap_mb", opts.max_heap_mb_per_h, [](auto& s, double& v) {
+            v = s.heap_mb; return s.server_valid && s.heap_mb >= 0; }),
+        trend("fds", opts.max_fds_per_h, [](auto& s, double& v) {
+            v = s.fds; return s.server_valid; }),
+        trend("threads", opts.max_threads_per_h, [](auto& s, double& v) {
+            v = s.threads; return s.server_valid; }),
+        trend("delay_p95_ms", opts.max_delay_ms_per_h, [](auto& s, double& v) {
+            v = s.delay_p95_ms; return s.receiving > 0; }),
+        trend("ttff_ms", opts.max_ttff_ms_per_h, [](auto& s, double& v) {
+            v = s.ttff_ms; return s.receiving > 0; }),
+    };
+
+    bool failed = cycles_without_video > 0;
+    bool any_fitted = false;
+    for (auto& t : trends) {
+        failed = failed || t.failed;
+        any_fitted = any_fitted || t.fitted;
+    }
+
+    if (opts.json_output) {
+        json list = json::array();
+        for (auto& t : trends) {
+            list.push_back({{"metric", t.metric}, {"fitted", t.fitted},
+                            {"slope_per_h", t.slope_per_h}, {"limit_per_h", t.limit_per_h},
+                            {"failed", t.failed}});
+        }
+        std::cout << json{
+            {"type", "verdict"}, {"cycles", samples.size()}, {"fitted_cycles", fit.size()},
+            {"cycles_without_video", cycles_without_video}, {"trends", list},
+            {"passed", !failed},
+        }.dump() << std::endl;
+    } else {
+        std::printf("\n%-14s %12s %12s  %s\n", "metric", "trend/h", "limit/h", "status");
+        for (auto& t : trends) {
+            std::printf("%-14s %12.2f %12.2f  %s\n", t.metric.c_str(), t.slope_per_h,
+                        t.limit_per_h, !t.fitted ? "not enough samples"
+                                       : t.failed ? "FAIL" : "ok");
+        }
+        if (cycles_without_video > 0) {
+            std::printf("%d cycle(s) had viewers without video\n", cycles_without_video);
+        }
+        std::printf("\nsoak %s after %zu cycle(s)\n", failed ? "FAILED" : "passed", samples.size());
+        std::fflush(stdout);
+    }
+
+    if (!any_fitted) {
+        spdlog::warn("Soak: fewer than {} cycles after warmup, trends were not checked",
+                     min_fit_samples);
+    }
+    return failed ? 1 : 0;
+}
+
+} // namespace ss::loadgen
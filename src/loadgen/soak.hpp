@@ -0,0 +1,40 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <sys/types.h>
+
+namespace ss::loadgen {
+
+struct SoakOptions {
+    std::string url = "ws://127.0.0.1:8080";
+    std::string admin_url = "http://127.0.0.1:8081";
+    std::string admin_token;
+    std::string replay_file;        // switch the server to this recording first
+    int duration_min = 60;
+    int peers = 4;                  // viewers per cycle
+    int cycle_s = 60;               // how long each wave of viewers stays
+    int settle_s = 5;               // idle time before sampling the server
+    int fail_every = 3;             // restart the source mid-cycle every N cycles (0 = never)
+    int warmup_cycles = 3;          // left out of the trend fit
+    int stall_ms = 200;
+    pid_t server_pid = 0;
+    bool json_output = false;
+
+    // Largest tolerated upward trend, per hour of soak
+    double max_rss_mb_per_h = 16.0;
+    double max_heap_mb_per_h = 16.0;
+    double max_fds_per_h = 2.0;
+    double max_threads_per_h = 2.0;
+    double max_delay_ms_per_h = 20.0;
+    double max_ttff_ms_per_h = 200.0;
+};
+
+// Cycles waves of viewers against a running server for the whole duration,
+// forcing periodic source failures, and samples the server's RSS, fds,
+// threads and heap plus the viewers' latency after every wave. Fails if a
+// metric's least-squares trend rises faster than its limit, or if any
+// viewer got no video. Returns the process exit status.
+int run_soak(const SoakOptions& opts, const std::atomic<bool>& interrupted);
+
+} // namespace ss::loadgen
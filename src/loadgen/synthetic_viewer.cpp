@@ -0,0 +1,238 @@
+#include "synthetic_viewer.hpp"
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cmath>
+
+using json = nlohmann::json;
+
+namespace ss::loadgen {
+
+static constexpr double rtp_clock_rate = 90000.0;
+
+static bool contains_idr(const rtc::binary& frame) {
+    // Annex-B start codes from the depacketizer; NAL type 5 = IDR slice
+    for (size_t i = 0; i + 3 < frame.size(); i++) {
+        if (frame[i] == std::byte{0} && frame[i + 1] == std::byte{0} && frame[i + 2] == std::byte{1}) {
+            if ((std::to_integer<uint8_t>(frame[i + 3]) & 0x1F) == 5) return true;
+            i += 2;
+        }
+    }
+    return false;
+}
+
+static double percentile(std::vector<double> values, double p) {
+    if (values.empty()) return 0.0;
+    size_t idx = static_cast<size_t>(p * static_cast<double>(values.size() - 1));
+    std::nth_element(values.begin(), values.begin() + static_cast<long>(idx), values.end());
+    return values[idx];
+}
+
+SyntheticViewer::SyntheticViewer(int index, std::string url, std::chrono::milliseconds stall_threshold)
+    : index_(index)
+    , url_(std::move(url))
+    , stall_threshold_(stall_threshold)
+{
+    result_.index = index;
+}
+
+SyntheticViewer::~SyntheticViewer() {
+    stop();
+}
+
+void SyntheticViewer::start() {
+    start_time_ = Clock::now();
+
+    // Loopback only: host candidates are enough, no STUN/TURN
+    rtc::Configuration config;
+    pc_ = std::make_shared<rtc::PeerConnection>(config);
+
+    pc_->onLocalDescription([this](rtc::Description description) {
+        json msg;
+        msg["type"] = description.typeString();
+        msg["sdp"] = std::string(description);
+        if (ws_ && ws_->isOpen()) ws_->send(msg.dump());
+    });
+
+    pc_->onLocalCandidate([this](rtc::Candidate candidate) {
+        json msg;
+        msg["type"] = "candidate";
+        msg["data"] = {{"candidate", std::string(candidate)}, {"sdpMid", candidate.mid()}};
+        if (ws_ && ws_->isOpen()) ws_->send(msg.dump());
+    });
+
+    pc_->onStateChange([this](rtc::PeerConnection::State state) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (state == rtc::PeerConnection::State::Connected) {
+            result_.connected = true;
+        } else if (state == rtc::PeerConnection::State::Failed) {
+            result_.error = "peer connection failed";
+            finished_.store(true);
+        }
+    });
+
+    pc_->onTrack([this](std::shared_ptr<rtc::Track> track) {
+        on_track(std::move(track));
+    });
+
+    // Keep the server's DataChannels alive; their content is not measured
+    pc_->onDataChannel([this](std::shared_ptr<rtc::DataChannel> channel) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        channels_.push_back(std::move(channel));
+    });
+
+    ws_ = std::make_shared<rtc::WebSocket>();
+    ws_->onOpen([this]() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        result_.ws_open_ms = std::chrono::duration<double, std::milli>(
+            Clock::now() - start_time_).count();
+    });
+    ws_->onMessage([this](rtc::message_variant data) {
+        if (std::holds_alternative<std::string>(data)) {
+            on_signaling_message(std::get<std::string>(data));
+        }
+    });
+    ws_->onError([this](std::string error) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (result_.error.empty()) result_.error = "websocket: " + error;
+        finished_.store(true);
+    });
+    ws_->open(url_);
+}
+
+void SyntheticViewer::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopped_) return;
+        stopped_ = true;
+        stop_time_ = Clock::now();
+    }
+
+    if (video_track_) video_track_->onFrame(nullptr);
+    if (pc_) pc_->close();
+    if (ws_) ws_->close();
+}
+
+void SyntheticViewer::on_signaling_message(const std::string& text) {
+    auto msg = json::parse(text, nullptr, false);
+    if (msg.is_discarded()) return;
+    std::string type = msg.value("type", "");
+
+    try {
+        if (type == "welcome") {
+            std::lock_guard<std::mutex> lock(mutex_);
+            result_.peer_id = msg.value("peerId", "");
+        } else if (type == "offer") {
+            // Auto-negotiation answers through onLocalDescription
+            pc_->setRemoteDescription(rtc::Description(msg.value("sdp", ""), "offer"));
+        } else if (type == "candidate") {
+            auto data = msg.value("data", json::object());
+            pc_->addRemoteCandidate(rtc::Candidate(data.value("candidate", ""),
+                                                   data.value("sdpMid", "0")));
+        } else if (type == "timeline") {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (auto& [phase, ms] : msg.value("phases", json::object()).items()) {
+                if (ms.is_number()) result_.server_phases[phase] = ms.get<double>();
+            }
+            result_.pooled = msg.value("pooled", false);
+            timeline_.store(true);
+        } else if (type == "error") {
+            std::lock_guard<std::mutex> lock(mutex_);
+            result_.rejected = true;
+            result_.error = msg.value("message", "rejected");
+            finished_.store(true);
+        }
+    } catch (const std::exception& e) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        result_.error = std::string("signaling: ") + e.what();
+        finished_.store(true);
+    }
+}
+
+void SyntheticViewer::on_track(std::shared_ptr<rtc::Track> track) {
+    if (track->description().type() != "video") return;
+
+    auto depacketizer = std::make_shared<rtc::H264RtpDepacketizer>(
+        rtc::NalUnit::Separator::LongStartSequence);
+    depacketizer->addToChain(std::make_shared<rtc::RtcpReceivingSession>());
+    track->setMediaHandler(depacketizer);
+
+    track->onFrame([this](rtc::binary data, rtc::FrameInfo info) {
+        on_frame(data, info.timestamp);
+    });
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    video_track_ = std::move(track);
+}
+
+void SyntheticViewer::on_frame(const rtc::binary& data, uint32_t rtp_timestamp) {
+    auto now = Clock::now();
+    bool idr = contains_idr(data);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopped_) return;
+
+    auto since_start_ms = std::chrono::duration<double, std::milli>(now - start_time_).count();
+    if (result_.frames == 0) {
+        first_frame_time_ = now;
+        result_.ttff_ms = since_start_ms;
+        first_frame_.store(true);
+    } else {
+        double gap_ms = std::chrono::duration<double, std::milli>(now - last_frame_time_).count();
+        result_.max_gap_ms = std::max(result_.max_gap_ms, gap_ms);
+        if (gap_ms > static_cast<double>(stall_threshold_.count())) {
+            result_.stalls++;
+        }
+    }
+    if (idr && result_.ttff_idr_ms < 0) {
+        result_.ttff_idr_ms = since_start_ms;
+    }
+    if (idr) result_.idr_frames++;
+    frame_bytes_sq_ += static_cast<double>(data.size()) * static_cast<double>(data.size());
+    result_.frame_bytes_max = std::max<uint64_t>(result_.frame_bytes_max, data.size());
+
+    // Arrival time minus media time, both relative to the first frame.
+    // RTP timestamps are unwrapped through the signed frame-to-frame delta.
+    if (result_.frames > 0) {
+        media_ticks_ += static_cast<int32_t>(rtp_timestamp - last_rtp_);
+    }
+    last_rtp_ = rtp_timestamp;
+    double media_ms = static_cast<double>(media_ticks_) * 1000.0 / rtp_clock_rate;
+    double arrival_ms = std::chrono::duration<double, std::milli>(now - first_frame_time_).count();
+    delays_ms_.push_back(arrival_ms - media_ms);
+
+    result_.frames++;
+    result_.bytes += data.size();
+    last_frame_time_ = now;
+}
+
+SyntheticViewer::Result SyntheticViewer::result() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Result r = result_;
+
+    if (r.frames > 0) {
+        auto end = stopped_ ? stop_time_ : Clock::now();
+        double seconds = std::chrono::duration<double>(end - first_frame_time_).count();
+        if (seconds > 0) r.receive_kbps = static_cast<double>(r.bytes) * 8.0 / 1000.0 / seconds;
+
+        double n = static_cast<double>(r.frames);
+        r.frame_bytes_mean = static_cast<double>(r.bytes) / n;
+        double variance = std::max(0.0, frame_bytes_sq_ / n - r.frame_bytes_mean * r.frame_bytes_mean);
+        if (r.frame_bytes_mean > 0) r.frame_bytes_cv = std::sqrt(variance) / r.frame_bytes_mean;
+    }
+
+    if (!delays_ms_.empty()) {
+        // Relative to the fastest frame, which is the best available baseline
+        double base = *std::min_element(delays_ms_.begin(), delays_ms_.end());
+        std::vector<double> above;
+        above.reserve(delays_ms_.size());
+        for (double d : delays_ms_) above.push_back(d - base);
+        r.delay_p50_ms = percentile(above, 0.50);
+        r.delay_p95_ms = percentile(above, 0.95);
+        r.delay_p99_ms = percentile(above, 0.99);
+        r.delay_max_ms = *std::max_element(above.begin(), above.end());
+    }
+    return r;
+}
+
+} // namespace ss::loadgen
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <rtc/rtc.hpp>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace ss::loadgen {
+
+// One headless viewer: signals against the server like the web viewer does,
+// receives the video track and depacketizes it into frames.
+class SyntheticViewer {
+public:
+    struct Result {
+        int index = 0;
+        std::string peer_id;
+        bool rejected = false;       // server full
+        bool connected = false;
+        std::string error;
+        double ws_open_ms = -1.0;    // connect → signaling WebSocket open
+        double ttff_ms = -1.0;       // connect → first frame
+        double ttff_idr_ms = -1.0;   // connect → first frame with an IDR
+        uint64_t frames = 0;
+        uint64_t bytes = 0;
+        double receive_kbps = 0.0;   // from first frame to stop
+        double max_gap_ms = 0.0;     // longest gap between frames
+        uint64_t stalls = 0;         // gaps longer than the stall threshold
+        // One-way delay above the fastest frame (RTP timestamp vs arrival).
+        // On loopback this is the server's queuing and send latency.
+        double delay_p50_ms = 0.0;
+        double delay_p95_ms = 0.0;
+        double delay_p99_ms = 0.0;
+        double delay_max_ms = 0.0;
+        // Frame sizes: IDR bursts show up as a high coefficient of variation
+        uint64_t idr_frames = 0;
+        double frame_bytes_mean = 0.0;
+        double frame_bytes_cv = 0.0;     // stddev / mean
+        uint64_t frame_bytes_max = 0;
+        // Server's setup timeline ("timeline" message): phase → ms since it
+        // accepted the WebSocket. Empty if the server did not send one.
+        std::map<std::string, double> server_phases;
+        bool pooled = false;         // server handed out a pre-gathered peer
+    };
+
+    SyntheticViewer(int index, std::string url, std::chrono::milliseconds stall_threshold);
+    ~SyntheticViewer();
+
+    // Non-copyable
+    SyntheticViewer(const SyntheticViewer&) = delete;
+    SyntheticViewer& operator=(const SyntheticViewer&) = delete;
+
+    void start();
+    void stop();
+
+    bool has_first_frame() const { return first_frame_.load(); }
+    bool finished() const { return finished_.load(); }
+    bool has_timeline() const { return timeline_.load(); }
+
+    Result result() const;
+
+private:
+    void on_signaling_message(const std::string& text);
+    void on_track(std::shared_ptr<rtc::Track> track);
+    void on_frame(const rtc::binary& data, uint32_t rtp_timestamp);
+
+    using Clock = std::chrono::steady_clock;
+
+    int index_;
+    std::string url_;
+    std::chrono::milliseconds stall_threshold_;
+
+    std::shared_ptr<rtc::WebSocket> ws_;
+    std::shared_ptr<rtc::PeerConnection> pc_;
+    std::shared_ptr<rtc::Track> video_track_;
+    std::vector<std::shared_ptr<rtc::DataChannel>> channels_;
+
+    std::atomic<bool> first_frame_{false};
+    std::atomic<bool> finished_{false};
+    std::atomic<bool> timeline_{false};
+
+    mutable std::mutex mutex_;
+    Result result_;
+    Clock::time_point start_time_;
+    Clock::time_point first_frame_time_;
+    Clock::time_point last_frame_time_;
+    Clock::time_point stop_time_;
+    bool stopped_ = false;
+    uint32_t last_rtp_ = 0;
+    int64_t media_ticks_ = 0;        // unwrapped RTP time since the first frame
+    std::vector<double> delays_ms_;   // arrival − RTP time, offset by the first frame
+    double frame_bytes_sq_ = 0.0;     // Σ size², for the variance
+};
+
+} // namespace ss::loadgen
@@ -9,6 +9,16 @@
 
 namespace ss {
 
+inline spdlog::level::level_enum parse_log_level(const std::string& level) {
+    if (level == "trace") return spdlog::level::trace;
+    if (level == "debug") return spdlog::level::debug;
+    if (level == "info") return spdlog::level::info;
+    if (level == "warn") return spdlog::level::warn;
+    if (level == "error") return spdlog::level::err;
+    if (level == "critical") return spdlog::level::critical;
+    return spdlog::level::info;
+}
+
 inline void init_logger(const LoggingConfig& cfg) {
     std::vector<spdlog::sink_ptr> sinks;
 
@@ -30,14 +40,7 @@ inline void init_logger(const LoggingConfig& cfg) {
 
     auto logger = std::make_shared<spdlog::logger>("stream-server", sinks.begin(), sinks.end());
 
-    // Set level
-    if (cfg.level == "trace") logger->set_level(spdlog::level::trace);
-    else if (cfg.level == "debug") logger->set_level(spdlog::level::debug);
-    else if (cfg.level == "info") logger->set_level(spdlog::level::info);
-    else if (cfg.level == "warn") logger->set_level(spdlog::level::warn);
-    else if (cfg.level == "error") logger->set_level(spdlog::level::err);
-    else if (cfg.level == "critical") logger->set_level(spdlog::level::critical);
-    else logger->set_level(spdlog::level::info);
+    logger->set_level(parse_log_level(cfg.level));
 
     logger->flush_on(spdlog::level::warn);
     spdlog::set_default_logger(logger);
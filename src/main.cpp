@@ -4,6 +4,13 @@
 #include "webrtc_server.hpp"
 #include "signaling_server.hpp"
 #include "http_server.hpp"
+#include "telemetry_ingest.hpp"
+#include "control_forwarder.hpp"
+#include "config_reloader.hpp"
+#include "bitrate_policy.hpp"
+#include "admin_api.hpp"
+#include "mosaic_stream.hpp"
+#include "startup.hpp"
 
 #include <spdlog/spdlog.h>
 #include <csignal>
@@ -14,12 +21,18 @@
 
 // ─── Global shutdown flag ─────────────────────────────────────────────────────
 static std::atomic<bool> g_shutdown{false};
+static std::atomic<bool> g_reload{false};
 
 static void signal_handler(int sig) {
     spdlog::info("Received signal {} — shutting down gracefully...", sig);
     g_shutdown.store(true);
 }
 
+// Only flags the request; the reload itself runs on the main loop
+static void reload_handler(int) {
+    g_reload.store(true);
+}
+
 static void print_banner(const ss::AppConfig& cfg) {
     std::cout << R"(
   ┌─────────────────────────────────────────────┐
@@ -31,7 +44,13 @@ static void print_banner(const ss::AppConfig& cfg) {
 
     spdlog::info("Configuration:");
     spdlog::info("  Signaling port  : {}", cfg.server.signaling_port);
-    spdlog::info("  RTSP URL        : {}", cfg.rtsp.url.empty() ? "(test mode)" : cfg.rtsp.url);
+    if (!cfg.replay.file.empty()) {
+        spdlog::info("  Replay          : {} ({}, {})", cfg.replay.file,
+                     cfg.replay.speed > 0 ? std::to_string(cfg.replay.speed) + "x" : std::string("unpaced"),
+                     cfg.replay.loop ? "loop" : "once");
+    } else {
+        spdlog::info("  RTSP URL        : {}", cfg.rtsp.url.empty() ? "(test mode)" : cfg.rtsp.url);
+    }
     spdlog::info("  Transport       : {}", cfg.rtsp.transport);
     spdlog::info("  Codec           : {}", cfg.webrtc.video.codec);
     spdlog::info("  Bitrate         : {} kbps (max: {} kbps)",
@@ -39,13 +58,40 @@ static void print_banner(const ss::AppConfig& cfg) {
     spdlog::info("  Max peers       : {}", cfg.webrtc.max_peers);
     spdlog::info("  STUN            : {}", cfg.webrtc.stun_server);
     spdlog::info("  TURN            : {}", cfg.webrtc.turn_server.empty() ? "(disabled)" : cfg.webrtc.turn_server);
-    spdlog::info("  HW encode       : {}", cfg.encoding.hw_encode ? "yes (Jetson)" : "no (software)");
+    spdlog::info("  Encoder         : {}{}", cfg.encoding.encoder,
+                 cfg.encoding.hw_encode ? " (prefer hardware)" : "");
     spdlog::info("  Passthrough     : {}", cfg.encoding.passthrough ? "yes" : "no");
+    spdlog::info("  Audio           : {}", cfg.audio.enabled
+                 ? cfg.audio.source_codec + " → Opus " + std::to_string(cfg.audio.bitrate_kbps) + " kbps"
+                 : std::string("(disabled)"));
     spdlog::info("  HTTP port       : {}", cfg.server.http_port);
     spdlog::info("  Web root        : {}", cfg.server.web_root);
+    if (cfg.telemetry.enabled) {
+        spdlog::info("  Telemetry       : {}", cfg.telemetry.ingest == "unix"
+                     ? "unix://" + cfg.telemetry.unix_path
+                     : "udp://" + cfg.telemetry.udp_bind + ":" + std::to_string(cfg.telemetry.udp_port));
+    } else {
+        spdlog::info("  Telemetry       : (disabled)");
+    }
+    spdlog::info("  Control         : {}", cfg.control.enabled
+                 ? "unix://" + cfg.control.backend_path : std::string("(disabled)"));
+    spdlog::info("  Pacing          : {}", cfg.webrtc.pacing.enabled ? "yes" : "no");
+    spdlog::info("  Session setup   : trickle ICE {} | GOP cache {} | peer pool {}",
+                 cfg.webrtc.trickle_ice ? "yes" : "no", cfg.webrtc.gop_cache ? "yes" : "no",
+                 cfg.webrtc.peer_pool_size);
+    if (cfg.webrtc.impairment.enabled) {
+        const auto& imp = cfg.webrtc.impairment;
+        spdlog::info("  Impairment      : {} loss {}% | delay {}±{} ms | rate {} | seed {}",
+                     imp.loss_model, imp.loss_percent, imp.delay_ms, imp.jitter_ms,
+                     imp.rate_kbps > 0 ? std::to_string(imp.rate_kbps) + " kbps" : "unlimited",
+                     imp.seed);
+    }
+    spdlog::info("  Admin API       : {}", cfg.admin.enabled ? "/api/ (token auth)" : "(disabled)");
 }
 
 int main(int argc, char* argv[]) {
+    ss::StartupTimer startup;
+
     // ─── Parse arguments ──────────────────────────────────────────────────────
     std::string config_path = "config.yaml";
     for (int i = 1; i < argc; i++) {
@@ -59,6 +105,7 @@ int main(int argc, char* argv[]) {
                       << "  -h, --help             Show this help\n"
                       << "\nEnvironment variables:\n"
                       << "  RTSP_URL               RTSP camera URL\n"
+                      << "  REPLAY_FILE            Play a recording instead of the camera\n"
                       << "  SIGNALING_PORT         WebSocket signaling port\n"
                       << "  STUN_SERVER            STUN server URL\n"
                       << "  TURN_SERVER            TURN server URL\n"
@@ -66,7 +113,8 @@ int main(int argc, char* argv[]) {
                       << "  TURN_CREDENTIAL        TURN credential\n"
                       << "  VIDEO_BITRATE_KBPS     Video bitrate in kbps\n"
                       << "  VIDEO_MAX_BITRATE_KBPS Max video bitrate in kbps\n"
-                      << "  LOG_LEVEL              Log level (trace/debug/info/warn/error)\n";
+                      << "  LOG_LEVEL              Log level (trace/debug/info/warn/error)\n"
+                      << "  ADMIN_TOKEN            Bearer token for the /api/ admin endpoints\n";
             return 0;
         }
     }
@@ -83,48 +131,273 @@ int main(int argc, char* argv[]) {
     // ─── Initialize logger ────────────────────────────────────────────────────
     ss::init_logger(config.logging);
     print_banner(config);
+    startup.mark("config");
+
+    // Before anything can call gst_init (the pipeline thread does)
+    ss::configure_gstreamer(config.startup);
 
     // ─── Signal handling ──────────────────────────────────────────────────────
     std::signal(SIGINT, signal_handler);
     std::signal(SIGTERM, signal_handler);
+    std::signal(SIGHUP, reload_handler);
 
     // ─── Create components ────────────────────────────────────────────────────
     ss::WebRtcServer webrtc_server(config);
     ss::SignalingServer signaling_server(config, webrtc_server);
     ss::RtspPipeline rtsp_pipeline(config);
     ss::HttpServer http_server(config.server.http_port, config.server.web_root);
+    ss::TelemetryIngest telemetry_ingest(config.telemetry);
+    ss::ControlForwarder control_forwarder(config.control);
 
     // ─── Wire RTSP → WebRTC ───────────────────────────────────────────────────
+    // The first frame is when the server is actually ready to stream
+    std::atomic<bool> first_frame{false};
+    bool ready_on_first_frame = config.startup.ready_on_first_frame;
     rtsp_pipeline.set_nal_callback(
+        [&webrtc_server, &first_frame, &startup, ready_on_first_frame](
+            const uint8_t* data, size_t size, uint64_t timestamp_us, uint64_t capture_us) {
+            webrtc_server.broadcast_nal(data, size, timestamp_us, capture_us);
+            if (!first_frame.load(std::memory_order_relaxed) && !first_frame.exchange(true)) {
+                startup.mark("first frame");
+                ss::notify_systemd(ready_on_first_frame ? "READY=1\nSTATUS=Streaming"
+                                                        : "STATUS=Streaming");
+            }
+        }
+    );
+
+    // A reconfigured camera: peers switch over at the next IDR
+    rtsp_pipeline.set_format_callback([&webrtc_server](const ss::h264::Sps& sps, bool idr) {
+        webrtc_server.on_source_format(sps, idr);
+    });
+
+    // Wire camera audio → WebRTC, transcode only while someone listens.
+    // Always wired so audio can be enabled by a config reload.
+    rtsp_pipeline.set_audio_callback(
         [&webrtc_server](const uint8_t* data, size_t size, uint64_t timestamp_us) {
-            webrtc_server.broadcast_nal(data, size, timestamp_us);
+            webrtc_server.broadcast_audio(data, size, timestamp_us);
+        }
+    );
+    webrtc_server.set_audio_demand_callback(
+        [&rtsp_pipeline](bool active) {
+            rtsp_pipeline.set_audio_enabled(active);
         }
     );
 
-    // Wire browser ABR → encoder bitrate control
-    signaling_server.set_bitrate_callback(
+    // Wire browser PLIs / new viewers → (coalesced) IDR requests
+    webrtc_server.set_keyframe_request_callback(
+        [&rtsp_pipeline]() {
+            return rtsp_pipeline.request_keyframe();
+        }
+    );
+
+    // Wire local telemetry → DataChannel (stamped on the video media clock)
+    telemetry_ingest.set_message_callback(
+        [&webrtc_server](const std::string& message) {
+            webrtc_server.broadcast_telemetry(message);
+        }
+    );
+
+    // Wire control channels ↔ robot backend
+    webrtc_server.set_control_callback(
+        [&control_forwarder](const std::string& peer_id, int64_t seq, const std::string& command) {
+            return control_forwarder.forward(peer_id, seq, command);
+        }
+    );
+    control_forwarder.set_reply_callback(
+        [&webrtc_server](const std::string& peer_id, const std::string& reply) {
+            webrtc_server.send_control(peer_id, reply);
+        }
+    );
+
+    // Wire browser ABR and scene complexity → bitrate policy → encoder bitrate
+    ss::BitratePolicy bitrate_policy(config,
         [&rtsp_pipeline](int bitrate_kbps) {
             rtsp_pipeline.set_bitrate(bitrate_kbps);
         }
     );
+    // Viewers with their own encoder (encoding.per_peer) steer it directly
+    signaling_server.set_bitrate_callback(
+        [&bitrate_policy, &rtsp_pipeline](const std::string& peer_id, int bitrate_kbps) {
+            if (rtsp_pipeline.peer_encoders().set_bitrate(peer_id, bitrate_kbps)) return;
+            bitrate_policy.on_peer_request(bitrate_kbps);
+        }
+    );
+    rtsp_pipeline.set_complexity_callback(
+        [&bitrate_policy](const ss::SceneComplexity::Estimate& estimate) {
+            bitrate_policy.on_complexity(estimate.score);
+        }
+    );
+
+    // Wire the multi-camera mosaic → its viewers
+    ss::MosaicStream mosaic(config);
+    mosaic.set_frame_callback(
+        [&webrtc_server](const uint8_t* data, size_t size, uint64_t timestamp_us) {
+            webrtc_server.broadcast_foreign_nal(ss::MosaicStream::stream_id, data, size, timestamp_us);
+        }
+    );
+    mosaic.set_return_callback(
+        [&rtsp_pipeline, &webrtc_server](const std::string& peer_id) {
+            rtsp_pipeline.peer_encoders().set_excluded(peer_id, false);
+            webrtc_server.set_peer_stream(peer_id, rtsp_pipeline.peer_encoders().stream_for(peer_id));
+        }
+    );
+    // Wire named stream requests (set_stream) → mosaic, preview or main
+    signaling_server.set_stream_callback(
+        [&rtsp_pipeline, &webrtc_server, &mosaic](const std::string& peer_id,
+                                                 const std::string& stream, std::string& error) {
+            auto& preview = rtsp_pipeline.preview();
+            bool to_mosaic = stream == ss::MosaicStream::stream_id;
+            bool to_preview = stream == ss::PreviewStream::stream_id;
+            if (!to_mosaic && !to_preview && stream != "main") {
+                error = "unknown stream " + stream;
+                return false;
+            }
+            if (to_mosaic && !mosaic.subscribe(peer_id, error)) return false;
+            if (to_preview && !preview.subscribe(peer_id, error)) return false;
+
+            // One view at a time: leave a zoom, the other rendition or a
+            // per-peer encoder
+            if (!to_mosaic) mosaic.unsubscribe(peer_id);
+            if (!to_preview) preview.unsubscribe(peer_id);
+            rtsp_pipeline.roi_streams().unsubscribe(peer_id);
+            bool to_main = stream == "main";
+            rtsp_pipeline.peer_encoders().set_excluded(peer_id, !to_main);
+            webrtc_server.set_peer_stream(peer_id, to_main
+                ? rtsp_pipeline.peer_encoders().stream_for(peer_id) : stream);
+            return true;
+        }
+    );
+
+    // Wire the preview rendition → its viewers
+    rtsp_pipeline.preview().set_frame_callback(
+        [&webrtc_server](const uint8_t* data, size_t size, uint64_t timestamp_us, bool own_clock) {
+            if (own_clock) {
+                webrtc_server.broadcast_foreign_nal(ss::PreviewStream::stream_id, data, size, timestamp_us);
+            } else {
+                webrtc_server.broadcast_stream_nal(ss::PreviewStream::stream_id, data, size, timestamp_us);
+            }
+        }
+    );
+    rtsp_pipeline.preview().set_return_callback(
+        [&rtsp_pipeline, &webrtc_server](const std::string& peer_id) {
+            rtsp_pipeline.peer_encoders().set_excluded(peer_id, false);
+            webrtc_server.set_peer_stream(peer_id, rtsp_pipeline.peer_encoders().stream_for(peer_id));
+        }
+    );
+
+    // Wire ROI (digital zoom) requests → per-region encodes → their viewers
+    signaling_server.set_roi_callback(
+        [&rtsp_pipeline, &webrtc_server, &mosaic](const std::string& peer_id, const ss::Roi& roi,
+                                                  std::string& error) {
+            std::string stream;
+            if (!rtsp_pipeline.roi_streams().subscribe(peer_id, roi, stream, error)) return false;
+            mosaic.unsubscribe(peer_id);
+            rtsp_pipeline.preview().unsubscribe(peer_id);
+            // A zoomed viewer gives up its per-peer encoder until it zooms out
+            rtsp_pipeline.peer_encoders().set_excluded(peer_id, !stream.empty());
+            if (stream.empty()) stream = rtsp_pipeline.peer_encoders().stream_for(peer_id);
+            webrtc_server.set_peer_stream(peer_id, stream);
+            return true;
+        }
+    );
+    rtsp_pipeline.roi_streams().set_frame_callback(
+        [&webrtc_server](const std::string& stream, const uint8_t* data, size_t size,
+                         uint64_t timestamp_us) {
+            webrtc_server.broadcast_stream_nal(stream, data, size, timestamp_us);
+        }
+    );
+    rtsp_pipeline.roi_streams().set_return_callback(
+        [&rtsp_pipeline, &webrtc_server](const std::string& peer_id) {
+            rtsp_pipeline.peer_encoders().set_excluded(peer_id, false);
+            webrtc_server.set_peer_stream(peer_id, "");
+        }
+    );
+    webrtc_server.set_stream_keyframe_callback(
+        [&rtsp_pipeline, &mosaic](const std::string& stream) {
+            if (stream == ss::MosaicStream::stream_id) {
+                return mosaic.request_keyframe();
+            }
+            if (stream == ss::PreviewStream::stream_id) {
+                return rtsp_pipeline.preview().request_keyframe();
+            }
+            if (ss::PeerEncoders::owns(stream)) {
+                return rtsp_pipeline.peer_encoders().request_keyframe(stream);
+            }
+            return rtsp_pipeline.roi_streams().request_keyframe(stream);
+        }
+    );
+
+    // Wire per-peer encoders (encoding.per_peer) → their viewers
+    rtsp_pipeline.peer_encoders().set_frame_callback(
+        [&webrtc_server](const std::string& stream, const uint8_t* data, size_t size,
+                         uint64_t timestamp_us) {
+            webrtc_server.broadcast_stream_nal(stream, data, size, timestamp_us);
+        }
+    );
+    rtsp_pipeline.peer_encoders().set_route_callback(
+        [&webrtc_server](const std::string& peer_id, const std::string& stream) {
+            webrtc_server.set_peer_stream(peer_id, stream);
+        }
+    );
+
+    // ─── Config hot-reload (SIGHUP) ───────────────────────────────────────────
+    ss::ConfigReloader reloader(config_path, config, {
+        webrtc_server, signaling_server, rtsp_pipeline,
+        http_server, telemetry_ingest, control_forwarder, bitrate_policy, mosaic
+    });
+
+    // ─── Admin API ────────────────────────────────────────────────────────────
+    ss::AdminApi admin_api(webrtc_server, signaling_server, rtsp_pipeline,
+                           bitrate_policy, reloader, mosaic);
+    http_server.add_route("/api/",
+        [&admin_api](const ss::HttpRequest& request) {
+            return admin_api.handle(request);
+        }
+    );
+    if (config.admin.enabled && config.admin.token.empty()) {
+        spdlog::warn("Admin API enabled without a token — all requests will be rejected");
+    }
+
+    startup.mark("components");
 
     // ─── Start everything ─────────────────────────────────────────────────────
+    // The pipeline goes first: GStreamer init and the camera connect run on
+    // its thread while the listeners below come up
     webrtc_server.start();
 
-    if (!signaling_server.start()) {
-        spdlog::critical("Failed to start signaling server");
+    ss::notify_systemd("STATUS=Waiting for the first video frame");
+    if (!rtsp_pipeline.start()) {
+        spdlog::critical("Failed to start RTSP pipeline");
         return 1;
     }
+    startup.mark("pipeline thread");
 
-    if (!rtsp_pipeline.start()) {
-        spdlog::critical("Failed to start RTSP pipeline");
+    if (!signaling_server.start()) {
+        spdlog::critical("Failed to start signaling server");
         return 1;
     }
+    startup.mark("signaling");
 
     if (!http_server.start()) {
         spdlog::warn("Failed to start HTTP server on port {} — web viewer unavailable",
                      config.server.http_port);
     }
+    startup.mark("http");
+
+    if (config.telemetry.enabled && !telemetry_ingest.start()) {
+        spdlog::warn("Failed to start telemetry ingest — telemetry channel will stay idle");
+    }
+
+    if (config.control.enabled && !control_forwarder.start()) {
+        spdlog::warn("Failed to start control forwarding — commands will be rejected");
+    }
+    startup.mark("listeners");
+
+    if (!ready_on_first_frame) {
+        // Reachable for diagnosis even while the camera is not
+        ss::notify_systemd(first_frame.load() ? "READY=1"
+                                              : "READY=1\nSTATUS=Listening, waiting for the first video frame");
+    }
 
     spdlog::info("All systems operational");
     spdlog::info("  WebSocket signaling : ws://0.0.0.0:{}", config.server.signaling_port);
@@ -138,6 +411,30 @@ int main(int argc, char* argv[]) {
     while (!g_shutdown.load()) {
         std::this_thread::sleep_for(std::chrono::milliseconds(500));
 
+        if (g_reload.exchange(false)) {
+            spdlog::info("Received SIGHUP — reloading {}", config_path);
+            reloader.reload();
+            config = reloader.current();
+        }
+
+        // Scene complexity reaches the encoder from here, off the streaming thread
+        bitrate_policy.tick();
+
+        // Rebuild ROI encodes after a reconnect, drop those nobody watches
+        rtsp_pipeline.roi_streams().tick(
+            [&webrtc_server](const std::string& peer_id) { return webrtc_server.has_peer(peer_id); });
+
+        // Per-peer encoders in and out against the CPU budget
+        rtsp_pipeline.peer_encoders().tick(webrtc_server.connected_peers());
+
+        // Preview encoder in while watched, out when idle
+        rtsp_pipeline.preview().tick(
+            [&webrtc_server](const std::string& peer_id) { return webrtc_server.has_peer(peer_id); });
+
+        // Build the mosaic for its first viewer, tear it down when idle
+        mosaic.tick(
+            [&webrtc_server](const std::string& peer_id) { return webrtc_server.has_peer(peer_id); });
+
         // Periodic stats logging
         auto now = std::chrono::steady_clock::now();
         if (now - last_stats_time >= stats_interval) {
@@ -147,29 +444,52 @@ int main(int argc, char* argv[]) {
             auto webrtc_stats = webrtc_server.get_stats();
 
             spdlog::info("──── Health Check ────");
-            spdlog::info("  Pipeline   : {} | Frames: {} | Bytes: {:.1f} MB | Reconnects: {}",
+            spdlog::info("  Pipeline   : {} | Frames: {} | Audio: {} | Bytes: {:.1f} MB | Reconnects: {}",
                         pipeline_stats.connected ? "CONNECTED" : "DISCONNECTED",
                         pipeline_stats.frames_received,
+                        pipeline_stats.audio_frames,
                         pipeline_stats.bytes_received / (1024.0 * 1024.0),
                         pipeline_stats.reconnect_count);
             spdlog::info("  WebRTC     : {}/{} peers connected | Sent: {:.1f} MB",
                         webrtc_stats.connected_peers,
                         webrtc_stats.total_peers,
                         webrtc_stats.total_bytes_sent / (1024.0 * 1024.0));
+            if (config.telemetry.enabled) {
+                spdlog::info("  Telemetry  : {} received | {} sent | {} dropped",
+                            telemetry_ingest.messages_received(),
+                            webrtc_stats.telemetry_sent,
+                            webrtc_stats.telemetry_dropped);
+            }
+            if (config.control.enabled) {
+                auto control_stats = control_forwarder.get_stats();
+                spdlog::info("  Control    : {} cmds | {} fwd | {} failed | RTT {:.1f} ms | "
+                            "delivery {:.1f}/{:.1f} ms (avg/max, {} acked)",
+                            webrtc_stats.control_received,
+                            control_stats.forwarded,
+                            control_stats.failed,
+                            webrtc_stats.control_rtt_avg_ms,
+                            control_stats.delivery_avg_ms,
+                            control_stats.delivery_max_ms,
+                            control_stats.acked);
+            }
             spdlog::info("──────────────────────");
 
-            // Watchdog: check if pipeline is healthy
-            if (!rtsp_pipeline.is_running() && !g_shutdown.load()) {
+            // Watchdog: the pipeline retries a lost camera itself (with
+            // rtsp.reconnect_* backoff); only a dead thread needs a restart
+            if (!rtsp_pipeline.is_running() && !rtsp_pipeline.reconnecting() &&
+                !g_shutdown.load()) {
                 spdlog::warn("Pipeline not running! Attempting restart...");
-                rtsp_pipeline.stop();
-                rtsp_pipeline.start();
+                rtsp_pipeline.restart();
             }
         }
     }
 
     // ─── Graceful shutdown ────────────────────────────────────────────────────
     spdlog::info("Shutting down...");
+    ss::notify_systemd("STOPPING=1");
     rtsp_pipeline.stop();
+    telemetry_ingest.stop();
+    control_forwarder.stop();
     http_server.stop();
     signaling_server.stop();
     webrtc_server.stop();
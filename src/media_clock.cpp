@@ -0,0 +1,79 @@
+#include "media_clock.hpp"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+
+namespace ss {
+
+uint64_t MediaClock::on_frame(uint64_t timestamp_us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto now = std::chrono::steady_clock::now();
+
+    if (!started_) {
+        // Timeline starts at zero on the first frame
+        started_ = true;
+        offset_us_ = -static_cast<int64_t>(timestamp_us);
+    } else if (timestamp_us + max_gap_us < last_input_us_ ||
+               timestamp_us > last_input_us_ + max_gap_us) {
+        // Source restarted: continue one frame after the last media time
+        offset_us_ = static_cast<int64_t>(last_media_us_ + restart_gap_us) -
+                     static_cast<int64_t>(timestamp_us);
+        spdlog::info("Media clock rebased after timestamp discontinuity");
+    }
+
+    last_input_us_ = timestamp_us;
+    auto media = static_cast<uint64_t>(static_cast<int64_t>(timestamp_us) + offset_us_);
+    // Track the newest frame only (B-frame PTS may arrive out of order)
+    if (media >= last_media_us_) {
+        last_media_us_ = media;
+        last_frame_time_ = now;
+    }
+    return media;
+}
+
+bool MediaClock::map(uint64_t timestamp_us, uint64_t& media_us) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!started_) return false;
+
+    int64_t media = static_cast<int64_t>(timestamp_us) + offset_us_;
+    int64_t last = static_cast<int64_t>(last_media_us_);
+    if (media < 0 || media + static_cast<int64_t>(max_gap_us) < last ||
+        media > last + static_cast<int64_t>(max_gap_us)) {
+        return false;
+    }
+
+    media_us = static_cast<uint64_t>(media);
+    return true;
+}
+
+uint64_t MediaClock::now_us() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!started_) return 0;
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - last_frame_time_).count();
+    return last_media_us_ + static_cast<uint64_t>(std::max<int64_t>(elapsed, 0));
+}
+
+bool MediaClock::started() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return started_;
+}
+
+void MediaClock::on_capture(uint64_t media_us, uint64_t capture_us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    has_capture_ = true;
+    capture_offset_us_ = static_cast<int64_t>(capture_us) - static_cast<int64_t>(media_us);
+    last_capture_time_ = std::chrono::steady_clock::now();
+}
+
+bool MediaClock::capture_time(uint64_t media_us, uint64_t& capture_us) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // The camera stopped sending reports, or the source has none
+    if (!has_capture_ || std::chrono::steady_clock::now() - last_capture_time_ > capture_expiry) {
+        return false;
+    }
+    capture_us = static_cast<uint64_t>(static_cast<int64_t>(media_us) + capture_offset_us_);
+    return true;
+}
+
+} // namespace ss
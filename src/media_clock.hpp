@@ -0,0 +1,62 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+namespace ss {
+
+// Shared media timeline for everything sent to peers.
+//
+// Pipeline timestamps restart whenever the camera reconnects, so they are
+// rebased onto a continuous timeline starting at the first frame. RTP
+// timestamps for every peer and the stamps on out-of-band data (telemetry)
+// are both derived from this timeline, which lets the browser line them up.
+class MediaClock {
+public:
+    // Register a frame's pipeline timestamp, returns its media time (µs)
+    uint64_t on_frame(uint64_t timestamp_us);
+
+    // Map another stream's pipeline timestamp (e.g. audio) onto the timeline
+    // without advancing it. Returns false until video has started, or if the
+    // timestamp is too far from the current position (source restarting).
+    bool map(uint64_t timestamp_us, uint64_t& media_us) const;
+
+    // Current media time, extrapolated from the last frame with the host clock
+    uint64_t now_us() const;
+
+    bool started() const;
+
+    // Wall-clock capture time (µs since the Unix epoch) of the frame at
+    // `media_us`, from the camera (rtsp.capture_clock)
+    void on_capture(uint64_t media_us, uint64_t capture_us);
+
+    // Capture time of any point on the timeline, from the latest frame's.
+    // False when no frame had one for a while.
+    bool capture_time(uint64_t media_us, uint64_t& capture_us) const;
+
+    // Convert media time to an RTP timestamp at the given clock rate
+    static uint32_t to_rtp(uint64_t media_us, uint32_t clock_rate) {
+        return static_cast<uint32_t>((media_us * clock_rate) / 1'000'000);
+    }
+
+private:
+    // Gaps larger than this (or going backwards) are treated as a restart
+    static constexpr uint64_t max_gap_us = 2'000'000;
+    static constexpr uint64_t restart_gap_us = 33'333;
+    static constexpr auto capture_expiry = std::chrono::seconds(5);
+
+    mutable std::mutex mutex_;
+    bool started_ = false;
+    int64_t offset_us_ = 0;          // media time = pipeline time + offset
+    uint64_t last_input_us_ = 0;
+    uint64_t last_media_us_ = 0;
+    std::chrono::steady_clock::time_point last_frame_time_;
+
+    // Capture time = media time + capture offset, as of the last frame with one
+    bool has_capture_ = false;
+    int64_t capture_offset_us_ = 0;
+    std::chrono::steady_clock::time_point last_capture_time_;
+};
+
+} // namespace ss
@@ -0,0 +1,356 @@
+#include "mosaic_stream.hpp"
+#include <gst/video/video.h>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cmath>
+
+namespace ss {
+
+// Joining-viewer and PLI IDRs are spaced at least this far
+static constexpr auto keyframe_min_interval = std::chrono::milliseconds(500);
+
+// After the pipeline failed to build or run, before trying again
+static constexpr auto retry_interval = std::chrono::seconds(5);
+
+// A failed camera's tile stays frozen this long before the mosaic is
+// rebuilt to reconnect it (a blip for the other tiles)
+static constexpr auto tile_retry_interval = std::chrono::seconds(30);
+
+static int even(double v) {
+    return static_cast<int>(v / 2.0) * 2;
+}
+
+std::vector<MosaicTile> mosaic_layout(size_t count, int width, int height) {
+    std::vector<MosaicTile> tiles;
+    if (count == 0) return tiles;
+    int cols = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(count))));
+    int rows = static_cast<int>((count + static_cast<size_t>(cols) - 1) / static_cast<size_t>(cols));
+    int tile_w = std::max(even(static_cast<double>(width) / cols), 2);
+    int tile_h = std::max(even(static_cast<double>(height) / rows), 2);
+    for (size_t i = 0; i < count; i++) {
+        int col = static_cast<int>(i) % cols;
+        int row = static_cast<int>(i) / cols;
+        tiles.push_back({col * tile_w, row * tile_h, tile_w, tile_h});
+    }
+    return tiles;
+}
+
+MosaicStream::MosaicStream(const AppConfig& config)
+    : config_(config)
+{
+}
+
+MosaicStream::~MosaicStream() {
+    GstElement* pipeline;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pipeline = release_pipeline();
+    }
+    if (pipeline) {
+        gst_element_set_state(pipeline, GST_STATE_NULL);
+        gst_object_unref(pipeline);
+    }
+}
+
+void MosaicStream::update_config(const AppConfig& config) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    config_ = config;
+    rebuild_ = pipeline_ != nullptr;
+}
+
+// ─── Pipeline ──────────────────────────────────────────────────────────────────
+
+std::vector<std::string> MosaicStream::tile_sources() const {
+    std::vector<std::string> sources;
+    if (config_.mosaic.include_main && config_.replay.file.empty()) {
+        // Test mode (no camera): the same test pattern as the main stream
+        sources.push_back(config_.rtsp.url.empty() ? "test:ball" : config_.rtsp.url);
+    }
+    sources.insert(sources.end(), config_.mosaic.sources.begin(), config_.mosaic.sources.end());
+    return sources;
+}
+
+std::string MosaicStream::launch(const std::vector<std::string>& sources,
+                                 const std::vector<MosaicTile>& tiles) const {
+    const MosaicConfig& mosaic = config_.mosaic;
+    std::string frame = ",width=" + std::to_string(mosaic.width) +
+                        ",height=" + std::to_string(mosaic.height) +
+                        ",framerate=" + std::to_string(mosaic.fps) + "/1";
+
+    VideoConfig video = config_.webrtc.video;
+    video.fps = mosaic.fps;
+    video.bitrate_kbps = mosaic.bitrate_kbps;
+    video.max_bitrate_kbps = std::max(video.max_bitrate_kbps, mosaic.bitrate_kbps);
+
+    // A black background on sink_0 keeps frames coming at the mosaic rate
+    // whatever the cameras do; ignore-inactive-pads stops a camera that is
+    // still connecting from holding up the others
+    std::string desc = "compositor name=mix background=black ignore-inactive-pads=true";
+    for (size_t i = 0; i < tiles.size(); i++) {
+        std::string pad = " sink_" + std::to_string(i + 1);
+        desc += pad + "::xpos=" + std::to_string(tiles[i].x) +
+                pad + "::ypos=" + std::to_string(tiles[i].y);
+    }
+    desc += " ! video/x-raw" + frame + " ! " +
+            encoder_.launch(config_.encoding, video, false) +
+            "video/x-h264,stream-format=byte-stream,alignment=au ! "
+            "h264parse config-interval=1 ! "
+            "appsink name=sink emit-signals=true sync=false max-buffers=5 drop=true ";
+    desc += "videotestsrc is-live=true pattern=black ! video/x-raw" + frame + " ! mix.sink_0 ";
+
+    for (size_t i = 0; i < sources.size(); i++) {
+        const std::string& source = sources[i];
+        std::string name = "tile" + std::to_string(i);
+        if (source.compare(0, 5, "test:") == 0) {
+            desc += "videotestsrc name=" + name + " is-live=true pattern=" + source.substr(5) + " ! ";
+        } else {
+            // decodebin picks the depayloader and decoder, H.264 or H.265
+            desc += "rtspsrc name=" + name + " location=" + source + " "
+                    "latency=" + std::to_string(config_.rtsp.latency_ms) + " "
+                    "protocols=" + config_.rtsp.transport + " ! decodebin ! ";
+        }
+        desc += "videoconvert ! videoscale add-borders=true ! videorate ! "
+                "video/x-raw,format=I420,pixel-aspect-ratio=1/1"
+                ",width=" + std::to_string(tiles[i].width) +
+                ",height=" + std::to_string(tiles[i].height) +
+                ",framerate=" + std::to_string(mosaic.fps) + "/1 ! "
+                "queue leaky=downstream max-size-buffers=2 max-size-bytes=0 max-size-time=0 ! "
+                "mix.sink_" + std::to_string(i + 1) + " ";
+    }
+    return desc;
+}
+
+bool MosaicStream::build() {
+    if (!gst_is_initialized()) {
+        gst_init(nullptr, nullptr);
+    }
+
+    std::vector<std::string> sources = tile_sources();
+    if (sources.empty()) return false;
+
+    if (!select_video_encoder_cached(config_, encoder_, encoder_selection_)) {
+        spdlog::error("Mosaic: no usable H.264 encoder");
+        return false;
+    }
+
+    std::vector<MosaicTile> tiles = mosaic_layout(sources.size(), config_.mosaic.width,
+                                                  config_.mosaic.height);
+    std::string desc = launch(sources, tiles);
+    spdlog::info("Mosaic pipeline: {}", desc);
+
+    GError* error = nullptr;
+    pipeline_ = gst_parse_launch(desc.c_str(), &error);
+    if (error) {
+        spdlog::error("Mosaic: {}", error->message);
+        g_error_free(error);
+        if (pipeline_) gst_object_unref(pipeline_);
+        pipeline_ = nullptr;
+        return false;
+    }
+
+    sink_ = gst_bin_get_by_name(GST_BIN(pipeline_), "sink");
+    if (sink_) gst_object_unref(sink_);
+    tiles_.clear();
+    for (size_t i = 0; i < sources.size(); i++) {
+        GstElement* tile = gst_bin_get_by_name(GST_BIN(pipeline_), ("tile" + std::to_string(i)).c_str());
+        if (tile) gst_object_unref(tile);
+        tiles_.push_back(tile);
+    }
+    tile_down_.assign(sources.size(), false);
+    tile_size_ = std::to_string(tiles.front().width) + "x" + std::to_string(tiles.front().height);
+
+    GstAppSinkCallbacks callbacks = {};
+    callbacks.new_sample = &MosaicStream::on_new_sample;
+    gst_app_sink_set_callbacks(GST_APP_SINK(sink_), &callbacks, this, nullptr);
+
+    if (gst_element_set_state(pipeline_, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
+        spdlog::error("Mosaic: failed to start");
+        GstElement* pipeline = release_pipeline();
+        gst_element_set_state(pipeline, GST_STATE_NULL);   // nothing is streaming yet
+        gst_object_unref(pipeline);
+        return false;
+    }
+    builds_++;
+    spdlog::info("Mosaic: {} tile(s) of {} at {} kbps", sources.size(), tile_size_,
+                 config_.mosaic.bitrate_kbps);
+    return true;
+}
+
+GstElement* MosaicStream::release_pipeline() {
+    GstElement* pipeline = pipeline_;
+    pipeline_ = nullptr;
+    sink_ = nullptr;
+    tiles_.clear();
+    tile_down_.clear();
+    return pipeline;
+}
+
+GstElement* MosaicStream::poll_bus() {
+    if (!pipeline_) return nullptr;
+    GstBus* bus = gst_element_get_bus(pipeline_);
+    bool failed = false;
+    while (GstMessage* msg = gst_bus_pop(bus)) {
+        if (GST_MESSAGE_TYPE(msg) == GST_MESSAGE_ERROR) {
+            GError* err = nullptr;
+            gchar* debug = nullptr;
+            gst_message_parse_error(msg, &err, &debug);
+            // A camera failing takes only its tile down
+            auto tile = std::find_if(tiles_.begin(), tiles_.end(), [&](GstElement* t) {
+                return t && (GST_MESSAGE_SRC(msg) == GST_OBJECT(t) ||
+                             gst_object_has_as_ancestor(GST_MESSAGE_SRC(msg), GST_OBJECT(t)));
+            });
+            if (tile != tiles_.end()) {
+                size_t index = static_cast<size_t>(tile - tiles_.begin());
+                if (!tile_down_[index]) {
+                    spdlog::warn("Mosaic: tile {} failed: {}", index, err ? err->message : "unknown");
+                    tile_down_[index] = true;
+                    retry_at_ = std::chrono::steady_clock::now() + tile_retry_interval;
+                }
+            } else {
+                spdlog::error("Mosaic: {} ({})", err ? err->message : "unknown", debug ? debug : "");
+                failed = true;
+            }
+            if (err) g_error_free(err);
+            g_free(debug);
+        } else if (GST_MESSAGE_TYPE(msg) == GST_MESSAGE_EOS) {
+            failed = true;
+        }
+        gst_message_unref(msg);
+    }
+    gst_object_unref(bus);
+
+    if (!failed) return nullptr;
+    retry_at_ = std::chrono::steady_clock::now() + retry_interval;
+    return release_pipeline();
+}
+
+// ─── Viewers ───────────────────────────────────────────────────────────────────
+
+bool MosaicStream::subscribe(const std::string& peer_id, std::string& error) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!config_.mosaic.enabled) {
+        error = "mosaic is disabled (mosaic.enabled)";
+        return false;
+    }
+    if (tile_sources().empty()) {
+        error = "mosaic has no sources";
+        return false;
+    }
+    // Built by the next tick, which may take a moment (encoder benchmark)
+    viewers_.insert(peer_id);
+    return true;
+}
+
+void MosaicStream::unsubscribe(const std::string& peer_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (viewers_.erase(peer_id) && viewers_.empty()) {
+        idle_since_ = std::chrono::steady_clock::now();
+    }
+}
+
+bool MosaicStream::request_keyframe() {
+    GstElement* sink = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!sink_) return false;
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_keyframe_ < keyframe_min_interval) return true;
+        last_keyframe_ = now;
+        sink = static_cast<GstElement*>(gst_object_ref(sink_));
+    }
+    // Outside the lock: the encoder takes its stream lock for the request
+    bool handled = gst_element_send_event(sink, gst_video_event_new_upstream_force_key_unit(
+        GST_CLOCK_TIME_NONE, TRUE, 0));
+    gst_object_unref(sink);
+    return handled;
+}
+
+void MosaicStream::tick(const std::function<bool(const std::string& peer_id)>& peer_alive) {
+    std::vector<GstElement*> stop;
+    std::vector<std::string> returned;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto now = std::chrono::steady_clock::now();
+
+        for (auto it = viewers_.begin(); it != viewers_.end();) {
+            if (!peer_alive(*it)) {
+                it = viewers_.erase(it);
+                if (viewers_.empty()) idle_since_ = now;
+            } else if (!config_.mosaic.enabled) {
+                // Turned off by a reload: viewers go back to the main stream
+                returned.push_back(*it);
+                it = viewers_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        if (GstElement* failed = poll_bus()) stop.push_back(failed);
+
+        bool tile_down = std::find(tile_down_.begin(), tile_down_.end(), true) != tile_down_.end();
+        auto idle_limit = std::chrono::milliseconds(config_.mosaic.idle_ms);
+        if (pipeline_ && (rebuild_ || !config_.mosaic.enabled ||
+                          (viewers_.empty() && now - idle_since_ >= idle_limit) ||
+                          (tile_down && now >= retry_at_))) {
+            spdlog::info("Mosaic: {}", rebuild_ ? "rebuilding for new settings"
+                                       : tile_down ? "rebuilding to reconnect failed tiles"
+                                       : "nobody watching, torn down");
+            stop.push_back(release_pipeline());
+            rebuild_ = false;
+            retry_at_ = now;
+        }
+
+        if (!pipeline_ && !viewers_.empty() && config_.mosaic.enabled && now >= retry_at_) {
+            if (!build()) retry_at_ = now + retry_interval;
+        }
+    }
+
+    // Outside the lock: stopping waits for the streaming threads, which may
+    // be asking for a keyframe
+    for (GstElement* pipeline : stop) {
+        gst_element_set_state(pipeline, GST_STATE_NULL);
+        gst_object_unref(pipeline);
+    }
+    if (return_cb_) {
+        for (auto& peer_id : returned) return_cb_(peer_id);
+    }
+}
+
+// ─── Frames ────────────────────────────────────────────────────────────────────
+
+GstFlowReturn MosaicStream::on_new_sample(GstAppSink* sink, gpointer user_data) {
+    auto* self = static_cast<MosaicStream*>(user_data);
+
+    GstSample* sample = gst_app_sink_pull_sample(sink);
+    if (!sample) return GST_FLOW_OK;
+
+    GstBuffer* buffer = gst_sample_get_buffer(sample);
+    GstMapInfo map;
+    if (buffer && GST_BUFFER_PTS_IS_VALID(buffer) && gst_buffer_map(buffer, &map, GST_MAP_READ)) {
+        self->frames_.fetch_add(1, std::memory_order_relaxed);
+        self->bytes_.fetch_add(map.size, std::memory_order_relaxed);
+        if (self->frame_cb_ && map.size > 0) {
+            self->frame_cb_(map.data, map.size, GST_BUFFER_PTS(buffer) / 1000);
+        }
+        gst_buffer_unmap(buffer, &map);
+    }
+    gst_sample_unref(sample);
+    return GST_FLOW_OK;
+}
+
+MosaicStream::Stats MosaicStream::get_stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats;
+    stats.enabled = config_.mosaic.enabled;
+    stats.running = pipeline_ != nullptr;
+    stats.tiles = pipeline_ ? tiles_.size() : tile_sources().size();
+    stats.tiles_down = static_cast<size_t>(std::count(tile_down_.begin(), tile_down_.end(), true));
+    stats.tile_size = tile_size_;
+    stats.viewers = viewers_.size();
+    stats.builds = builds_;
+    stats.frames = frames_.load();
+    stats.bytes = bytes_.load();
+    return stats;
+}
+
+} // namespace ss
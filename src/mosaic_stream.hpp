@@ -0,0 +1,119 @@
+#pragma once
+
+#include "config.hpp"
+#include "video_encoder.hpp"
+#include <gst/gst.h>
+#include <gst/app/gstappsink.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace ss {
+
+// Where one camera lands in the composite frame
+struct MosaicTile {
+    int x = 0, y = 0;
+    int width = 0, height = 0;
+};
+
+// `count` tiles in a near-square grid filling width × height, row by row
+std::vector<MosaicTile> mosaic_layout(size_t count, int width, int height);
+
+// Several cameras decoded at tile size and tiled into one frame, encoded
+// once and offered as stream "mosaic" (config `mosaic`), so a supervisor
+// watching every camera pulls one stream instead of one per camera.
+//
+// It is a pipeline of its own, on its own clock, so a camera that fails
+// only freezes its tile and never disturbs the main stream. Built by tick()
+// once a viewer asks for it, torn down idle_ms after the last one leaves.
+class MosaicStream {
+public:
+    static constexpr const char* stream_id = "mosaic";
+
+    // Encoded access unit, on the mosaic pipeline's timestamps
+    using FrameCallback = std::function<void(const uint8_t* data, size_t size, uint64_t timestamp_us)>;
+
+    // A viewer was moved back to the main stream (mosaic turned off)
+    using ReturnCallback = std::function<void(const std::string& peer_id)>;
+
+    explicit MosaicStream(const AppConfig& config);
+    ~MosaicStream();
+
+    // Non-copyable
+    MosaicStream(const MosaicStream&) = delete;
+    MosaicStream& operator=(const MosaicStream&) = delete;
+
+    void set_frame_callback(FrameCallback cb) { frame_cb_ = std::move(cb); }
+    void set_return_callback(ReturnCallback cb) { return_cb_ = std::move(cb); }
+
+    // New sources or layout: a running mosaic is rebuilt by the next tick()
+    void update_config(const AppConfig& config);
+
+    // Route `peer_id` to the mosaic; fails when it is off or has no tiles
+    bool subscribe(const std::string& peer_id, std::string& error);
+    void unsubscribe(const std::string& peer_id);
+
+    // IDR for a joining viewer or PLI; rate limited
+    bool request_keyframe();
+
+    // Build, rebuild or tear down for the current viewers, drop viewers
+    // that are gone and handle the pipeline's bus messages
+    void tick(const std::function<bool(const std::string& peer_id)>& peer_alive);
+
+    struct Stats {
+        bool enabled = false;
+        bool running = false;
+        size_t tiles = 0;
+        size_t tiles_down = 0;      // sources that failed since the last build
+        std::string tile_size;      // WxH
+        size_t viewers = 0;
+        uint64_t builds = 0;
+        uint64_t frames = 0;
+        uint64_t bytes = 0;
+    };
+    Stats get_stats() const;
+
+private:
+    std::vector<std::string> tile_sources() const;     // mutex_ held
+    std::string launch(const std::vector<std::string>& sources,
+                       const std::vector<MosaicTile>& tiles) const;   // mutex_ held
+    bool build();                                       // mutex_ held
+    GstElement* release_pipeline();                     // mutex_ held; stop it unlocked
+    GstElement* poll_bus();                             // mutex_ held; ditto on failure
+
+    static GstFlowReturn on_new_sample(GstAppSink* sink, gpointer user_data);
+
+    FrameCallback frame_cb_;
+    ReturnCallback return_cb_;
+
+    mutable std::mutex mutex_;
+    AppConfig config_;
+    bool rebuild_ = false;                  // config changed while running
+    std::unordered_set<std::string> viewers_;
+    std::chrono::steady_clock::time_point idle_since_;
+    std::chrono::steady_clock::time_point retry_at_;    // after a failed build
+    std::chrono::steady_clock::time_point last_keyframe_;
+
+    // Encoder picked on first build, again when the settings it depends on change
+    VideoEncoder encoder_;
+    std::string encoder_selection_;
+
+    GstElement* pipeline_ = nullptr;
+    GstElement* sink_ = nullptr;            // owned by the pipeline
+    std::vector<GstElement*> tiles_;        // tile sources, owned by the pipeline
+    std::vector<bool> tile_down_;
+    std::string tile_size_;
+    uint64_t builds_ = 0;
+
+    // Counted on the streaming thread, which must not wait for mutex_:
+    // stopping the pipeline waits for it
+    std::atomic<uint64_t> frames_{0};
+    std::atomic<uint64_t> bytes_{0};
+};
+
+} // namespace ss
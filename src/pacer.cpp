@@ -0,0 +1,99 @@
+#include "pacer.hpp"
+#include <algorithm>
+
+namespace ss {
+
+Pacer::Pacer(int rate_kbps, std::chrono::milliseconds burst)
+    : bytes_per_sec_(rate_kbps * 1000.0 / 8.0)
+    , burst_(burst)
+    , tokens_(bytes_per_sec_ * burst.count() / 1000.0)
+    , last_refill_(std::chrono::steady_clock::now())
+{
+}
+
+void Pacer::outgoing(rtc::message_vector& messages, const rtc::message_callback& send) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    send_ = send;
+
+    // Keep RTCP in the vector so it goes out right away; queue RTP
+    rtc::message_vector passthrough;
+    for (auto& message : messages) {
+        if (!message) continue;
+        if (message->type == rtc::Message::Control) {
+            passthrough.push_back(std::move(message));
+        } else {
+            queued_bytes_ += message->size();
+            queue_.push_back(std::move(message));
+        }
+    }
+    messages.swap(passthrough);
+
+    refill(std::chrono::steady_clock::now());
+    drain();
+}
+
+void Pacer::flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (queue_.empty()) return;
+    refill(std::chrono::steady_clock::now());
+    drain();
+}
+
+void Pacer::charge_priority(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    refill(std::chrono::steady_clock::now());
+    tokens_ -= static_cast<double>(bytes);
+}
+
+void Pacer::set_rate(int rate_kbps) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    refill(std::chrono::steady_clock::now());
+    bytes_per_sec_ = rate_kbps * 1000.0 / 8.0;
+}
+
+void Pacer::set_output(Output output) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    output_ = std::move(output);
+}
+
+void Pacer::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    queue_.clear();
+    queued_bytes_ = 0;
+    send_ = nullptr;
+    output_ = nullptr;
+}
+
+size_t Pacer::queued_bytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queued_bytes_;
+}
+
+void Pacer::refill(std::chrono::steady_clock::time_point now) {
+    double elapsed_s = std::chrono::duration<double>(now - last_refill_).count();
+    last_refill_ = now;
+    double max_tokens = bytes_per_sec_ * burst_.count() / 1000.0;
+    tokens_ = std::min(max_tokens, tokens_ + elapsed_s * bytes_per_sec_);
+}
+
+void Pacer::drain() {
+    if (!send_) return;
+
+    // A queue this deep means the rate is far below the encoder output;
+    // holding packets longer only adds latency
+    bool unpaced = queued_bytes_ > bytes_per_sec_ * max_queue_delay.count() / 1000.0;
+
+    while (!queue_.empty() && (unpaced || tokens_ > 0)) {
+        auto message = std::move(queue_.front());
+        queue_.pop_front();
+        queued_bytes_ -= message->size();
+        tokens_ -= static_cast<double>(message->size());
+        if (output_) {
+            output_(std::move(message));
+        } else {
+            send_(std::move(message));
+        }
+    }
+}
+
+} // namespace ss
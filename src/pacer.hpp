@@ -0,0 +1,60 @@
+#pragma once
+
+#include <rtc/rtc.hpp>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+namespace ss {
+
+// Token-bucket pacer at the end of a video track's media handler chain.
+//
+// RTP packets are queued and released at a fixed rate instead of in one burst
+// per frame. Priority traffic sent outside the track (control DataChannel)
+// is charged against the same bucket first, so it never waits behind a
+// keyframe. RTCP passes through immediately.
+class Pacer final : public rtc::MediaHandler {
+public:
+    Pacer(int rate_kbps, std::chrono::milliseconds burst);
+
+    void outgoing(rtc::message_vector& messages, const rtc::message_callback& send) override;
+
+    // Release queued packets that fit in the budget (called by a ticker)
+    void flush();
+
+    // Account for priority bytes sent out of band
+    void charge_priority(size_t bytes);
+
+    void set_rate(int rate_kbps);
+
+    // Hand released packets to this instead of the chain's send callback,
+    // e.g. to an Impairment that must see paced traffic
+    using Output = std::function<void(rtc::message_ptr)>;
+    void set_output(Output output);
+
+    // Drop queued packets (peer is going away)
+    void clear();
+
+    size_t queued_bytes() const;
+
+private:
+    void refill(std::chrono::steady_clock::time_point now);
+    void drain();
+
+    // Queue beyond this much send time is flushed unpaced
+    static constexpr std::chrono::milliseconds max_queue_delay{500};
+
+    mutable std::mutex mutex_;
+    std::deque<rtc::message_ptr> queue_;
+    size_t queued_bytes_ = 0;
+    rtc::message_callback send_;
+    Output output_;
+
+    double bytes_per_sec_;
+    std::chrono::milliseconds burst_;
+    double tokens_;
+    std::chrono::steady_clock::time_point last_refill_;
+};
+
+} // namespace ss
@@ -1,24 +1,77 @@
 #include "peer_connection.hpp"
+#include "abs_capture_time.hpp"
+#include "h264.hpp"
+#include <nlohmann/json.hpp>
 #include <spdlog/spdlog.h>
+#include <algorithm>
 #include <random>
 
 namespace ss {
 
 std::atomic<uint32_t> PeerConnection::next_ssrc_{42};
-std::atomic<uint64_t> PeerConnection::start_time_{0};
+
+static constexpr uint32_t opus_clock_rate = 48000;
+
+// Offered when the source's is not known yet (libdatachannel's default)
+static constexpr const char* default_video_profile = "42e01f";
+static constexpr const char* video_cname = "video-stream";
+static constexpr const char* stream_msid = "stream-server";
+
+// Unsent telemetry beyond this is stale, newer samples supersede it
+static constexpr size_t telemetry_max_buffered = 64 * 1024;
+
+// H.264 profile-level-id of the video in an answer, "" if it names none
+static std::string answered_video_profile(rtc::Description& answer) {
+    static const std::string key = "profile-level-id=";
+    for (int i = 0; i < answer.mediaCount(); i++) {
+        auto entry = answer.media(i);
+        auto* media = std::get_if<rtc::Description::Media*>(&entry);
+        if (!media || (*media)->type() != "video") continue;
+        for (int pt : (*media)->payloadTypes()) {
+            auto* map = (*media)->rtpMap(pt);
+            if (!map || (map->format != "H264" && map->format != "h264")) continue;
+            for (auto& fmtp : map->fmtps) {
+                auto at = fmtp.find(key);
+                if (at != std::string::npos && fmtp.size() >= at + key.size() + 6) {
+                    return fmtp.substr(at + key.size(), 6);
+                }
+            }
+        }
+    }
+    return "";
+}
 
 PeerConnection::PeerConnection(const std::string& peer_id,
-                               const WebRtcConfig& config,
-                               SignalingCallback signaling_cb)
+                               const AppConfig& config,
+                               const MediaClock& clock,
+                               const std::string& video_profile)
     : peer_id_(peer_id)
     , config_(config)
-    , signaling_cb_(std::move(signaling_cb))
+    , clock_(clock)
     , ssrc_(next_ssrc_.fetch_add(1))
+    , audio_ssrc_(next_ssrc_.fetch_add(1))
 {
+    stats_.phases_ms.fill(-1.0);
+    stats_.video_profile = video_profile.empty() ? default_video_profile : video_profile;
     setup_connection();
+    mark_phase(Phase::PeerCreated);
+}
+
+static uint64_t steady_now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
 }
 
 PeerConnection::~PeerConnection() {
+    if (pacer_) {
+        pacer_->clear();
+    }
+    if (impairment_) {
+        impairment_->clear();
+    }
+    if (audio_impairment_) {
+        audio_impairment_->clear();
+    }
     if (pc_) {
         pc_->close();
     }
@@ -28,18 +81,18 @@ void PeerConnection::setup_connection() {
     rtc::Configuration rtc_config;
 
     // STUN server
-    if (!config_.stun_server.empty()) {
-        rtc_config.iceServers.emplace_back(config_.stun_server);
-        spdlog::debug("[{}] STUN: {}", peer_id_, config_.stun_server);
+    if (!config_.webrtc.stun_server.empty()) {
+        rtc_config.iceServers.emplace_back(config_.webrtc.stun_server);
+        spdlog::debug("[{}] STUN: {}", peer_id_, config_.webrtc.stun_server);
     }
 
     // TURN server (Cloudflare or custom)
-    if (!config_.turn_server.empty()) {
-        rtc::IceServer turn_server(config_.turn_server);
-        turn_server.username = config_.turn_username;
-        turn_server.password = config_.turn_credential;
+    if (!config_.webrtc.turn_server.empty()) {
+        rtc::IceServer turn_server(config_.webrtc.turn_server);
+        turn_server.username = config_.webrtc.turn_username;
+        turn_server.password = config_.webrtc.turn_credential;
         rtc_config.iceServers.push_back(turn_server);
-        spdlog::debug("[{}] TURN: {}", peer_id_, config_.turn_server);
+        spdlog::debug("[{}] TURN: {}", peer_id_, config_.webrtc.turn_server);
     }
 
     // Disable auto-negotiation — we manually trigger offer creation
@@ -49,11 +102,12 @@ void PeerConnection::setup_connection() {
 
     // ─── Send local description (offer) to browser via signaling ─────────
     pc_->onLocalDescription([this](rtc::Description description) {
-        std::string sdp = std::string(description);
         std::string type = description.typeString();
         spdlog::debug("[{}] Local description: {}", peer_id_, type);
-        if (signaling_cb_) {
-            signaling_cb_(type, sdp);
+        // Without trickle the offer waits for every candidate (see below);
+        // offers after the first go out as they are
+        if (config_.webrtc.trickle_ice || reoffering_.exchange(false)) {
+            signal(type, std::string(description));
         }
     });
 
@@ -71,6 +125,9 @@ void PeerConnection::setup_connection() {
         spdlog::info("[{}] Connection state: {}", peer_id_, state_str);
 
         connected_.store(state == rtc::PeerConnection::State::Connected);
+        if (state == rtc::PeerConnection::State::Connected) {
+            mark_phase(Phase::DtlsConnected);
+        }
         if (state == rtc::PeerConnection::State::Closed ||
             state == rtc::PeerConnection::State::Failed) {
             closed_.store(true);
@@ -85,9 +142,9 @@ void PeerConnection::setup_connection() {
     // ICE candidate callback → send to remote peer
     pc_->onLocalCandidate([this](rtc::Candidate candidate) {
         spdlog::debug("[{}] Local ICE candidate: {}", peer_id_, std::string(candidate));
-        if (signaling_cb_) {
+        if (config_.webrtc.trickle_ice) {
             std::string mid = candidate.mid();
-            signaling_cb_("candidate",
+            signal("candidate",
                 "{\"candidate\":\"" + std::string(candidate) + "\","
                 "\"sdpMid\":\"" + mid + "\"}");
         }
@@ -96,26 +153,36 @@ void PeerConnection::setup_connection() {
     pc_->onGatheringStateChange([this](rtc::PeerConnection::GatheringState state) {
         if (state == rtc::PeerConnection::GatheringState::Complete) {
             spdlog::info("[{}] ICE gathering complete", peer_id_);
+            // Non-trickle: one offer that already lists every candidate
+            if (!config_.webrtc.trickle_ice) {
+                if (auto description = pc_->localDescription()) {
+                    signal(description->typeString(), std::string(*description));
+                }
+            }
         }
     });
 
-    // ─── Add video track ─────────────────────────────────────────────────
-    const std::string cname = "video-stream";
-    const std::string msid = "stream-server";
+    pc_->onIceStateChange([this](rtc::PeerConnection::IceState state) {
+        if (state == rtc::PeerConnection::IceState::Connected ||
+            state == rtc::PeerConnection::IceState::Completed) {
+            mark_phase(Phase::IceConnected);
+        }
+    });
 
-    rtc::Description::Video media(cname, rtc::Description::Direction::SendOnly);
-    media.addH264Codec(config_.video.payload_type);
-    media.addSSRC(ssrc_, cname, msid, cname);
-    media.setBitrate(config_.video.bitrate_kbps);
+    // ─── Add video track ─────────────────────────────────────────────────
+    const std::string cname = video_cname;
+    const std::string msid = stream_msid;
+    bool capture_times = config_.rtsp.capture_clock != "off";
 
-    video_track_ = pc_->addTrack(media);
+    video_track_ = pc_->addTrack(video_description());
 
     // Configure RTP packetizer chain:
-    //   H264RtpPacketizer → RtcpSrReporter → RtcpNackResponder
+    //   H264RtpPacketizer → RtcpSrReporter → [AbsCaptureTime] →
+    //   RtcpNackResponder → PliHandler
     rtp_config_ = std::make_shared<rtc::RtpPacketizationConfig>(
         ssrc_,
         cname,
-        config_.video.payload_type,
+        config_.webrtc.video.payload_type,
         rtc::H264RtpPacketizer::defaultClockRate
     );
 
@@ -129,36 +196,440 @@ void PeerConnection::setup_connection() {
     sr_reporter_ = std::make_shared<rtc::RtcpSrReporter>(rtp_config_);
     packetizer_->addToChain(sr_reporter_);
 
+    // Camera capture times on the sender reports and frames; before the
+    // NACK responder so retransmissions carry them too
+    if (capture_times) {
+        packetizer_->addToChain(std::make_shared<AbsCaptureTime>(clock_, rtc::H264RtpPacketizer::defaultClockRate));
+    }
+
     // RTCP NACK responder
     auto nack_responder = std::make_shared<rtc::RtcpNackResponder>();
     packetizer_->addToChain(nack_responder);
 
+    // PLI/FIR: loss NACKs could not repair, the browser needs an IDR
+    packetizer_->addToChain(std::make_shared<rtc::PliHandler>([this]() {
+        {
+            std::lock_guard<std::mutex> lock(stats_mutex_);
+            stats_.plis_received++;
+        }
+        spdlog::debug("[{}] PLI received", peer_id_);
+        if (keyframe_request_cb_) keyframe_request_cb_();
+    }));
+
+    // Pacer last, so the NACK history holds packets before they are paced
+    if (config_.webrtc.pacing.enabled) {
+        int rate_kbps = static_cast<int>(config_.webrtc.video.max_bitrate_kbps *
+                                         config_.webrtc.pacing.rate_factor);
+        pacer_ = std::make_shared<Pacer>(
+            rate_kbps, std::chrono::milliseconds(config_.webrtc.pacing.burst_ms));
+        packetizer_->addToChain(pacer_);
+    }
+
+    // Test impairment after everything, where the network would be. Paced
+    // packets bypass the rest of the chain, so the pacer feeds it directly.
+    if (config_.webrtc.impairment.enabled) {
+        impairment_ = std::make_shared<Impairment>(config_.webrtc.impairment, 0);
+        packetizer_->addToChain(impairment_);
+        if (pacer_) {
+            std::weak_ptr<Impairment> weak = impairment_;
+            pacer_->set_output([weak](rtc::message_ptr message) {
+                if (auto impairment = weak.lock()) {
+                    impairment->submit(std::move(message));
+                }
+            });
+        }
+    }
+
     // Set the full media handler chain on the track
     video_track_->setMediaHandler(packetizer_);
 
     video_track_->onOpen([this]() {
         spdlog::info("[{}] Video track opened", peer_id_);
         needs_keyframe_.store(true);
+        mark_phase(Phase::TrackOpen);
     });
 
     video_track_->onClosed([this]() {
         spdlog::info("[{}] Video track closed", peer_id_);
     });
 
+    if (config_.audio.enabled) {
+        setup_audio_track(cname, msid);
+    }
+
+    if (config_.telemetry.enabled) {
+        setup_telemetry_channel();
+    }
+
+    if (config_.control.enabled) {
+        setup_control_channel();
+    }
+
     spdlog::info("[{}] Peer connection created (SSRC={})", peer_id_, ssrc_);
 }
 
+rtc::Description::Video PeerConnection::video_description() const {
+    rtc::Description::Video media(video_cname, rtc::Description::Direction::SendOnly);
+    media.addH264Codec(config_.webrtc.video.payload_type,
+                       "profile-level-id=" + video_profile() + ";packetization-mode=1;level-asymmetry-allowed=1");
+    media.addSSRC(ssrc_, video_cname, stream_msid, video_cname);
+    media.setBitrate(config_.webrtc.video.bitrate_kbps);
+    if (config_.rtsp.capture_clock != "off") {
+        media.addExtMap(rtc::Description::Entry::ExtMap(AbsCaptureTime::extension_id, AbsCaptureTime::uri));
+    }
+    return media;
+}
+
+void PeerConnection::setup_audio_track(const std::string& cname, const std::string& msid) {
+    // Same CNAME and msid as video: browsers lip-sync tracks of one source
+    // using both tracks' sender reports, which share the media clock
+    const std::string mid = "audio-stream";
+
+    rtc::Description::Audio media(mid, rtc::Description::Direction::SendOnly);
+    media.addOpusCodec(config_.audio.payload_type);
+    media.addSSRC(audio_ssrc_, cname, msid, mid);
+    bool capture_times = config_.rtsp.capture_clock != "off";
+    if (capture_times) {
+        media.addExtMap(rtc::Description::Entry::ExtMap(AbsCaptureTime::extension_id, AbsCaptureTime::uri));
+    }
+
+    audio_track_ = pc_->addTrack(media);
+
+    audio_rtp_config_ = std::make_shared<rtc::RtpPacketizationConfig>(
+        audio_ssrc_,
+        cname,
+        config_.audio.payload_type,
+        opus_clock_rate
+    );
+
+    auto packetizer = std::make_shared<rtc::OpusRtpPacketizer>(audio_rtp_config_);
+    packetizer->addToChain(std::make_shared<rtc::RtcpSrReporter>(audio_rtp_config_));
+    if (capture_times) {
+        packetizer->addToChain(std::make_shared<AbsCaptureTime>(clock_, opus_clock_rate));
+    }
+    if (config_.webrtc.impairment.enabled) {
+        audio_impairment_ = std::make_shared<Impairment>(config_.webrtc.impairment, 1);
+        packetizer->addToChain(audio_impairment_);
+    }
+    audio_track_->setMediaHandler(packetizer);
+
+    audio_track_->onOpen([this]() {
+        spdlog::info("[{}] Audio track opened", peer_id_);
+        audio_open_.store(true);
+    });
+
+    audio_track_->onClosed([this]() {
+        spdlog::info("[{}] Audio track closed", peer_id_);
+        audio_open_.store(false);
+    });
+}
+
+void PeerConnection::setup_telemetry_channel() {
+    // Unordered + no retransmits: a late pose sample is worse than a lost one
+    rtc::DataChannelInit init;
+    init.reliability.unordered = true;
+    init.reliability.maxRetransmits = 0;
+
+    telemetry_channel_ = pc_->createDataChannel("telemetry", init);
+
+    telemetry_channel_->onOpen([this]() {
+        spdlog::info("[{}] Telemetry channel opened", peer_id_);
+    });
+
+    telemetry_channel_->onClosed([this]() {
+        spdlog::info("[{}] Telemetry channel closed", peer_id_);
+    });
+}
+
+void PeerConnection::setup_control_channel() {
+    rtc::DataChannelInit init;
+    init.reliability.unordered = !config_.control.ordered;
+    if (config_.control.max_retransmits >= 0) {
+        init.reliability.maxRetransmits = static_cast<unsigned int>(config_.control.max_retransmits);
+    } else if (config_.control.max_packet_lifetime_ms > 0) {
+        init.reliability.maxPacketLifeTime =
+            std::chrono::milliseconds(config_.control.max_packet_lifetime_ms);
+    }
+
+    control_channel_ = pc_->createDataChannel("control", init);
+
+    control_channel_->onOpen([this]() {
+        spdlog::info("[{}] Control channel opened", peer_id_);
+    });
+
+    control_channel_->onClosed([this]() {
+        spdlog::info("[{}] Control channel closed", peer_id_);
+    });
+
+    control_channel_->onMessage([this](rtc::message_variant data) {
+        if (std::holds_alternative<std::string>(data)) {
+            handle_control_message(std::get<std::string>(data));
+        }
+    });
+}
+
+void PeerConnection::handle_control_message(const std::string& text) {
+    auto msg = nlohmann::json::parse(text, nullptr, false);
+    bool is_object = !msg.is_discarded() && msg.is_object();
+
+    // Answer to our RTT probe
+    if (is_object && msg.value("type", "") == "pong") {
+        uint64_t sent_us = msg.value("t", uint64_t{0});
+        uint64_t now_us = steady_now_us();
+        if (sent_us == 0 || sent_us > now_us) return;
+
+        double rtt_ms = (now_us - sent_us) / 1000.0;
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        stats_.control_rtt_avg_ms = stats_.control_rtt_ms == 0.0
+            ? rtt_ms
+            : 0.875 * stats_.control_rtt_avg_ms + 0.125 * rtt_ms;
+        stats_.control_rtt_ms = rtt_ms;
+        return;
+    }
+
+    int64_t seq = is_object ? msg.value("seq", int64_t{-1}) : -1;
+    bool ok = control_cb_ && control_cb_(peer_id_, seq, text);
+
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        stats_.control_received++;
+        if (ok) {
+            stats_.control_forwarded++;
+        } else {
+            stats_.control_failed++;
+        }
+    }
+
+    // Ack lets the browser measure command delivery time to the robot host
+    if (seq >= 0) {
+        nlohmann::json ack;
+        ack["type"] = "ack";
+        ack["seq"] = seq;
+        ack["ok"] = ok;
+        send_control(ack.dump());
+    }
+}
+
+void PeerConnection::send_control(const std::string& message) {
+    if (!control_channel_ || !control_channel_->isOpen()) {
+        return;
+    }
+
+    try {
+        // Charge the pacer first so queued video yields to this message
+        if (pacer_) {
+            pacer_->charge_priority(message.size());
+        }
+        control_channel_->send(message);
+    } catch (const std::exception& e) {
+        spdlog::warn("[{}] Failed to send control message: {}", peer_id_, e.what());
+    }
+}
+
+void PeerConnection::pace() {
+    if (pacer_) {
+        pacer_->flush();
+    }
+    if (impairment_) {
+        impairment_->flush();
+    }
+    if (audio_impairment_) {
+        audio_impairment_->flush();
+    }
+}
+
+void PeerConnection::set_pacing_rate(int rate_kbps) {
+    if (pacer_) {
+        pacer_->set_rate(rate_kbps);
+    }
+}
+
+void PeerConnection::control_tick() {
+    if (!control_channel_ || !control_channel_->isOpen()) {
+        return;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (now - last_control_ping_ < std::chrono::milliseconds(config_.control.ping_interval_ms)) {
+        return;
+    }
+    last_control_ping_ = now;
+
+    nlohmann::json ping;
+    ping["type"] = "ping";
+    ping["t"] = steady_now_us();
+    {
+        // Report the smoothed RTT so the browser can display it too
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        ping["rtt_ms"] = stats_.control_rtt_avg_ms;
+    }
+    send_control(ping.dump());
+}
+
+void PeerConnection::attach(SignalingCallback signaling_cb,
+                            std::chrono::steady_clock::time_point accepted_at) {
+    {
+        std::lock_guard<std::mutex> lock(signaling_mutex_);
+        signaling_cb_ = std::move(signaling_cb);
+    }
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    accepted_at_ = accepted_at;
+}
+
+void PeerConnection::prepare_offer() {
+    if (!offer_started_.exchange(true)) {
+        pc_->setLocalDescription(rtc::Description::Type::Offer);
+        spdlog::debug("[{}] Prepared SDP offer", peer_id_);
+    }
+}
+
 void PeerConnection::start_offer() {
+    // Release whatever a prepared offer has queued, in order
+    std::vector<std::pair<std::string, std::string>> pending;
+    {
+        std::lock_guard<std::mutex> lock(signaling_mutex_);
+        signaling_open_ = true;
+        pending.swap(pending_signaling_);
+    }
+    for (auto& [type, payload] : pending) {
+        signal(type, payload);
+    }
+
     // Server creates the offer (since it has sendonly tracks)
-    pc_->setLocalDescription(rtc::Description::Type::Offer);
+    if (!offer_started_.exchange(true)) {
+        pc_->setLocalDescription(rtc::Description::Type::Offer);
+    }
     spdlog::info("[{}] Created and sent SDP offer", peer_id_);
 }
 
 void PeerConnection::handle_answer(const std::string& sdp) {
     spdlog::debug("[{}] Received SDP answer", peer_id_);
+    mark_phase(Phase::AnswerReceived);
     rtc::Description answer(sdp, rtc::Description::Type::Answer);
+    std::string answered = answered_video_profile(answer);
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        stats_.answered_profile = answered;
+    }
     pc_->setRemoteDescription(answer);
     needs_keyframe_.store(true);
+
+    bool reoffer = false;
+    {
+        std::lock_guard<std::mutex> lock(signaling_mutex_);
+        std::swap(reoffer, reoffer_pending_);
+    }
+    if (reoffer) offer_video();
+}
+
+std::string PeerConnection::video_profile() const {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    return stats_.video_profile;
+}
+
+std::string PeerConnection::accepted_video_profile() const {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    return stats_.answered_profile.empty() ? stats_.video_profile : stats_.answered_profile;
+}
+
+void PeerConnection::renegotiate_video(const std::string& profile) {
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        if (stats_.video_profile == profile) return;
+        stats_.video_profile = profile;
+    }
+
+    // Not offered yet: the first offer takes the new description
+    if (!offer_started_.load()) {
+        video_track_->setDescription(video_description());
+        return;
+    }
+
+    // An offer in flight is answered first: handle_answer() or this, once
+    // stable, takes the pending re-offer
+    {
+        std::lock_guard<std::mutex> lock(signaling_mutex_);
+        reoffer_pending_ = true;
+    }
+    if (pc_->signalingState() != rtc::PeerConnection::SignalingState::Stable) return;
+    {
+        std::lock_guard<std::mutex> lock(signaling_mutex_);
+        if (!reoffer_pending_) return;
+        reoffer_pending_ = false;
+    }
+    offer_video();
+}
+
+void PeerConnection::offer_video() {
+    spdlog::info("[{}] Offering video again as profile-level-id {}", peer_id_, video_profile());
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        stats_.renegotiations++;
+    }
+    // Nothing decodes across the switch before an IDR
+    needs_keyframe_.store(true);
+    video_track_->setDescription(video_description());
+    reoffering_.store(true);
+    pc_->setLocalDescription(rtc::Description::Type::Offer);
+}
+
+void PeerConnection::signal(const std::string& type, const std::string& payload) {
+    {
+        std::lock_guard<std::mutex> lock(signaling_mutex_);
+        if (!signaling_open_ || !signaling_cb_) {
+            pending_signaling_.emplace_back(type, payload);
+            return;
+        }
+        signaling_cb_(type, payload);
+    }
+    if (type == "offer") {
+        mark_phase(Phase::OfferSent);
+    }
+}
+
+const char* PeerConnection::phase_name(Phase phase) {
+    switch (phase) {
+        case Phase::PeerCreated:    return "peer_created";
+        case Phase::OfferSent:      return "offer_sent";
+        case Phase::AnswerReceived: return "answer_received";
+        case Phase::IceConnected:   return "ice_connected";
+        case Phase::DtlsConnected:  return "dtls_connected";
+        case Phase::TrackOpen:      return "track_open";
+        case Phase::FirstKeyframe:  return "first_keyframe";
+    }
+    return "unknown";
+}
+
+void PeerConnection::mark_phase(Phase phase) {
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        auto& at = phase_times_[static_cast<size_t>(phase)];
+        if (at != std::chrono::steady_clock::time_point{}) return;
+        at = std::chrono::steady_clock::now();
+    }
+    if (phase == Phase::FirstKeyframe) {
+        report_timeline();
+    }
+}
+
+void PeerConnection::report_timeline() {
+    auto stats = get_stats();
+
+    nlohmann::json phases;
+    std::string summary;
+    for (size_t i = 0; i < phase_count; i++) {
+        const char* name = phase_name(static_cast<Phase>(i));
+        phases[name] = stats.phases_ms[i];
+        if (i > 0) summary += ", ";
+        summary += fmt::format("{} {:.0f}", name, stats.phases_ms[i]);
+    }
+    spdlog::info("[{}] Setup timeline{} (ms): {}", peer_id_, stats.pooled ? " (pooled)" : "", summary);
+
+    // The client gets the server side of its time to first frame
+    nlohmann::json timeline;
+    timeline["phases"] = phases;
+    timeline["pooled"] = stats.pooled;
+    signal("timeline", timeline.dump());
 }
 
 void PeerConnection::handle_candidate(const std::string& candidate, const std::string& mid) {
@@ -170,20 +641,15 @@ void PeerConnection::handle_candidate(const std::string& candidate, const std::s
     }
 }
 
-void PeerConnection::send_h264_nal(const uint8_t* data, size_t size, uint64_t timestamp_us) {
+bool PeerConnection::send_h264_nal(const uint8_t* data, size_t size, uint64_t media_us) {
     if (!connected_.load() || !video_track_ || !video_track_->isOpen()) {
-        return;
+        return false;
     }
 
     try {
-        // Use relative timestamp from first frame to avoid uint32 overflow
-        uint64_t expected = 0;
-        start_time_.compare_exchange_strong(expected, timestamp_us);
-        uint64_t relative_us = timestamp_us - start_time_.load();
-
-        // Convert to 90kHz RTP clock
-        rtp_config_->timestamp = static_cast<uint32_t>(
-            (relative_us * rtc::H264RtpPacketizer::defaultClockRate) / 1'000'000);
+        // Convert to 90kHz RTP clock (same timeline as telemetry stamps)
+        rtp_config_->timestamp = MediaClock::to_rtp(
+            media_us, rtc::H264RtpPacketizer::defaultClockRate);
 
         // Send the NAL unit(s) via the track
         auto byte_ptr = reinterpret_cast<const std::byte*>(data);
@@ -197,6 +663,52 @@ void PeerConnection::send_h264_nal(const uint8_t* data, size_t size, uint64_t ti
         }
     } catch (const std::exception& e) {
         spdlog::warn("[{}] Failed to send RTP: {}", peer_id_, e.what());
+        return false;
+    }
+
+    if (!first_keyframe_sent_.load() && h264::contains_idr(data, size)) {
+        first_keyframe_sent_.store(true);
+        mark_phase(Phase::FirstKeyframe);
+    }
+    return true;
+}
+
+void PeerConnection::send_audio(const uint8_t* data, size_t size, uint64_t media_us) {
+    if (!connected_.load() || !audio_track_ || !audio_track_->isOpen()) {
+        return;
+    }
+
+    try {
+        audio_rtp_config_->timestamp = MediaClock::to_rtp(media_us, opus_clock_rate);
+        audio_track_->send(reinterpret_cast<const std::byte*>(data), size);
+
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        stats_.audio_packets_sent++;
+        stats_.bytes_sent += size;
+    } catch (const std::exception& e) {
+        spdlog::warn("[{}] Failed to send audio: {}", peer_id_, e.what());
+    }
+}
+
+void PeerConnection::send_telemetry(const std::string& message) {
+    if (!telemetry_channel_ || !telemetry_channel_->isOpen()) {
+        return;
+    }
+
+    bool sent = false;
+    try {
+        if (telemetry_channel_->bufferedAmount() < telemetry_max_buffered) {
+            sent = telemetry_channel_->send(message);
+        }
+    } catch (const std::exception& e) {
+        spdlog::debug("[{}] Failed to send telemetry: {}", peer_id_, e.what());
+    }
+
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    if (sent) {
+        stats_.telemetry_sent++;
+    } else {
+        stats_.telemetry_dropped++;
     }
 }
 
@@ -208,9 +720,56 @@ bool PeerConnection::is_closed() const {
     return closed_.load();
 }
 
+static std::string describe_candidate(const rtc::Candidate& candidate) {
+    const char* type = "unknown";
+    switch (candidate.type()) {
+        case rtc::Candidate::Type::Host:            type = "host"; break;
+        case rtc::Candidate::Type::ServerReflexive: type = "srflx"; break;
+        case rtc::Candidate::Type::PeerReflexive:   type = "prflx"; break;
+        case rtc::Candidate::Type::Relayed:         type = "relay"; break;
+        default: break;
+    }
+    return std::string(type) + " " + candidate.address().value_or("?") + ":" +
+           std::to_string(candidate.port().value_or(0));
+}
+
 PeerConnection::Stats PeerConnection::get_stats() const {
-    std::lock_guard<std::mutex> lock(stats_mutex_);
-    return stats_;
+    Stats stats;
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        stats = stats_;
+
+        // Phases done before the client arrived (pooled peer) count as 0 ms
+        auto created = phase_times_[static_cast<size_t>(Phase::PeerCreated)];
+        stats.pooled = created < accepted_at_;
+        for (size_t i = 0; i < phase_count; i++) {
+            if (phase_times_[i] == std::chrono::steady_clock::time_point{}) continue;
+            stats.phases_ms[i] = std::max(0.0, std::chrono::duration<double, std::milli>(
+                phase_times_[i] - accepted_at_).count());
+        }
+    }
+
+    if (pc_) {
+        stats.transport_bytes_sent = pc_->bytesSent();
+        stats.transport_bytes_received = pc_->bytesReceived();
+        if (auto rtt = pc_->rtt()) {
+            stats.transport_rtt_ms = static_cast<double>(rtt->count());
+        }
+        rtc::Candidate local, remote;
+        if (pc_->getSelectedCandidatePair(&local, &remote)) {
+            stats.local_candidate = describe_candidate(local);
+            stats.remote_candidate = describe_candidate(remote);
+        }
+    }
+
+    for (auto& impairment : {impairment_, audio_impairment_}) {
+        if (impairment) {
+            auto is = impairment->get_stats();
+            stats.impairment_lost += is.lost;
+            stats.impairment_queue_drops += is.queue_drops;
+        }
+    }
+    return stats;
 }
 
 } // namespace ss
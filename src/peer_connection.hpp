@@ -1,30 +1,53 @@
 #pragma once
 
 #include "config.hpp"
+#include "impairment.hpp"
+#include "media_clock.hpp"
+#include "pacer.hpp"
 #include <rtc/rtc.hpp>
+#include <array>
+#include <chrono>
 #include <functional>
 #include <memory>
 #include <mutex>
 #include <atomic>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace ss {
 
 // Callback for signaling messages back to client
 using SignalingCallback = std::function<void(const std::string& type, const std::string& payload)>;
 
+// Callback for commands from the control channel, returns false if the
+// command could not be forwarded to the robot
+using ControlCallback = std::function<bool(const std::string& peer_id, int64_t seq,
+                                           const std::string& command)>;
+
 class PeerConnection {
 public:
+    // `video_profile`: H.264 profile-level-id to offer, that of the stream
+    // being sent ("" = libdatachannel's default, 42e01f)
     PeerConnection(const std::string& peer_id,
-                   const WebRtcConfig& config,
-                   SignalingCallback signaling_cb);
+                   const AppConfig& config,
+                   const MediaClock& clock,
+                   const std::string& video_profile);
     ~PeerConnection();
 
     // Non-copyable
     PeerConnection(const PeerConnection&) = delete;
     PeerConnection& operator=(const PeerConnection&) = delete;
 
-    // Server creates offer → sends to browser
+    // Hand the peer to a client: signaling goes to `signaling_cb` and the
+    // setup timeline is measured from `accepted_at` (WebSocket accept)
+    void attach(SignalingCallback signaling_cb, std::chrono::steady_clock::time_point accepted_at);
+
+    // Create the offer and gather candidates before any client asks (peer
+    // pool). Nothing is signaled until start_offer().
+    void prepare_offer();
+
+    // Server creates offer → sends to browser (a prepared one goes out at once)
     void start_offer();
 
     // Browser sends answer back → server sets remote description
@@ -33,49 +56,156 @@ public:
     // ICE candidate exchange
     void handle_candidate(const std::string& candidate, const std::string& mid);
 
-    // Send H.264 NAL units to remote peer
-    void send_h264_nal(const uint8_t* data, size_t size, uint64_t timestamp_us);
+    // Send H.264 NAL units to remote peer (timestamp on the shared media clock).
+    // Returns false if the track is not open yet or the send failed.
+    bool send_h264_nal(const uint8_t* data, size_t size, uint64_t media_us);
+
+    // Send one Opus packet (timestamp on the shared media clock)
+    void send_audio(const uint8_t* data, size_t size, uint64_t media_us);
+
+    // Peer negotiated the audio track and it is open
+    bool audio_active() const { return audio_open_.load(); }
+
+    // Send a pre-stamped telemetry message (dropped if the channel is backed up)
+    void send_telemetry(const std::string& message);
+
+    // Control channel: commands in, acks/replies out (prioritized over video)
+    void set_control_callback(ControlCallback cb) { control_cb_ = std::move(cb); }
+    void send_control(const std::string& message);
+
+    // Periodic work: release paced/impaired packets, send control RTT probes
+    void pace();
+    bool needs_ticks() const { return pacer_ || impairment_ || audio_impairment_; }
+    void set_pacing_rate(int rate_kbps);
+    void control_tick();
+
+    // Browser asked for a keyframe (RTCP PLI/FIR after loss)
+    void set_keyframe_request_callback(std::function<void()> cb) { keyframe_request_cb_ = std::move(cb); }
 
     // Request a keyframe (for new connections)
     bool needs_keyframe() const { return needs_keyframe_.load(); }
     void keyframe_sent() { needs_keyframe_.store(false); }
+    // Switched to another stream (ROI): nothing decodes before its IDR
+    void wait_for_keyframe() { needs_keyframe_.store(true); }
+
+    // H.264 profile-level-id the video was offered with
+    std::string video_profile() const;
+
+    // The one the browser's answer accepted (the offered one until answered);
+    // what the stream has to fit
+    std::string accepted_video_profile() const;
+
+    // Offer the video again with another profile-level-id (the source's no
+    // longer fits). Waits for the answer to an offer in flight.
+    void renegotiate_video(const std::string& profile);
 
     // Connection state
     bool is_connected() const;
     bool is_closed() const;
     std::string id() const { return peer_id_; }
 
+    // Session setup phases, in order
+    enum class Phase {
+        PeerCreated,
+        OfferSent,
+        AnswerReceived,
+        IceConnected,
+        DtlsConnected,
+        TrackOpen,
+        FirstKeyframe,
+    };
+    static constexpr size_t phase_count = 7;
+    static const char* phase_name(Phase phase);
+
     // Stats
     struct Stats {
         uint64_t rtp_packets_sent = 0;
         uint64_t bytes_sent = 0;
+        uint64_t audio_packets_sent = 0;
+        uint64_t telemetry_sent = 0;
+        uint64_t telemetry_dropped = 0;
+        uint64_t control_received = 0;
+        uint64_t control_forwarded = 0;
+        uint64_t control_failed = 0;
+        uint64_t plis_received = 0;
+        double control_rtt_ms = 0.0;      // last probe
+        double control_rtt_avg_ms = 0.0;  // smoothed (EWMA)
         std::string state = "new";
+        // Transport (ICE/DTLS), read from libdatachannel on request
+        uint64_t transport_bytes_sent = 0;
+        uint64_t transport_bytes_received = 0;
+        double transport_rtt_ms = 0.0;
+        std::string local_candidate;   // "host 10.0.0.5:50123"
+        std::string remote_candidate;
+        // Packets dropped by the test impairment (audio + video)
+        uint64_t impairment_lost = 0;
+        uint64_t impairment_queue_drops = 0;
+        // Setup timeline: ms from the WebSocket accept to each phase
+        // (-1 = not reached). Pooled peers did the early phases beforehand.
+        std::array<double, phase_count> phases_ms{};
+        bool pooled = false;
+        std::string video_profile;      // H.264 profile-level-id offered
+        std::string answered_profile;   // and accepted in the answer ("" = none yet)
+        uint64_t renegotiations = 0;    // offered again for a source format change
     };
     Stats get_stats() const;
 
 private:
     void setup_connection();
+    rtc::Description::Video video_description() const;
+    void offer_video();
+    void signal(const std::string& type, const std::string& payload);
+    void mark_phase(Phase phase);
+    void report_timeline();
+    void setup_audio_track(const std::string& cname, const std::string& msid);
+    void setup_telemetry_channel();
+    void setup_control_channel();
+    void handle_control_message(const std::string& text);
 
     std::string peer_id_;
-    WebRtcConfig config_;
+    AppConfig config_;
+    const MediaClock& clock_;
+    ControlCallback control_cb_;
+    std::function<void()> keyframe_request_cb_;
+
+    // Signaling is held until start_offer(), so a pooled peer's offer and
+    // candidates reach the client after its welcome message
+    std::mutex signaling_mutex_;
     SignalingCallback signaling_cb_;
+    bool signaling_open_ = false;
+    std::vector<std::pair<std::string, std::string>> pending_signaling_;
+    std::atomic<bool> offer_started_{false};
+    bool reoffer_pending_ = false;          // renegotiate once answered
+    std::atomic<bool> reoffering_{false};   // signal the next local description
 
     std::shared_ptr<rtc::PeerConnection> pc_;
     std::shared_ptr<rtc::Track> video_track_;
     std::shared_ptr<rtc::RtpPacketizationConfig> rtp_config_;
     std::shared_ptr<rtc::H264RtpPacketizer> packetizer_;
     std::shared_ptr<rtc::RtcpSrReporter> sr_reporter_;
+    std::shared_ptr<rtc::Track> audio_track_;
+    std::shared_ptr<rtc::RtpPacketizationConfig> audio_rtp_config_;
+    std::shared_ptr<Pacer> pacer_;
+    std::shared_ptr<Impairment> impairment_;       // test only
+    std::shared_ptr<Impairment> audio_impairment_;
+    std::shared_ptr<rtc::DataChannel> telemetry_channel_;
+    std::shared_ptr<rtc::DataChannel> control_channel_;
+    std::chrono::steady_clock::time_point last_control_ping_;
 
     std::atomic<bool> needs_keyframe_{true};
     std::atomic<bool> connected_{false};
     std::atomic<bool> closed_{false};
+    std::atomic<bool> audio_open_{false};
 
     mutable std::mutex stats_mutex_;
     Stats stats_;
+    std::chrono::steady_clock::time_point accepted_at_;
+    std::array<std::chrono::steady_clock::time_point, phase_count> phase_times_{};
+    std::atomic<bool> first_keyframe_sent_{false};
 
     uint32_t ssrc_;
+    uint32_t audio_ssrc_;
     static std::atomic<uint32_t> next_ssrc_;
-    static std::atomic<uint64_t> start_time_; // relative timestamp base
 };
 
 } // namespace ss
@@ -0,0 +1,331 @@
+#include "peer_encoders.hpp"
+#include <gst/video/video.h>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+
+namespace ss {
+
+// Joining-viewer and PLI IDRs per encoder are spaced at least this far
+static constexpr auto keyframe_min_interval = std::chrono::milliseconds(500);
+
+// Weight of the newest CPU sample; samples come every watchdog tick
+static constexpr double cpu_alpha = 0.3;
+
+static const std::string stream_prefix = "peer-";
+
+PeerEncoders::~PeerEncoders() {
+    detach();
+}
+
+// ─── Pipeline lifecycle ────────────────────────────────────────────────────────
+
+void PeerEncoders::attach(const Setup& setup) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    setup_ = setup;
+    last_change_ = std::chrono::steady_clock::now();
+}
+
+void PeerEncoders::detach() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // The pipeline is stopped: encoder bins go with it. Their viewers get
+    // an encoder again as soon as tick() finds the new pipeline.
+    for (auto& encoder : encoders_) {
+        if (encoder->tee_pad) gst_object_unref(encoder->tee_pad);
+        stranded_.push_back(encoder->peer_id);
+    }
+    encoders_.clear();
+}
+
+bool PeerEncoders::owns(const std::string& stream) {
+    return stream.compare(0, stream_prefix.size(), stream_prefix) == 0;
+}
+
+// ─── Encoders ──────────────────────────────────────────────────────────────────
+
+int PeerEncoders::clamp_bitrate(int bitrate_kbps) const {
+    const VideoConfig& video = setup_.encode.video;
+    return std::max(video.min_bitrate_kbps, std::min(bitrate_kbps, video.max_bitrate_kbps));
+}
+
+std::shared_ptr<PeerEncoders::Encoder> PeerEncoders::build(const std::string& peer_id) {
+    auto encoder = std::make_shared<Encoder>();
+    encoder->owner = this;
+    encoder->peer_id = peer_id;
+    encoder->stream = stream_prefix + peer_id;
+
+    // Start where the viewer's ABR left the shared encode, if it asked yet
+    auto requested = requested_.find(peer_id);
+    VideoConfig video = setup_.encode.video;
+    video.bitrate_kbps = clamp_bitrate(requested != requested_.end() ? requested->second
+                                                                     : video.bitrate_kbps);
+    encoder->bitrate_kbps = video.bitrate_kbps;
+
+    std::string desc =
+        "queue leaky=downstream max-size-buffers=2 max-size-bytes=0 max-size-time=0 ! " +
+        setup_.encode.encoder.launch(setup_.encode.encoding, video, setup_.encode.nvmm) +
+        "video/x-h264,stream-format=byte-stream,alignment=au ! "
+        "h264parse config-interval=1 ! "
+        "appsink name=peersink emit-signals=true sync=false max-buffers=5 drop=true";
+
+    GError* error = nullptr;
+    encoder->bin = gst_parse_bin_from_description(desc.c_str(), TRUE, &error);
+    if (error) {
+        spdlog::error("Per-peer encoder for {}: {}", peer_id, error->message);
+        g_error_free(error);
+        return nullptr;
+    }
+
+    // Owned by the bin
+    encoder->encoder = gst_bin_get_by_name(GST_BIN(encoder->bin), "enc");
+    encoder->sink = gst_bin_get_by_name(GST_BIN(encoder->bin), "peersink");
+    if (encoder->encoder) gst_object_unref(encoder->encoder);
+    if (encoder->sink) gst_object_unref(encoder->sink);
+
+    GstAppSinkCallbacks callbacks = {};
+    callbacks.new_sample = &PeerEncoders::on_new_sample;
+    gst_app_sink_set_callbacks(GST_APP_SINK(encoder->sink), &callbacks, encoder.get(), nullptr);
+
+    if (!tap_.link(encoder->bin, nullptr, encoder->tee_pad)) {
+        gst_object_unref(gst_object_ref_sink(encoder->bin));
+        return nullptr;
+    }
+    return encoder;
+}
+
+void PeerEncoders::remove(size_t index, std::vector<BranchTap::Unlink>& unlinks) {
+    auto encoder = encoders_[index];
+    tap_.unlink(encoder->tee_pad, encoder->bin, encoder, unlinks);
+    encoders_.erase(encoders_.begin() + static_cast<std::ptrdiff_t>(index));
+}
+
+// ─── Viewers ───────────────────────────────────────────────────────────────────
+
+bool PeerEncoders::set_bitrate(const std::string& peer_id, int bitrate_kbps) {
+    GstElement* element = nullptr;
+    VideoEncoder video_encoder;
+    FrameBudget budget;
+    int clamped;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        requested_[peer_id] = bitrate_kbps;
+        auto it = std::find_if(encoders_.begin(), encoders_.end(),
+                               [&](const auto& e) { return e->peer_id == peer_id; });
+        if (it == encoders_.end()) return false;
+
+        auto& encoder = *it;
+        clamped = clamp_bitrate(bitrate_kbps);
+        if (clamped == encoder->bitrate_kbps || !encoder->encoder) return true;
+        encoder->bitrate_kbps = clamped;
+        video_encoder = setup_.encode.encoder;
+        budget = frame_budget(setup_.encode.encoding.latency_budget_ms, clamped,
+                              setup_.encode.video.fps);
+        element = static_cast<GstElement*>(gst_object_ref(encoder->encoder));
+    }
+    // Outside the lock, like the branch keyframe requests
+    video_encoder.set_bitrate(element, clamped, budget);
+    gst_object_unref(element);
+    spdlog::debug("[{}] Per-peer encoder bitrate: {} kbps", peer_id, clamped);
+    return true;
+}
+
+std::string PeerEncoders::stream_for(const std::string& peer_id) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& encoder : encoders_) {
+        if (encoder->peer_id == peer_id) return encoder->stream;
+    }
+    return "";
+}
+
+void PeerEncoders::set_excluded(const std::string& peer_id, bool excluded) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (excluded) {
+        excluded_.insert(peer_id);
+    } else {
+        excluded_.erase(peer_id);
+    }
+}
+
+bool PeerEncoders::request_keyframe(const std::string& stream) {
+    GstElement* sink = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = std::find_if(encoders_.begin(), encoders_.end(),
+                               [&](const auto& e) { return e->stream == stream; });
+        if (it == encoders_.end() || !(*it)->sink) return false;
+        auto now = std::chrono::steady_clock::now();
+        if (now - (*it)->last_keyframe < keyframe_min_interval) return true;
+        (*it)->last_keyframe = now;
+        sink = static_cast<GstElement*>(gst_object_ref((*it)->sink));
+    }
+    bool handled = gst_element_send_event(sink, gst_video_event_new_upstream_force_key_unit(
+        GST_CLOCK_TIME_NONE, TRUE, 0));
+    gst_object_unref(sink);
+    return handled;
+}
+
+// ─── CPU budget ────────────────────────────────────────────────────────────────
+
+void PeerEncoders::sample_cpu() {
+    ProcStats::Sample sample = proc_.sample();
+    if (!sample.valid) return;
+    cpu_percent_ = cpu_percent_ < 0.0
+        ? sample.cpu_percent
+        : cpu_alpha * sample.cpu_percent + (1.0 - cpu_alpha) * cpu_percent_;
+
+    // Measure only once the last change has settled
+    auto settle = std::chrono::milliseconds(setup_.per_peer.settle_ms);
+    if (std::chrono::steady_clock::now() - last_change_ < settle) return;
+    if (encoders_.empty()) {
+        idle_cpu_percent_ = cpu_percent_;
+    } else if (idle_cpu_percent_ >= 0.0) {
+        encoder_cost_percent_ = std::max(0.0, (cpu_percent_ - idle_cpu_percent_) /
+                                              static_cast<double>(encoders_.size()));
+    }
+}
+
+void PeerEncoders::tick(const std::vector<std::string>& peers) {
+    std::vector<BranchTap::Unlink> unlinks;
+    std::vector<std::pair<std::string, std::string>> routes;
+    GstElement* keyframe_sink = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        sample_cpu();
+
+        auto connected = [&](const std::string& peer_id) {
+            return std::find(peers.begin(), peers.end(), peer_id) != peers.end();
+        };
+        for (auto it = requested_.begin(); it != requested_.end();) {
+            it = connected(it->first) ? std::next(it) : requested_.erase(it);
+        }
+        for (auto it = excluded_.begin(); it != excluded_.end();) {
+            it = connected(*it) ? std::next(it) : excluded_.erase(it);
+        }
+        const PerPeerConfig& config = setup_.per_peer;
+
+        // After a pipeline rebuild: encoders back for the viewers that had
+        // one, on the same stream, without waiting for the budget
+        bool source_known = tap_.attached() && !tap_.source_resolution().empty();
+        for (auto it = stranded_.begin(); it != stranded_.end();) {
+            const std::string peer_id = *it;
+            bool eligible = connected(peer_id) && !excluded_.count(peer_id) && config.enabled &&
+                            static_cast<int>(encoders_.size()) < config.max_encoders;
+            if (eligible && !source_known) break;   // wait for the new pipeline
+            it = stranded_.erase(it);
+            auto encoder = eligible ? build(peer_id) : nullptr;
+            if (encoder) {
+                encoders_.push_back(encoder);
+            } else if (connected(peer_id)) {
+                routes.emplace_back(peer_id, "");
+            }
+        }
+
+        // Viewers that left, switched to a ROI stream, or are over the limit
+        // after a reload
+        for (size_t i = encoders_.size(); i-- > 0;) {
+            const std::string& peer_id = encoders_[i]->peer_id;
+            bool gone = !connected(peer_id);
+            bool excluded = excluded_.count(peer_id) > 0;   // already routed to its ROI stream
+            if (gone || excluded || !config.enabled || static_cast<int>(i) >= config.max_encoders) {
+                if (!gone && !excluded) routes.emplace_back(peer_id, "");
+                spdlog::info("[{}] Per-peer encoder removed", peer_id);
+                remove(i, unlinks);
+                last_change_ = std::chrono::steady_clock::now();
+            }
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        bool settled = now - last_change_ >= std::chrono::milliseconds(config.settle_ms);
+        if (config.enabled && settled && cpu_percent_ >= 0.0) {
+            if (cpu_percent_ > config.cpu_budget_percent && !encoders_.empty()) {
+                // Over budget: the newest viewer goes back to the shared encode
+                auto& newest = encoders_.back();
+                spdlog::warn("[{}] CPU {:.0f}% over the {:.0f}% budget, back to the shared encode",
+                             newest->peer_id, cpu_percent_, config.cpu_budget_percent);
+                routes.emplace_back(newest->peer_id, "");
+                remove(encoders_.size() - 1, unlinks);
+                returned_++;
+                last_change_ = now;
+            } else if (static_cast<int>(encoders_.size()) < config.max_encoders &&
+                       cpu_percent_ + encoder_cost_percent_ <= config.cpu_budget_percent &&
+                       source_known && stranded_.empty()) {
+                // One viewer per settle period, so its cost can be measured
+                for (auto& peer_id : peers) {
+                    bool has_encoder = std::any_of(encoders_.begin(), encoders_.end(),
+                        [&](const auto& e) { return e->peer_id == peer_id; });
+                    if (has_encoder || excluded_.count(peer_id)) continue;
+
+                    auto encoder = build(peer_id);
+                    if (!encoder) break;
+                    encoders_.push_back(encoder);
+                    routes.emplace_back(peer_id, encoder->stream);
+                    admitted_++;
+                    last_change_ = now;
+                    encoder->last_keyframe = now;
+                    keyframe_sink = static_cast<GstElement*>(gst_object_ref(encoder->sink));
+                    spdlog::info("[{}] Per-peer encoder at {} kbps ({} of {}, ~{:.0f}% CPU each)",
+                                 peer_id, encoder->bitrate_kbps, encoders_.size(),
+                                 config.max_encoders, encoder_cost_percent_);
+                    break;
+                }
+            }
+        }
+    }
+
+    // Outside the lock: the probe may run right here and stop an encoder
+    // whose streaming thread is waiting for the lock in on_new_sample
+    BranchTap::run(unlinks);
+    if (route_cb_) {
+        for (auto& [peer_id, stream] : routes) route_cb_(peer_id, stream);
+    }
+    if (keyframe_sink) {
+        // In passthrough the shared decoder may have just been added mid-GOP
+        gst_element_send_event(keyframe_sink, gst_video_event_new_upstream_force_key_unit(
+            GST_CLOCK_TIME_NONE, TRUE, 0));
+        gst_object_unref(keyframe_sink);
+    }
+}
+
+// ─── Frames ────────────────────────────────────────────────────────────────────
+
+GstFlowReturn PeerEncoders::on_new_sample(GstAppSink* sink, gpointer user_data) {
+    auto* encoder = static_cast<Encoder*>(user_data);
+    PeerEncoders* self = encoder->owner;
+
+    GstSample* sample = gst_app_sink_pull_sample(sink);
+    if (!sample) return GST_FLOW_OK;
+
+    GstBuffer* buffer = gst_sample_get_buffer(sample);
+    GstMapInfo map;
+    if (buffer && GST_BUFFER_PTS_IS_VALID(buffer) && gst_buffer_map(buffer, &map, GST_MAP_READ)) {
+        {
+            std::lock_guard<std::mutex> lock(self->mutex_);
+            encoder->frames++;
+            encoder->bytes += map.size;
+        }
+        if (self->frame_cb_ && map.size > 0) {
+            self->frame_cb_(encoder->stream, map.data, map.size, GST_BUFFER_PTS(buffer) / 1000);
+        }
+        gst_buffer_unmap(buffer, &map);
+    }
+    gst_sample_unref(sample);
+    return GST_FLOW_OK;
+}
+
+PeerEncoders::Stats PeerEncoders::get_stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats;
+    stats.enabled = setup_.per_peer.enabled;
+    stats.max_encoders = setup_.per_peer.max_encoders;
+    stats.cpu_budget_percent = setup_.per_peer.cpu_budget_percent;
+    stats.cpu_percent = std::max(cpu_percent_, 0.0);
+    stats.encoder_cost_percent = encoder_cost_percent_;
+    stats.admitted = admitted_;
+    stats.returned = returned_;
+    for (auto& encoder : encoders_) {
+        stats.encoders.push_back({encoder->peer_id, encoder->bitrate_kbps,
+                                  encoder->frames, encoder->bytes});
+    }
+    return stats;
+}
+
+} // namespace ss
@@ -0,0 +1,145 @@
+#pragma once
+
+#include "branch_tap.hpp"
+#include "config.hpp"
+#include "proc_stats.hpp"
+#include <gst/gst.h>
+#include <gst/app/gstappsink.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace ss {
+
+// A full-frame encoder per viewer for small audiences (encoding.per_peer),
+// fed from the shared decode through the branch tap. Each runs at the
+// bitrate its own viewer's ABR asks for, instead of the single rate the
+// shared encode settles on for everyone.
+//
+// Encoders are added one viewer at a time, settle_ms apart, while the
+// process CPU plus the measured cost of one more encoder stays under
+// cpu_budget_percent. Above the budget the newest viewer goes back to the
+// shared encode. Viewers past max_encoders, or watching a ROI stream,
+// stay on the shared encode.
+class PeerEncoders {
+public:
+    // Encoded access unit for one viewer, on the pipeline's timestamps
+    using FrameCallback = std::function<void(const std::string& stream, const uint8_t* data,
+                                             size_t size, uint64_t timestamp_us)>;
+
+    // A viewer moved to its own encoder (`stream`) or back to the shared
+    // one ("")
+    using RouteCallback = std::function<void(const std::string& peer_id, const std::string& stream)>;
+
+    struct Setup {
+        PerPeerConfig per_peer;
+        BranchEncode encode;
+    };
+
+    explicit PeerEncoders(BranchTap& tap) : tap_(tap) {}
+    ~PeerEncoders();
+
+    // Non-copyable
+    PeerEncoders(const PeerEncoders&) = delete;
+    PeerEncoders& operator=(const PeerEncoders&) = delete;
+
+    void set_frame_callback(FrameCallback cb) { frame_cb_ = std::move(cb); }
+    void set_route_callback(RouteCallback cb) { route_cb_ = std::move(cb); }
+
+    // The branch tap was attached to a new pipeline; viewers are
+    // readmitted by tick()
+    void attach(const Setup& setup);
+
+    // The pipeline is about to be torn down (the encoders go with it)
+    void detach();
+
+    // Stream names of per-peer encoders ("peer-<id>")
+    static bool owns(const std::string& stream);
+
+    // A viewer's ABR request. Returns false when the viewer is on the
+    // shared encode, whose bitrate policy should take it instead.
+    bool set_bitrate(const std::string& peer_id, int bitrate_kbps);
+
+    // The viewer's own stream, "" when it is on the shared encode
+    std::string stream_for(const std::string& peer_id) const;
+
+    // Keep a viewer on the shared path (it switched to a ROI stream); its
+    // encoder, if any, is removed on the next tick
+    void set_excluded(const std::string& peer_id, bool excluded);
+
+    // IDR on one viewer's encoder (joining, PLI); rate limited
+    bool request_keyframe(const std::string& stream);
+
+    // Admit or return viewers against the CPU budget and drop those that
+    // left. `peers`: connected viewer ids.
+    void tick(const std::vector<std::string>& peers);
+
+    struct EncoderStats {
+        std::string peer_id;
+        int bitrate_kbps = 0;
+        uint64_t frames = 0;
+        uint64_t bytes = 0;
+    };
+    struct Stats {
+        bool enabled = false;
+        int max_encoders = 0;
+        double cpu_budget_percent = 0.0;
+        double cpu_percent = 0.0;           // process, smoothed
+        double encoder_cost_percent = 0.0;  // measured CPU per encoder, 0 = not yet known
+        uint64_t admitted = 0;
+        uint64_t returned = 0;              // moved back to the shared encode over budget
+        std::vector<EncoderStats> encoders;
+    };
+    Stats get_stats() const;
+
+private:
+    struct Encoder {
+        PeerEncoders* owner = nullptr;
+        std::string peer_id;
+        std::string stream;
+        GstElement* bin = nullptr;
+        GstElement* encoder = nullptr;
+        GstElement* sink = nullptr;
+        GstPad* tee_pad = nullptr;          // reference handed back to the tap on removal
+        int bitrate_kbps = 0;
+        std::chrono::steady_clock::time_point last_keyframe;
+        uint64_t frames = 0;
+        uint64_t bytes = 0;
+    };
+
+    static GstFlowReturn on_new_sample(GstAppSink* sink, gpointer user_data);
+
+    int clamp_bitrate(int bitrate_kbps) const;                          // mutex_ held
+    std::shared_ptr<Encoder> build(const std::string& peer_id);        // mutex_ held
+    void remove(size_t index, std::vector<BranchTap::Unlink>& unlinks); // mutex_ held
+    void sample_cpu();                                                  // mutex_ held
+
+    BranchTap& tap_;
+    FrameCallback frame_cb_;
+    RouteCallback route_cb_;
+
+    mutable std::mutex mutex_;
+    Setup setup_;
+    std::vector<std::shared_ptr<Encoder>> encoders_;    // admission order
+    std::unordered_map<std::string, int> requested_;    // peer id → last ABR request
+    std::unordered_set<std::string> excluded_;
+    std::vector<std::string> stranded_;                 // had an encoder on the last pipeline
+
+    // CPU budget
+    ProcStats proc_;
+    double cpu_percent_ = -1.0;             // smoothed, < 0 until the first sample
+    double idle_cpu_percent_ = -1.0;        // smoothed with no encoders running
+    double encoder_cost_percent_ = 0.0;
+    std::chrono::steady_clock::time_point last_change_;
+    uint64_t admitted_ = 0;
+    uint64_t returned_ = 0;
+};
+
+} // namespace ss
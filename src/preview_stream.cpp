@@ -0,0 +1,345 @@
+#include "preview_stream.hpp"
+#include <gst/video/video.h>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+
+namespace ss {
+
+// Joining-viewer and PLI IDRs are spaced at least this far
+static constexpr auto keyframe_min_interval = std::chrono::milliseconds(500);
+
+// After the substream failed to start or dropped, before trying again
+static constexpr auto retry_interval = std::chrono::seconds(5);
+
+PreviewStream::~PreviewStream() {
+    detach();
+    std::shared_ptr<Source> substream;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        substream = release_substream();
+    }
+    if (substream) {
+        gst_element_set_state(substream->element, GST_STATE_NULL);
+        gst_object_unref(substream->element);
+    }
+}
+
+// ─── Pipeline lifecycle ────────────────────────────────────────────────────────
+
+void PreviewStream::attach(const Setup& setup) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    setup_ = setup;
+    // The branch for current viewers is rebuilt by tick() once the source
+    // is running; a substream on another url is replaced there too
+}
+
+void PreviewStream::detach() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // The pipeline is stopped: the branch bin goes with it
+    if (branch_ && branch_->tee_pad) gst_object_unref(branch_->tee_pad);
+    branch_.reset();
+}
+
+// ─── Sources ───────────────────────────────────────────────────────────────────
+
+std::shared_ptr<PreviewStream::Source> PreviewStream::build_branch() {
+    const PreviewConfig& preview = setup_.preview;
+    std::string size = ",width=" + std::to_string(preview.width) +
+                       ",height=" + std::to_string(preview.height);
+    // Frames are dropped down to the preview rate before anything is scaled
+    std::string scale = setup_.encode.nvmm
+        ? "videorate drop-only=true max-rate=" + std::to_string(preview.fps) + " ! "
+          "nvvidconv ! video/x-raw(memory:NVMM)" + size + " ! "
+        : "videorate drop-only=true ! video/x-raw,framerate=" + std::to_string(preview.fps) + "/1 ! "
+          "videoscale add-borders=true ! video/x-raw,pixel-aspect-ratio=1/1" + size + " ! ";
+
+    VideoConfig video = setup_.encode.video;
+    video.fps = preview.fps;
+    video.bitrate_kbps = preview.bitrate_kbps;
+    video.max_bitrate_kbps = std::max(video.max_bitrate_kbps, preview.bitrate_kbps);
+
+    std::string desc =
+        "queue leaky=downstream max-size-buffers=2 max-size-bytes=0 max-size-time=0 ! " + scale +
+        setup_.encode.encoder.launch(setup_.encode.encoding, video, setup_.encode.nvmm) +
+        "video/x-h264,stream-format=byte-stream,alignment=au ! "
+        "h264parse config-interval=1 ! "
+        "appsink name=previewsink emit-signals=true sync=false max-buffers=5 drop=true";
+
+    GError* error = nullptr;
+    auto source = std::make_shared<Source>();
+    source->owner = this;
+    source->element = gst_parse_bin_from_description(desc.c_str(), TRUE, &error);
+    if (error) {
+        spdlog::error("Preview branch: {}", error->message);
+        g_error_free(error);
+        return nullptr;
+    }
+
+    // Owned by the bin
+    source->sink = gst_bin_get_by_name(GST_BIN(source->element), "previewsink");
+    if (source->sink) gst_object_unref(source->sink);
+
+    GstAppSinkCallbacks callbacks = {};
+    callbacks.new_sample = &PreviewStream::on_new_sample;
+    gst_app_sink_set_callbacks(GST_APP_SINK(source->sink), &callbacks, source.get(), nullptr);
+
+    if (!tap_.link(source->element, &source->paused, source->tee_pad)) {
+        gst_object_unref(gst_object_ref_sink(source->element));
+        return nullptr;
+    }
+
+    builds_++;
+    spdlog::info("Preview: encoding {}x{} at {} fps, {} kbps", preview.width, preview.height,
+                 preview.fps, preview.bitrate_kbps);
+    return source;
+}
+
+std::shared_ptr<PreviewStream::Source> PreviewStream::build_substream() {
+    if (!gst_is_initialized()) {
+        gst_init(nullptr, nullptr);
+    }
+
+    // Relayed as is: the camera already encodes it at substream size
+    std::string desc =
+        "rtspsrc location=" + setup_.preview.url + " "
+        "latency=" + std::to_string(setup_.rtsp.latency_ms) + " "
+        "protocols=" + setup_.rtsp.transport + " ! "
+        "rtph264depay ! h264parse config-interval=1 ! "
+        "video/x-h264,stream-format=byte-stream,alignment=au ! "
+        "appsink name=sink emit-signals=true sync=false max-buffers=5 drop=true";
+
+    GError* error = nullptr;
+    auto source = std::make_shared<Source>();
+    source->owner = this;
+    source->own_clock = true;
+    source->element = gst_parse_launch(desc.c_str(), &error);
+    if (error) {
+        spdlog::error("Preview substream: {}", error->message);
+        g_error_free(error);
+        if (source->element) gst_object_unref(source->element);
+        return nullptr;
+    }
+
+    source->sink = gst_bin_get_by_name(GST_BIN(source->element), "sink");
+    if (source->sink) gst_object_unref(source->sink);
+
+    GstAppSinkCallbacks callbacks = {};
+    callbacks.new_sample = &PreviewStream::on_new_sample;
+    gst_app_sink_set_callbacks(GST_APP_SINK(source->sink), &callbacks, source.get(), nullptr);
+
+    if (gst_element_set_state(source->element, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
+        spdlog::error("Preview substream: failed to start");
+        gst_element_set_state(source->element, GST_STATE_NULL);    // nothing is streaming yet
+        gst_object_unref(source->element);
+        return nullptr;
+    }
+
+    builds_++;
+    substream_url_ = setup_.preview.url;
+    spdlog::info("Preview: relaying camera substream");
+    return source;
+}
+
+// Start whichever source the settings call for, if it can run now
+void PreviewStream::ensure() {
+    if (viewers_.empty() || !setup_.preview.enabled) return;
+    if (setup_.preview.url.empty()) {
+        if (branch_) {
+            branch_->paused.store(false);
+        } else if (tap_.attached() && !tap_.source_resolution().empty()) {
+            branch_ = build_branch();
+        }
+    } else if (!substream_ && std::chrono::steady_clock::now() >= retry_at_) {
+        substream_ = build_substream();
+        if (!substream_) retry_at_ = std::chrono::steady_clock::now() + retry_interval;
+    }
+}
+
+std::shared_ptr<PreviewStream::Source> PreviewStream::release_substream() {
+    substream_url_.clear();
+    return std::move(substream_);
+}
+
+std::shared_ptr<PreviewStream::Source> PreviewStream::poll_substream() {
+    if (!substream_) return nullptr;
+    GstBus* bus = gst_element_get_bus(substream_->element);
+    bool failed = false;
+    while (GstMessage* msg = gst_bus_pop(bus)) {
+        if (GST_MESSAGE_TYPE(msg) == GST_MESSAGE_ERROR) {
+            GError* err = nullptr;
+            gst_message_parse_error(msg, &err, nullptr);
+            spdlog::warn("Preview substream: {}", err ? err->message : "unknown error");
+            if (err) g_error_free(err);
+            failed = true;
+        } else if (GST_MESSAGE_TYPE(msg) == GST_MESSAGE_EOS) {
+            failed = true;
+        }
+        gst_message_unref(msg);
+    }
+    gst_object_unref(bus);
+
+    if (!failed) return nullptr;
+    retry_at_ = std::chrono::steady_clock::now() + retry_interval;
+    return release_substream();
+}
+
+// ─── Viewers ───────────────────────────────────────────────────────────────────
+
+bool PreviewStream::subscribe(const std::string& peer_id, std::string& error) {
+    GstElement* keyframe_sink = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!setup_.preview.enabled) {
+            error = "preview is disabled (encoding.preview.enabled)";
+            return false;
+        }
+        if (setup_.preview.url.empty() && !tap_.attached()) {
+            error = "pipeline not running";
+            return false;
+        }
+        viewers_.insert(peer_id);
+        ensure();
+
+        // A running encode restarts its GOP for the newcomer
+        auto& source = setup_.preview.url.empty() ? branch_ : substream_;
+        if (source && source->sink) {
+            last_keyframe_ = std::chrono::steady_clock::now();
+            keyframe_sink = static_cast<GstElement*>(gst_object_ref(source->sink));
+        }
+    }
+
+    // Outside the lock: the encoder takes its stream lock for the request
+    if (keyframe_sink) {
+        gst_element_send_event(keyframe_sink, gst_video_event_new_upstream_force_key_unit(
+            GST_CLOCK_TIME_NONE, TRUE, 0));
+        gst_object_unref(keyframe_sink);
+    }
+    return true;
+}
+
+void PreviewStream::unsubscribe(const std::string& peer_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (viewers_.erase(peer_id) && viewers_.empty()) {
+        idle_since_ = std::chrono::steady_clock::now();
+        if (branch_) branch_->paused.store(true);
+    }
+}
+
+bool PreviewStream::request_keyframe() {
+    GstElement* sink = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto& source = branch_ ? branch_ : substream_;
+        if (!source || !source->sink) return false;
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_keyframe_ < keyframe_min_interval) return true;
+        last_keyframe_ = now;
+        sink = static_cast<GstElement*>(gst_object_ref(source->sink));
+    }
+    bool handled = gst_element_send_event(sink, gst_video_event_new_upstream_force_key_unit(
+        GST_CLOCK_TIME_NONE, TRUE, 0));
+    gst_object_unref(sink);
+    return handled;
+}
+
+void PreviewStream::tick(const std::function<bool(const std::string& peer_id)>& peer_alive) {
+    std::vector<BranchTap::Unlink> unlinks;
+    std::vector<std::shared_ptr<Source>> stop;
+    std::vector<std::string> returned;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto now = std::chrono::steady_clock::now();
+        const PreviewConfig& preview = setup_.preview;
+
+        bool watched = !viewers_.empty();
+        for (auto it = viewers_.begin(); it != viewers_.end();) {
+            if (!peer_alive(*it)) {
+                it = viewers_.erase(it);
+            } else if (!preview.enabled) {
+                // Turned off by a reload: viewers go back to the main stream
+                returned.push_back(*it);
+                it = viewers_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        if (watched && viewers_.empty()) {
+            idle_since_ = now;
+            if (branch_) branch_->paused.store(true);
+        }
+
+        if (auto failed = poll_substream()) stop.push_back(failed);
+
+        bool idle = viewers_.empty() &&
+                    now - idle_since_ >= std::chrono::milliseconds(preview.idle_ms);
+        if (branch_ && (idle || !preview.enabled || !preview.url.empty())) {
+            spdlog::info("Preview: {}", idle ? "nobody watching, encoder removed"
+                                              : "encoder removed");
+            tap_.unlink(branch_->tee_pad, branch_->element, branch_, unlinks);
+            branch_.reset();
+        }
+        if (substream_ && (idle || !preview.enabled || preview.url != substream_url_)) {
+            spdlog::info("Preview: {}", idle ? "nobody watching, substream closed"
+                                              : "substream closed");
+            stop.push_back(release_substream());
+        }
+
+        // After a pipeline rebuild or a substream failure
+        ensure();
+    }
+
+    // Outside the lock: the probe may run right here and stop a branch
+    // whose streaming thread is waiting for it, and stopping the substream
+    // waits for its streaming threads
+    BranchTap::run(unlinks);
+    for (auto& substream : stop) {
+        gst_element_set_state(substream->element, GST_STATE_NULL);
+        gst_object_unref(substream->element);
+    }
+    if (return_cb_) {
+        for (auto& peer_id : returned) return_cb_(peer_id);
+    }
+}
+
+// ─── Frames ────────────────────────────────────────────────────────────────────
+
+GstFlowReturn PreviewStream::on_new_sample(GstAppSink* sink, gpointer user_data) {
+    auto* source = static_cast<Source*>(user_data);
+    PreviewStream* self = source->owner;
+
+    GstSample* sample = gst_app_sink_pull_sample(sink);
+    if (!sample) return GST_FLOW_OK;
+
+    GstBuffer* buffer = gst_sample_get_buffer(sample);
+    GstMapInfo map;
+    if (buffer && GST_BUFFER_PTS_IS_VALID(buffer) && gst_buffer_map(buffer, &map, GST_MAP_READ)) {
+        self->frames_.fetch_add(1, std::memory_order_relaxed);
+        self->bytes_.fetch_add(map.size, std::memory_order_relaxed);
+        if (self->frame_cb_ && map.size > 0) {
+            self->frame_cb_(map.data, map.size, GST_BUFFER_PTS(buffer) / 1000, source->own_clock);
+        }
+        gst_buffer_unmap(buffer, &map);
+    }
+    gst_sample_unref(sample);
+    return GST_FLOW_OK;
+}
+
+PreviewStream::Stats PreviewStream::get_stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const PreviewConfig& preview = setup_.preview;
+    Stats stats;
+    stats.enabled = preview.enabled;
+    stats.source = preview.url.empty() ? "encode" : "substream";
+    stats.running = branch_ != nullptr || substream_ != nullptr;
+    if (preview.url.empty()) {
+        stats.output = std::to_string(preview.width) + "x" + std::to_string(preview.height) +
+                       "@" + std::to_string(preview.fps);
+    }
+    stats.viewers = viewers_.size();
+    stats.builds = builds_;
+    stats.frames = frames_.load();
+    stats.bytes = bytes_.load();
+    return stats;
+}
+
+} // namespace ss
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "branch_tap.hpp"
+#include "config.hpp"
+#include <gst/gst.h>
+#include <gst/app/gstappsink.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace ss {
+
+// Thumbnail rendition for dashboard tiles (encoding.preview), offered as
+// stream "preview": the decoded video, rate-limited, scaled down and
+// encoded on a branch of the tap. The branch exists only while the preview
+// has viewers, plus idle_ms after the last one leaves.
+//
+// With a camera substream configured (preview.url) nothing is encoded: the
+// substream is relayed from a pipeline of its own, run on the same terms.
+class PreviewStream {
+public:
+    static constexpr const char* stream_id = "preview";
+
+    // Encoded access unit. `own_clock`: from the substream pipeline, whose
+    // timestamps are not the main pipeline's.
+    using FrameCallback = std::function<void(const uint8_t* data, size_t size,
+                                             uint64_t timestamp_us, bool own_clock)>;
+
+    // A viewer was moved back to the main stream (preview turned off)
+    using ReturnCallback = std::function<void(const std::string& peer_id)>;
+
+    // How the preview is built for the current pipeline
+    struct Setup {
+        PreviewConfig preview;
+        BranchEncode encode;
+        RtspConfig rtsp;            // latency and transport for the substream
+    };
+
+    explicit PreviewStream(BranchTap& tap) : tap_(tap) {}
+    ~PreviewStream();
+
+    // Non-copyable
+    PreviewStream(const PreviewStream&) = delete;
+    PreviewStream& operator=(const PreviewStream&) = delete;
+
+    void set_frame_callback(FrameCallback cb) { frame_cb_ = std::move(cb); }
+    void set_return_callback(ReturnCallback cb) { return_cb_ = std::move(cb); }
+
+    // The branch tap was attached to a new pipeline; the preview is rebuilt
+    // on it for current viewers
+    void attach(const Setup& setup);
+
+    // The pipeline is about to be torn down (the branch goes with it)
+    void detach();
+
+    // Route `peer_id` to the preview; fails when it is off or cannot run
+    bool subscribe(const std::string& peer_id, std::string& error);
+    void unsubscribe(const std::string& peer_id);
+
+    // IDR for a joining viewer or PLI; rate limited. On the substream it
+    // becomes a PLI to the camera.
+    bool request_keyframe();
+
+    // Build or remove the branch or substream for the current viewers and
+    // drop viewers that are gone
+    void tick(const std::function<bool(const std::string& peer_id)>& peer_alive);
+
+    struct Stats {
+        bool enabled = false;
+        std::string source;         // "encode" or "substream"
+        bool running = false;
+        std::string output;         // WxH@fps, encode only
+        size_t viewers = 0;
+        uint64_t builds = 0;
+        uint64_t frames = 0;
+        uint64_t bytes = 0;
+    };
+    Stats get_stats() const;
+
+private:
+    // The branch, or the substream pipeline
+    struct Source {
+        PreviewStream* owner = nullptr;
+        bool own_clock = false;
+        GstElement* element = nullptr;  // branch bin or substream pipeline
+        GstElement* sink = nullptr;     // owned by `element`
+        GstPad* tee_pad = nullptr;      // branch: reference handed back to the tap
+        std::atomic<bool> paused{false};    // branch with no viewers: frames dropped at the tee
+    };
+
+    static GstFlowReturn on_new_sample(GstAppSink* sink, gpointer user_data);
+
+    std::shared_ptr<Source> build_branch();                 // mutex_ held
+    std::shared_ptr<Source> build_substream();              // mutex_ held
+    void ensure();                                          // mutex_ held
+    // mutex_ held; the caller stops the pipeline unlocked, and the Source
+    // its appsink callback points at lives until then
+    std::shared_ptr<Source> release_substream();
+    std::shared_ptr<Source> poll_substream();              // released on failure
+
+    BranchTap& tap_;
+    FrameCallback frame_cb_;
+    ReturnCallback return_cb_;
+
+    mutable std::mutex mutex_;
+    Setup setup_;
+    std::unordered_set<std::string> viewers_;
+    std::chrono::steady_clock::time_point idle_since_;
+    std::chrono::steady_clock::time_point retry_at_;        // after a failed substream
+    std::chrono::steady_clock::time_point last_keyframe_;
+
+    std::shared_ptr<Source> branch_;
+    std::shared_ptr<Source> substream_;
+    std::string substream_url_;                             // what substream_ plays
+    uint64_t builds_ = 0;
+
+    // Counted on the streaming threads, which must not wait for mutex_
+    std::atomic<uint64_t> frames_{0};
+    std::atomic<uint64_t> bytes_{0};
+};
+
+} // namespace ss
@@ -0,0 +1,110 @@
+#include "proc_stats.hpp"
+#include <dirent.h>
+#include <unistd.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+namespace ss {
+
+ProcStats::ProcStats(pid_t pid)
+    : proc_dir_(pid == 0 ? "/proc/self" : "/proc/" + std::to_string(pid))
+{
+}
+
+ProcStats::Sample ProcStats::sample() {
+    Sample s;
+
+    // /proc/<pid>/stat: utime and stime are fields 14 and 15. The command
+    // name (field 2) may contain spaces, so parse after the closing paren.
+    std::ifstream stat_file(proc_dir_ + "/stat");
+    std::string stat;
+    if (!std::getline(stat_file, stat)) return s;
+    auto paren = stat.rfind(')');
+    if (paren == std::string::npos) return s;
+
+    std::istringstream fields(stat.substr(paren + 2));
+    std::string field;
+    uint64_t utime = 0, stime = 0, threads = 0;
+    for (int i = 3; fields >> field; i++) {
+        if (i == 14) utime = std::stoull(field);
+        else if (i == 15) stime = std::stoull(field);
+        else if (i == 20) { threads = std::stoull(field); break; }
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    uint64_t ticks = utime + stime;
+    if (primed_) {
+        double elapsed_s = std::chrono::duration<double>(now - last_time_).count();
+        double cpu_s = static_cast<double>(ticks - last_cpu_ticks_) / sysconf(_SC_CLK_TCK);
+        if (elapsed_s > 0) s.cpu_percent = 100.0 * cpu_s / elapsed_s;
+    }
+    last_cpu_ticks_ = ticks;
+    last_time_ = now;
+    primed_ = true;
+
+    // /proc/<pid>/statm: resident pages are the second field
+    std::ifstream statm(proc_dir_ + "/statm");
+    uint64_t size_pages = 0, rss_pages = 0;
+    if (statm >> size_pages >> rss_pages) {
+        s.rss_kb = rss_pages * static_cast<uint64_t>(sysconf(_SC_PAGESIZE)) / 1024;
+    }
+
+    s.threads = threads;
+
+    if (DIR* dir = opendir((proc_dir_ + "/fd").c_str())) {
+        while (dirent* entry = readdir(dir)) {
+            if (entry->d_name[0] != '.') s.open_fds++;
+        }
+        closedir(dir);
+    }
+
+    s.valid = true;
+    return s;
+}
+
+pid_t ProcStats::find_by_name(const std::string& name) {
+    DIR* dir = opendir("/proc");
+    if (!dir) return 0;
+
+    pid_t found = 0;
+    while (dirent* entry = readdir(dir)) {
+        char* end = nullptr;
+        long pid = std::strtol(entry->d_name, &end, 10);
+        if (*end != '\0' || pid <= 0) continue;
+
+        std::ifstream comm("/proc/" + std::string(entry->d_name) + "/comm");
+        std::string comm_name;
+        // comm is truncated to 15 characters by the kernel
+        if (std::getline(comm, comm_name) && comm_name == name.substr(0, 15)) {
+            found = static_cast<pid_t>(pid);
+            break;
+        }
+    }
+    closedir(dir);
+    return found;
+}
+
+ProcStats::Heap ProcStats::heap() {
+    Heap h;
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    struct mallinfo2 info = mallinfo2();
+    h.in_use_kb = info.uordblks / 1024;
+    h.free_kb = info.fordblks / 1024;
+    h.mmap_kb = info.hblkhd / 1024;
+    h.valid = true;
+#elif defined(__GLIBC__)
+    // mallinfo() fields are int and wrap above 2 GB
+    struct mallinfo info = mallinfo();
+    h.in_use_kb = static_cast<unsigned int>(info.uordblks) / 1024;
+    h.free_kb = static_cast<unsigned int>(info.fordblks) / 1024;
+    h.mmap_kb = static_cast<unsigned int>(info.hblkhd) / 1024;
+    h.valid = true;
+#endif
+    return h;
+}
+
+} // namespace ss
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <sys/types.h>
+
+namespace ss {
+
+// CPU and memory usage of a process, read from /proc (Linux only)
+class ProcStats {
+public:
+    struct Sample {
+        bool valid = false;
+        double cpu_percent = 0.0;   // since the previous sample, 100 = one core
+        uint64_t rss_kb = 0;
+        uint64_t threads = 0;
+        uint64_t open_fds = 0;
+    };
+
+    // pid 0 = this process
+    explicit ProcStats(pid_t pid = 0);
+
+    Sample sample();
+
+    // First process whose /proc/<pid>/comm matches, 0 if none
+    static pid_t find_by_name(const std::string& name);
+
+    // Allocator state of this process (glibc only; invalid elsewhere)
+    struct Heap {
+        bool valid = false;
+        uint64_t in_use_kb = 0;     // allocated and not freed
+        uint64_t free_kb = 0;       // held by the allocator but unused
+        uint64_t mmap_kb = 0;       // large blocks mapped directly
+    };
+    static Heap heap();
+
+private:
+    std::string proc_dir_;
+    uint64_t last_cpu_ticks_ = 0;
+    std::chrono::steady_clock::time_point last_time_;
+    bool primed_ = false;
+};
+
+} // namespace ss
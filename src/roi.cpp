@@ -0,0 +1,59 @@
+#include "roi.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace ss {
+
+bool Roi::valid() const {
+    return x >= 0.0 && y >= 0.0 && width > 0.0 && height > 0.0 &&
+           x + width <= 1.0 + 1e-6 && y + height <= 1.0 + 1e-6;
+}
+
+RoiCells RoiCells::snap(const Roi& roi, int grid) {
+    RoiCells cells;
+    cells.grid = std::max(grid, 1);
+    auto lower = [&](double v) {
+        return std::clamp(static_cast<int>(std::floor(v * cells.grid + 1e-6)), 0, cells.grid - 1);
+    };
+    auto upper = [&](double v, int low) {
+        return std::clamp(static_cast<int>(std::ceil(v * cells.grid - 1e-6)), low + 1, cells.grid);
+    };
+    // Rounded outward, so the viewer always gets at least what they asked for
+    cells.x0 = lower(roi.x);
+    cells.y0 = lower(roi.y);
+    cells.x1 = upper(roi.x + roi.width, cells.x0);
+    cells.y1 = upper(roi.y + roi.height, cells.y0);
+    return cells;
+}
+
+std::string RoiCells::key() const {
+    return "roi-" + std::to_string(x0) + "-" + std::to_string(y0) + "-" +
+           std::to_string(x1) + "-" + std::to_string(y1);
+}
+
+static int even(double v) {
+    return static_cast<int>(std::lround(v / 2.0)) * 2;
+}
+
+RoiCrop RoiCrop::compute(const RoiCells& cells, Resolution source, int max_width, int max_height) {
+    RoiCrop c;
+    // Even offsets and sizes: 4:2:0 chroma cannot be cut between pixel pairs
+    int x0 = even(static_cast<double>(source.width) * cells.x0 / cells.grid);
+    int y0 = even(static_cast<double>(source.height) * cells.y0 / cells.grid);
+    int x1 = std::min(even(static_cast<double>(source.width) * cells.x1 / cells.grid), source.width);
+    int y1 = std::min(even(static_cast<double>(source.height) * cells.y1 / cells.grid), source.height);
+
+    c.left = x0;
+    c.top = y0;
+    c.right = source.width - x1;
+    c.bottom = source.height - y1;
+    c.crop = {x1 - x0, y1 - y0};
+
+    double scale = std::min({1.0,
+                             static_cast<double>(max_width) / std::max(c.crop.width, 1),
+                             static_cast<double>(max_height) / std::max(c.crop.height, 1)});
+    c.output = {std::max(even(c.crop.width * scale), 2), std::max(even(c.crop.height * scale), 2)};
+    return c;
+}
+
+} // namespace ss
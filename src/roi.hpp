@@ -0,0 +1,44 @@
+#pragma once
+
+#include "scaling_policy.hpp"
+#include <string>
+
+namespace ss {
+
+// Region of interest a viewer zoomed into, as fractions of the source
+// frame (0..1), so the browser does not need to know the camera resolution
+struct Roi {
+    double x = 0.0;
+    double y = 0.0;
+    double width = 1.0;
+    double height = 1.0;
+
+    // Inside the frame with a positive size
+    bool valid() const;
+};
+
+// A Roi snapped to a grid of `grid` × `grid` cells. Rectangles that snap to
+// the same cells share one encode; the whole frame means the main stream.
+struct RoiCells {
+    int grid = 0;
+    int x0 = 0, y0 = 0, x1 = 0, y1 = 0;   // cell bounds, x1/y1 exclusive
+
+    static RoiCells snap(const Roi& roi, int grid);
+
+    bool full() const { return x0 == 0 && y0 == 0 && x1 == grid && y1 == grid; }
+
+    // Stream name peers are routed by, e.g. "roi-4-4-12-12"
+    std::string key() const;
+};
+
+// The snapped region in source pixels and the size it is encoded at
+struct RoiCrop {
+    int left = 0, top = 0;          // pixels cropped off each edge
+    int right = 0, bottom = 0;
+    Resolution crop;                // size of the region
+    Resolution output;              // crop fitted into the output box, never upscaled
+
+    static RoiCrop compute(const RoiCells& cells, Resolution source, int max_width, int max_height);
+};
+
+} // namespace ss
@@ -0,0 +1,368 @@
+#include "roi_streams.hpp"
+#include <gst/video/video.h>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+
+namespace ss {
+
+// Branch IDRs for joining viewers and PLIs are spaced at least this far
+static constexpr auto keyframe_min_interval = std::chrono::milliseconds(500);
+
+namespace {
+
+std::string crop_label(const RoiCrop& crop) {
+    return crop.crop.str() + "+" + std::to_string(crop.left) + "+" + std::to_string(crop.top);
+}
+
+} // namespace
+
+RoiStreams::~RoiStreams() {
+    detach();
+}
+
+// ─── Pipeline lifecycle ────────────────────────────────────────────────────────
+
+void RoiStreams::attach(const Setup& setup) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    setup_ = setup;
+    // Branches for current viewers are rebuilt by tick() once the source
+    // size is known
+}
+
+void RoiStreams::detach() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // The pipeline is stopped: branch bins go with it
+    for (auto& branch : branches_) {
+        if (branch->tee_pad) gst_object_unref(branch->tee_pad);
+    }
+    branches_.clear();
+}
+
+// ─── Branches ──────────────────────────────────────────────────────────────────
+
+bool RoiStreams::build(const std::shared_ptr<Branch>& branch) {
+    const RoiCrop& c = branch->crop;
+    std::string size = ",width=" + std::to_string(c.output.width) +
+                       ",height=" + std::to_string(c.output.height);
+    // nvvidconv takes the kept rectangle's edges, videocrop what to cut off
+    std::string crop = setup_.encode.nvmm
+        ? "nvvidconv name=crop left=" + std::to_string(c.left) +
+          " right=" + std::to_string(c.left + c.crop.width) +
+          " top=" + std::to_string(c.top) +
+          " bottom=" + std::to_string(c.top + c.crop.height) + " ! "
+          "capsfilter name=roicaps caps=\"video/x-raw(memory:NVMM)" + size + "\" ! "
+        : "videocrop name=crop left=" + std::to_string(c.left) +
+          " right=" + std::to_string(c.right) +
+          " top=" + std::to_string(c.top) +
+          " bottom=" + std::to_string(c.bottom) + " ! "
+          "videoscale ! capsfilter name=roicaps caps=\"video/x-raw" + size + "\" ! ";
+
+    VideoConfig video = setup_.encode.video;
+    video.bitrate_kbps = setup_.roi.bitrate_kbps;
+    video.max_bitrate_kbps = std::max(video.max_bitrate_kbps, setup_.roi.bitrate_kbps);
+
+    std::string desc =
+        "queue leaky=downstream max-size-buffers=2 max-size-bytes=0 max-size-time=0 ! " + crop +
+        setup_.encode.encoder.launch(setup_.encode.encoding, video, setup_.encode.nvmm) +
+        "video/x-h264,stream-format=byte-stream,alignment=au ! "
+        "h264parse config-interval=1 ! "
+        "appsink name=roisink emit-signals=true sync=false max-buffers=5 drop=true";
+
+    GError* error = nullptr;
+    branch->bin = gst_parse_bin_from_description(desc.c_str(), TRUE, &error);
+    if (error) {
+        spdlog::error("ROI branch {}: {}", branch->stream, error->message);
+        g_error_free(error);
+        branch->bin = nullptr;
+        return false;
+    }
+
+    // Owned by the bin
+    branch->crop_element = gst_bin_get_by_name(GST_BIN(branch->bin), "crop");
+    branch->caps = gst_bin_get_by_name(GST_BIN(branch->bin), "roicaps");
+    branch->sink = gst_bin_get_by_name(GST_BIN(branch->bin), "roisink");
+    if (branch->crop_element) gst_object_unref(branch->crop_element);
+    if (branch->caps) gst_object_unref(branch->caps);
+    if (branch->sink) gst_object_unref(branch->sink);
+
+    GstAppSinkCallbacks callbacks = {};
+    callbacks.new_sample = &RoiStreams::on_new_sample;
+    gst_app_sink_set_callbacks(GST_APP_SINK(branch->sink), &callbacks, branch.get(), nullptr);
+
+    if (!tap_.link(branch->bin, &branch->paused, branch->tee_pad)) {
+        gst_object_unref(gst_object_ref_sink(branch->bin));
+        branch->bin = nullptr;
+        return false;
+    }
+
+    counters_.branches_created++;
+    spdlog::info("ROI: {} crop {} → {} at {} kbps ({} of {} encodes)", branch->stream,
+                 crop_label(c), c.output.str(), setup_.roi.bitrate_kbps,
+                 branches_.size() + 1, setup_.roi.max_encodes);
+    return true;
+}
+
+void RoiStreams::retarget(Branch& branch) {
+    const RoiCrop& c = branch.crop;
+    if (setup_.encode.nvmm) {
+        g_object_set(G_OBJECT(branch.crop_element),
+                     "left", c.left, "right", c.left + c.crop.width,
+                     "top", c.top, "bottom", c.top + c.crop.height, nullptr);
+    } else {
+        g_object_set(G_OBJECT(branch.crop_element),
+                     "left", c.left, "right", c.right,
+                     "top", c.top, "bottom", c.bottom, nullptr);
+    }
+    // A new size renegotiates the encoder, which restarts with new SPS/PPS
+    std::string caps_str = std::string(setup_.encode.nvmm ? "video/x-raw(memory:NVMM)" : "video/x-raw") +
+                           ",width=" + std::to_string(c.output.width) +
+                           ",height=" + std::to_string(c.output.height);
+    GstCaps* caps = gst_caps_from_string(caps_str.c_str());
+    g_object_set(G_OBJECT(branch.caps), "caps", caps, nullptr);
+    gst_caps_unref(caps);
+
+    counters_.branches_retargeted++;
+    spdlog::info("ROI: idle branch retargeted to {} crop {} → {}", branch.stream,
+                 crop_label(c), c.output.str());
+}
+
+std::shared_ptr<RoiStreams::Branch> RoiStreams::find(const std::string& stream) const {
+    for (auto& branch : branches_) {
+        if (branch->stream == stream) return branch;
+    }
+    return nullptr;
+}
+
+void RoiStreams::release(const std::string& peer_id) {
+    auto it = viewers_.find(peer_id);
+    if (it == viewers_.end()) return;
+    auto branch = find(it->second.key());
+    if (branch && branch->viewers > 0 && --branch->viewers == 0) {
+        branch->idle_since = std::chrono::steady_clock::now();
+        branch->paused.store(true);
+    }
+    viewers_.erase(it);
+}
+
+// ─── Viewers ───────────────────────────────────────────────────────────────────
+
+bool RoiStreams::subscribe(const std::string& peer_id, const Roi& roi,
+                           std::string& stream, std::string& error) {
+    GstElement* keyframe_sink = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!roi.valid()) {
+            error = "ROI must lie inside the frame (fractions 0..1)";
+            return false;
+        }
+        RoiCells cells = RoiCells::snap(roi, setup_.roi.grid);
+        if (!setup_.roi.enabled && !cells.full()) {
+            error = "ROI streams are disabled (encoding.roi.enabled)";
+            return false;
+        }
+
+        auto previous = viewers_.find(peer_id);
+        if (previous != viewers_.end() && previous->second.key() == cells.key()) {
+            stream = cells.key();
+            return true;
+        }
+        std::optional<RoiCells> old;
+        if (previous != viewers_.end()) old = previous->second;
+        release(peer_id);
+
+        if (cells.full()) {
+            stream.clear();
+            return true;
+        }
+
+        Resolution source = tap_.source_resolution();
+        std::shared_ptr<Branch> branch;
+        if (!tap_.attached()) {
+            error = "pipeline not running";
+        } else if (source.empty()) {
+            error = "source size not known yet";
+        } else if ((branch = find(cells.key()))) {
+            keyframe_sink = branch->sink;
+        } else {
+            RoiCrop crop = RoiCrop::compute(cells, source, setup_.roi.max_width, setup_.roi.max_height);
+            auto idle = std::find_if(branches_.begin(), branches_.end(),
+                                     [](const std::shared_ptr<Branch>& b) { return b->viewers == 0; });
+            if (idle != branches_.end()) {
+                branch = *idle;
+                branch->stream = cells.key();
+                branch->cells = cells;
+                branch->crop = crop;
+                retarget(*branch);
+                keyframe_sink = branch->sink;
+            } else if (static_cast<int>(branches_.size()) < setup_.roi.max_encodes) {
+                branch = std::make_shared<Branch>();
+                branch->owner = this;
+                branch->stream = cells.key();
+                branch->cells = cells;
+                branch->crop = crop;
+                if (build(branch)) {
+                    branches_.push_back(branch);
+                } else {
+                    branch.reset();
+                    error = "could not build the ROI encoder";
+                }
+            } else {
+                counters_.rejected++;
+                error = "all " + std::to_string(setup_.roi.max_encodes) + " ROI encodes are busy";
+            }
+        }
+
+        if (!branch) {
+            // Keep the viewer where it was
+            if (old) {
+                viewers_[peer_id] = *old;
+                if (auto b = find(old->key())) {
+                    b->viewers++;
+                    b->paused.store(false);
+                }
+            }
+            return false;
+        }
+
+        branch->viewers++;
+        branch->paused.store(false);
+        viewers_[peer_id] = cells;
+        stream = cells.key();
+        if (keyframe_sink) {
+            branch->last_keyframe = std::chrono::steady_clock::now();
+            gst_object_ref(keyframe_sink);
+        }
+    }
+
+    // Outside the lock: the encoder takes its stream lock for the request
+    if (keyframe_sink) {
+        gst_element_send_event(keyframe_sink, gst_video_event_new_upstream_force_key_unit(
+            GST_CLOCK_TIME_NONE, TRUE, 0));
+        gst_object_unref(keyframe_sink);
+    }
+    return true;
+}
+
+void RoiStreams::unsubscribe(const std::string& peer_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    release(peer_id);
+}
+
+bool RoiStreams::request_keyframe(const std::string& stream) {
+    GstElement* sink = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto branch = find(stream);
+        if (!branch || !branch->sink) return false;
+        auto now = std::chrono::steady_clock::now();
+        if (now - branch->last_keyframe < keyframe_min_interval) return true;
+        branch->last_keyframe = now;
+        sink = static_cast<GstElement*>(gst_object_ref(branch->sink));
+    }
+    bool handled = gst_element_send_event(sink, gst_video_event_new_upstream_force_key_unit(
+        GST_CLOCK_TIME_NONE, TRUE, 0));
+    gst_object_unref(sink);
+    return handled;
+}
+
+void RoiStreams::tick(const std::function<bool(const std::string& peer_id)>& peer_alive) {
+    std::vector<BranchTap::Unlink> unlinks;
+    std::vector<std::string> returned;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        for (auto it = viewers_.begin(); it != viewers_.end();) {
+            auto next = std::next(it);
+            if (!peer_alive(it->first)) {
+                release(it->first);
+            } else if (!setup_.roi.enabled) {
+                // Turned off by a reload: viewers go back to the main stream
+                returned.push_back(it->first);
+                release(it->first);
+            }
+            it = next;
+        }
+
+        // After a pipeline rebuild: bring back the branches viewers are on
+        Resolution source = tap_.source_resolution();
+        for (auto& [peer_id, cells] : viewers_) {
+            if (source.empty()) break;
+            if (find(cells.key())) continue;
+            if (static_cast<int>(branches_.size()) >= setup_.roi.max_encodes) break;
+
+            auto branch = std::make_shared<Branch>();
+            branch->owner = this;
+            branch->stream = cells.key();
+            branch->cells = cells;
+            branch->crop = RoiCrop::compute(cells, source, setup_.roi.max_width, setup_.roi.max_height);
+            if (!build(branch)) break;
+            branch->viewers = static_cast<size_t>(std::count_if(viewers_.begin(), viewers_.end(),
+                [&](const auto& v) { return v.second.key() == branch->stream; }));
+            branches_.push_back(branch);
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        auto idle_limit = std::chrono::milliseconds(setup_.roi.idle_ms);
+        for (auto it = branches_.begin(); it != branches_.end();) {
+            auto& branch = *it;
+            if (branch->viewers == 0 && now - branch->idle_since >= idle_limit) {
+                spdlog::info("ROI: {} idle for {} ms, removing its encoder", branch->stream,
+                             setup_.roi.idle_ms);
+                tap_.unlink(branch->tee_pad, branch->bin, branch, unlinks);
+                counters_.branches_removed++;
+                it = branches_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    // Outside the lock: the probe may run right here and stop a branch
+    // whose streaming thread is waiting for the lock in on_new_sample
+    BranchTap::run(unlinks);
+    if (return_cb_) {
+        for (auto& peer_id : returned) return_cb_(peer_id);
+    }
+}
+
+// ─── Frames ────────────────────────────────────────────────────────────────────
+
+GstFlowReturn RoiStreams::on_new_sample(GstAppSink* sink, gpointer user_data) {
+    auto* branch = static_cast<Branch*>(user_data);
+    RoiStreams* self = branch->owner;
+
+    GstSample* sample = gst_app_sink_pull_sample(sink);
+    if (!sample) return GST_FLOW_OK;
+
+    GstBuffer* buffer = gst_sample_get_buffer(sample);
+    GstMapInfo map;
+    if (buffer && GST_BUFFER_PTS_IS_VALID(buffer) && gst_buffer_map(buffer, &map, GST_MAP_READ)) {
+        std::string stream;
+        {
+            std::lock_guard<std::mutex> lock(self->mutex_);
+            stream = branch->stream;
+            branch->frames++;
+            branch->bytes += map.size;
+        }
+        if (self->frame_cb_ && map.size > 0) {
+            self->frame_cb_(stream, map.data, map.size, GST_BUFFER_PTS(buffer) / 1000);
+        }
+        gst_buffer_unmap(buffer, &map);
+    }
+    gst_sample_unref(sample);
+    return GST_FLOW_OK;
+}
+
+RoiStreams::Stats RoiStreams::get_stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats = counters_;
+    stats.enabled = setup_.roi.enabled;
+    stats.max_encodes = setup_.roi.max_encodes;
+    for (auto& branch : branches_) {
+        stats.streams.push_back({branch->stream, crop_label(branch->crop), branch->crop.output.str(),
+                                 branch->viewers, branch->frames, branch->bytes});
+    }
+    return stats;
+}
+
+} // namespace ss
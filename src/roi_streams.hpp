@@ -0,0 +1,131 @@
+#pragma once
+
+#include "branch_tap.hpp"
+#include "config.hpp"
+#include "roi.hpp"
+#include <gst/gst.h>
+#include <gst/app/gstappsink.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ss {
+
+// Crop → scale → encode branches for viewers that zoomed into part of the
+// frame (encoding.roi), so they get the region at a viewer-sized
+// resolution instead of the full-resolution stream.
+//
+// Branches hang off the pipeline's branch tap. Peers asking for the same
+// (grid-snapped) region share one branch. At most max_encodes exist; a
+// branch nobody watches stays idle for idle_ms, ready to be retargeted to
+// the next region without building a new encoder, then it is removed.
+class RoiStreams {
+public:
+    // Encoded ROI access unit, on the pipeline's timestamps
+    using FrameCallback = std::function<void(const std::string& stream, const uint8_t* data,
+                                             size_t size, uint64_t timestamp_us)>;
+
+    // How branches are built for the current pipeline
+    struct Setup {
+        RoiConfig roi;
+        BranchEncode encode;
+    };
+
+    explicit RoiStreams(BranchTap& tap) : tap_(tap) {}
+    ~RoiStreams();
+
+    // Non-copyable
+    RoiStreams(const RoiStreams&) = delete;
+    RoiStreams& operator=(const RoiStreams&) = delete;
+
+    void set_frame_callback(FrameCallback cb) { frame_cb_ = std::move(cb); }
+
+    // A viewer was moved back to the main stream (ROI turned off by a reload)
+    using ReturnCallback = std::function<void(const std::string& peer_id)>;
+    void set_return_callback(ReturnCallback cb) { return_cb_ = std::move(cb); }
+
+    // The branch tap was attached to a new pipeline; branches for the
+    // current viewers are rebuilt on it
+    void attach(const Setup& setup);
+
+    // The pipeline is about to be torn down (its branches go with it)
+    void detach();
+
+    // Route `peer_id` to `roi`. On success `stream` names the branch the
+    // peer should receive ("" = whole frame, back to the main stream).
+    // Fails when ROI is off, the source size is not known yet or every
+    // branch is busy with another region.
+    bool subscribe(const std::string& peer_id, const Roi& roi,
+                   std::string& stream, std::string& error);
+    void unsubscribe(const std::string& peer_id);
+
+    // IDR on one branch (new viewer, PLI); rate limited per branch
+    bool request_keyframe(const std::string& stream);
+
+    // Drop viewers that are gone and remove branches idle past idle_ms
+    void tick(const std::function<bool(const std::string& peer_id)>& peer_alive);
+
+    struct StreamStats {
+        std::string stream;
+        std::string crop;           // source pixels, WxH+X+Y
+        std::string output;         // encoded WxH
+        size_t viewers = 0;
+        uint64_t frames = 0;
+        uint64_t bytes = 0;
+    };
+    struct Stats {
+        bool enabled = false;
+        int max_encodes = 0;
+        uint64_t branches_created = 0;
+        uint64_t branches_retargeted = 0;
+        uint64_t branches_removed = 0;
+        uint64_t rejected = 0;      // requests refused with every branch busy
+        std::vector<StreamStats> streams;
+    };
+    Stats get_stats() const;
+
+private:
+    struct Branch {
+        RoiStreams* owner = nullptr;
+        std::string stream;         // RoiCells key, guarded by mutex_
+        RoiCells cells;
+        RoiCrop crop;
+        GstElement* bin = nullptr;
+        GstElement* crop_element = nullptr;
+        GstElement* caps = nullptr;
+        GstElement* sink = nullptr;
+        GstPad* tee_pad = nullptr;      // reference handed back to the tap on removal
+        size_t viewers = 0;
+        std::atomic<bool> paused{false};    // no viewers: frames dropped at the tee
+        std::chrono::steady_clock::time_point idle_since;
+        std::chrono::steady_clock::time_point last_keyframe;
+        uint64_t frames = 0;
+        uint64_t bytes = 0;
+    };
+
+    static GstFlowReturn on_new_sample(GstAppSink* sink, gpointer user_data);
+
+    bool build(const std::shared_ptr<Branch>& branch);   // mutex_ held
+    void retarget(Branch& branch);                        // mutex_ held
+    void release(const std::string& peer_id);             // mutex_ held
+    std::shared_ptr<Branch> find(const std::string& stream) const;  // mutex_ held
+
+    BranchTap& tap_;
+    FrameCallback frame_cb_;
+    ReturnCallback return_cb_;
+
+    mutable std::mutex mutex_;
+    Setup setup_;
+    std::vector<std::shared_ptr<Branch>> branches_;
+    std::unordered_map<std::string, RoiCells> viewers_;  // peer id → region
+    Stats counters_;
+};
+
+} // namespace ss
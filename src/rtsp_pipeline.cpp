@@ -1,91 +1,499 @@
 #include "rtsp_pipeline.hpp"
+#include <gst/rtp/gstrtpbuffer.h>
+#include <gst/video/video.h>
 #include <spdlog/spdlog.h>
+#include <algorithm>
 #include <chrono>
 #include <cstring>
+#include <ctime>
 
 namespace ss {
 
-RtspPipeline::RtspPipeline(const AppConfig& config) : config_(config) {
-    gst_init(nullptr, nullptr);
+RtspPipeline::RtspPipeline(const AppConfig& config)
+    : config_(config)
+    , complexity_(config.encoding.content_adaptive)
+    , timestamps_(config.rtsp)
+    , capture_clock_(config.rtsp)
+{
 }
 
 RtspPipeline::~RtspPipeline() {
     stop();
 }
 
-void RtspPipeline::set_nal_callback(NalUnitCallback cb) {
+void RtspPipeline::set_nal_callback(VideoFrameCallback cb) {
     nal_callback_ = std::move(cb);
 }
 
+void RtspPipeline::set_format_callback(FormatCallback cb) {
+    format_callback_ = std::move(cb);
+}
+
+void RtspPipeline::set_complexity_callback(ComplexityCallback cb) {
+    complexity_callback_ = std::move(cb);
+}
+
+void RtspPipeline::set_audio_callback(NalUnitCallback cb) {
+    audio_callback_ = std::move(cb);
+}
+
+void RtspPipeline::set_audio_enabled(bool enabled) {
+    if (audio_enabled_.exchange(enabled) == enabled) return;
+
+    {
+        // A pipeline built meanwhile reads audio_enabled_ for its valve
+        std::lock_guard<std::mutex> lock(elements_mutex_);
+        if (audio_valve_) {
+            g_object_set(G_OBJECT(audio_valve_), "drop", enabled ? FALSE : TRUE, nullptr);
+        }
+    }
+    spdlog::info("Audio {}", enabled ? "enabled (peer accepted audio)" : "paused (no audio peers)");
+}
+
 bool RtspPipeline::start() {
-    if (running_.load()) {
+    std::lock_guard<std::mutex> lock(lifecycle_mutex_);
+    return start_locked();
+}
+
+void RtspPipeline::stop() {
+    std::lock_guard<std::mutex> lock(lifecycle_mutex_);
+    stop_locked();
+}
+
+bool RtspPipeline::restart() {
+    std::lock_guard<std::mutex> lock(lifecycle_mutex_);
+    stop_locked();
+    return start_locked();
+}
+
+bool RtspPipeline::restart(const AppConfig& config) {
+    std::lock_guard<std::mutex> lock(lifecycle_mutex_);
+    stop_locked();
+    update_config(config);
+    return start_locked();
+}
+
+bool RtspPipeline::start_locked() {
+    // The thread keeps reconnecting on its own until stopped
+    if (thread_.joinable()) {
         spdlog::warn("Pipeline already running");
         return true;
     }
 
     stop_requested_.store(false);
+    thread_alive_.store(true);
     thread_ = std::thread(&RtspPipeline::pipeline_thread, this);
     return true;
 }
 
-void RtspPipeline::stop() {
+void RtspPipeline::stop_locked() {
+    // The pipeline thread notices within one bus poll and tears down itself
     stop_requested_.store(true);
     running_.store(false);
 
-    if (pipeline_) {
-        gst_element_set_state(pipeline_, GST_STATE_NULL);
-    }
-
     if (thread_.joinable()) {
         thread_.join();
     }
-
-    if (pipeline_) {
-        gst_object_unref(pipeline_);
-        pipeline_ = nullptr;
-        appsink_ = nullptr;
-        encoder_ = nullptr;
-    }
 }
 
 void RtspPipeline::set_bitrate(int bitrate_kbps) {
-    if (!encoder_ || !running_.load()) return;
+    if (!running_.load()) return;
 
     // Clamp to configured limits
-    int clamped = std::max(config_.webrtc.video.min_bitrate_kbps,
+    int clamped;
+    VideoEncoder encoder;
+    FrameBudget budget;
+    {
+        std::lock_guard<std::mutex> lock(config_mutex_);
+        clamped = std::max(config_.webrtc.video.min_bitrate_kbps,
                            std::min(bitrate_kbps, config_.webrtc.video.max_bitrate_kbps));
+        encoder = video_encoder_;
+        budget = frame_budget(config_.encoding.latency_budget_ms, clamped, config_.webrtc.video.fps);
+    }
+    {
+        std::lock_guard<std::mutex> lock(elements_mutex_);
+        if (!encoder_) return;
+        encoder.set_bitrate(encoder_, clamped, budget);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        stats_.encoder_bitrate_kbps = clamped;
+        stats_.frame_budget_bytes = budget.max_frame_bytes;
+    }
 
-    if (is_hw_encode_) {
-        // nvv4l2h264enc uses bits per second
-        guint bps = static_cast<guint>(clamped * 1000);
-        guint peak = static_cast<guint>(clamped * 1200); // peak = 120% of target
-        g_object_set(G_OBJECT(encoder_),
-                     "bitrate", bps,
-                     "peak-bitrate", peak,
-                     nullptr);
+    if (budget.vbv_ms) {
+        spdlog::info("Encoder bitrate: {} kbps (VBV {} kbit, frame cap {} bytes monitored)",
+                     clamped, budget.vbv_kbits, budget.max_frame_bytes);
     } else {
-        // x264enc uses kbps
-        g_object_set(G_OBJECT(encoder_),
-                     "bitrate", static_cast<guint>(clamped),
-                     "vbv-buf-capacity", static_cast<guint>(clamped),
-                     nullptr);
+        spdlog::info("Encoder bitrate: {} kbps", clamped);
+    }
+    rescale(clamped);
+}
+
+static double process_cpu_s() {
+    timespec ts{};
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) / 1e9;
+}
+
+std::string RtspPipeline::scaler_branch(bool nvmm) {
+    if (!config_.encoding.scaling.enabled) {
+        std::lock_guard<std::mutex> lock(scaling_mutex_);
+        scale_current_ = {};
+        return "";
+    }
+
+    for (auto& entry : config_.encoding.scaling.ladder) {
+        Resolution r;
+        if (!ScalingPolicy::parse(entry, r)) {
+            spdlog::warn("encoding.scaling: ignoring ladder entry '{}' (expected even WxH)", entry);
+        }
+    }
+
+    // A reconnect keeps the resolution the bitrate last called for
+    std::lock_guard<std::mutex> lock(scaling_mutex_);
+    scale_nvmm_ = nvmm;
+    return std::string(nvmm ? "nvvidconv name=scale" : "videoscale name=scale") +
+           " ! capsfilter name=scalecaps caps=\"" + scale_caps(scale_current_) + "\" ! ";
+}
+
+std::string RtspPipeline::scale_caps(Resolution resolution) const {
+    std::string caps = scale_nvmm_ ? "video/x-raw(memory:NVMM)" : "video/x-raw";
+    if (!resolution.empty()) {
+        caps += ",width=" + std::to_string(resolution.width) +
+                ",height=" + std::to_string(resolution.height);
+    }
+    return caps;
+}
+
+Resolution RtspPipeline::source_resolution() const {
+    Resolution source;
+    GstPad* pad = gst_element_get_static_pad(scaler_, "sink");
+    if (!pad) return source;
+    GstCaps* caps = gst_pad_get_current_caps(pad);
+    if (caps) {
+        GstStructure* s = gst_caps_get_structure(caps, 0);
+        gst_structure_get_int(s, "width", &source.width);
+        gst_structure_get_int(s, "height", &source.height);
+        gst_caps_unref(caps);
+    }
+    gst_object_unref(pad);
+    return source;
+}
+
+void RtspPipeline::rescale(int bitrate_kbps) {
+    if (!running_.load()) return;
+
+    ScalingConfig scaling;
+    int fps;
+    {
+        std::lock_guard<std::mutex> lock(config_mutex_);
+        scaling = config_.encoding.scaling;
+        fps = config_.webrtc.video.fps;
+    }
+
+    std::lock_guard<std::mutex> scaling_lock(scaling_mutex_);
+    Resolution source, target, next;
+    {
+        // The scaler elements go away with the pipeline on a reconnect
+        std::lock_guard<std::mutex> lock(elements_mutex_);
+        if (!scale_caps_) return;
+        source = source_resolution();
+        if (source.empty()) return; // decoder has not negotiated yet
+        target = ScalingPolicy(scaling).choose(bitrate_kbps, fps, source, scale_current_);
+        next = target == source ? Resolution{} : target;
+        if (next == scale_current_) return;
+
+        // The capsfilter change renegotiates the encoder, which restarts its
+        // stream with new SPS/PPS; the keyframe request makes sure the first
+        // frame at the new size is an IDR on every encoder
+        GstCaps* caps = gst_caps_from_string(scale_caps(next).c_str());
+        g_object_set(G_OBJECT(scale_caps_), "caps", caps, nullptr);
+        gst_caps_unref(caps);
+    }
+
+    spdlog::info("Encode resolution: {} → {} at {} kbps ({:.3f} bits/pixel)",
+                 scale_current_.empty() ? source.str() : scale_current_.str(), target.str(),
+                 bitrate_kbps, ScalingPolicy::bits_per_pixel(bitrate_kbps, fps, target));
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        account_scale_time(stats_);
+        stats_.encode_resolution = next.empty() ? "" : next.str();
+    }
+    scale_current_ = next;
+    request_keyframe();
+}
+
+// Fold the time since the last switch into the current resolution's entry
+// (stats_mutex_ held; the label comes from stats_.encode_resolution)
+void RtspPipeline::account_scale_time(Stats& stats) const {
+    if (!scale_accounting_) return;
+    auto now = std::chrono::steady_clock::now();
+    double cpu = process_cpu_s();
+    std::string label = stats.encode_resolution.empty() ? "source" : stats.encode_resolution;
+
+    auto it = std::find_if(stats.scale_times.begin(), stats.scale_times.end(),
+                           [&](const Stats::ScaleTime& t) { return t.resolution == label; });
+    if (it == stats.scale_times.end()) {
+        stats.scale_times.push_back({label, 0.0, 0.0});
+        it = stats.scale_times.end() - 1;
+    }
+    it->seconds += std::chrono::duration<double>(now - scale_since_).count();
+    it->cpu_seconds += cpu - scale_cpu_since_;
+}
+
+bool RtspPipeline::request_keyframe() {
+    if (!running_.load()) return false;
+
+    // Sent from the sink so it reaches whichever element can produce an IDR.
+    // Peers and PLIs call in on their own threads: the lock keeps the sink
+    // from being torn down under the event.
+    bool handled;
+    {
+        std::lock_guard<std::mutex> lock(elements_mutex_);
+        if (!appsink_) return false;
+        GstEvent* event = gst_video_event_new_upstream_force_key_unit(
+            GST_CLOCK_TIME_NONE, TRUE, 0);
+        handled = gst_element_send_event(appsink_, event);
+    }
+    if (!handled) {
+        spdlog::warn("Keyframe request was not handled upstream");
+        return false;
     }
 
-    spdlog::info("Encoder bitrate: {} kbps", clamped);
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    stats_.keyframe_requests++;
+    return true;
+}
+
+void RtspPipeline::update_config(const AppConfig& config) {
+    {
+        std::lock_guard<std::mutex> lock(config_mutex_);
+        config_ = config;
+    }
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    complexity_.update_config(config.encoding.content_adaptive);
+    timestamps_.update_config(config.rtsp);
+    capture_clock_.update_config(config.rtsp);
 }
 
 RtspPipeline::Stats RtspPipeline::get_stats() const {
     std::lock_guard<std::mutex> lock(stats_mutex_);
-    return stats_;
+    Stats stats = stats_;
+    account_scale_time(stats); // include the time at the current resolution
+    stats.timestamps = timestamps_.stats();
+    stats.capture = capture_clock_.stats();
+    return stats;
+}
+
+std::string RtspPipeline::audio_branch(bool test_source) const {
+    // The valve sits in front of the decoder/encoder so nothing downstream
+    // runs while no peer wants audio
+    std::string valve = std::string("valve name=avalve drop=") +
+                        (audio_enabled_.load() ? "false" : "true") + " ! ";
+    std::string opus_encode =
+        "audioconvert ! audioresample ! audio/x-raw,rate=48000,channels=2 ! "
+        "opusenc bitrate=" + std::to_string(config_.audio.bitrate_kbps * 1000) + " "
+        "frame-size=20 audio-type=voice ! ";
+    std::string sink =
+        "appsink name=asink emit-signals=true sync=false max-buffers=20 drop=true";
+
+    if (test_source) {
+        return "audiotestsrc is-live=true wave=ticks ! " + valve + opus_encode + sink;
+    }
+
+    if (config_.audio.source_codec == "opus") {
+        return "src. ! queue ! rtpopusdepay ! " + valve + sink;
+    }
+    if (config_.audio.source_codec == "aac-latm") {
+        return "src. ! queue ! rtpmp4adepay ! aacparse ! " + valve +
+               "avdec_aac ! " + opus_encode + sink;
+    }
+    return "src. ! queue ! rtpmp4gdepay ! aacparse ! " + valve +
+           "avdec_aac ! " + opus_encode + sink;
+}
+
+std::string RtspPipeline::replay_codec() const {
+    std::string codec = config_.replay.codec;
+    if (codec != "auto") return codec;
+
+    auto dot = config_.replay.file.rfind('.');
+    std::string ext = dot == std::string::npos ? "" : config_.replay.file.substr(dot + 1);
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    return (ext == "h265" || ext == "hevc" || ext == "265") ? "h265" : "h264";
+}
+
+std::string RtspPipeline::replay_source() const {
+    const auto& replay = config_.replay;
+    std::string codec = replay_codec();
+
+    auto dot = replay.file.rfind('.');
+    std::string ext = dot == std::string::npos ? "" : replay.file.substr(dot + 1);
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+
+    std::string src = "filesrc location=\"" + replay.file + "\" ! ";
+
+    if (ext == "mp4" || ext == "mov" || ext == "m4v") {
+        return src + "qtdemux ! ";
+    }
+    if (ext == "mkv") {
+        return src + "matroskademux ! ";
+    }
+    if (ext == "pcap") {
+        // Camera RTP captured with tcpdump; capture times become the timestamps
+        std::string encoding = codec == "h265" ? "H265" : "H264";
+        std::string filter = replay.pcap_port > 0
+            ? "dst-port=" + std::to_string(replay.pcap_port) + " " : "";
+        return src + "pcapparse " + filter + "! "
+               "application/x-rtp,media=video,clock-rate=90000,"
+               "encoding-name=" + encoding + ","
+               "payload=" + std::to_string(replay.pcap_payload_type) + " ! "
+               "rtp" + codec + "depay ! ";
+    }
+
+    // Raw elementary stream: no timestamps, the parser derives them from
+    // the frame rate
+    return src + "video/x-" + codec + ",stream-format=byte-stream,"
+           "framerate=" + std::to_string(config_.webrtc.video.fps) + "/1 ! ";
+}
+
+const VideoEncoder& RtspPipeline::video_encoder() {
+    // Warnings and stats only when the (cached) selection actually changed
+    const auto& encoding = config_.encoding;
+    std::string previous = encoder_selection_;
+    if (!select_video_encoder_cached(config_, video_encoder_, encoder_selection_)) {
+        throw std::runtime_error("No usable H.264 encoder");
+    }
+    if (encoder_selection_ == previous) return video_encoder_;
+
+    if (encoding.latency_budget_ms > 0 && !video_encoder_.supports_vbv()) {
+        spdlog::warn("{} has no VBV size, latency_budget_ms is only monitored",
+                     video_encoder_.element());
+    }
+    if (encoding.intra_refresh && !video_encoder_.supports_intra_refresh()) {
+        spdlog::warn("{} has no intra refresh, keeping IDRs every {} frames",
+                     video_encoder_.element(), encoding.idr_interval);
+    }
+
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    stats_.encoder = video_encoder_.element();
+    stats_.encoder_hardware = video_encoder_.hardware();
+    return video_encoder_;
+}
+
+std::string RtspPipeline::reencode_branch(const std::string& codec) {
+    const VideoEncoder& encoder = video_encoder();
+#ifdef JETSON_PLATFORM
+    (void)codec; // nvv4l2decoder handles H.264 and H.265
+    // Jetson: always HW decode; NVMM frames go straight to nvv4l2h264enc
+    return "nvv4l2decoder enable-max-performance=1 ! " + branch_tee() + scaler_branch(true) +
+           encoder.launch(config_.encoding, config_.webrtc.video, true);
+#else
+    return "avdec_" + codec + " ! " + branch_tee() + scaler_branch(false) +
+           encoder.launch(config_.encoding, config_.webrtc.video, false);
+#endif
+}
+
+// Where ROI, per-peer and preview encoders tap the video, only when one of
+// them is on
+std::string RtspPipeline::branch_tee() const {
+    const auto& preview = config_.encoding.preview;
+    bool used = config_.encoding.roi.enabled || config_.encoding.per_peer.enabled ||
+                (preview.enabled && preview.url.empty());
+    return used ? "tee name=branchtee allow-not-linked=true ! queue ! " : "";
+}
+
+// How ROI, per-peer and preview encoders are built on this pipeline
+// (config_mutex_ held)
+void RtspPipeline::branch_setup(bool test_source, bool passthrough, RoiStreams::Setup& roi,
+                                PeerEncoders::Setup& peers, PreviewStream::Setup& preview,
+                                std::string& decoder) {
+    roi.roi = config_.encoding.roi;
+    peers.per_peer = config_.encoding.per_peer;
+    preview.preview = config_.encoding.preview;
+    preview.rtsp = config_.rtsp;
+    decoder.clear();
+    // A camera substream preview needs no encoder
+    bool preview_encode = preview.preview.enabled && preview.preview.url.empty();
+    if (!roi.roi.enabled && !peers.per_peer.enabled && !preview_encode) return;
+
+    BranchEncode encode;
+    encode.encoding = config_.encoding;
+    encode.video = config_.webrtc.video;
+    try {
+        encode.encoder = video_encoder();
+    } catch (const std::exception& e) {
+        // Passthrough viewers do not need an encoder, only the branches do
+        spdlog::warn("ROI, per-peer and preview encoders disabled: {}", e.what());
+        roi.roi.enabled = false;
+        peers.per_peer.enabled = false;
+        if (preview_encode) preview.preview.enabled = false;
+        return;
+    }
+#ifdef JETSON_PLATFORM
+    encode.nvmm = !test_source;
+    if (passthrough) decoder = "nvv4l2decoder enable-max-performance=1";
+#else
+    (void)test_source;
+    if (passthrough) decoder = "avdec_h264";
+#endif
+    roi.encode = encode;
+    peers.encode = encode;
+    preview.encode = encode;
+}
+
+// The pipeline is stopped or failed to start: branches go with it
+void RtspPipeline::detach_branches() {
+    branch_tap_.detach();
+    roi_.detach();
+    peer_encoders_.detach();
+    preview_.detach();
+}
+
+void RtspPipeline::teardown_pipeline() {
+    // Unpublish first: once the lock is released no other thread can reach
+    // an element of this pipeline
+    GstElement* pipeline;
+    {
+        std::lock_guard<std::mutex> lock(elements_mutex_);
+        pipeline = pipeline_;
+        pipeline_ = nullptr;
+        appsink_ = nullptr;
+        encoder_ = nullptr;
+        audio_valve_ = nullptr;
+        scaler_ = nullptr;
+        scale_caps_ = nullptr;
+    }
+    if (!pipeline) return;
+
+    gst_element_set_state(pipeline, GST_STATE_NULL);
+    detach_branches();
+    gst_object_unref(pipeline);
 }
 
 void RtspPipeline::build_pipeline() {
+    std::unique_lock<std::mutex> config_lock(config_mutex_);
     std::string pipeline_desc;
 
     bool use_test_source = false;
+    bool relay = false;
 #ifdef ENABLE_TEST_MODE
-    use_test_source = config_.rtsp.url.empty();
+    use_test_source = config_.rtsp.url.empty() && config_.replay.file.empty();
 #endif
+    bool use_replay = !config_.replay.file.empty();
+    if (!launch_value_safe(config_.rtsp.url) || !launch_value_safe(config_.replay.file)) {
+        throw std::runtime_error("rtsp.url or replay.file contains quotes, '!' or whitespace");
+    }
+    replay_speed_.store(use_replay ? config_.replay.speed : 0.0);
+    replay_loop_.store(use_replay && config_.replay.loop);
+    replay_active_.store(use_replay);
+    replay_reanchor_.store(true);
+
+    // Replay frames are paced in on_new_sample, so the sink never drops
+    const std::string video_sink = use_replay
+        ? "appsink name=sink emit-signals=true sync=false max-buffers=5 drop=false"
+        : "appsink name=sink emit-signals=true sync=false max-buffers=5 drop=true";
 
     if (use_test_source) {
         // Test pattern source for development/verification
@@ -94,134 +502,206 @@ void RtspPipeline::build_pipeline() {
             "videotestsrc is-live=true pattern=ball ! "
             "video/x-raw,width=1280,height=720,framerate=30/1 ! ";
 
-#ifdef JETSON_PLATFORM
-        if (config_.encoding.hw_encode) {
-            pipeline_desc +=
-                "nvvidconv ! "
-                "video/x-raw(memory:NVMM),format=NV12 ! "
-                "nvv4l2h264enc "
-                "bitrate=" + std::to_string(config_.webrtc.video.bitrate_kbps * 1000) + " "
-                "maxperf-enable=1 "
-                "preset-level=1 "
-                "insert-sps-pps=1 "
-                "idrinterval=" + std::to_string(config_.encoding.idr_interval) + " ! ";
-        } else {
-#endif
-            pipeline_desc +=
-                "x264enc tune=zerolatency speed-preset=ultrafast "
-                "bitrate=" + std::to_string(config_.webrtc.video.bitrate_kbps) + " "
-                "key-int-max=" + std::to_string(config_.encoding.idr_interval) + " "
-                "bframes=0 ! ";
-#ifdef JETSON_PLATFORM
-        }
-#endif
+        pipeline_desc += branch_tee() + scaler_branch(false) +
+                         video_encoder().launch(config_.encoding, config_.webrtc.video, false);
         pipeline_desc +=
-            "video/x-h264,profile=baseline ! "
-            "h264parse config-interval=1 ! "
-            "appsink name=sink emit-signals=true sync=false max-buffers=5 drop=true";
-
-    } else if (config_.encoding.passthrough) {
-        // Passthrough mode: relay H.264 from RTSP directly
-        spdlog::info("Using RTSP passthrough mode (no re-encode)");
-        pipeline_desc =
-            "rtspsrc location=" + config_.rtsp.url + " "
-            "latency=" + std::to_string(config_.rtsp.latency_ms) + " "
-            "protocols=" + config_.rtsp.transport + " "
-            "is-live=true "
-            "buffer-mode=auto "
-            "do-retransmission=false "
-            "drop-on-latency=true ! "
-            "rtph264depay ! "
-            "h264parse config-interval=1 ! "
             "video/x-h264,stream-format=byte-stream,alignment=au ! "
+            "h264parse config-interval=1 ! "
             "appsink name=sink emit-signals=true sync=false max-buffers=5 drop=true";
 
     } else {
-        // Re-encode mode: decode + encode with bitrate control
-        spdlog::info("Using re-encode mode");
-        pipeline_desc =
-            "rtspsrc location=" + config_.rtsp.url + " "
-            "latency=" + std::to_string(config_.rtsp.latency_ms) + " "
-            "protocols=" + config_.rtsp.transport + " "
-            "is-live=true "
-            "buffer-mode=auto "
-            "do-retransmission=false "
-            "drop-on-latency=true ! "
-            "rtph264depay ! "
-            "h264parse config-interval=-1 ! "
-            "video/x-h264,stream-format=byte-stream,alignment=au ! ";
+        std::string codec = "h264";
+        if (use_replay) {
+            codec = replay_codec();
+            spdlog::info("Replaying {} ({}, speed {}, {})", config_.replay.file, codec,
+                         config_.replay.speed > 0 ? std::to_string(config_.replay.speed) + "x"
+                                                  : std::string("unpaced"),
+                         config_.replay.loop ? "looping" : "once");
+            pipeline_desc = replay_source();
+        } else {
+            pipeline_desc =
+                "rtspsrc name=src location=" + config_.rtsp.url + " "
+                "latency=" + std::to_string(config_.rtsp.latency_ms) + " "
+                "protocols=" + config_.rtsp.transport + " "
+                "is-live=true "
+                "buffer-mode=auto "
+                "do-retransmission=false "
+                "drop-on-latency=true ! "
+                "rtph264depay name=depay ! ";
+        }
 
-#ifdef JETSON_PLATFORM
-        // Jetson: always use HW decoder, optionally HW encoder
-        if (config_.encoding.hw_encode) {
-            is_hw_encode_ = true;
-            // HW decode → HW encode
+        // Peers only negotiate H.264, so H.265 input is always re-encoded
+        bool passthrough = config_.encoding.passthrough && codec == "h264";
+        relay = passthrough;
+        if (config_.encoding.passthrough && !passthrough) {
+            spdlog::warn("H.265 source cannot be relayed to H.264 peers, re-encoding");
+        }
+
+        if (passthrough) {
+            // Passthrough mode: relay H.264 directly
+            spdlog::info("Using {} passthrough mode (no re-encode)", use_replay ? "replay" : "RTSP");
+            if (config_.encoding.intra_refresh) {
+                spdlog::warn("encoding.intra_refresh needs re-encode mode, the source's GOP is relayed");
+            }
             pipeline_desc +=
-                "nvv4l2decoder enable-max-performance=1 ! "
-                "nvv4l2h264enc name=enc "
-                "bitrate=" + std::to_string(config_.webrtc.video.bitrate_kbps * 1000) + " "
-                "peak-bitrate=" + std::to_string(config_.webrtc.video.max_bitrate_kbps * 1000) + " "
-                "maxperf-enable=1 "
-                "preset-level=1 "
-                "control-rate=1 "
-                "insert-sps-pps=1 "
-                "idrinterval=" + std::to_string(config_.encoding.idr_interval) + " ! ";
+                "h264parse config-interval=1 ! "
+                "video/x-h264,stream-format=byte-stream,alignment=au ! " + branch_tee() + video_sink;
         } else {
-            // HW decode → SW encode
-            is_hw_encode_ = false;
+            // Re-encode mode: decode + encode with bitrate control
+            spdlog::info("Using re-encode mode");
             pipeline_desc +=
-                "nvv4l2decoder enable-max-performance=1 ! "
-                "nvvidconv ! video/x-raw,format=I420 ! "
-                "x264enc name=enc tune=zerolatency speed-preset=ultrafast "
-                "bitrate=" + std::to_string(config_.webrtc.video.bitrate_kbps) + " "
-                "vbv-buf-capacity=" + std::to_string(config_.webrtc.video.max_bitrate_kbps) + " "
-                "key-int-max=" + std::to_string(config_.encoding.idr_interval) + " "
-                "bframes=0 ! ";
+                codec + "parse config-interval=-1 ! "
+                "video/x-" + codec + ",stream-format=byte-stream,alignment=au ! " +
+                reencode_branch(codec) +
+                "video/x-h264,stream-format=byte-stream,alignment=au ! "
+                "h264parse config-interval=1 ! " + video_sink;
         }
-#else
-        // Non-Jetson: software decode + encode
-        is_hw_encode_ = false;
-        pipeline_desc +=
-            "avdec_h264 ! videoconvert ! "
-            "x264enc name=enc tune=zerolatency speed-preset=ultrafast "
-            "bitrate=" + std::to_string(config_.webrtc.video.bitrate_kbps) + " "
-            "vbv-buf-capacity=" + std::to_string(config_.webrtc.video.max_bitrate_kbps) + " "
-            "key-int-max=" + std::to_string(config_.encoding.idr_interval) + " "
-            "bframes=0 ! ";
-#endif
-        pipeline_desc +=
-            "video/x-h264,stream-format=byte-stream,alignment=au ! "
-            "h264parse config-interval=1 ! "
-            "appsink name=sink emit-signals=true sync=false max-buffers=5 drop=true";
     }
 
+    // Recordings carry no camera audio branch to tap
+    bool audio_enabled = config_.audio.enabled && !use_replay;
+    if (audio_enabled) {
+        pipeline_desc += " " + audio_branch(use_test_source);
+    } else if (config_.audio.enabled) {
+        spdlog::info("Audio disabled while replaying");
+    }
+
+    int initial_bitrate_kbps = config_.webrtc.video.bitrate_kbps;
+    FrameBudget initial_budget = frame_budget(config_.encoding.latency_budget_ms,
+                                              initial_bitrate_kbps, config_.webrtc.video.fps);
+    RoiStreams::Setup roi_setup;
+    PeerEncoders::Setup peer_setup;
+    PreviewStream::Setup preview_setup;
+    std::string branch_decoder;
+    branch_setup(use_test_source, relay, roi_setup, peer_setup, preview_setup, branch_decoder);
+    nominal_interval_us_.store(1'000'000 / static_cast<uint64_t>(std::max(config_.webrtc.video.fps, 1)));
+    config_lock.unlock();
+
     spdlog::info("Pipeline: {}", pipeline_desc);
 
     GError* error = nullptr;
-    pipeline_ = gst_parse_launch(pipeline_desc.c_str(), &error);
+    GstElement* pipeline = gst_parse_launch(pipeline_desc.c_str(), &error);
     if (error) {
         std::string err_msg = error->message;
         g_error_free(error);
+        if (pipeline) gst_object_unref(pipeline);
         throw std::runtime_error("Failed to create pipeline: " + err_msg);
     }
+    {
+        std::lock_guard<std::mutex> lock(elements_mutex_);
+        pipeline_ = pipeline;
+    }
 
-    appsink_ = gst_bin_get_by_name(GST_BIN(pipeline_), "sink");
-    if (!appsink_) {
+    GstElement* appsink = gst_bin_get_by_name(GST_BIN(pipeline_), "sink");
+    if (!appsink) {
         throw std::runtime_error("Failed to find appsink element");
     }
 
-    // Grab encoder element for dynamic bitrate control
-    encoder_ = gst_bin_get_by_name(GST_BIN(pipeline_), "enc");
-    if (encoder_) {
+    // A new source starts a new timeline; rtsp.timestamps "rtp" and the
+    // capture clock read the camera's RTP timestamps going into the
+    // depayloader
+    timestamps_.reset();
+    capture_clock_.reset();
+    if (GstElement* depay = gst_bin_get_by_name(GST_BIN(pipeline_), "depay")) {
+        GstPad* pad = gst_element_get_static_pad(depay, "sink");
+        gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, &RtspPipeline::on_rtp_packet, this, nullptr);
+        gst_object_unref(pad);
+        gst_object_unref(depay);
+    }
+
+    // The camera's sender reports are in rtspsrc's rtpbin, created once the
+    // stream is described
+    if (capture_clock_.enabled()) {
+        if (GstElement* src = gst_bin_get_by_name(GST_BIN(pipeline_), "src")) {
+            g_signal_connect(src, "new-manager", G_CALLBACK(&RtspPipeline::on_new_manager), this);
+            gst_object_unref(src);
+        } else {
+            spdlog::info("rtsp.capture_clock needs a live RTSP source, frames go without capture times");
+        }
+    }
+
+    branch_tap_.attach(pipeline_, branch_decoder);
+    roi_.attach(roi_setup);
+    peer_encoders_.attach(peer_setup);
+    preview_.attach(preview_setup);
+
+    // Grab encoder element for dynamic bitrate control. Owned by the
+    // pipeline, like the scaler and the audio valve.
+    GstElement* encoder = gst_bin_get_by_name(GST_BIN(pipeline_), "enc");
+    if (encoder) {
+        gst_object_unref(encoder);
         spdlog::info("Encoder found — dynamic bitrate control enabled");
     }
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        stats_.encoder_bitrate_kbps = encoder ? initial_bitrate_kbps : 0;
+        stats_.frame_budget_bytes = encoder ? initial_budget.max_frame_bytes : 0;
+        if (!encoder) {
+            stats_.encoder.clear();
+            stats_.encoder_hardware = false;
+        }
+    }
+
+    GstElement* scaler = gst_bin_get_by_name(GST_BIN(pipeline_), "scale");
+    GstElement* scale_caps = gst_bin_get_by_name(GST_BIN(pipeline_), "scalecaps");
+    if (scaler) gst_object_unref(scaler);
+    if (scale_caps) gst_object_unref(scale_caps);
+    if (!scaler) scale_caps = nullptr;
+    if (scale_caps) {
+        spdlog::info("Scaler found — encode resolution follows the bitrate");
+    }
+    {
+        std::lock_guard<std::mutex> lock(elements_mutex_);
+        encoder_ = encoder;
+        scaler_ = scaler;
+        scale_caps_ = scale_caps;
+    }
+    {
+        std::lock_guard<std::mutex> scaling_lock(scaling_mutex_);
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        account_scale_time(stats_);
+        scale_accounting_ = scale_caps != nullptr;
+        stats_.encode_resolution = scale_current_.empty() ? "" : scale_current_.str();
+        scale_since_ = std::chrono::steady_clock::now();
+        scale_cpu_since_ = process_cpu_s();
+        // Frame sizes from the previous source or encoder say nothing here
+        complexity_.reset();
+        stats_.complexity = {};
+    }
 
     // Configure appsink callbacks
     GstAppSinkCallbacks callbacks = {};
     callbacks.new_sample = &RtspPipeline::on_new_sample;
-    gst_app_sink_set_callbacks(GST_APP_SINK(appsink_), &callbacks, this, nullptr);
+    gst_app_sink_set_callbacks(GST_APP_SINK(appsink), &callbacks, this, nullptr);
+
+    // Owned by the pipeline; only the pointer is kept for request_keyframe
+    gst_object_unref(appsink);
+    {
+        std::lock_guard<std::mutex> lock(elements_mutex_);
+        appsink_ = appsink;
+    }
 
-    gst_object_unref(appsink_);
+    if (audio_enabled) {
+        GstElement* audio_sink = gst_bin_get_by_name(GST_BIN(pipeline_), "asink");
+        if (audio_sink) {
+            GstAppSinkCallbacks audio_callbacks = {};
+            audio_callbacks.new_sample = &RtspPipeline::on_new_audio_sample;
+            gst_app_sink_set_callbacks(GST_APP_SINK(audio_sink), &audio_callbacks, this, nullptr);
+            gst_object_unref(audio_sink);
+        }
+
+        // Owned by the pipeline; only the pointer is kept for set_audio_enabled
+        GstElement* valve = gst_bin_get_by_name(GST_BIN(pipeline_), "avalve");
+        if (valve) {
+            gst_object_unref(valve);
+        }
+        std::lock_guard<std::mutex> lock(elements_mutex_);
+        audio_valve_ = valve;
+        // A toggle since the description was built would otherwise be lost
+        if (valve) {
+            g_object_set(G_OBJECT(valve), "drop", audio_enabled_.load() ? FALSE : TRUE, nullptr);
+        }
+    }
 }
 
 GstFlowReturn RtspPipeline::on_new_sample(GstAppSink* sink, gpointer user_data) {
@@ -232,35 +712,236 @@ GstFlowReturn RtspPipeline::on_new_sample(GstAppSink* sink, gpointer user_data)
         return GST_FLOW_OK;
     }
 
+    if (self->replay_speed_.load() > 0) {
+        self->pace_replay(sample);
+    }
+    self->deliver_video_sample(sample);
+    gst_sample_unref(sample);
+    return GST_FLOW_OK;
+}
+
+GstPadProbeReturn RtspPipeline::on_rtp_packet(GstPad* /*pad*/, GstPadProbeInfo* info,
+                                              gpointer user_data) {
+    auto* self = static_cast<RtspPipeline*>(user_data);
+    GstBuffer* buffer = GST_PAD_PROBE_INFO_BUFFER(info);
+    if (!buffer || !GST_BUFFER_PTS_IS_VALID(buffer)) return GST_PAD_PROBE_OK;
+
+    GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+    if (gst_rtp_buffer_map(buffer, GST_MAP_READ, &rtp)) {
+        uint32_t rtp_timestamp = gst_rtp_buffer_get_timestamp(&rtp);
+        self->timestamps_.on_rtp(GST_BUFFER_PTS(buffer) / 1000, rtp_timestamp);
+        self->capture_clock_.on_rtp(gst_rtp_buffer_get_ssrc(&rtp), rtp_timestamp);
+        gst_rtp_buffer_unmap(&rtp);
+    }
+    return GST_PAD_PROBE_OK;
+}
+
+void RtspPipeline::on_new_manager(GstElement* /*src*/, GstElement* manager, gpointer user_data) {
+    g_signal_connect(manager, "on-ssrc-active", G_CALLBACK(&RtspPipeline::on_ssrc_active), user_data);
+}
+
+void RtspPipeline::on_ssrc_active(GstElement* rtpbin, guint session, guint ssrc, gpointer user_data) {
+    // Emitted for each RTCP packet from the source; its last sender report
+    // is in the source's stats
+    auto* self = static_cast<RtspPipeline*>(user_data);
+    GObject* internal = nullptr;
+    g_signal_emit_by_name(rtpbin, "get-internal-session", session, &internal);
+    if (!internal) return;
+    GObject* source = nullptr;
+    g_signal_emit_by_name(internal, "get-source-by-ssrc", ssrc, &source);
+    g_object_unref(internal);
+    if (!source) return;
+
+    GstStructure* stats = nullptr;
+    g_object_get(source, "stats", &stats, nullptr);
+    g_object_unref(source);
+    if (!stats) return;
+
+    gboolean have_sr = FALSE;
+    guint64 ntp_time = 0;
+    guint rtp_timestamp = 0;
+    if (gst_structure_get_boolean(stats, "have-sr", &have_sr) && have_sr &&
+        gst_structure_get_uint64(stats, "sr-ntptime", &ntp_time) &&
+        gst_structure_get_uint(stats, "sr-rtptime", &rtp_timestamp)) {
+        self->capture_clock_.on_sender_report(ssrc, ntp_time, rtp_timestamp);
+    }
+    gst_structure_free(stats);
+}
+
+uint64_t RtspPipeline::frame_interval_us(GstSample* sample) const {
+    // Relayed H.264 often has no frame rate in its caps
+    GstCaps* caps = gst_sample_get_caps(sample);
+    gint num = 0, den = 0;
+    if (caps && gst_caps_get_size(caps) > 0 &&
+        gst_structure_get_fraction(gst_caps_get_structure(caps, 0), "framerate", &num, &den) &&
+        num > 0 && den > 0) {
+        return static_cast<uint64_t>(1'000'000) * static_cast<uint64_t>(den) / static_cast<uint64_t>(num);
+    }
+    return nominal_interval_us_.load(std::memory_order_relaxed);
+}
+
+void RtspPipeline::pace_replay(GstSample* sample) {
+    double speed = replay_speed_.load();
+    if (speed <= 0) return;
+    GstBuffer* buffer = gst_sample_get_buffer(sample);
+    if (!buffer) return;
+
+    // Decode order is monotonic, presentation order is not (B-frames)
+    GstClockTime ts = GST_BUFFER_DTS_OR_PTS(buffer);
+    if (!GST_CLOCK_TIME_IS_VALID(ts)) return;
+    uint64_t ts_us = ts / 1000;
+
+    auto now = std::chrono::steady_clock::now();
+    if (replay_reanchor_.exchange(false) || ts_us < replay_first_us_) {
+        replay_anchor_ = now;
+        replay_first_us_ = ts_us;
+        return;
+    }
+
+    // Hold the frame until its original offset from the start, scaled by speed
+    auto due = replay_anchor_ + std::chrono::microseconds(
+        static_cast<int64_t>(static_cast<double>(ts_us - replay_first_us_) / speed));
+    while (now < due && !stop_requested_.load()) {
+        std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(
+            due - now, std::chrono::milliseconds(50)));
+        now = std::chrono::steady_clock::now();
+    }
+}
+
+bool RtspPipeline::loop_replay() {
+    replay_reanchor_.store(true);
+    if (!gst_element_seek_simple(pipeline_, GST_FORMAT_TIME,
+            static_cast<GstSeekFlags>(GST_SEEK_FLAG_FLUSH | GST_SEEK_FLAG_KEY_UNIT), 0)) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    stats_.replay_loops++;
+    return true;
+}
+
+void RtspPipeline::deliver_video_sample(GstSample* sample) {
     GstBuffer* buffer = gst_sample_get_buffer(sample);
     if (!buffer) {
-        gst_sample_unref(sample);
-        return GST_FLOW_OK;
+        return;
     }
 
     GstMapInfo map;
     if (gst_buffer_map(buffer, &map, GST_MAP_READ)) {
-        // Get timestamp in microseconds
-        uint64_t timestamp_us = 0;
-        if (GST_BUFFER_PTS_IS_VALID(buffer)) {
-            timestamp_us = GST_BUFFER_PTS(buffer) / 1000; // ns → µs
-        } else {
-            auto now = std::chrono::steady_clock::now();
-            timestamp_us = std::chrono::duration_cast<std::chrono::microseconds>(
-                now.time_since_epoch()).count();
+        // Timestamp in microseconds, the delivery time when there is no
+        // PTS, regenerated per rtsp.timestamps
+        bool has_pts = GST_BUFFER_PTS_IS_VALID(buffer);
+        uint64_t pts_us = has_pts ? GST_BUFFER_PTS(buffer) / 1000 : 0;
+        uint64_t timestamp_us = timestamps_.on_frame(has_pts, pts_us, frame_interval_us(sample));
+
+        // Capture time from the camera RTP timestamp the frame came with
+        // (the encoder keeps the PTS)
+        uint64_t capture_us = 0;
+        uint32_t rtp_timestamp = 0;
+        if (has_pts && timestamps_.camera_rtp(pts_us, rtp_timestamp)) {
+            capture_clock_.capture_time(rtp_timestamp, capture_us);
+        }
+
+        last_frame_ns_.store(std::chrono::steady_clock::now().time_since_epoch().count(),
+                             std::memory_order_relaxed);
+        reconnect_failures_.store(0, std::memory_order_relaxed);
+
+        // A camera reconfigured mid-stream sends new parameter sets; peers
+        // hear of it before they get frames that need them
+        bool keyframe = !GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+        h264::Sps sps;
+        if (map.size > 0 && parameter_sets_changed(map.data, map.size, sps) && format_callback_) {
+            format_callback_(sps, keyframe);
         }
 
         // Deliver NAL units to callback
-        if (self->nal_callback_ && map.size > 0) {
-            self->nal_callback_(map.data, map.size, timestamp_us);
+        if (nal_callback_ && map.size > 0) {
+            nal_callback_(map.data, map.size, timestamp_us, capture_us);
         }
 
         // Update stats
+        bool estimated = false;
+        SceneComplexity::Estimate estimate;
+        {
+            std::lock_guard<std::mutex> lock(stats_mutex_);
+            stats_.frames_received++;
+            stats_.bytes_received += map.size;
+            stats_.connected = true;
+            if (stats_.frame_budget_bytes > 0 && map.size > stats_.frame_budget_bytes) {
+                (keyframe ? stats_.keyframes_over_budget : stats_.frames_over_budget)++;
+            }
+            if (complexity_.on_frame(map.size, keyframe)) {
+                estimate = stats_.complexity = complexity_.estimate();
+                estimated = true;
+            }
+        }
+        if (estimated && complexity_callback_) {
+            complexity_callback_(estimate);
+        }
+
+        gst_buffer_unmap(buffer, &map);
+    }
+}
+
+bool RtspPipeline::parameter_sets_changed(const uint8_t* data, size_t size, h264::Sps& sps) {
+    // h264parse repeats them ahead of every IDR; only different ones count
+    const uint8_t* sps_nal = nullptr;
+    size_t sps_size = 0;
+    if (!h264::find_nal(data, size, h264::NalSps, sps_nal, sps_size)) return false;
+    const uint8_t* pps_nal = nullptr;
+    size_t pps_size = 0;
+    h264::find_nal(data, size, h264::NalPps, pps_nal, pps_size);
+
+    std::string format;
+    {
+        std::lock_guard<std::mutex> lock(sps_pps_mutex_);
+        bool same_sps = cached_sps_.size() == sps_size && std::equal(sps_nal, sps_nal + sps_size, cached_sps_.begin());
+        bool same_pps = !pps_nal || (cached_pps_.size() == pps_size &&
+                                     std::equal(pps_nal, pps_nal + pps_size, cached_pps_.begin()));
+        if (same_sps && same_pps) return false;
+
+        cached_sps_.assign(sps_nal, sps_nal + sps_size);
+        if (pps_nal) cached_pps_.assign(pps_nal, pps_nal + pps_size);
+        if (!h264::parse_sps(sps_nal, sps_size, sps)) {
+            spdlog::warn("Unreadable SPS from the source ({} bytes)", sps_size);
+            return false;
+        }
+        format = std::to_string(sps.width) + "x" + std::to_string(sps.height) + ", profile-level-id " +
+                 h264::profile_level_id(sps);
+    }
+
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    if (stats_.source_format.empty()) {
+        spdlog::info("Source format: {}", format);
+    } else {
+        spdlog::info("Source format changed: {} → {}", stats_.source_format, format);
+        stats_.format_changes++;
+    }
+    stats_.source_format = format;
+    return true;
+}
+
+GstFlowReturn RtspPipeline::on_new_audio_sample(GstAppSink* sink, gpointer user_data) {
+    auto* self = static_cast<RtspPipeline*>(user_data);
+
+    GstSample* sample = gst_app_sink_pull_sample(sink);
+    if (!sample) {
+        return GST_FLOW_OK;
+    }
+
+    GstBuffer* buffer = gst_sample_get_buffer(sample);
+    GstMapInfo map;
+    // Audio without a PTS can't be placed on the video timeline, drop it
+    if (buffer && GST_BUFFER_PTS_IS_VALID(buffer) && gst_buffer_map(buffer, &map, GST_MAP_READ)) {
+        uint64_t timestamp_us = GST_BUFFER_PTS(buffer) / 1000; // ns → µs
+
+        if (self->audio_callback_ && map.size > 0) {
+            self->audio_callback_(map.data, map.size, timestamp_us);
+        }
+
         {
             std::lock_guard<std::mutex> lock(self->stats_mutex_);
-            self->stats_.frames_received++;
-            self->stats_.bytes_received += map.size;
-            self->stats_.connected = true;
+            self->stats_.audio_frames++;
         }
 
         gst_buffer_unmap(buffer, &map);
@@ -273,11 +954,22 @@ GstFlowReturn RtspPipeline::on_new_sample(GstAppSink* sink, gpointer user_data)
 void RtspPipeline::pipeline_thread() {
     spdlog::info("Pipeline thread started");
 
+    // The plugin registry load is the slow part of boot; doing it here lets
+    // the caller bring up its listeners meanwhile
+    if (!gst_is_initialized()) {
+        auto t0 = std::chrono::steady_clock::now();
+        gst_init(nullptr, nullptr);
+        spdlog::info("GStreamer initialized in {:.1f} ms",
+                     std::chrono::duration<double, std::milli>(
+                         std::chrono::steady_clock::now() - t0).count());
+    }
+
     while (!stop_requested_.load()) {
         try {
             build_pipeline();
         } catch (const std::exception& e) {
             spdlog::error("Failed to build pipeline: {}", e.what());
+            teardown_pipeline();
             attempt_reconnect();
             continue;
         }
@@ -285,9 +977,7 @@ void RtspPipeline::pipeline_thread() {
         GstStateChangeReturn ret = gst_element_set_state(pipeline_, GST_STATE_PLAYING);
         if (ret == GST_STATE_CHANGE_FAILURE) {
             spdlog::error("Failed to set pipeline to PLAYING");
-            gst_object_unref(pipeline_);
-            pipeline_ = nullptr;
-            appsink_ = nullptr;
+            teardown_pipeline();
             attempt_reconnect();
             continue;
         }
@@ -295,21 +985,41 @@ void RtspPipeline::pipeline_thread() {
         running_.store(true);
         spdlog::info("Pipeline is PLAYING");
 
+        // The stall timeout also covers the RTSP handshake
+        last_frame_ns_.store(std::chrono::steady_clock::now().time_since_epoch().count());
+
         // Run the message loop
         GstBus* bus = gst_element_get_bus(pipeline_);
         bool pipeline_ok = true;
 
+        bool restart_now = false;
+
         while (!stop_requested_.load() && pipeline_ok) {
             GstMessage* msg = gst_bus_timed_pop(bus, 500 * GST_MSECOND);
             if (msg) {
                 handle_bus_message(msg);
 
-                if (GST_MESSAGE_TYPE(msg) == GST_MESSAGE_ERROR ||
-                    GST_MESSAGE_TYPE(msg) == GST_MESSAGE_EOS) {
+                if (GST_MESSAGE_TYPE(msg) == GST_MESSAGE_EOS && replay_active_.load()) {
+                    if (!replay_loop_.load()) {
+                        // Stay up without frames so the watchdog leaves us alone
+                        spdlog::info("Replay finished");
+                    } else if (!loop_replay()) {
+                        // Source can't seek (e.g. pcap), rebuild without the reconnect delay
+                        pipeline_ok = false;
+                        restart_now = true;
+                    }
+                } else if (GST_MESSAGE_TYPE(msg) == GST_MESSAGE_ERROR ||
+                           GST_MESSAGE_TYPE(msg) == GST_MESSAGE_EOS) {
                     pipeline_ok = false;
                 }
                 gst_message_unref(msg);
             }
+
+            // A camera can stop sending without closing the session; rtspsrc
+            // then waits forever, so rebuild once frames have been gone too long
+            if (pipeline_ok && stalled()) {
+                pipeline_ok = false;
+            }
         }
 
         gst_object_unref(bus);
@@ -320,18 +1030,18 @@ void RtspPipeline::pipeline_thread() {
             stats_.connected = false;
         }
 
-        // Cleanup pipeline
-        gst_element_set_state(pipeline_, GST_STATE_NULL);
-        gst_object_unref(pipeline_);
-        pipeline_ = nullptr;
-        appsink_ = nullptr;
+        teardown_pipeline();
 
-        if (!stop_requested_.load()) {
+        if (restart_now && !stop_requested_.load()) {
+            std::lock_guard<std::mutex> lock(stats_mutex_);
+            stats_.replay_loops++;
+        } else if (!stop_requested_.load()) {
             spdlog::warn("Pipeline ended unexpectedly, will reconnect...");
             attempt_reconnect();
         }
     }
 
+    thread_alive_.store(false);
     spdlog::info("Pipeline thread stopped");
 }
 
@@ -358,7 +1068,11 @@ void RtspPipeline::handle_bus_message(GstMessage* msg) {
             break;
         }
         case GST_MESSAGE_EOS:
-            spdlog::warn("End of stream received");
+            if (replay_active_.load()) {
+                spdlog::debug("Replay reached end of file");
+            } else {
+                spdlog::warn("End of stream received");
+            }
             break;
         case GST_MESSAGE_STATE_CHANGED: {
             if (GST_MESSAGE_SRC(msg) == GST_OBJECT(pipeline_)) {
@@ -375,6 +1089,29 @@ void RtspPipeline::handle_bus_message(GstMessage* msg) {
     }
 }
 
+bool RtspPipeline::stalled() {
+    // A finished or paused replay legitimately goes quiet
+    if (replay_active_.load()) return false;
+
+    int timeout_ms;
+    {
+        std::lock_guard<std::mutex> lock(config_mutex_);
+        timeout_ms = config_.rtsp.stall_timeout_ms;
+    }
+    if (timeout_ms <= 0) return false;
+
+    auto last = std::chrono::steady_clock::time_point(
+        std::chrono::steady_clock::duration(last_frame_ns_.load(std::memory_order_relaxed)));
+    auto silent_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - last).count();
+    if (silent_ms < timeout_ms) return false;
+
+    spdlog::warn("No frames for {}ms, reconnecting", silent_ms);
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    stats_.stalls++;
+    return true;
+}
+
 void RtspPipeline::attempt_reconnect() {
     if (stop_requested_.load()) return;
 
@@ -383,14 +1120,28 @@ void RtspPipeline::attempt_reconnect() {
         stats_.reconnect_count++;
     }
 
-    int interval_ms = config_.rtsp.reconnect_interval_ms;
-    spdlog::info("Reconnecting in {}ms...", interval_ms);
+    // Consecutive attempts that never produced a frame
+    int failures = reconnect_failures_.fetch_add(1);
+
+    int interval_ms;
+    {
+        std::lock_guard<std::mutex> lock(config_mutex_);
+        interval_ms = config_.rtsp.reconnect_interval_ms;
+        if (config_.rtsp.reconnect_strategy == "backoff") {
+            int64_t backoff = static_cast<int64_t>(interval_ms) << std::min(failures, 16);
+            interval_ms = static_cast<int>(std::min<int64_t>(
+                backoff, std::max(interval_ms, config_.rtsp.reconnect_max_interval_ms)));
+        }
+    }
+    spdlog::info("Reconnecting in {}ms (attempt {})...", interval_ms, failures + 1);
 
     // Sleep in small increments to allow quick shutdown
-    int elapsed = 0;
-    while (elapsed < interval_ms && !stop_requested_.load()) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        elapsed += 100;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(interval_ms);
+    while (!stop_requested_.load()) {
+        auto remaining = deadline - std::chrono::steady_clock::now();
+        if (remaining <= std::chrono::steady_clock::duration::zero()) break;
+        std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(
+            remaining, std::chrono::milliseconds(100)));
     }
 }
 
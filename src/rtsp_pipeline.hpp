@@ -1,11 +1,22 @@
 #pragma once
 
+#include "branch_tap.hpp"
+#include "capture_clock.hpp"
 #include "config.hpp"
+#include "h264.hpp"
+#include "peer_encoders.hpp"
+#include "preview_stream.hpp"
+#include "roi_streams.hpp"
+#include "scaling_policy.hpp"
+#include "scene_complexity.hpp"
+#include "timestamp_smoother.hpp"
+#include "video_encoder.hpp"
 #include <gst/gst.h>
 #include <gst/app/gstappsink.h>
 #include <functional>
 #include <mutex>
 #include <atomic>
+#include <chrono>
 #include <thread>
 #include <string>
 #include <vector>
@@ -15,6 +26,18 @@ namespace ss {
 // Callback: receives H.264 NAL unit data (with start codes)
 using NalUnitCallback = std::function<void(const uint8_t* data, size_t size, uint64_t timestamp_us)>;
 
+// Callback: one encoded video access unit and its wall-clock capture time
+// (µs since the Unix epoch, 0 = unknown; see rtsp.capture_clock)
+using VideoFrameCallback = std::function<void(const uint8_t* data, size_t size,
+                                              uint64_t timestamp_us, uint64_t capture_us)>;
+
+// Callback: the video's parameter sets changed (the first ones, or the
+// camera was reconfigured), announced with the access unit carrying them
+using FormatCallback = std::function<void(const h264::Sps& sps, bool idr)>;
+
+// Callback: a new scene complexity estimate from the encoded frame sizes
+using ComplexityCallback = std::function<void(const SceneComplexity::Estimate& estimate)>;
+
 class RtspPipeline {
 public:
     explicit RtspPipeline(const AppConfig& config);
@@ -25,52 +48,205 @@ public:
     RtspPipeline& operator=(const RtspPipeline&) = delete;
 
     // Set callback for received NAL units
-    void set_nal_callback(NalUnitCallback cb);
+    void set_nal_callback(VideoFrameCallback cb);
+
+    // Set callback for source format changes, called ahead of the NAL callback
+    void set_format_callback(FormatCallback cb);
+
+    // Set callback for scene complexity estimates (one per content_adaptive window)
+    void set_complexity_callback(ComplexityCallback cb);
 
-    // Start / stop the pipeline
+    // Set callback for encoded Opus packets (same timestamp base as video)
+    void set_audio_callback(NalUnitCallback cb);
+
+    // Open/close the audio valve; while closed the transcode does no work
+    void set_audio_enabled(bool enabled);
+
+    // Start / stop the pipeline. Lifecycle calls are serialized against each
+    // other (watchdog, admin API, config reload); the pipeline thread alone
+    // builds and tears down, stop() asks it to finish and joins it.
     bool start();
     void stop();
 
+    // stop() + start() as one step; with a config, it is applied while the
+    // pipeline is down
+    bool restart();
+    bool restart(const AppConfig& config);
+
     // Check if pipeline is running
     bool is_running() const { return running_.load(); }
 
-    // Dynamically adjust encoder bitrate (only in re-encode mode)
+    // Not streaming, but the pipeline thread is still up: connecting, or
+    // waiting out its reconnect delay (rtsp.reconnect_*)
+    bool reconnecting() const { return thread_alive_.load() && !running_.load(); }
+
+    // Dynamically adjust encoder bitrate (only in re-encode mode). With
+    // encoding.scaling the encode resolution follows the bitrate.
     void set_bitrate(int bitrate_kbps);
 
+    // Ask for an IDR: the encoder produces one directly; in passthrough the
+    // request travels upstream and rtpbin turns it into a PLI to the camera
+    bool request_keyframe();
+
+    // Per-peer region-of-interest encodes (encoding.roi), rebuilt with the
+    // pipeline
+    RoiStreams& roi_streams() { return roi_; }
+
+    // Per-viewer encoders for small audiences (encoding.per_peer)
+    PeerEncoders& peer_encoders() { return peer_encoders_; }
+
+    // Thumbnail rendition for dashboard tiles (encoding.preview)
+    PreviewStream& preview() { return preview_; }
+
+    // Replace settings. Bitrate limits and reconnect timing apply right away;
+    // source/encoding changes need restart(config) to rebuild the pipeline.
+    void update_config(const AppConfig& config);
+
+    // Video path of the appsink callback, minus the pull. Exposed so the
+    // benchmarks can drive it with synthetic samples.
+    void deliver_video_sample(GstSample* sample);
+
     // Get pipeline statistics
     struct Stats {
         uint64_t frames_received = 0;
         uint64_t bytes_received = 0;
         uint64_t reconnect_count = 0;
+        uint64_t stalls = 0;          // reconnects forced by stall_timeout_ms
+        uint64_t audio_frames = 0;
+        uint64_t keyframe_requests = 0;
+        uint64_t replay_loops = 0;
+        int encoder_bitrate_kbps = 0; // 0 in passthrough
+        // encoding.latency_budget_ms: largest frame that drains within the
+        // budget at the current rate, and frames that came out bigger
+        size_t frame_budget_bytes = 0;  // 0 = no budget
+        uint64_t frames_over_budget = 0;
+        uint64_t keyframes_over_budget = 0;
+        std::string encoder;          // re-encode element, empty until selected
+        bool encoder_hardware = false;
+
+        // encoding.scaling: wall and process CPU time spent at each encode
+        // resolution, to see what the smaller rungs save
+        struct ScaleTime {
+            std::string resolution;   // "source" or WxH
+            double seconds = 0.0;
+            double cpu_seconds = 0.0;
+        };
+        std::string encode_resolution; // empty = source size
+        std::vector<ScaleTime> scale_times;
+        SceneComplexity::Estimate complexity;
+        TimestampSmoother::Stats timestamps;
+        CaptureClock::Stats capture;
+        std::string source_format;    // WxH and profile-level-id of the sent stream
+        uint64_t format_changes = 0;  // parameter sets changed mid-stream
         bool connected = false;
     };
     Stats get_stats() const;
 
 private:
     void build_pipeline();
+    std::string audio_branch(bool test_source) const;
+    std::string reencode_branch(const std::string& codec);
+    std::string branch_tee() const;
+    void branch_setup(bool test_source, bool passthrough, RoiStreams::Setup& roi,
+                      PeerEncoders::Setup& peers, PreviewStream::Setup& preview,
+                      std::string& decoder);
+    void detach_branches();
+    void teardown_pipeline();          // pipeline thread only
+    const VideoEncoder& video_encoder();
+    std::string scaler_branch(bool nvmm);
+    std::string scale_caps(Resolution resolution) const;
+    Resolution source_resolution() const;       // elements_mutex_ held
+    void rescale(int bitrate_kbps);
+    void account_scale_time(Stats& stats) const;
+    std::string replay_source() const;
+    std::string replay_codec() const;
+    uint64_t frame_interval_us(GstSample* sample) const;
+    bool parameter_sets_changed(const uint8_t* data, size_t size, h264::Sps& sps);
+    void pace_replay(GstSample* sample);
+    bool loop_replay();
     void pipeline_thread();
     void handle_bus_message(GstMessage* msg);
     void attempt_reconnect();
+    bool stalled();
 
     // GStreamer appsink callback
     static GstFlowReturn on_new_sample(GstAppSink* sink, gpointer user_data);
+    static GstFlowReturn on_new_audio_sample(GstAppSink* sink, gpointer user_data);
+    static GstPadProbeReturn on_rtp_packet(GstPad* pad, GstPadProbeInfo* info, gpointer user_data);
+    static void on_new_manager(GstElement* src, GstElement* manager, gpointer user_data);
+    static void on_ssrc_active(GstElement* rtpbin, guint session, guint ssrc, gpointer user_data);
 
     AppConfig config_;
-    NalUnitCallback nal_callback_;
-
+    mutable std::mutex config_mutex_;
+    VideoFrameCallback nal_callback_;
+    NalUnitCallback audio_callback_;
+    ComplexityCallback complexity_callback_;
+    FormatCallback format_callback_;
+
+    // Set and cleared by the pipeline thread, under elements_mutex_; other
+    // threads use an element only while holding it. The pipeline thread
+    // reads them without it.
+    std::mutex elements_mutex_;
     GstElement* pipeline_ = nullptr;
     GstElement* appsink_ = nullptr;
     GstElement* encoder_ = nullptr;  // for dynamic bitrate control
-    bool is_hw_encode_ = false;
-
+    GstElement* audio_valve_ = nullptr;
+    GstElement* scaler_ = nullptr;       // videoscale / nvvidconv (encoding.scaling)
+    GstElement* scale_caps_ = nullptr;   // its capsfilter, retargeted by rescale()
+
+    // Re-encode encoder, benchmarked on first use (guarded by config_mutex_)
+    VideoEncoder video_encoder_;
+    std::string encoder_selection_;      // settings video_encoder_ was chosen for
+
+    // Encode resolution (empty = source size); rescale() runs one at a time
+    std::mutex scaling_mutex_;
+    Resolution scale_current_;
+    bool scale_nvmm_ = false;
+    std::chrono::steady_clock::time_point scale_since_;   // guarded by stats_mutex_
+    double scale_cpu_since_ = 0.0;                         // guarded by stats_mutex_
+    bool scale_accounting_ = false;                        // guarded by stats_mutex_
+    std::atomic<bool> audio_enabled_{false};
+
+    // Extra encoders off the decoded video: ROI crops and per-peer encodes
+    BranchTap branch_tap_;
+    RoiStreams roi_{branch_tap_};
+    PeerEncoders peer_encoders_{branch_tap_};
+    PreviewStream preview_{branch_tap_};
+
+    // File replay (set when the pipeline is built, read on streaming threads)
+    std::atomic<bool> replay_active_{false};
+    std::atomic<bool> replay_loop_{false};
+    std::atomic<double> replay_speed_{0.0};   // 0 = unpaced
+    std::atomic<bool> replay_reanchor_{true};
+    std::chrono::steady_clock::time_point replay_anchor_;
+    uint64_t replay_first_us_ = 0;
+
+    // Reconnect / stall tracking. Failures reset on the first frame received.
+    std::atomic<int> reconnect_failures_{0};
+    std::atomic<int64_t> last_frame_ns_{0};   // steady clock
+
+    bool start_locked();                  // lifecycle_mutex_ held
+    void stop_locked();                   // lifecycle_mutex_ held
+
+    std::mutex lifecycle_mutex_;          // start / stop / restart
     std::thread thread_;
     std::atomic<bool> running_{false};
+    std::atomic<bool> thread_alive_{false};
     std::atomic<bool> stop_requested_{false};
 
     mutable std::mutex stats_mutex_;
     Stats stats_;
+    SceneComplexity complexity_;         // guarded by stats_mutex_
+
+    // rtsp.timestamps: regenerated frame timestamps, nominal frame interval
+    // for the current pipeline (from webrtc.video.fps until caps say)
+    TimestampSmoother timestamps_;
+    std::atomic<uint64_t> nominal_interval_us_{33'333};
+
+    // rtsp.capture_clock: capture times from the camera's sender reports
+    CaptureClock capture_clock_;
 
-    // SPS/PPS storage for keyframe insertion
+    // Parameter sets of the stream sent, to notice format changes
     std::mutex sps_pps_mutex_;
     std::vector<uint8_t> cached_sps_;
     std::vector<uint8_t> cached_pps_;
@@ -0,0 +1,499 @@
+// stream-server-rtsp-standin — local camera stand-in and reconnect harness.
+//
+// Serves a test pattern or a recording over RTSP (gst-rtsp-server) and
+// injects camera faults: stop sending, dropped connection, mid-stream
+// resolution change, restart with a new SPS. In harness mode an in-process
+// RtspPipeline is run against it once per reconnect strategy, transport and
+// fault, and the recovery time and frames lost are reported. With --serve
+// it only serves, taking fault commands on stdin, for testing a full server.
+
+#include "rtsp_standin.hpp"
+#include "rtsp_pipeline.hpp"
+
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using json = nlohmann::json;
+using ss::standin::RtspStandIn;
+using Clock = std::chrono::steady_clock;
+
+static std::atomic<bool> g_interrupted{false};
+
+static void signal_handler(int) {
+    g_interrupted.store(true);
+}
+
+// RtspPipeline reconnect settings under test
+struct Strategy {
+    std::string name;
+    std::string mode;           // rtsp.reconnect_strategy
+    int interval_ms;
+    int max_interval_ms;
+};
+
+static const std::vector<Strategy> all_strategies = {
+    {"fixed-3000", "fixed", 3000, 3000},    // shipped default
+    {"fixed-500", "fixed", 500, 500},
+    {"backoff", "backoff", 250, 8000},
+};
+
+static const std::vector<std::string> all_faults = {"stall", "drop", "resolution", "restart"};
+
+struct Options {
+    ss::standin::StandInConfig standin;
+    std::vector<std::string> strategies;
+    std::vector<std::string> transports = {"tcp", "udp"};
+    std::vector<std::string> faults = all_faults;
+    int stall_ms = 6000;
+    int stall_timeout_ms = 3000;
+    int warmup_s = 3;
+    int recovery_timeout_s = 30;
+    bool reencode = false;
+    bool serve = false;
+    bool json_output = false;
+};
+
+static void print_usage() {
+    std::cout << "Usage: stream-server-rtsp-standin [options]\n"
+              << "Options:\n"
+              << "  -p, --port <port>            RTSP port (default: 8554)\n"
+              << "  -f, --file <path>            Serve a recording instead of the test pattern\n"
+              << "      --size <WxH>             Stream resolution (default: 1280x720)\n"
+              << "      --fps <N>                Frame rate (default: 30)\n"
+              << "      --serve                  Only serve; read fault commands from stdin\n"
+              << "  -s, --strategies <a,b,...>   fixed-3000, fixed-500, backoff (default: all)\n"
+              << "  -t, --transports <a,b>       tcp, udp (default: both)\n"
+              << "      --faults <a,b,...>       stall, drop, resolution, restart (default: all)\n"
+              << "      --stall-ms <ms>          How long the camera goes quiet (default: 6000)\n"
+              << "      --stall-timeout-ms <ms>  Pipeline stall timeout under test (default: 3000)\n"
+              << "      --reencode               Test the re-encode path instead of passthrough\n"
+              << "      --json                   One JSON report per run on stdout\n"
+              << "  -h, --help                   Show this help\n"
+              << "\nServe-mode commands: stall, resume, drop, res <WxH>, restart, reset, quit\n"
+              << "Exit status is 1 if any run did not recover.\n";
+}
+
+static std::vector<std::string> split_list(const std::string& list) {
+    std::vector<std::string> out;
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) out.push_back(item);
+    }
+    return out;
+}
+
+static bool parse_size(const std::string& s, int& width, int& height) {
+    return std::sscanf(s.c_str(), "%dx%d", &width, &height) == 2 && width > 0 && height > 0;
+}
+
+static bool parse_args(int argc, char* argv[], Options& opts) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto next = [&]() -> std::string {
+            if (i + 1 >= argc) throw std::invalid_argument("missing value for " + arg);
+            return argv[++i];
+        };
+
+        if (arg == "-p" || arg == "--port") {
+            opts.standin.port = static_cast<uint16_t>(std::stoi(next()));
+        } else if (arg == "-f" || arg == "--file") {
+            opts.standin.file = next();
+        } else if (arg == "--size") {
+            if (!parse_size(next(), opts.standin.width, opts.standin.height)) {
+                throw std::invalid_argument("size must look like 1280x720");
+            }
+        } else if (arg == "--fps") {
+            opts.standin.fps = std::stoi(next());
+        } else if (arg == "--serve") {
+            opts.serve = true;
+        } else if (arg == "-s" || arg == "--strategies") {
+            opts.strategies = split_list(next());
+            for (auto& name : opts.strategies) {
+                bool known = std::any_of(all_strategies.begin(), all_strategies.end(),
+                                         [&](const Strategy& s) { return s.name == name; });
+                if (!known) throw std::invalid_argument("unknown strategy " + name);
+            }
+        } else if (arg == "-t" || arg == "--transports") {
+            opts.transports = split_list(next());
+            for (auto& t : opts.transports) {
+                if (t != "tcp" && t != "udp") throw std::invalid_argument("unknown transport " + t);
+            }
+        } else if (arg == "--faults") {
+            opts.faults = split_list(next());
+            for (auto& f : opts.faults) {
+                if (std::find(all_faults.begin(), all_faults.end(), f) == all_faults.end()) {
+                    throw std::invalid_argument("unknown fault " + f);
+                }
+            }
+        } else if (arg == "--stall-ms") {
+            opts.stall_ms = std::stoi(next());
+        } else if (arg == "--stall-timeout-ms") {
+            opts.stall_timeout_ms = std::stoi(next());
+        } else if (arg == "--reencode") {
+            opts.reencode = true;
+        } else if (arg == "--json") {
+            opts.json_output = true;
+        } else if (arg == "-h" || arg == "--help") {
+            print_usage();
+            return false;
+        } else {
+            throw std::invalid_argument("unknown option " + arg);
+        }
+    }
+    return true;
+}
+
+static bool sleep_interruptible(std::chrono::milliseconds duration) {
+    auto end = Clock::now() + duration;
+    while (Clock::now() < end) {
+        if (g_interrupted.load()) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    return true;
+}
+
+static double ms_between(Clock::time_point from, Clock::time_point to) {
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+// ─── Receive side ─────────────────────────────────────────────────────────────
+
+// Records when each access unit arrived and when the SPS changed
+class FrameProbe {
+public:
+    void on_frame(const uint8_t* data, size_t size) {
+        auto now = Clock::now();
+        std::lock_guard<std::mutex> lock(mutex_);
+        arrivals_.push_back(now);
+
+        // Access units are Annex-B; look for an SPS (NAL type 7)
+        for (size_t i = 0; i + 3 < size; i++) {
+            if (data[i] != 0 || data[i + 1] != 0 || data[i + 2] != 1) continue;
+            size_t start = i + 3;
+            if ((data[start] & 0x1F) != 7) continue;
+            size_t end = start;
+            while (end + 2 < size && !(data[end] == 0 && data[end + 1] == 0 &&
+                                       (data[end + 2] == 1 || data[end + 2] == 0))) {
+                end++;
+            }
+            if (end + 2 >= size) end = size;
+            std::vector<uint8_t> sps(data + start, data + end);
+            if (!last_sps_.empty() && sps != last_sps_) {
+                sps_changes_.push_back(now);
+            }
+            last_sps_ = std::move(sps);
+            break;
+        }
+    }
+
+    std::vector<Clock::time_point> arrivals() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return arrivals_;
+    }
+
+    // First SPS change at or after `since`
+    bool sps_changed_since(Clock::time_point since, Clock::time_point& when) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto t : sps_changes_) {
+            if (t >= since) {
+                when = t;
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    mutable std::mutex mutex_;
+    std::vector<Clock::time_point> arrivals_;
+    std::vector<Clock::time_point> sps_changes_;
+    std::vector<uint8_t> last_sps_;
+};
+
+// ─── Harness ──────────────────────────────────────────────────────────────────
+
+struct RunResult {
+    std::string transport;
+    std::string strategy;
+    std::string fault;
+    bool recovered = false;
+    std::string error;
+    double recovery_ms = -1;   // fault cleared → first frame of the recovered stream
+    double outage_ms = -1;     // longest frame gap after the fault
+    uint64_t frames_lost = 0;  // frames a steady stream would have delivered in the outage
+    bool new_sps = false;
+    uint64_t reconnects = 0;
+    uint64_t stalls = 0;
+    uint64_t frames_sent = 0;
+    uint64_t frames_received = 0;
+};
+
+static RunResult run_one(const Options& opts, RtspStandIn& standin, const std::string& transport,
+                         const Strategy& strategy, const std::string& fault) {
+    RunResult result;
+    result.transport = transport;
+    result.strategy = strategy.name;
+    result.fault = fault;
+
+    spdlog::info("──── {} / {} / {} ────", transport, strategy.name, fault);
+    standin.reset();
+
+    ss::AppConfig config;
+    config.rtsp.url = standin.url();
+    config.rtsp.transport = transport;
+    config.rtsp.reconnect_strategy = strategy.mode;
+    config.rtsp.reconnect_interval_ms = strategy.interval_ms;
+    config.rtsp.reconnect_max_interval_ms = strategy.max_interval_ms;
+    config.rtsp.stall_timeout_ms = opts.stall_timeout_ms;
+    config.encoding.passthrough = !opts.reencode;
+    config.audio.enabled = false;
+
+    FrameProbe probe;
+    ss::RtspPipeline pipeline(config);
+    pipeline.set_nal_callback([&probe](const uint8_t* data, size_t size, uint64_t, uint64_t) {
+        probe.on_frame(data, size);
+    });
+
+    uint64_t sent_start = standin.frames_sent();
+    pipeline.start();
+
+    auto first_deadline = Clock::now() + std::chrono::seconds(opts.recovery_timeout_s);
+    while (probe.arrivals().empty() && Clock::now() < first_deadline && !g_interrupted.load()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    if (probe.arrivals().empty()) {
+        result.error = "no frames before the fault";
+        pipeline.stop();
+        return result;
+    }
+    sleep_interruptible(std::chrono::seconds(opts.warmup_s));
+    auto before = pipeline.get_stats();
+
+    // ─── Inject ───────────────────────────────────────────────────────────
+    auto fault_at = Clock::now();
+    auto cleared_at = fault_at;
+    bool wants_new_sps = false;
+    if (fault == "stall") {
+        standin.set_sending(false);
+        sleep_interruptible(std::chrono::milliseconds(opts.stall_ms));
+        standin.set_sending(true);
+        cleared_at = Clock::now();
+    } else if (fault == "drop") {
+        standin.drop_connections();
+    } else if (fault == "resolution") {
+        standin.change_resolution((opts.standin.width / 2) & ~1, (opts.standin.height / 2) & ~1);
+        wants_new_sps = true;
+    } else if (fault == "restart") {
+        standin.restart_new_sps();
+        wants_new_sps = true;
+    }
+
+    // ─── Wait for a steady stream again ───────────────────────────────────
+    // Frames buffered before the fault can trickle in after it, so recovery
+    // needs a second of steady frames (and the new SPS where one is due)
+    auto deadline = cleared_at + std::chrono::seconds(opts.recovery_timeout_s);
+    auto frame_interval = std::chrono::milliseconds(1000 / std::max(1, opts.standin.fps));
+    while (Clock::now() < deadline && !g_interrupted.load()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        auto now = Clock::now();
+        auto arrivals = probe.arrivals();
+        size_t recent = std::count_if(arrivals.begin(), arrivals.end(), [&](auto t) {
+            return t > cleared_at && now - t <= std::chrono::seconds(1);
+        });
+        Clock::time_point sps_at;
+        bool sps_ok = !wants_new_sps || probe.sps_changed_since(fault_at, sps_at);
+        if (sps_ok && recent >= static_cast<size_t>(opts.standin.fps / 2) &&
+            now - arrivals.back() < 10 * frame_interval) {
+            result.recovered = true;
+            break;
+        }
+    }
+
+    auto after = pipeline.get_stats();
+    pipeline.stop();
+
+    result.reconnects = after.reconnect_count - before.reconnect_count;
+    result.stalls = after.stalls - before.stalls;
+    result.frames_sent = standin.frames_sent() - sent_start;
+    result.frames_received = after.frames_received;
+
+    // ─── Analyse ──────────────────────────────────────────────────────────
+    // The outage is the longest gap between frames ending after the fault;
+    // recovery is measured from when the fault cleared to the gap's end
+    auto arrivals = probe.arrivals();
+    Clock::time_point gap_start, gap_end;
+    double longest = -1;
+    for (size_t i = 1; i < arrivals.size(); i++) {
+        if (arrivals[i] <= fault_at) continue;
+        double gap = ms_between(arrivals[i - 1], arrivals[i]);
+        if (gap > longest) {
+            longest = gap;
+            gap_start = arrivals[i - 1];
+            gap_end = arrivals[i];
+        }
+    }
+
+    Clock::time_point sps_at;
+    result.new_sps = probe.sps_changed_since(fault_at, sps_at);
+
+    if (!result.recovered) {
+        result.error = wants_new_sps && !result.new_sps ? "new SPS never arrived" : "no steady frames";
+    } else {
+        result.outage_ms = longest;
+        result.recovery_ms = std::max(0.0, ms_between(cleared_at, gap_end));
+        if (wants_new_sps) {
+            // The stream only counts as recovered once the new SPS is in
+            result.recovery_ms = std::max(result.recovery_ms, ms_between(cleared_at, sps_at));
+        }
+        double expected = longest * opts.standin.fps / 1000.0;
+        result.frames_lost = expected > 1.0 ? static_cast<uint64_t>(std::lround(expected - 1.0)) : 0;
+    }
+    return result;
+}
+
+static void report(const Options& opts, const std::vector<RunResult>& results) {
+    if (opts.json_output) {
+        for (auto& r : results) {
+            json j = {
+                {"transport", r.transport}, {"strategy", r.strategy}, {"fault", r.fault},
+                {"recovered", r.recovered}, {"error", r.error},
+                {"recovery_ms", r.recovery_ms}, {"outage_ms", r.outage_ms},
+                {"frames_lost", r.frames_lost}, {"new_sps", r.new_sps},
+                {"reconnects", r.reconnects}, {"stalls", r.stalls},
+                {"frames_sent", r.frames_sent}, {"frames_received", r.frames_received},
+                {"stall_ms", opts.stall_ms}, {"stall_timeout_ms", opts.stall_timeout_ms},
+                {"passthrough", !opts.reencode},
+            };
+            std::cout << j.dump() << std::endl;
+        }
+        return;
+    }
+
+    std::printf("%-5s %-11s %-11s %11s %10s %6s %5s %6s %6s  %s\n",
+                "tport", "strategy", "fault", "recovery_ms", "outage_ms", "lost",
+                "sps", "recon", "stalls", "status");
+    for (auto& r : results) {
+        std::printf("%-5s %-11s %-11s %11.0f %10.0f %6llu %5s %6llu %6llu  %s\n",
+                    r.transport.c_str(), r.strategy.c_str(), r.fault.c_str(),
+                    r.recovery_ms, r.outage_ms, static_cast<unsigned long long>(r.frames_lost),
+                    r.new_sps ? "new" : "-",
+                    static_cast<unsigned long long>(r.reconnects),
+                    static_cast<unsigned long long>(r.stalls),
+                    r.recovered ? "ok" : r.error.c_str());
+    }
+    std::fflush(stdout);
+}
+
+// ─── Serve mode ───────────────────────────────────────────────────────────────
+
+static void serve(RtspStandIn& standin) {
+    std::cerr << "Serving " << standin.url() << " — commands: stall, resume, drop, "
+              << "res <WxH>, restart, reset, quit\n";
+
+    // stdin is read on its own thread so Ctrl-C still ends the loop
+    std::thread reader([&]() {
+        std::string line;
+        while (!g_interrupted.load() && std::getline(std::cin, line)) {
+            std::istringstream in(line);
+            std::string cmd;
+            in >> cmd;
+            if (cmd == "stall") {
+                standin.set_sending(false);
+            } else if (cmd == "resume") {
+                standin.set_sending(true);
+            } else if (cmd == "drop") {
+                standin.drop_connections();
+            } else if (cmd == "res") {
+                std::string size;
+                in >> size;
+                int width = 0, height = 0;
+                if (!parse_size(size, width, height) || !standin.change_resolution(width, height)) {
+                    std::cerr << "res needs WxH and a connected client\n";
+                }
+            } else if (cmd == "restart") {
+                standin.restart_new_sps();
+            } else if (cmd == "reset") {
+                standin.reset();
+            } else if (cmd == "quit") {
+                break;
+            } else if (!cmd.empty()) {
+                std::cerr << "unknown command " << cmd << "\n";
+            }
+        }
+        g_interrupted.store(true);
+    });
+    reader.detach();
+
+    while (!g_interrupted.load()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    spdlog::info("Stand-in sent {} frames", standin.frames_sent());
+}
+
+int main(int argc, char* argv[]) {
+    Options opts;
+    try {
+        if (!parse_args(argc, argv, opts)) return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "ERROR: " << e.what() << "\n\n";
+        print_usage();
+        return 2;
+    }
+
+    // Progress on stderr so stdout stays parseable
+    spdlog::set_default_logger(spdlog::stderr_color_mt("standin"));
+    spdlog::set_pattern("[%H:%M:%S.%e] [%^%l%$] %v");
+
+    gst_init(&argc, &argv);
+
+    std::signal(SIGINT, signal_handler);
+    std::signal(SIGTERM, signal_handler);
+
+    RtspStandIn standin(opts.standin);
+    if (!standin.start()) return 1;
+
+    if (opts.serve) {
+        serve(standin);
+        standin.stop();
+        return 0;
+    }
+
+    std::vector<Strategy> strategies;
+    for (auto& s : all_strategies) {
+        if (opts.strategies.empty() ||
+            std::find(opts.strategies.begin(), opts.strategies.end(), s.name) != opts.strategies.end()) {
+            strategies.push_back(s);
+        }
+    }
+
+    std::vector<RunResult> results;
+    for (auto& transport : opts.transports) {
+        for (auto& strategy : strategies) {
+            for (auto& fault : opts.faults) {
+                if (g_interrupted.load()) break;
+                results.push_back(run_one(opts, standin, transport, strategy, fault));
+                spdlog::info("{} / {} / {}: {}", transport, strategy.name, fault,
+                             results.back().recovered ? "recovered" : results.back().error);
+            }
+        }
+    }
+
+    standin.stop();
+    report(opts, results);
+
+    bool ok = std::all_of(results.begin(), results.end(), [](auto& r) { return r.recovered; });
+    return ok ? 0 : 1;
+}
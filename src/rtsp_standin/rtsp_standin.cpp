@@ -0,0 +1,271 @@
+#include "rtsp_standin.hpp"
+#include <spdlog/spdlog.h>
+#include <future>
+
+namespace ss::standin {
+
+RtspStandIn::RtspStandIn(StandInConfig config)
+    : config_(std::move(config)) {}
+
+RtspStandIn::~RtspStandIn() {
+    stop();
+}
+
+bool RtspStandIn::start() {
+    if (loop_) return true;
+
+    context_ = g_main_context_new();
+    loop_ = g_main_loop_new(context_, FALSE);
+    server_ = gst_rtsp_server_new();
+    gst_rtsp_server_set_service(server_, std::to_string(config_.port).c_str());
+
+    factory_ = gst_rtsp_media_factory_new();
+    {
+        std::lock_guard<std::mutex> lock(media_mutex_);
+        gst_rtsp_media_factory_set_launch(factory_, launch_description().c_str());
+    }
+    // One encoder for every client, like a camera
+    gst_rtsp_media_factory_set_shared(factory_, TRUE);
+    g_signal_connect(factory_, "media-configure", G_CALLBACK(&RtspStandIn::on_media_configure), this);
+
+    // The mount points take a reference; ours is kept for set_launch
+    GstRTSPMountPoints* mounts = gst_rtsp_server_get_mount_points(server_);
+    gst_rtsp_mount_points_add_factory(mounts, config_.mount.c_str(),
+                                      GST_RTSP_MEDIA_FACTORY(g_object_ref(factory_)));
+    g_object_unref(mounts);
+
+    source_id_ = gst_rtsp_server_attach(server_, context_);
+    if (source_id_ == 0) {
+        spdlog::error("Stand-in: cannot listen on port {}", config_.port);
+        g_object_unref(factory_);
+        g_object_unref(server_);
+        g_main_loop_unref(loop_);
+        g_main_context_unref(context_);
+        factory_ = nullptr;
+        server_ = nullptr;
+        loop_ = nullptr;
+        context_ = nullptr;
+        return false;
+    }
+
+    thread_ = std::thread([this]() { g_main_loop_run(loop_); });
+
+    spdlog::info("Stand-in camera at {} ({}, {}x{}@{})", url(),
+                 config_.file.empty() ? "test pattern" : config_.file,
+                 config_.width, config_.height, config_.fps);
+    return true;
+}
+
+void RtspStandIn::stop() {
+    if (!loop_) return;
+
+    run_in_context([this]() { close_clients(); });
+    g_main_loop_quit(loop_);
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+
+    if (GSource* source = g_main_context_find_source_by_id(context_, source_id_)) {
+        g_source_destroy(source);
+    }
+    {
+        std::lock_guard<std::mutex> lock(media_mutex_);
+        if (media_) {
+            g_object_unref(media_);
+            media_ = nullptr;
+        }
+    }
+    g_object_unref(factory_);
+    g_object_unref(server_);
+    g_main_loop_unref(loop_);
+    g_main_context_unref(context_);
+    factory_ = nullptr;
+    server_ = nullptr;
+    loop_ = nullptr;
+    context_ = nullptr;
+    source_id_ = 0;
+}
+
+std::string RtspStandIn::url() const {
+    return "rtsp://127.0.0.1:" + std::to_string(config_.port) + config_.mount;
+}
+
+std::string RtspStandIn::launch_description() const {
+    // The alternate settings give the restarted "camera" a different SPS
+    bool alternate = generation_ % 2 == 1;
+    int width = alternate ? (config_.width * 3 / 4) & ~1 : config_.width;
+    int height = alternate ? (config_.height * 3 / 4) & ~1 : config_.height;
+
+    std::string source = config_.file.empty()
+        ? "videotestsrc is-live=true pattern=ball ! "
+        : "filesrc location=" + config_.file + " ! decodebin ! ";
+
+    // videoscale ahead of the capsfilter lets change_resolution() renegotiate
+    // in place; the valve after the encoder is the "stop sending" switch
+    return "( " + source +
+        "videoconvert ! videoscale ! videorate ! "
+        "capsfilter name=res caps=video/x-raw,"
+        "width=" + std::to_string(width) + ",height=" + std::to_string(height) + ","
+        "framerate=" + std::to_string(config_.fps) + "/1 ! "
+        "x264enc tune=zerolatency speed-preset=ultrafast bframes=0 "
+        "bitrate=" + std::to_string(config_.bitrate_kbps) + " "
+        "key-int-max=" + std::to_string(config_.idr_interval) + " ! "
+        "video/x-h264,profile=" + (alternate ? "main" : "baseline") + " ! "
+        "valve name=fault drop=" + (sending_ ? "false" : "true") + " ! "
+        "rtph264pay name=pay0 pt=96 config-interval=1 )";
+}
+
+GstElement* RtspStandIn::find_element(const char* name) {
+    std::lock_guard<std::mutex> lock(media_mutex_);
+    if (!media_) return nullptr;
+
+    GstElement* bin = gst_rtsp_media_get_element(media_);
+    GstElement* element = gst_bin_get_by_name(GST_BIN(bin), name);
+    gst_object_unref(bin);
+    return element;
+}
+
+void RtspStandIn::run_in_context(std::function<void()> fn) {
+    // Client and session bookkeeping belongs to the server's main loop
+    struct Call {
+        std::function<void()> fn;
+        std::promise<void> done;
+    };
+    Call call{std::move(fn), {}};
+    auto done = call.done.get_future();
+
+    g_main_context_invoke(context_, [](gpointer data) -> gboolean {
+        auto* c = static_cast<Call*>(data);
+        c->fn();
+        c->done.set_value();
+        return G_SOURCE_REMOVE;
+    }, &call);
+    done.wait();
+}
+
+int RtspStandIn::close_clients() {
+    int closed = 0;
+    GList* kept = gst_rtsp_server_client_filter(server_,
+        [](GstRTSPServer*, GstRTSPClient*, gpointer data) -> GstRTSPFilterResult {
+            (*static_cast<int*>(data))++;
+            return GST_RTSP_FILTER_REMOVE;
+        }, &closed);
+    g_list_free_full(kept, g_object_unref);
+
+    // Without their sessions the shared media is unprepared right away
+    // instead of lingering until the session timeout
+    GstRTSPSessionPool* pool = gst_rtsp_server_get_session_pool(server_);
+    GList* sessions = gst_rtsp_session_pool_filter(pool,
+        [](GstRTSPSessionPool*, GstRTSPSession*, gpointer) -> GstRTSPFilterResult {
+            return GST_RTSP_FILTER_REMOVE;
+        }, nullptr);
+    g_list_free_full(sessions, g_object_unref);
+    g_object_unref(pool);
+
+    return closed;
+}
+
+// ─── Faults ───────────────────────────────────────────────────────────────────
+
+void RtspStandIn::set_sending(bool sending) {
+    {
+        std::lock_guard<std::mutex> lock(media_mutex_);
+        sending_ = sending;
+    }
+    if (GstElement* valve = find_element("fault")) {
+        g_object_set(valve, "drop", sending ? FALSE : TRUE, nullptr);
+        gst_object_unref(valve);
+    }
+    spdlog::info("Stand-in: {} sending", sending ? "resumed" : "stopped");
+}
+
+int RtspStandIn::drop_connections() {
+    int closed = 0;
+    run_in_context([&]() { closed = close_clients(); });
+    spdlog::info("Stand-in: dropped {} connection(s)", closed);
+    return closed;
+}
+
+bool RtspStandIn::change_resolution(int width, int height) {
+    GstElement* filter = find_element("res");
+    if (!filter) return false;
+
+    GstCaps* caps = gst_caps_new_simple("video/x-raw",
+        "width", G_TYPE_INT, width,
+        "height", G_TYPE_INT, height,
+        "framerate", GST_TYPE_FRACTION, config_.fps, 1,
+        nullptr);
+    g_object_set(filter, "caps", caps, nullptr);
+    gst_caps_unref(caps);
+    gst_object_unref(filter);
+
+    spdlog::info("Stand-in: resolution changed to {}x{}", width, height);
+    return true;
+}
+
+int RtspStandIn::restart_new_sps() {
+    int closed = 0;
+    run_in_context([&]() {
+        GstRTSPMedia* media = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(media_mutex_);
+            generation_++;
+            gst_rtsp_media_factory_set_launch(factory_, launch_description().c_str());
+            media = media_ ? GST_RTSP_MEDIA(g_object_ref(media_)) : nullptr;
+        }
+        closed = close_clients();
+        if (media) {
+            gst_rtsp_media_unprepare(media);
+            g_object_unref(media);
+        }
+    });
+    spdlog::info("Stand-in: restarted with new encoder settings ({} connection(s) dropped)",
+                 closed);
+    return closed;
+}
+
+void RtspStandIn::reset() {
+    {
+        std::lock_guard<std::mutex> lock(media_mutex_);
+        generation_ = 0;
+        sending_ = true;
+        gst_rtsp_media_factory_set_launch(factory_, launch_description().c_str());
+    }
+    // A media still prepared from an earlier run gets the same treatment
+    if (GstElement* valve = find_element("fault")) {
+        g_object_set(valve, "drop", FALSE, nullptr);
+        gst_object_unref(valve);
+    }
+    change_resolution(config_.width, config_.height);
+}
+
+// ─── Callbacks ────────────────────────────────────────────────────────────────
+
+void RtspStandIn::on_media_configure(GstRTSPMediaFactory*, GstRTSPMedia* media,
+                                     gpointer user_data) {
+    auto* self = static_cast<RtspStandIn*>(user_data);
+
+    GstElement* bin = gst_rtsp_media_get_element(media);
+    if (GstElement* valve = gst_bin_get_by_name(GST_BIN(bin), "fault")) {
+        GstPad* pad = gst_element_get_static_pad(valve, "src");
+        gst_pad_add_probe(pad, GST_PAD_PROBE_TYPE_BUFFER, &RtspStandIn::on_frame_sent,
+                          self, nullptr);
+        gst_object_unref(pad);
+        gst_object_unref(valve);
+    }
+    gst_object_unref(bin);
+
+    std::lock_guard<std::mutex> lock(self->media_mutex_);
+    if (self->media_) {
+        g_object_unref(self->media_);
+    }
+    self->media_ = GST_RTSP_MEDIA(g_object_ref(media));
+    spdlog::debug("Stand-in: media configured (generation {})", self->generation_);
+}
+
+GstPadProbeReturn RtspStandIn::on_frame_sent(GstPad*, GstPadProbeInfo*, gpointer user_data) {
+    static_cast<RtspStandIn*>(user_data)->frames_sent_++;
+    return GST_PAD_PROBE_OK;
+}
+
+} // namespace ss::standin
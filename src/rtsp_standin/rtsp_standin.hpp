@@ -0,0 +1,92 @@
+#pragma once
+
+#include <gst/gst.h>
+#include <gst/rtsp-server/rtsp-server.h>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace ss::standin {
+
+struct StandInConfig {
+    uint16_t port = 8554;
+    std::string mount = "/cam";
+    std::string file;           // decoded and re-encoded once; empty = test pattern
+    int width = 1280;
+    int height = 720;
+    int fps = 30;
+    int idr_interval = 30;
+    int bitrate_kbps = 2000;
+};
+
+// Local RTSP server standing in for an IP camera. Serves one shared H.264
+// stream and can misbehave on request the way real cameras do.
+class RtspStandIn {
+public:
+    explicit RtspStandIn(StandInConfig config);
+    ~RtspStandIn();
+
+    // Non-copyable
+    RtspStandIn(const RtspStandIn&) = delete;
+    RtspStandIn& operator=(const RtspStandIn&) = delete;
+
+    bool start();
+    void stop();
+
+    std::string url() const;
+
+    // ─── Faults ───────────────────────────────────────────────────────────
+    // Stop / resume sending RTP while keeping the RTSP session open
+    void set_sending(bool sending);
+
+    // Close every client's RTSP connection and drop their sessions.
+    // Returns the number of clients closed.
+    int drop_connections();
+
+    // Rescale the stream without interrupting it; the encoder starts a new
+    // GOP with a new SPS in-band
+    bool change_resolution(int width, int height);
+
+    // Simulate a camera reboot with different encoder settings: drop every
+    // client and tear the stream down; the next session gets another
+    // resolution and profile, so its SPS differs. Returns clients closed.
+    int restart_new_sps();
+
+    // Back to the configured resolution and profile, sending enabled
+    void reset();
+
+    uint64_t frames_sent() const { return frames_sent_.load(); }
+
+private:
+    std::string launch_description() const;
+    GstElement* find_element(const char* name);
+    void run_in_context(std::function<void()> fn);
+    int close_clients();
+
+    static void on_media_configure(GstRTSPMediaFactory* factory, GstRTSPMedia* media,
+                                   gpointer user_data);
+    static GstPadProbeReturn on_frame_sent(GstPad* pad, GstPadProbeInfo* info,
+                                           gpointer user_data);
+
+    StandInConfig config_;
+
+    GMainContext* context_ = nullptr;
+    GMainLoop* loop_ = nullptr;
+    GstRTSPServer* server_ = nullptr;
+    GstRTSPMediaFactory* factory_ = nullptr;
+    guint source_id_ = 0;
+    std::thread thread_;
+
+    // Current shared media, replaced on every media-configure
+    std::mutex media_mutex_;
+    GstRTSPMedia* media_ = nullptr;
+    int generation_ = 0;        // odd = alternate resolution and profile
+    bool sending_ = true;
+
+    std::atomic<uint64_t> frames_sent_{0};
+};
+
+} // namespace ss::standin
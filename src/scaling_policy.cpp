@@ -0,0 +1,73 @@
+#include "scaling_policy.hpp"
+#include <algorithm>
+#include <cstdio>
+
+namespace ss {
+
+std::string Resolution::str() const {
+    return std::to_string(width) + "x" + std::to_string(height);
+}
+
+bool operator==(const Resolution& a, const Resolution& b) {
+    return a.width == b.width && a.height == b.height;
+}
+
+bool operator!=(const Resolution& a, const Resolution& b) {
+    return !(a == b);
+}
+
+ScalingPolicy::ScalingPolicy(const ScalingConfig& config)
+    : min_bits_per_pixel_(config.min_bits_per_pixel)
+    , up_bits_per_pixel_(std::max(config.up_bits_per_pixel, config.min_bits_per_pixel))
+{
+    for (auto& entry : config.ladder) {
+        Resolution r;
+        if (parse(entry, r)) ladder_.push_back(r);
+    }
+    std::sort(ladder_.begin(), ladder_.end(),
+              [](const Resolution& a, const Resolution& b) { return a.pixels() > b.pixels(); });
+}
+
+std::vector<Resolution> ScalingPolicy::rungs(Resolution source) const {
+    std::vector<Resolution> result{source};
+    for (auto& r : ladder_) {
+        if (r.pixels() < source.pixels()) result.push_back(r);
+    }
+    return result;
+}
+
+Resolution ScalingPolicy::choose(int bitrate_kbps, int fps, Resolution source,
+                                 Resolution current) const {
+    auto candidates = rungs(source);
+    size_t index = 0;
+    for (size_t i = 0; i < candidates.size(); i++) {
+        if (candidates[i] == current) index = i;
+    }
+
+    while (index + 1 < candidates.size() &&
+           bits_per_pixel(bitrate_kbps, fps, candidates[index]) < min_bits_per_pixel_) {
+        index++;
+    }
+    while (index > 0 &&
+           bits_per_pixel(bitrate_kbps, fps, candidates[index - 1]) >= up_bits_per_pixel_) {
+        index--;
+    }
+    return candidates[index];
+}
+
+double ScalingPolicy::bits_per_pixel(int bitrate_kbps, int fps, Resolution resolution) {
+    if (resolution.empty() || fps <= 0) return 0.0;
+    return bitrate_kbps * 1000.0 / (static_cast<double>(resolution.pixels()) * fps);
+}
+
+bool ScalingPolicy::parse(const std::string& text, Resolution& resolution) {
+    int width = 0, height = 0;
+    char tail = 0;
+    if (std::sscanf(text.c_str(), "%dx%d%c", &width, &height, &tail) != 2) return false;
+    // 4:2:0 needs even dimensions
+    if (width <= 0 || height <= 0 || width % 2 || height % 2) return false;
+    resolution = {width, height};
+    return true;
+}
+
+} // namespace ss
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "config.hpp"
+#include <string>
+#include <vector>
+
+namespace ss {
+
+struct Resolution {
+    int width = 0;
+    int height = 0;
+
+    int64_t pixels() const { return static_cast<int64_t>(width) * height; }
+    bool empty() const { return width <= 0 || height <= 0; }
+    std::string str() const;
+};
+
+bool operator==(const Resolution& a, const Resolution& b);
+bool operator!=(const Resolution& a, const Resolution& b);
+
+// Picks the re-encode resolution for a target bitrate from the bits each
+// pixel gets per frame. Too few bits at full size gives blocky mush; the
+// same bits spent on fewer pixels look sharper once the browser upscales.
+//
+// The rungs are the source resolution followed by every ladder entry
+// smaller than it, so the policy never upscales. Stepping up needs more
+// bits per pixel than stepping down (up_bits_per_pixel), which keeps a
+// bitrate near a threshold from flapping between two rungs.
+class ScalingPolicy {
+public:
+    explicit ScalingPolicy(const ScalingConfig& config);
+
+    std::vector<Resolution> rungs(Resolution source) const;
+
+    // Resolution for `bitrate_kbps` starting from `current` (empty = source)
+    Resolution choose(int bitrate_kbps, int fps, Resolution source, Resolution current) const;
+
+    static double bits_per_pixel(int bitrate_kbps, int fps, Resolution resolution);
+
+    // "1280x720"
+    static bool parse(const std::string& text, Resolution& resolution);
+
+private:
+    std::vector<Resolution> ladder_;    // largest first
+    double min_bits_per_pixel_;
+    double up_bits_per_pixel_;
+};
+
+} // namespace ss
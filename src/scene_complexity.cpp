@@ -0,0 +1,71 @@
+#include "scene_complexity.hpp"
+#include <algorithm>
+
+namespace ss {
+
+// IDRs are rare, so each one carries more weight than a window of P-frames
+static constexpr double idr_alpha = 0.5;
+static constexpr double p_frame_alpha = 0.3;
+
+SceneComplexity::SceneComplexity(const ContentAdaptiveConfig& config)
+    : config_(config)
+{
+}
+
+void SceneComplexity::update_config(const ContentAdaptiveConfig& config) {
+    config_ = config;
+}
+
+bool SceneComplexity::on_frame(size_t bytes, bool keyframe,
+                               std::chrono::steady_clock::time_point now) {
+    if (keyframe) {
+        estimate_.idr_bytes = estimate_.idr_bytes > 0.0
+            ? estimate_.idr_bytes + idr_alpha * (static_cast<double>(bytes) - estimate_.idr_bytes)
+            : static_cast<double>(bytes);
+    } else {
+        window_p_bytes_ += bytes;
+        window_p_frames_++;
+    }
+
+    if (!window_open_) {
+        window_open_ = true;
+        window_start_ = now;
+        return false;
+    }
+    if (now - window_start_ < std::chrono::milliseconds(std::max(config_.window_ms, 100))) {
+        return false;
+    }
+
+    bool updated = false;
+    if (window_p_frames_ > 0) {
+        double mean = static_cast<double>(window_p_bytes_) / static_cast<double>(window_p_frames_);
+        estimate_.p_frame_bytes = estimate_.p_frame_bytes > 0.0
+            ? estimate_.p_frame_bytes + p_frame_alpha * (mean - estimate_.p_frame_bytes)
+            : mean;
+
+        if (estimate_.idr_bytes > 0.0) {
+            estimate_.p_ratio = estimate_.p_frame_bytes / estimate_.idr_bytes;
+            double span = config_.motion_ratio - config_.static_ratio;
+            estimate_.score = span > 0.0
+                ? std::clamp((estimate_.p_ratio - config_.static_ratio) / span, 0.0, 1.0)
+                : (estimate_.p_ratio > config_.static_ratio ? 1.0 : 0.0);
+            estimate_.valid = true;
+            estimate_.windows++;
+            updated = true;
+        }
+    }
+
+    window_start_ = now;
+    window_p_bytes_ = 0;
+    window_p_frames_ = 0;
+    return updated;
+}
+
+void SceneComplexity::reset() {
+    estimate_ = {};
+    window_open_ = false;
+    window_p_bytes_ = 0;
+    window_p_frames_ = 0;
+}
+
+} // namespace ss
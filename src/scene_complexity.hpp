@@ -0,0 +1,55 @@
+#pragma once
+
+#include "config.hpp"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace ss {
+
+// Estimates how much the picture changes from the encoded frame sizes alone.
+// An IDR costs what the scene's detail costs; a P-frame costs what changed
+// since the previous frame. Their ratio is near zero for a parked robot
+// facing a wall and climbs toward one in fast motion. Both sizes move
+// together with the encoder's bitrate, so the ratio stays put when the
+// policy acts on it.
+//
+// The encoders' per-frame QP is not exposed by GStreamer, so it is not used.
+// Under intra refresh the IDR reference comes from the IDRs sent for new
+// viewers and PLIs; until one is seen there is no estimate.
+class SceneComplexity {
+public:
+    struct Estimate {
+        bool valid = false;         // an IDR and a window of P-frames seen
+        double score = 0.0;         // 0 = static … 1 = full motion
+        double p_ratio = 0.0;       // mean P-frame / mean IDR size
+        double p_frame_bytes = 0.0;
+        double idr_bytes = 0.0;
+        uint64_t windows = 0;       // estimates made
+    };
+
+    explicit SceneComplexity(const ContentAdaptiveConfig& config);
+
+    void update_config(const ContentAdaptiveConfig& config);
+
+    // One encoded access unit. Returns true when it closed a window and a
+    // new estimate is available.
+    bool on_frame(size_t bytes, bool keyframe,
+                  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+
+    Estimate estimate() const { return estimate_; }
+
+    // Forget the reference sizes (new source or encoder)
+    void reset();
+
+private:
+    ContentAdaptiveConfig config_;
+    Estimate estimate_;
+
+    std::chrono::steady_clock::time_point window_start_;
+    bool window_open_ = false;
+    uint64_t window_p_bytes_ = 0;
+    uint64_t window_p_frames_ = 0;
+};
+
+} // namespace ss
@@ -16,20 +16,32 @@ SignalingServer::~SignalingServer() {
     stop();
 }
 
-bool SignalingServer::start() {
-    try {
-        rtc::WebSocketServer::Configuration ws_config;
-        ws_config.port = config_.server.signaling_port;
-        ws_config.enableTls = false;
+void SignalingServer::update_config(const AppConfig& config) {
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    config_ = config;
+}
 
-        ws_server_ = std::make_shared<rtc::WebSocketServer>(ws_config);
+// New listening server on the configured port (throws if it cannot bind)
+std::shared_ptr<rtc::WebSocketServer> SignalingServer::listen() {
+    rtc::WebSocketServer::Configuration ws_config;
+    {
+        std::lock_guard<std::mutex> lock(config_mutex_);
+        ws_config.port = config_.server.signaling_port;
+    }
+    ws_config.enableTls = false;
 
-        ws_server_->onClient([this](std::shared_ptr<rtc::WebSocket> ws) {
-            on_client_connected(ws);
-        });
+    auto server = std::make_shared<rtc::WebSocketServer>(ws_config);
+    server->onClient([this](std::shared_ptr<rtc::WebSocket> ws) {
+        on_client_connected(ws);
+    });
+    spdlog::info("Signaling server listening on ws://0.0.0.0:{}", ws_config.port);
+    return server;
+}
 
+bool SignalingServer::start() {
+    try {
+        ws_server_ = listen();
         running_.store(true);
-        spdlog::info("Signaling server listening on ws://0.0.0.0:{}", config_.server.signaling_port);
         return true;
 
     } catch (const std::exception& e) {
@@ -38,6 +50,24 @@ bool SignalingServer::start() {
     }
 }
 
+bool SignalingServer::rebind() {
+    std::shared_ptr<rtc::WebSocketServer> server;
+    try {
+        server = listen();
+    } catch (const std::exception& e) {
+        spdlog::error("Failed to move signaling server, still on the old port: {}", e.what());
+        return false;
+    }
+
+    // Only the listening socket goes; accepted sessions are not its own
+    if (ws_server_) {
+        ws_server_->stop();
+    }
+    ws_server_ = std::move(server);
+    running_.store(true);
+    return true;
+}
+
 void SignalingServer::stop() {
     running_.store(false);
 
@@ -60,6 +90,8 @@ void SignalingServer::stop() {
 }
 
 void SignalingServer::on_client_connected(std::shared_ptr<rtc::WebSocket> ws) {
+    // Start of the client's setup timeline
+    auto accepted_at = std::chrono::steady_clock::now();
     auto ws_weak = std::weak_ptr<rtc::WebSocket>(ws);
 
     // Signaling callback: sends offer/answer/candidate to the browser
@@ -77,6 +109,9 @@ void SignalingServer::on_client_connected(std::shared_ptr<rtc::WebSocket> ws) {
                 } catch (...) {
                     msg["data"] = payload;
                 }
+            } else if (type == "timeline") {
+                auto timeline = json::parse(payload, nullptr, false);
+                if (timeline.is_object()) msg.update(timeline);
             }
 
             try {
@@ -88,7 +123,7 @@ void SignalingServer::on_client_connected(std::shared_ptr<rtc::WebSocket> ws) {
     };
 
     // Create WebRTC peer
-    std::string peer_id = webrtc_server_.create_peer(std::move(sig_cb));
+    std::string peer_id = webrtc_server_.create_peer(std::move(sig_cb), accepted_at);
 
     if (peer_id.empty()) {
         spdlog::warn("Rejected client: max peers reached");
@@ -110,17 +145,25 @@ void SignalingServer::on_client_connected(std::shared_ptr<rtc::WebSocket> ws) {
     welcome["peerId"] = peer_id;
 
     json ice_servers = json::array();
-    if (!config_.webrtc.stun_server.empty()) {
-        ice_servers.push_back({{"urls", config_.webrtc.stun_server}});
-    }
-    if (!config_.webrtc.turn_server.empty()) {
-        json turn;
-        turn["urls"] = config_.webrtc.turn_server;
-        turn["username"] = config_.webrtc.turn_username;
-        turn["credential"] = config_.webrtc.turn_credential;
-        ice_servers.push_back(turn);
+    {
+        std::lock_guard<std::mutex> lock(config_mutex_);
+        if (!config_.webrtc.stun_server.empty()) {
+            ice_servers.push_back({{"urls", config_.webrtc.stun_server}});
+        }
+        if (!config_.webrtc.turn_server.empty()) {
+            json turn;
+            turn["urls"] = config_.webrtc.turn_server;
+            turn["username"] = config_.webrtc.turn_username;
+            turn["credential"] = config_.webrtc.turn_credential;
+            ice_servers.push_back(turn);
+        }
     }
     welcome["iceServers"] = ice_servers;
+    {
+        // Host pages embed.html takes control commands from (and replies to)
+        std::lock_guard<std::mutex> lock(config_mutex_);
+        welcome["controlOrigins"] = config_.control.embed_origins;
+    }
 
     try {
         ws->send(welcome.dump());
@@ -187,8 +230,39 @@ void SignalingServer::on_client_message(const std::string& peer_id,
             int bitrate = msg.value("bitrate_kbps", 0);
             if (bitrate > 0 && bitrate_cb_) {
                 spdlog::debug("[{}] ABR request: {} kbps", peer_id, bitrate);
-                bitrate_cb_(bitrate);
+                bitrate_cb_(peer_id, bitrate);
             }
+        } else if (type == "set_roi") {
+            // Fractions of the frame; no rectangle = the whole frame
+            Roi roi;
+            roi.x = msg.value("x", 0.0);
+            roi.y = msg.value("y", 0.0);
+            roi.width = msg.value("width", 1.0);
+            roi.height = msg.value("height", 1.0);
+
+            std::string error = "ROI not supported";
+            bool ok = roi_cb_ && roi_cb_(peer_id, roi, error);
+            json reply;
+            reply["type"] = "roi";
+            reply["ok"] = ok;
+            if (!ok) {
+                reply["error"] = error;
+                spdlog::info("[{}] ROI request refused: {}", peer_id, error);
+            }
+            ws->send(reply.dump());
+        } else if (type == "set_stream") {
+            std::string stream = msg.value("stream", "main");
+            std::string error = "stream switching not supported";
+            bool ok = stream_cb_ && stream_cb_(peer_id, stream, error);
+            json reply;
+            reply["type"] = "stream";
+            reply["ok"] = ok;
+            reply["stream"] = stream;
+            if (!ok) {
+                reply["error"] = error;
+                spdlog::info("[{}] Stream request refused: {}", peer_id, error);
+            }
+            ws->send(reply.dump());
         } else {
             spdlog::debug("[{}] Unknown message type: {}", peer_id, type);
         }
@@ -204,10 +278,35 @@ void SignalingServer::on_client_disconnected(const std::string& peer_id) {
         clients_.erase(peer_id);
     }
 
+    if (roi_cb_) {
+        std::string error;
+        roi_cb_(peer_id, Roi{}, error);
+    }
+
     webrtc_server_.remove_peer(peer_id);
     spdlog::info("Client disconnected: {}", peer_id);
 }
 
+bool SignalingServer::disconnect_peer(const std::string& peer_id) {
+    std::shared_ptr<rtc::WebSocket> ws;
+    {
+        std::lock_guard<std::mutex> lock(clients_mutex_);
+        auto it = clients_.find(peer_id);
+        if (it == clients_.end()) return false;
+        ws = it->second.ws;
+        clients_.erase(it);
+    }
+
+    webrtc_server_.remove_peer(peer_id);
+    if (ws) {
+        try {
+            ws->close();
+        } catch (...) {}
+    }
+    spdlog::info("Client disconnected by admin: {}", peer_id);
+    return true;
+}
+
 void SignalingServer::send_json(std::shared_ptr<rtc::WebSocket> ws,
                                  const std::string& type,
                                  const std::string& peer_id,
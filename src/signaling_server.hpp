@@ -1,6 +1,7 @@
 #pragma once
 
 #include "config.hpp"
+#include "roi.hpp"
 #include "webrtc_server.hpp"
 #include <rtc/rtc.hpp>
 #include <functional>
@@ -25,13 +26,39 @@ public:
     bool start();
     void stop();
 
+    // Listen on the configured port instead of the current one. Open
+    // sessions and their peers stay; on failure the old port is kept.
+    bool rebind();
+
     bool is_running() const { return running_.load(); }
 
+    // ICE servers in the welcome message follow the new config right away;
+    // a port change only takes effect on the next start() or rebind()
+    void update_config(const AppConfig& config);
+
+    // Close a client's signaling session and its peer connection.
+    // Returns false if no session exists for the peer.
+    bool disconnect_peer(const std::string& peer_id);
+
     // Set callback for adaptive bitrate requests from clients
-    using BitrateCallback = std::function<void(int bitrate_kbps)>;
+    using BitrateCallback = std::function<void(const std::string& peer_id, int bitrate_kbps)>;
     void set_bitrate_callback(BitrateCallback cb) { bitrate_cb_ = std::move(cb); }
 
+    // Set callback for region-of-interest (digital zoom) requests. The whole
+    // frame means back to the main stream; it is also sent on disconnect.
+    // Returns false with `error` if the region cannot be served.
+    using RoiCallback = std::function<bool(const std::string& peer_id, const Roi& roi,
+                                           std::string& error)>;
+    void set_roi_callback(RoiCallback cb) { roi_cb_ = std::move(cb); }
+
+    // Set callback for switching a viewer to a named stream ("mosaic") or
+    // back to "main". Returns false with `error` if it cannot be served.
+    using StreamCallback = std::function<bool(const std::string& peer_id, const std::string& stream,
+                                              std::string& error)>;
+    void set_stream_callback(StreamCallback cb) { stream_cb_ = std::move(cb); }
+
 private:
+    std::shared_ptr<rtc::WebSocketServer> listen();
     void on_client_connected(std::shared_ptr<rtc::WebSocket> ws);
     void on_client_message(const std::string& peer_id,
                            std::shared_ptr<rtc::WebSocket> ws,
@@ -45,6 +72,7 @@ private:
                    const std::string& payload);
 
     AppConfig config_;
+    std::mutex config_mutex_;
     WebRtcServer& webrtc_server_;
     std::shared_ptr<rtc::WebSocketServer> ws_server_;
 
@@ -58,6 +86,8 @@ private:
 
     std::atomic<bool> running_{false};
     BitrateCallback bitrate_cb_;
+    RoiCallback roi_cb_;
+    StreamCallback stream_cb_;
 };
 
 } // namespace ss
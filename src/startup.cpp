@@ -0,0 +1,82 @@
+#include "startup.hpp"
+#include <spdlog/spdlog.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+
+namespace ss {
+
+StartupTimer::StartupTimer() : start_(Clock::now()), last_(start_) {}
+
+void StartupTimer::mark(const std::string& phase) {
+    auto now = Clock::now();
+    double phase_ms, total_ms;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        phase_ms = std::chrono::duration<double, std::milli>(now - last_).count();
+        total_ms = std::chrono::duration<double, std::milli>(now - start_).count();
+        last_ = now;
+    }
+    spdlog::info("Startup: {:<20} {:7.1f} ms (total {:.1f} ms)", phase, phase_ms, total_ms);
+}
+
+double StartupTimer::elapsed_ms() const {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start_).count();
+}
+
+void configure_gstreamer(const StartupConfig& config) {
+    if (!config.gst_registry.empty()) {
+        setenv("GST_REGISTRY_1_0", config.gst_registry.c_str(), 0);
+    }
+
+    // Without a rescan GStreamer only maps the cache file. A missing cache
+    // still has to be built once, so the first boot always scans.
+    if (!config.gst_registry_update) {
+        struct stat st {};
+        if (config.gst_registry.empty()) {
+            spdlog::warn("startup.gst_registry_update is off but no gst_registry is set, "
+                         "plugins will be rescanned");
+        } else if (stat(config.gst_registry.c_str(), &st) == 0) {
+            setenv("GST_REGISTRY_UPDATE", "no", 0);
+        } else {
+            spdlog::info("GStreamer registry {} not found, building it", config.gst_registry);
+        }
+    }
+
+    if (!config.gst_plugin_path.empty()) {
+        setenv("GST_PLUGIN_SYSTEM_PATH_1_0", config.gst_plugin_path.c_str(), 0);
+    }
+}
+
+bool notify_systemd(const std::string& state) {
+    const char* path = std::getenv("NOTIFY_SOCKET");
+    if (!path || (path[0] != '/' && path[0] != '@')) return false;
+
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    size_t len = std::strlen(path);
+    if (len >= sizeof(addr.sun_path)) return false;
+    std::memcpy(addr.sun_path, path, len);
+    if (path[0] == '@') addr.sun_path[0] = '\0'; // abstract namespace
+
+    int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return false;
+    auto addr_len = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + len);
+    ssize_t sent = sendto(fd, state.data(), state.size(), MSG_NOSIGNAL,
+                          reinterpret_cast<sockaddr*>(&addr), addr_len);
+    close(fd);
+
+    if (sent != static_cast<ssize_t>(state.size())) {
+        spdlog::warn("sd_notify {} failed: {}", state, std::strerror(errno));
+        return false;
+    }
+    spdlog::debug("sd_notify: {}", state);
+    return true;
+}
+
+} // namespace ss
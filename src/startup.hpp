@@ -0,0 +1,42 @@
+#pragma once
+
+#include "config.hpp"
+#include <chrono>
+#include <mutex>
+#include <string>
+
+namespace ss {
+
+// Times the boot sequence: each mark() logs how long the phase took and
+// how long the server has been starting.
+class StartupTimer {
+public:
+    StartupTimer();
+
+    // Non-copyable
+    StartupTimer(const StartupTimer&) = delete;
+    StartupTimer& operator=(const StartupTimer&) = delete;
+
+    // End of a phase (thread-safe: the first frame arrives on the pipeline thread)
+    void mark(const std::string& phase);
+
+    double elapsed_ms() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    Clock::time_point start_;
+    mutable std::mutex mutex_;
+    Clock::time_point last_;
+};
+
+// Point GStreamer at a persistent registry and plugin directory. Must run
+// before gst_init; variables already set in the environment win.
+void configure_gstreamer(const StartupConfig& config);
+
+// Send a state string ("READY=1", "STATUS=...", "STOPPING=1") to systemd
+// over $NOTIFY_SOCKET, as sd_notify(3) does, without linking libsystemd.
+// Returns false if not run under Type=notify or the send failed.
+bool notify_systemd(const std::string& state);
+
+} // namespace ss
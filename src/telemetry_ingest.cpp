@@ -0,0 +1,119 @@
+#include "telemetry_ingest.hpp"
+#include <spdlog/spdlog.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <cstring>
+
+namespace ss {
+
+TelemetryIngest::TelemetryIngest(const TelemetryConfig& config) : config_(config) {}
+
+TelemetryIngest::~TelemetryIngest() {
+    stop();
+}
+
+bool TelemetryIngest::start() {
+    bool ok = (config_.ingest == "unix") ? open_unix() : open_udp();
+    if (!ok) return false;
+
+    // Wake up periodically so stop() doesn't block on recv
+    timeval tv{};
+    tv.tv_usec = 500 * 1000;
+    setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    running_.store(true);
+    thread_ = std::thread(&TelemetryIngest::receive_thread, this);
+    return true;
+}
+
+void TelemetryIngest::stop() {
+    running_.store(false);
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+        if (config_.ingest == "unix") {
+            unlink(config_.unix_path.c_str());
+        }
+    }
+}
+
+bool TelemetryIngest::open_udp() {
+    fd_ = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd_ < 0) {
+        spdlog::error("Telemetry: Failed to create UDP socket");
+        return false;
+    }
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(config_.udp_port);
+    if (inet_pton(AF_INET, config_.udp_bind.c_str(), &addr.sin_addr) != 1) {
+        spdlog::error("Telemetry: Invalid bind address {}", config_.udp_bind);
+        close(fd_);
+        fd_ = -1;
+        return false;
+    }
+
+    if (bind(fd_, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        spdlog::error("Telemetry: Failed to bind to udp://{}:{}", config_.udp_bind, config_.udp_port);
+        close(fd_);
+        fd_ = -1;
+        return false;
+    }
+
+    spdlog::info("Telemetry ingest listening on udp://{}:{}", config_.udp_bind, config_.udp_port);
+    return true;
+}
+
+bool TelemetryIngest::open_unix() {
+    sockaddr_un addr{};
+    if (config_.unix_path.size() >= sizeof(addr.sun_path)) {
+        spdlog::error("Telemetry: Socket path too long: {}", config_.unix_path);
+        return false;
+    }
+
+    fd_ = socket(AF_UNIX, SOCK_DGRAM, 0);
+    if (fd_ < 0) {
+        spdlog::error("Telemetry: Failed to create unix socket");
+        return false;
+    }
+
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, config_.unix_path.c_str(), sizeof(addr.sun_path) - 1);
+    unlink(config_.unix_path.c_str()); // stale socket from a previous run
+
+    if (bind(fd_, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        spdlog::error("Telemetry: Failed to bind to {}", config_.unix_path);
+        close(fd_);
+        fd_ = -1;
+        return false;
+    }
+
+    spdlog::info("Telemetry ingest listening on unix://{}", config_.unix_path);
+    return true;
+}
+
+void TelemetryIngest::receive_thread() {
+    // Large enough for any single datagram
+    std::string buf(64 * 1024, '\0');
+
+    while (running_.load()) {
+        ssize_t n = recv(fd_, buf.data(), buf.size(), 0);
+        if (n <= 0) {
+            continue; // timeout or interrupted
+        }
+
+        messages_received_.fetch_add(1);
+        if (message_cb_) {
+            message_cb_(buf.substr(0, static_cast<size_t>(n)));
+        }
+    }
+}
+
+} // namespace ss
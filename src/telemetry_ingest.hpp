@@ -0,0 +1,49 @@
+#pragma once
+
+#include "config.hpp"
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+
+namespace ss {
+
+// Local datagram socket (UDP or unix) that robot processes write telemetry to.
+// Each datagram is one message, forwarded as-is to the callback.
+class TelemetryIngest {
+public:
+    using MessageCallback = std::function<void(const std::string& message)>;
+
+    explicit TelemetryIngest(const TelemetryConfig& config);
+    ~TelemetryIngest();
+
+    // Non-copyable
+    TelemetryIngest(const TelemetryIngest&) = delete;
+    TelemetryIngest& operator=(const TelemetryIngest&) = delete;
+
+    void set_message_callback(MessageCallback cb) { message_cb_ = std::move(cb); }
+
+    bool start();
+    void stop();
+    bool is_running() const { return running_.load(); }
+
+    // Replace settings (call while stopped)
+    void update_config(const TelemetryConfig& config) { config_ = config; }
+
+    uint64_t messages_received() const { return messages_received_.load(); }
+
+private:
+    bool open_udp();
+    bool open_unix();
+    void receive_thread();
+
+    TelemetryConfig config_;
+    MessageCallback message_cb_;
+
+    int fd_ = -1;
+    std::atomic<bool> running_{false};
+    std::atomic<uint64_t> messages_received_{0};
+    std::thread thread_;
+};
+
+} // namespace ss
@@ -0,0 +1,173 @@
+#include "timestamp_smoother.hpp"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cmath>
+
+namespace ss {
+
+TimestampSmoother::TimestampSmoother(const RtspConfig& config)
+    : config_(config)
+{
+    reset();
+}
+
+void TimestampSmoother::update_config(const RtspConfig& config) {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    config_ = config;
+}
+
+void TimestampSmoother::reset() {
+    {
+        std::lock_guard<std::mutex> lock(rtp_mutex_);
+        rtp_marks_.clear();
+        rtp_started_ = false;
+        rtp_unwrapped_ = 0;
+    }
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    mode_ = config_.timestamps;
+    if (mode_ != "arrival" && mode_ != "rtp" && mode_ != "nominal") {
+        spdlog::warn("Unknown rtsp.timestamps '{}', using arrival", mode_);
+        mode_ = "arrival";
+    }
+    max_correction_percent_ = std::max(config_.max_correction_percent, 0.0);
+    started_ = false;
+    has_last_rtp_ = false;
+    error_us_ = 0.0;
+    input_jitter_us_ = 0.0;
+    output_jitter_us_ = 0.0;
+}
+
+// ─── Camera RTP clock ──────────────────────────────────────────────────────────
+
+void TimestampSmoother::on_rtp(uint64_t pts_us, uint32_t rtp_timestamp) {
+    std::lock_guard<std::mutex> lock(rtp_mutex_);
+    if (!rtp_started_) {
+        rtp_started_ = true;
+        rtp_unwrapped_ = rtp_timestamp;
+    } else {
+        rtp_unwrapped_ += static_cast<int32_t>(rtp_timestamp - last_rtp_);
+    }
+    last_rtp_ = rtp_timestamp;
+
+    // Packets of one frame share its RTP timestamp: the first one marks it
+    int64_t rtp_us = rtp_unwrapped_ * 1'000'000 / rtp_clock_rate;
+    if (!rtp_marks_.empty() && rtp_marks_.back().rtp_us == rtp_us) return;
+    rtp_marks_.push_back({pts_us, rtp_us, rtp_timestamp});
+    if (rtp_marks_.size() > rtp_history) rtp_marks_.pop_front();
+}
+
+const TimestampSmoother::RtpMark* TimestampSmoother::mark_for(uint64_t pts_us) const {
+    // The frame carries the PTS of one of its packets: the newest mark at
+    // or before it is the frame's
+    for (auto it = rtp_marks_.rbegin(); it != rtp_marks_.rend(); ++it) {
+        if (it->pts_us <= pts_us) return &*it;
+    }
+    return nullptr;
+}
+
+bool TimestampSmoother::camera_rtp(uint64_t pts_us, uint32_t& rtp_timestamp) {
+    std::lock_guard<std::mutex> lock(rtp_mutex_);
+    const RtpMark* mark = mark_for(pts_us);
+    if (!mark) return false;
+    rtp_timestamp = mark->rtp_timestamp;
+    return true;
+}
+
+// ─── Frames ────────────────────────────────────────────────────────────────────
+
+void TimestampSmoother::resync(uint64_t input_us, int64_t rtp_us, bool has_rtp) {
+    started_ = true;
+    last_input_us_ = input_us;
+    last_output_us_ = static_cast<double>(input_us);
+    last_rtp_us_ = rtp_us;
+    has_last_rtp_ = has_rtp;
+    error_us_ = 0.0;
+}
+
+uint64_t TimestampSmoother::on_frame(bool valid, uint64_t timestamp_us, uint64_t nominal_interval_us,
+                                     std::chrono::steady_clock::time_point now) {
+    uint64_t input = valid ? timestamp_us
+                           : static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                                 now.time_since_epoch()).count());
+
+    int64_t rtp_us = 0;
+    bool has_rtp = false;
+    if (valid) {
+        std::lock_guard<std::mutex> lock(rtp_mutex_);
+        if (const RtpMark* mark = mark_for(input)) {
+            rtp_us = mark->rtp_us;
+            has_rtp = true;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    if (!started_) {
+        interval_us_ = static_cast<double>(std::max<uint64_t>(nominal_interval_us, 1));
+        resync(input, rtp_us, has_rtp);
+        return input;
+    }
+
+    auto delta = static_cast<double>(static_cast<int64_t>(input - last_input_us_));
+    if (std::abs(delta) > resync_us) {
+        // Source restarted or stalled: begin again from its timestamps
+        spdlog::debug("Timestamps resynced after a {:.0f} ms jump", delta / 1000.0);
+        resyncs_++;
+        resync(input, rtp_us, has_rtp);
+        return input;
+    }
+
+    // Frame rate from the mean spacing, leaving out lost frames and reordering
+    if (delta > 0.0 && delta < 3.0 * interval_us_) {
+        interval_us_ += (delta - interval_us_) / 32.0;
+    }
+    input_jitter_us_ += (std::abs(delta - interval_us_) - input_jitter_us_) / 16.0;
+
+    double output = static_cast<double>(input);
+    if (mode_ == "rtp" || mode_ == "nominal") {
+        double candidate;
+        if (mode_ == "nominal") {
+            double frames = std::max(1.0, std::round(delta / interval_us_));
+            candidate = last_output_us_ + frames * interval_us_;
+        } else if (has_rtp && has_last_rtp_) {
+            candidate = last_output_us_ + static_cast<double>(rtp_us - last_rtp_us_);
+        } else {
+            candidate = last_output_us_ + delta;
+        }
+
+        double error = candidate - static_cast<double>(input);
+        if (std::abs(error) > resync_us) {
+            spdlog::debug("Timestamps resynced {:.0f} ms off the delivered ones", error / 1000.0);
+            resyncs_++;
+            resync(input, rtp_us, has_rtp);
+            return input;
+        }
+        error_us_ += (error - error_us_) / 16.0;
+
+        // Follow drift slowly enough that the spacing stays steady
+        double limit = interval_us_ * max_correction_percent_ / 100.0;
+        double correction = std::clamp(-error_us_ / 10.0, -limit, limit);
+        output = std::max(candidate + correction, 0.0);
+        error_us_ += correction;
+    }
+
+    output_jitter_us_ += (std::abs(output - last_output_us_ - interval_us_) - output_jitter_us_) / 16.0;
+    last_input_us_ = input;
+    last_output_us_ = output;
+    last_rtp_us_ = rtp_us;
+    has_last_rtp_ = has_rtp;
+    return static_cast<uint64_t>(std::llround(output));
+}
+
+TimestampSmoother::Stats TimestampSmoother::stats() const {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    Stats stats;
+    stats.mode = mode_;
+    stats.interval_ms = interval_us_ / 1000.0;
+    stats.input_jitter_ms = input_jitter_us_ / 1000.0;
+    stats.output_jitter_ms = output_jitter_us_ / 1000.0;
+    stats.offset_ms = error_us_ / 1000.0;
+    stats.resyncs = resyncs_;
+    return stats;
+}
+
+} // namespace ss
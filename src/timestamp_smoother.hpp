@@ -0,0 +1,102 @@
+#pragma once
+
+#include "config.hpp"
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+
+namespace ss {
+
+// Regenerates the main stream's frame timestamps (rtsp.timestamps) so the
+// RTP timestamps viewers get do not carry the camera link's arrival jitter.
+// With rtspsrc at latency 0 the delivered PTS are close to arrival times,
+// and without PTS the pipeline falls back to the delivery time; a browser
+// sizes its jitter buffer to that jitter.
+//
+//   arrival  the delivered PTS, unchanged
+//   rtp      spacing from the camera's RTP timestamps (recorded at the
+//            depayloader), or the delivered PTS where there are none
+//   nominal  a steady cadence at the measured frame rate, skipping a
+//            frame interval for each frame lost
+//
+// Regenerated timestamps are pulled toward the delivered ones to follow
+// clock drift: by a tenth of the smoothed difference per frame, at most
+// max_correction_percent of a frame interval. They stay within jitter of
+// the pipeline clock, which audio and branch streams are mapped with.
+class TimestampSmoother {
+public:
+    struct Stats {
+        std::string mode;
+        double interval_ms = 0.0;       // measured frame interval
+        double input_jitter_ms = 0.0;   // mean deviation of frame spacing, as delivered
+        double output_jitter_ms = 0.0;  // the same after regeneration
+        double offset_ms = 0.0;         // regenerated minus delivered, smoothed
+        uint64_t resyncs = 0;           // restarted on a discontinuity
+    };
+
+    explicit TimestampSmoother(const RtspConfig& config);
+
+    // Takes effect at the next reset()
+    void update_config(const RtspConfig& config);
+
+    // A camera RTP packet's timestamp at the depayloader, with its PTS
+    // (streaming thread of the source; frames arrive on another)
+    void on_rtp(uint64_t pts_us, uint32_t rtp_timestamp);
+
+    // One frame: `timestamp_us` is its PTS (`valid` false when it has none),
+    // `nominal_interval_us` the frame interval from the caps or config.
+    // Returns the timestamp to send it with.
+    uint64_t on_frame(bool valid, uint64_t timestamp_us, uint64_t nominal_interval_us,
+                      std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+
+    // The camera RTP timestamp of the frame with this PTS, as recorded by
+    // on_rtp(); false when there is none
+    bool camera_rtp(uint64_t pts_us, uint32_t& rtp_timestamp);
+
+    Stats stats() const;
+
+    // New pipeline: forget the timeline and RTP history
+    void reset();
+
+private:
+    static constexpr uint32_t rtp_clock_rate = 90000;
+    static constexpr int64_t resync_us = 1'000'000;    // larger differences restart
+    static constexpr size_t rtp_history = 64;
+
+    struct RtpMark {
+        uint64_t pts_us;
+        int64_t rtp_us;
+        uint32_t rtp_timestamp;     // as sent by the camera
+    };
+
+    const RtpMark* mark_for(uint64_t pts_us) const;         // rtp_mutex_ held
+    void resync(uint64_t input_us, int64_t rtp_us, bool has_rtp);   // stats_mutex_ held
+
+    RtspConfig config_;
+    std::string mode_;
+    double max_correction_percent_ = 5.0;
+
+    // Depayloader side: PTS → unwrapped RTP time, oldest first
+    std::mutex rtp_mutex_;
+    std::deque<RtpMark> rtp_marks_;
+    bool rtp_started_ = false;
+    uint32_t last_rtp_ = 0;
+    int64_t rtp_unwrapped_ = 0;     // 90 kHz ticks
+
+    // Frame side (appsink streaming thread), read by stats() under stats_mutex_
+    mutable std::mutex stats_mutex_;
+    bool started_ = false;
+    uint64_t last_input_us_ = 0;
+    double last_output_us_ = 0.0;
+    int64_t last_rtp_us_ = 0;
+    bool has_last_rtp_ = false;
+    double interval_us_ = 0.0;
+    double error_us_ = 0.0;         // output minus input, smoothed
+    double input_jitter_us_ = 0.0;
+    double output_jitter_us_ = 0.0;
+    uint64_t resyncs_ = 0;
+};
+
+} // namespace ss
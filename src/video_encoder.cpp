@@ -0,0 +1,414 @@
+#include "video_encoder.hpp"
+#include <spdlog/spdlog.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+
+namespace ss {
+
+// Benchmark input: a typical camera main stream, long enough to get past
+// encoder start-up (lookahead, hardware session setup)
+static constexpr int bench_width = 1280;
+static constexpr int bench_height = 720;
+static constexpr int bench_frames = 60;
+static constexpr auto bench_timeout = std::chrono::seconds(10);
+
+// Throughput needed on synthetic frames to count as keeping up; the live
+// path also decodes and converts
+static constexpr double fps_headroom = 1.2;
+
+// nvv4l2h264enc has no "never": with intra refresh, IDRs only come on request
+static constexpr int no_periodic_idr = 1 << 30;
+
+// encoding.preset, from fastest (0) to slowest (3). Names follow the
+// Jetson encoder's presets, which the option was introduced for.
+static int preset_level(const std::string& preset) {
+    if (preset == "FastPreset" || preset == "fast") return 1;
+    if (preset == "MediumPreset" || preset == "medium") return 2;
+    if (preset == "SlowPreset" || preset == "slow") return 3;
+    return 0; // UltraFastPreset
+}
+
+FrameBudget frame_budget(int latency_budget_ms, int bitrate_kbps, int fps) {
+    FrameBudget budget;
+    if (latency_budget_ms <= 0 || bitrate_kbps <= 0) return budget;
+    budget.vbv_ms = latency_budget_ms;
+    budget.vbv_kbits = std::max(1, bitrate_kbps * latency_budget_ms / 1000);
+    double drain_ms = latency_budget_ms + 1000.0 / std::max(1, fps);
+    budget.max_frame_bytes = static_cast<size_t>(bitrate_kbps * drain_ms / 8.0);
+    return budget;
+}
+
+const char* VideoEncoder::name() const {
+    switch (kind_) {
+        case Kind::X264:     return "x264";
+        case Kind::OpenH264: return "openh264";
+        case Kind::Va:       return "va";
+        case Kind::Nvv4l2:   return "nvv4l2";
+    }
+    return "unknown";
+}
+
+const char* VideoEncoder::element() const {
+    switch (kind_) {
+        case Kind::X264:     return "x264enc";
+        case Kind::OpenH264: return "openh264enc";
+        case Kind::Va:       return "vah264enc";
+        case Kind::Nvv4l2:   return "nvv4l2h264enc";
+    }
+    return "";
+}
+
+bool VideoEncoder::hardware() const {
+    return kind_ == Kind::Va || kind_ == Kind::Nvv4l2;
+}
+
+bool VideoEncoder::available() const {
+    GstElementFactory* factory = gst_element_factory_find(element());
+    if (!factory) return false;
+    gst_object_unref(factory);
+    return true;
+}
+
+bool VideoEncoder::supports_intra_refresh() const {
+    return kind_ == Kind::X264 || kind_ == Kind::Nvv4l2;
+}
+
+bool VideoEncoder::supports_vbv() const {
+    return kind_ != Kind::OpenH264;
+}
+
+std::vector<VideoEncoder> VideoEncoder::all() {
+    return {VideoEncoder(Kind::X264), VideoEncoder(Kind::OpenH264),
+            VideoEncoder(Kind::Va), VideoEncoder(Kind::Nvv4l2)};
+}
+
+bool VideoEncoder::parse(const std::string& name, VideoEncoder& encoder) {
+    for (auto& candidate : all()) {
+        if (name == candidate.name() || name == candidate.element()) {
+            encoder = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string VideoEncoder::launch(const EncodingConfig& encoding, const VideoConfig& video,
+                                 bool nvmm_input) const {
+    const int level = preset_level(encoding.preset);
+    const std::string bitrate = std::to_string(video.bitrate_kbps);
+    const std::string bitrate_bps = std::to_string(video.bitrate_kbps * 1000);
+    const std::string peak_bps = std::to_string(video.max_bitrate_kbps * 1000);
+    const std::string interval = std::to_string(encoding.idr_interval);
+    const bool intra_refresh = encoding.intra_refresh && supports_intra_refresh();
+    const FrameBudget budget = frame_budget(encoding.latency_budget_ms, video.bitrate_kbps, video.fps);
+
+    switch (kind_) {
+        case Kind::X264: {
+            static const char* presets[] = {"ultrafast", "superfast", "veryfast", "medium"};
+            return std::string(nvmm_input ? "nvvidconv ! video/x-raw,format=I420 ! " : "videoconvert ! ") +
+                "x264enc name=enc tune=zerolatency speed-preset=" + presets[level] + " "
+                "bitrate=" + bitrate + " "
+                // VBV in ms of the target rate
+                "vbv-buf-capacity=" + std::to_string(budget.vbv_ms ? budget.vbv_ms
+                                                                   : video.max_bitrate_kbps) + " "
+                "key-int-max=" + interval + " " +
+                // key-int-max becomes the refresh period; no periodic IDRs
+                (intra_refresh ? "intra-refresh=true " : "") +
+                "bframes=0 ! ";
+        }
+        case Kind::OpenH264: {
+            static const char* complexity[] = {"low", "low", "medium", "high"};
+            return std::string(nvmm_input ? "nvvidconv ! " : "videoconvert ! ") +
+                "video/x-raw,format=I420 ! "
+                "openh264enc name=enc usage-type=camera rate-control=bitrate "
+                "complexity=" + complexity[level] + " "
+                "bitrate=" + bitrate_bps + " "
+                "max-bitrate=" + peak_bps + " "
+                "gop-size=" + interval + " ! ";
+        }
+        case Kind::Va: {
+            // target-usage runs from 1 (best quality) to 7 (fastest)
+            static const char* usage[] = {"7", "6", "4", "1"};
+            return std::string(nvmm_input ? "nvvidconv ! " : "videoconvert ! ") +
+                "video/x-raw,format=NV12 ! "
+                "vah264enc name=enc rate-control=cbr "
+                "target-usage=" + usage[level] + " "
+                "bitrate=" + bitrate + " " +
+                (budget.vbv_kbits ? "cpb-size=" + std::to_string(budget.vbv_kbits) + " " : "") +
+                "key-int-max=" + interval + " "
+                "b-frames=0 ! ";
+        }
+        case Kind::Nvv4l2:
+            return std::string(nvmm_input ? "" : "nvvidconv ! video/x-raw(memory:NVMM),format=NV12 ! ") +
+                "nvv4l2h264enc name=enc "
+                "bitrate=" + bitrate_bps + " "
+                "peak-bitrate=" + peak_bps + " "
+                "maxperf-enable=1 "
+                "preset-level=" + std::to_string(level + 1) + " "
+                "control-rate=1 " +
+                (budget.vbv_kbits ? "vbv-size=" + std::to_string(budget.vbv_kbits * 1000) + " " : "") +
+                "insert-sps-pps=" + (encoding.insert_sps_pps ? "1" : "0") + " " +
+                (intra_refresh
+                    ? "SliceIntraRefreshInterval=" + interval + " "
+                      "iframeinterval=" + std::to_string(no_periodic_idr) + " "
+                      "idrinterval=" + std::to_string(no_periodic_idr) + " ! "
+                    : "idrinterval=" + interval + " ! ");
+    }
+    return "";
+}
+
+void VideoEncoder::set_bitrate(GstElement* encoder, int bitrate_kbps,
+                               const FrameBudget& budget) const {
+    switch (kind_) {
+        case Kind::X264:
+            // The buffer is in ms, so a budget needs no rescaling here
+            g_object_set(G_OBJECT(encoder),
+                         "bitrate", static_cast<guint>(bitrate_kbps),
+                         "vbv-buf-capacity", static_cast<guint>(budget.vbv_ms ? budget.vbv_ms
+                                                                              : bitrate_kbps),
+                         nullptr);
+            break;
+        case Kind::OpenH264:
+            g_object_set(G_OBJECT(encoder),
+                         "bitrate", static_cast<guint>(bitrate_kbps * 1000),
+                         "max-bitrate", static_cast<guint>(bitrate_kbps * 1200),
+                         nullptr);
+            break;
+        case Kind::Va:
+            g_object_set(G_OBJECT(encoder), "bitrate", static_cast<guint>(bitrate_kbps), nullptr);
+            if (budget.vbv_kbits) {
+                g_object_set(G_OBJECT(encoder), "cpb-size", static_cast<guint>(budget.vbv_kbits), nullptr);
+            }
+            break;
+        case Kind::Nvv4l2:
+            // Bits per second, peak = 120% of target
+            g_object_set(G_OBJECT(encoder),
+                         "bitrate", static_cast<guint>(bitrate_kbps * 1000),
+                         "peak-bitrate", static_cast<guint>(bitrate_kbps * 1200),
+                         nullptr);
+            if (budget.vbv_kbits) {
+                g_object_set(G_OBJECT(encoder), "vbv-size", static_cast<guint>(budget.vbv_kbits * 1000), nullptr);
+            }
+            break;
+    }
+}
+
+// ─── Benchmark ────────────────────────────────────────────────────────────────
+
+static double process_cpu_s() {
+    timespec ts{};
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) / 1e9;
+}
+
+// CPU time of one thread of this process, 0 once it has exited. schedstat
+// has nanoseconds; stat only clock ticks.
+static double thread_cpu_s(const std::string& tid) {
+    std::string task = "/proc/self/task/" + tid;
+    std::ifstream schedstat(task + "/schedstat");
+    uint64_t ns = 0;
+    if (schedstat >> ns) return static_cast<double>(ns) / 1e9;
+
+    std::ifstream stat_file(task + "/stat");
+    std::string stat;
+    if (!std::getline(stat_file, stat)) return 0.0;
+    auto paren = stat.rfind(')');
+    if (paren == std::string::npos) return 0.0;
+    std::istringstream fields(stat.substr(paren + 2));
+    std::string field;
+    uint64_t ticks = 0;
+    for (int i = 3; fields >> field && i <= 15; i++) {
+        if (i == 14 || i == 15) ticks += std::stoull(field);
+    }
+    return static_cast<double>(ticks) / static_cast<double>(sysconf(_SC_CLK_TCK));
+}
+
+// CPU time of every thread of this process, by thread id
+static std::unordered_map<std::string, double> threads_cpu_s() {
+    std::unordered_map<std::string, double> threads;
+    if (DIR* dir = opendir("/proc/self/task")) {
+        while (dirent* entry = readdir(dir)) {
+            if (entry->d_name[0] == '.') continue;
+            threads[entry->d_name] = thread_cpu_s(entry->d_name);
+        }
+        closedir(dir);
+    }
+    return threads;
+}
+
+// Push synthetic frames through `fragment` (empty = no encoder) as fast as
+// it goes. Wall and CPU time are returned for the whole run; the CPU is the
+// process's minus what its threads from before the run used meanwhile
+// (viewers, the live pipeline), leaving the benchmark's own threads,
+// encoder library threads included.
+static bool encode_frames(const std::string& fragment, int fps, double& wall_s, double& cpu_s,
+                          std::string& error) {
+    std::string desc =
+        "videotestsrc num-buffers=" + std::to_string(bench_frames) + " pattern=ball ! "
+        "video/x-raw,format=I420,width=" + std::to_string(bench_width) + ","
+        "height=" + std::to_string(bench_height) + ","
+        "framerate=" + std::to_string(fps) + "/1 ! " +
+        fragment + "fakesink sync=false";
+
+    GError* gerror = nullptr;
+    GstElement* pipeline = gst_parse_launch(desc.c_str(), &gerror);
+    if (gerror) {
+        error = gerror->message;
+        g_error_free(gerror);
+        if (pipeline) gst_object_unref(pipeline);
+        return false;
+    }
+
+    auto others0 = threads_cpu_s();
+    double cpu0 = process_cpu_s();
+    auto t0 = std::chrono::steady_clock::now();
+    bool ok = gst_element_set_state(pipeline, GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE;
+    if (!ok) {
+        error = "cannot start";
+    } else {
+        GstBus* bus = gst_element_get_bus(pipeline);
+        auto timeout = std::chrono::duration_cast<std::chrono::nanoseconds>(bench_timeout).count();
+        GstMessage* msg = gst_bus_timed_pop_filtered(
+            bus, static_cast<GstClockTime>(timeout),
+            static_cast<GstMessageType>(GST_MESSAGE_EOS | GST_MESSAGE_ERROR));
+        if (!msg) {
+            ok = false;
+            error = "timed out";
+        } else if (GST_MESSAGE_TYPE(msg) == GST_MESSAGE_ERROR) {
+            GError* err = nullptr;
+            gst_message_parse_error(msg, &err, nullptr);
+            ok = false;
+            error = err ? err->message : "error";
+            if (err) g_error_free(err);
+        }
+        if (msg) gst_message_unref(msg);
+        gst_object_unref(bus);
+    }
+    wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    cpu_s = process_cpu_s() - cpu0;
+    for (auto& [tid, cpu] : others0) {
+        cpu_s -= std::max(0.0, thread_cpu_s(tid) - cpu);
+    }
+    cpu_s = std::max(0.0, cpu_s);
+
+    gst_element_set_state(pipeline, GST_STATE_NULL);
+    gst_object_unref(pipeline);
+    return ok;
+}
+
+bool select_video_encoder(const AppConfig& config, VideoEncoder& selected,
+                          std::vector<EncoderBenchmark>* results) {
+    const auto& encoding = config.encoding;
+    if (encoding.encoder != "auto") {
+        VideoEncoder named;
+        if (!VideoEncoder::parse(encoding.encoder, named)) {
+            spdlog::warn("Unknown encoder '{}', choosing automatically", encoding.encoder);
+        } else if (!named.available()) {
+            spdlog::warn("Encoder {} ({}) is not installed, choosing automatically",
+                         named.name(), named.element());
+        } else {
+            selected = named;
+            return true;
+        }
+    }
+
+    std::vector<VideoEncoder> candidates;
+    for (auto& encoder : VideoEncoder::all()) {
+        if (encoder.available()) {
+            candidates.push_back(encoder);
+        } else {
+            spdlog::debug("Encoder {} not available", encoder.element());
+        }
+    }
+    if (encoding.intra_refresh &&
+        std::any_of(candidates.begin(), candidates.end(),
+                    [](const VideoEncoder& e) { return e.supports_intra_refresh(); })) {
+        candidates.erase(std::remove_if(candidates.begin(), candidates.end(),
+                                        [](const VideoEncoder& e) { return !e.supports_intra_refresh(); }),
+                         candidates.end());
+    }
+    if (candidates.empty()) {
+        spdlog::error("No H.264 encoder available (tried x264enc, openh264enc, vah264enc, nvv4l2h264enc)");
+        return false;
+    }
+
+    // The test source's own cost, taken off every encoder's CPU time
+    const int fps = std::max(1, config.webrtc.video.fps);
+    double base_wall = 0.0, base_cpu = 0.0;
+    std::string error;
+    if (!encode_frames("", fps, base_wall, base_cpu, error)) {
+        base_cpu = 0.0;
+    }
+
+    std::vector<EncoderBenchmark> benchmarks;
+    for (auto& encoder : candidates) {
+        EncoderBenchmark b;
+        b.encoder = encoder;
+        double wall_s = 0.0, cpu_s = 0.0;
+        b.ok = encode_frames(encoder.launch(encoding, config.webrtc.video, false), fps,
+                             wall_s, cpu_s, b.error);
+        if (b.ok && wall_s > 0.0) {
+            b.fps = bench_frames / wall_s;
+            double cpu_per_frame = std::max(0.0, cpu_s - base_cpu) / bench_frames;
+            b.cpu_percent = cpu_per_frame * fps * 100.0;
+            spdlog::info("Encoder benchmark: {:<13} {:7.1f} fps, {:6.1f}% CPU at {} fps",
+                         encoder.element(), b.fps, b.cpu_percent, fps);
+        } else {
+            spdlog::info("Encoder benchmark: {:<13} failed ({})", encoder.element(), b.error);
+        }
+        benchmarks.push_back(b);
+    }
+
+    // Lowest CPU among those that keep up; hw_encode prefers hardware ones
+    auto pick = [&](bool hardware_only) -> const EncoderBenchmark* {
+        const EncoderBenchmark* best = nullptr;
+        for (auto& b : benchmarks) {
+            if (!b.ok || b.fps < fps * fps_headroom) continue;
+            if (hardware_only && !b.encoder.hardware()) continue;
+            if (!best || b.cpu_percent < best->cpu_percent) best = &b;
+        }
+        return best;
+    };
+    const EncoderBenchmark* choice = encoding.hw_encode ? pick(true) : nullptr;
+    if (!choice) choice = pick(false);
+    if (!choice) {
+        for (auto& b : benchmarks) {
+            if (b.ok && (!choice || b.fps > choice->fps)) choice = &b;
+        }
+        if (choice) {
+            spdlog::warn("No encoder keeps up with {} fps at {}x{}, using the fastest",
+                         fps, bench_width, bench_height);
+        }
+    }
+
+    if (results) *results = benchmarks;
+    if (!choice) {
+        spdlog::error("Every H.264 encoder failed the benchmark");
+        return false;
+    }
+    selected = choice->encoder;
+    spdlog::info("Selected encoder: {} ({:.1f} fps, {:.1f}% CPU)", selected.element(),
+                 choice->fps, choice->cpu_percent);
+    return true;
+}
+
+bool select_video_encoder_cached(const AppConfig& config, VideoEncoder& selected,
+                                 std::string& selection) {
+    const auto& encoding = config.encoding;
+    std::string settings = encoding.encoder + "/" + (encoding.hw_encode ? "hw" : "sw") + "/" +
+                           (encoding.intra_refresh ? "ir" : "idr") + "/" +
+                           std::to_string(config.webrtc.video.fps);
+    if (settings == selection) return true;
+
+    if (!select_video_encoder(config, selected)) return false;
+    selection = settings;
+    return true;
+}
+
+} // namespace ss
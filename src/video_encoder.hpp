@@ -0,0 +1,92 @@
+#pragma once
+
+#include "config.hpp"
+#include <gst/gst.h>
+#include <string>
+#include <vector>
+
+namespace ss {
+
+// encoding.latency_budget_ms at one target bitrate: the encoder's VBV
+// buffer holds `budget` of queuing, so no frame (keyframes included) takes
+// longer than one frame interval plus the budget to drain at that rate.
+// The encoders only take the VBV size; max_frame_bytes is what the pipeline
+// checks delivered frames against.
+struct FrameBudget {
+    int vbv_ms = 0;                 // 0 = no budget, encoder defaults
+    int vbv_kbits = 0;
+    size_t max_frame_bytes = 0;     // monitored, not enforced
+};
+
+FrameBudget frame_budget(int latency_budget_ms, int bitrate_kbps, int fps);
+
+// An H.264 encoder element for the re-encode path, and how the server's
+// controls (bitrate, keyframe interval, speed preset) map onto its
+// properties.
+class VideoEncoder {
+public:
+    enum class Kind {
+        X264,       // x264enc (software)
+        OpenH264,   // openh264enc (software)
+        Va,         // vah264enc (VA-API, Intel/AMD)
+        Nvv4l2,     // nvv4l2h264enc (Jetson)
+    };
+
+    explicit VideoEncoder(Kind kind = Kind::X264) : kind_(kind) {}
+
+    Kind kind() const { return kind_; }
+    const char* name() const;       // config name: x264, openh264, va, nvv4l2
+    const char* element() const;    // GStreamer factory name
+    bool hardware() const;
+
+    // Element factory present in the registry
+    bool available() const;
+
+    // Has a rolling intra refresh (encoding.intra_refresh)
+    bool supports_intra_refresh() const;
+
+    // Takes a VBV/CPB size, so a FrameBudget can be enforced
+    bool supports_vbv() const;
+
+    // Launch fragment "<convert> ! <encoder name=enc ...> ! " for raw video.
+    // `nvmm_input`: frames come from a Jetson decoder in NVMM memory.
+    std::string launch(const EncodingConfig& encoding, const VideoConfig& video,
+                       bool nvmm_input) const;
+
+    // Retarget the running element created by launch(); the budget is
+    // recomputed for the new rate
+    void set_bitrate(GstElement* encoder, int bitrate_kbps, const FrameBudget& budget) const;
+
+    static std::vector<VideoEncoder> all();
+    static bool parse(const std::string& name, VideoEncoder& encoder);
+
+private:
+    Kind kind_;
+};
+
+// Outcome of encoding synthetic frames with one encoder
+struct EncoderBenchmark {
+    VideoEncoder encoder;
+    bool ok = false;
+    double fps = 0.0;               // encode throughput, unthrottled
+    double cpu_percent = 0.0;       // CPU it would use at the target fps (100 = one core)
+    std::string error;
+};
+
+// Picks the re-encode path's encoder. A named `encoding.encoder` is used
+// if present. "auto" benchmarks every available encoder on synthetic frames
+// and takes the one that keeps up with the target fps at the lowest CPU
+// (hardware only when hw_encode is set and one qualifies), else the fastest.
+// With intra_refresh, encoders that cannot do it are only a last resort.
+// Returns false if no encoder works at all. Needs gst_init.
+bool select_video_encoder(const AppConfig& config, VideoEncoder& selected,
+                          std::vector<EncoderBenchmark>* results = nullptr);
+
+// select_video_encoder() again only when a setting it depends on changed.
+// `selection` records the settings `selected` was chosen for (empty = none
+// yet); the benchmark takes a second or two, so reconnects and rebuilds
+// reuse the result.
+bool select_video_encoder_cached(const AppConfig& config, VideoEncoder& selected,
+                                 std::string& selection);
+
+} // namespace ss
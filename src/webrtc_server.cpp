@@ -1,5 +1,8 @@
 #include "webrtc_server.hpp"
+#include "h264.hpp"
+#include <nlohmann/json.hpp>
 #include <spdlog/spdlog.h>
+#include <cstdlib>
 #include <random>
 #include <sstream>
 #include <iomanip>
@@ -16,13 +19,32 @@ static std::string generate_peer_id() {
     return oss.str();
 }
 
-WebRtcServer::WebRtcServer(const AppConfig& config) : config_(config) {}
+// Pooled peers are recycled before their gathered candidates go stale
+// (NAT bindings and TURN allocations time out)
+static constexpr auto pool_max_age = std::chrono::seconds(30);
+
+// A GOP larger than this is not worth replaying; caching resumes at the next IDR
+static constexpr size_t gop_cache_max_bytes = 8 * 1024 * 1024;
+
+// Intra refresh has no GOP end: past this the cache is dropped and the next
+// viewer forces a fresh IDR rather than getting seconds of backlog
+static constexpr uint64_t intra_refresh_cache_max_us = 2'000'000;
+
+// A forced IDR that never shows up (pipeline down) stops absorbing requests
+static constexpr auto keyframe_request_timeout = std::chrono::seconds(2);
+
+WebRtcServer::WebRtcServer(const AppConfig& config)
+    : config_(config)
+    , keyframe_min_interval_ms_(config.webrtc.keyframe_min_interval_ms)
+{
+}
 
 WebRtcServer::~WebRtcServer() {
     stop();
 }
 
-std::string WebRtcServer::create_peer(SignalingCallback signaling_cb) {
+std::string WebRtcServer::create_peer(SignalingCallback signaling_cb,
+                                      std::chrono::steady_clock::time_point accepted_at) {
     std::lock_guard<std::mutex> lock(peers_mutex_);
 
     // Check max peer limit
@@ -31,18 +53,52 @@ std::string WebRtcServer::create_peer(SignalingCallback signaling_cb) {
         return "";
     }
 
-    std::string peer_id = generate_peer_id();
+    std::shared_ptr<PeerConnection> peer;
+    while (!pool_.empty() && !peer) {
+        if (!pool_.front().peer->is_closed()) peer = pool_.front().peer;
+        pool_.pop_front();
+    }
+    bool pooled = peer != nullptr;
 
     try {
-        auto peer = std::make_shared<PeerConnection>(
-            peer_id, config_.webrtc, std::move(signaling_cb));
-        peers_[peer_id] = peer;
-        spdlog::info("Created peer: {} (total: {})", peer_id, peers_.size());
-        return peer_id;
+        if (!peer) peer = make_peer();
     } catch (const std::exception& e) {
         spdlog::error("Failed to create peer: {}", e.what());
         return "";
     }
+
+    peer->attach(std::move(signaling_cb), accepted_at);
+    peers_[peer->id()] = peer;
+    spdlog::info("Created peer: {} (total: {}{})", peer->id(), peers_.size(),
+                 pooled ? ", from pool" : "");
+    return peer->id();
+}
+
+std::shared_ptr<PeerConnection> WebRtcServer::make_peer() {
+    auto peer = std::make_shared<PeerConnection>(generate_peer_id(), config_, media_clock_, source_profile_);
+    peer->set_control_callback(control_cb_);
+    std::string id = peer->id();
+    peer->set_keyframe_request_callback([this, id]() { on_pli(id); });
+    return peer;
+}
+
+void WebRtcServer::refill_pool() {
+    auto now = std::chrono::steady_clock::now();
+    while (!pool_.empty() && (now - pool_.front().created > pool_max_age ||
+                              pool_.front().peer->is_closed())) {
+        pool_.pop_front();
+    }
+
+    // One per tick, so refilling never stalls the peers lock for long
+    if (static_cast<int>(pool_.size()) < config_.webrtc.peer_pool_size) {
+        try {
+            auto peer = make_peer();
+            peer->prepare_offer();
+            pool_.push_back(PooledPeer{std::move(peer), now});
+        } catch (const std::exception& e) {
+            spdlog::warn("Failed to create pooled peer: {}", e.what());
+        }
+    }
 }
 
 void WebRtcServer::start_offer(const std::string& peer_id) {
@@ -84,21 +140,297 @@ void WebRtcServer::remove_peer(const std::string& peer_id) {
         peers_.erase(it);
         spdlog::info("Removed peer: {} (remaining: {})", peer_id, peers_.size());
     }
+    peer_streams_.erase(peer_id);
 }
 
-void WebRtcServer::broadcast_nal(const uint8_t* data, size_t size, uint64_t timestamp_us) {
+bool WebRtcServer::has_peer(const std::string& peer_id) const {
+    std::lock_guard<std::mutex> lock(peers_mutex_);
+    return peers_.count(peer_id) > 0;
+}
+
+void WebRtcServer::broadcast_nal(const uint8_t* data, size_t size, uint64_t timestamp_us,
+                                 uint64_t capture_us) {
+    uint64_t media_us = media_clock_.on_frame(timestamp_us);
+    if (capture_us > 0) {
+        media_clock_.on_capture(media_us, capture_us);
+    }
+    bool idr = h264::contains_idr(data, size);
+
+    if (idr) {
+        std::lock_guard<std::mutex> lock(keyframe_mutex_);
+        keyframe_outstanding_ = false;
+    }
+
+    std::lock_guard<std::mutex> lock(peers_mutex_);
+    if (config_.webrtc.gop_cache) {
+        cache_frame(data, size, media_us, idr);
+    }
+
+    bool viewer_waiting = false;
+    for (auto& [id, peer] : peers_) {
+        if (!peer->is_connected()) continue;
+        if (!peer_streams_.empty() && peer_streams_.count(id)) continue;
+        if (!peer->needs_keyframe()) {
+            peer->send_h264_nal(data, size, media_us);
+            continue;
+        }
+
+        // A new peer cannot decode anything before an IDR: replay the
+        // cached GOP (which ends with this frame) or wait for the next one
+        if (!gop_.empty()) {
+            if (peer->send_h264_nal(gop_.front().data.data(), gop_.front().data.size(),
+                                    gop_.front().media_us)) {
+                for (size_t i = 1; i < gop_.size(); i++) {
+                    peer->send_h264_nal(gop_[i].data.data(), gop_[i].data.size(), gop_[i].media_us);
+                }
+                peer->keyframe_sent();
+            }
+        } else if (idr && peer->send_h264_nal(data, size, media_us)) {
+            peer->keyframe_sent();
+        } else if (!idr) {
+            viewer_waiting = true;
+        }
+    }
+
+    // Periodic IDRs come anyway; with intra refresh a new viewer waits
+    // until someone asks for one
+    if (viewer_waiting && config_.encoding.intra_refresh) {
+        request_keyframe("new viewer");
+    }
+}
+
+void WebRtcServer::on_source_format(const h264::Sps& sps, bool idr) {
+    std::string profile = h264::profile_level_id(sps);
+    std::lock_guard<std::mutex> lock(peers_mutex_);
+
+    // Pooled peers prepared their offer with the old profile
+    if (profile != source_profile_) {
+        pool_.clear();
+        source_profile_ = profile;
+    }
+
+    bool gate = !idr;
+    for (auto& [id, peer] : peers_) {
+        if (!peer_streams_.empty() && peer_streams_.count(id)) continue;   // another stream
+        std::string accepted = peer->accepted_video_profile();
+        if (!h264::profile_compatible(accepted, sps)) {
+            spdlog::info("[{}] Source profile-level-id {} does not fit the negotiated {}",
+                         id, profile, accepted);
+            peer->renegotiate_video(profile);
+        }
+        if (gate) peer->wait_for_keyframe();
+    }
+
+    // With the new parameter sets in an IDR the switch is seamless as is
+    if (gate) {
+        gop_.clear();
+        gop_bytes_ = 0;
+        request_keyframe("source format change");
+    }
+}
+
+void WebRtcServer::broadcast_stream_nal(const std::string& stream, const uint8_t* data,
+                                        size_t size, uint64_t timestamp_us) {
+    // Same pipeline, same timestamps: place it on the main stream's timeline
+    uint64_t media_us;
+    if (!media_clock_.map(timestamp_us, media_us)) return;
+    send_stream_nal(stream, data, size, media_us);
+}
+
+void WebRtcServer::broadcast_foreign_nal(const std::string& stream, const uint8_t* data,
+                                         size_t size, uint64_t timestamp_us) {
+    // Another clock: anchor its timestamps where the main stream is now,
+    // so a viewer switching between them keeps a continuous timeline
+    static constexpr int64_t max_drift_us = 2'000'000;
+    int64_t now = media_clock_.started() ? static_cast<int64_t>(media_clock_.now_us())
+                                         : static_cast<int64_t>(timestamp_us);
+    uint64_t media_us;
+    {
+        std::lock_guard<std::mutex> lock(peers_mutex_);
+        auto it = foreign_offsets_.find(stream);
+        int64_t media = it == foreign_offsets_.end() ? 0 : static_cast<int64_t>(timestamp_us) + it->second;
+        if (it == foreign_offsets_.end() || media < 0 || std::abs(media - now) > max_drift_us) {
+            // First frame, or the pipeline was rebuilt and restarted its clock
+            foreign_offsets_[stream] = now - static_cast<int64_t>(timestamp_us);
+            media = now;
+        }
+        media_us = static_cast<uint64_t>(media);
+    }
+    send_stream_nal(stream, data, size, media_us);
+}
+
+void WebRtcServer::send_stream_nal(const std::string& stream, const uint8_t* data, size_t size,
+                                   uint64_t media_us) {
+    bool idr = h264::contains_idr(data, size);
+
+    bool viewer_waiting = false;
+    {
+        std::lock_guard<std::mutex> lock(peers_mutex_);
+        for (auto& [id, peer_stream] : peer_streams_) {
+            if (peer_stream != stream) continue;
+            auto it = peers_.find(id);
+            if (it == peers_.end() || !it->second->is_connected()) continue;
+            auto& peer = it->second;
+            if (!peer->needs_keyframe()) {
+                peer->send_h264_nal(data, size, media_us);
+            } else if (idr && peer->send_h264_nal(data, size, media_us)) {
+                peer->keyframe_sent();
+            } else if (!idr) {
+                viewer_waiting = true;
+            }
+        }
+    }
+
+    if (viewer_waiting && stream_keyframe_cb_) {
+        stream_keyframe_cb_(stream);
+    }
+}
+
+void WebRtcServer::set_peer_stream(const std::string& peer_id, const std::string& stream) {
+    std::lock_guard<std::mutex> lock(peers_mutex_);
+    auto it = peers_.find(peer_id);
+    if (it == peers_.end()) return;
+
+    auto current = peer_streams_.find(peer_id);
+    const std::string& from = current == peer_streams_.end() ? std::string() : current->second;
+    if (from == stream) return;
+    spdlog::info("[{}] Stream {} → {}", peer_id, from.empty() ? "main" : from,
+                 stream.empty() ? "main" : stream);
+
+    if (stream.empty()) {
+        peer_streams_.erase(peer_id);
+    } else {
+        peer_streams_[peer_id] = stream;
+    }
+    // New SPS/PPS and resolution: hold the peer until the stream's next IDR
+    it->second->wait_for_keyframe();
+}
+
+void WebRtcServer::on_pli(const std::string& peer_id) {
+    std::string stream;
+    {
+        std::lock_guard<std::mutex> lock(peers_mutex_);
+        auto it = peer_streams_.find(peer_id);
+        if (it != peer_streams_.end()) stream = it->second;
+    }
+    if (stream.empty()) {
+        request_keyframe("PLI from " + peer_id);
+    } else if (stream_keyframe_cb_) {
+        stream_keyframe_cb_(stream);
+    }
+}
+
+void WebRtcServer::cache_frame(const uint8_t* data, size_t size, uint64_t media_us, bool idr) {
+    if (idr) {
+        gop_.clear();
+        gop_bytes_ = 0;
+    } else if (gop_.empty()) {
+        return; // a GOP starts at an IDR
+    }
+
+    bool too_long = config_.encoding.intra_refresh && !gop_.empty() &&
+                    media_us - gop_.front().media_us > intra_refresh_cache_max_us;
+    if (gop_bytes_ + size > gop_cache_max_bytes || too_long) {
+        gop_.clear();
+        gop_bytes_ = 0;
+        return;
+    }
+    gop_.push_back(CachedFrame{std::vector<uint8_t>(data, data + size), media_us});
+    gop_bytes_ += size;
+}
+
+void WebRtcServer::request_keyframe(const std::string& reason) {
+    std::lock_guard<std::mutex> lock(keyframe_mutex_);
+    auto now = std::chrono::steady_clock::now();
+    if (keyframe_outstanding_ && now - last_keyframe_forced_ < keyframe_request_timeout) {
+        return; // the IDR already on its way serves this request too
+    }
+    keyframe_requests_++;
+
+    auto interval = std::chrono::milliseconds(keyframe_min_interval_ms_.load());
+    if (keyframes_forced_ > 0 && now - last_keyframe_forced_ < interval) {
+        if (!keyframe_pending_) spdlog::debug("Keyframe request ({}) deferred", reason);
+        keyframe_pending_ = true;
+        return;
+    }
+    force_keyframe(reason);
+}
+
+// Sends a deferred request once its interval is up (cleanup loop tick)
+void WebRtcServer::flush_keyframe_request() {
+    std::lock_guard<std::mutex> lock(keyframe_mutex_);
+    if (!keyframe_pending_) return;
+    auto interval = std::chrono::milliseconds(keyframe_min_interval_ms_.load());
+    if (std::chrono::steady_clock::now() - last_keyframe_forced_ < interval) return;
+    force_keyframe("coalesced");
+}
+
+// keyframe_mutex_ held
+void WebRtcServer::force_keyframe(const std::string& reason) {
+    keyframe_pending_ = false;
+    if (!keyframe_request_cb_) return;
+
+    last_keyframe_forced_ = std::chrono::steady_clock::now();
+    keyframes_forced_++;
+    keyframe_outstanding_ = keyframe_request_cb_();
+    spdlog::debug("Keyframe forced ({})", reason);
+}
+
+void WebRtcServer::broadcast_audio(const uint8_t* data, size_t size, uint64_t timestamp_us) {
+    uint64_t media_us = 0;
+    if (!media_clock_.map(timestamp_us, media_us)) return;
+
+    std::lock_guard<std::mutex> lock(peers_mutex_);
+    for (auto& [id, peer] : peers_) {
+        if (peer->is_connected() && peer->audio_active()) {
+            peer->send_audio(data, size, media_us);
+        }
+    }
+}
+
+void WebRtcServer::broadcast_telemetry(const std::string& message) {
+    // No video yet means no timeline to align against
+    if (!media_clock_.started()) return;
+
+    uint64_t media_us = media_clock_.now_us();
+
+    nlohmann::json envelope;
+    envelope["type"] = "telemetry";
+    envelope["rtp"] = MediaClock::to_rtp(media_us, rtc::H264RtpPacketizer::defaultClockRate);
+    envelope["media_us"] = media_us;
+    envelope["data"] = nlohmann::json::parse(message, nullptr, false);
+    if (envelope["data"].is_discarded()) {
+        envelope["data"] = message; // not JSON, forward as a string
+    }
+    std::string stamped = envelope.dump();
+
     std::lock_guard<std::mutex> lock(peers_mutex_);
     for (auto& [id, peer] : peers_) {
         if (peer->is_connected()) {
-            peer->send_h264_nal(data, size, timestamp_us);
+            peer->send_telemetry(stamped);
         }
     }
 }
 
+void WebRtcServer::send_control(const std::string& peer_id, const std::string& message) {
+    std::lock_guard<std::mutex> lock(peers_mutex_);
+    auto it = peers_.find(peer_id);
+    if (it != peers_.end()) {
+        it->second->send_control(message);
+    }
+}
+
 void WebRtcServer::start() {
     running_.store(true);
     cleanup_thread_ = std::thread(&WebRtcServer::cleanup_loop, this);
-    spdlog::info("WebRTC server started (max peers: {})", config_.webrtc.max_peers);
+    update_ticker();
+    if (config_.webrtc.impairment.enabled) {
+        spdlog::warn("Network impairment enabled for new peers (test only)");
+    }
+    spdlog::info("WebRTC server started (max peers: {}, pool: {}, trickle ICE: {}, GOP cache: {})",
+                 config_.webrtc.max_peers, config_.webrtc.peer_pool_size,
+                 config_.webrtc.trickle_ice ? "on" : "off",
+                 config_.webrtc.gop_cache ? "on" : "off");
 }
 
 void WebRtcServer::stop() {
@@ -106,50 +438,189 @@ void WebRtcServer::stop() {
     if (cleanup_thread_.joinable()) {
         cleanup_thread_.join();
     }
+    {
+        std::lock_guard<std::mutex> ticker_lock(ticker_mutex_);
+        if (pacer_thread_.joinable()) {
+            pacer_thread_.join();
+        }
+    }
 
     // Close all peers
     std::lock_guard<std::mutex> lock(peers_mutex_);
     peers_.clear();
+    pool_.clear();
     spdlog::info("WebRTC server stopped");
 }
 
+void WebRtcServer::update_config(const AppConfig& config) {
+    {
+        std::lock_guard<std::mutex> lock(peers_mutex_);
+        apply_config(config);
+    }
+    update_ticker();
+}
+
+// peers_mutex_ held
+void WebRtcServer::apply_config(const AppConfig& config) {
+    config_ = config;
+    keyframe_min_interval_ms_.store(config_.webrtc.keyframe_min_interval_ms);
+
+    // Pooled peers were negotiated with the old settings
+    pool_.clear();
+    if (!config_.webrtc.gop_cache) {
+        gop_.clear();
+        gop_bytes_ = 0;
+    }
+
+    int pacing_kbps = static_cast<int>(config_.webrtc.video.max_bitrate_kbps *
+                                       config_.webrtc.pacing.rate_factor);
+    for (auto& [id, peer] : peers_) {
+        peer->set_pacing_rate(pacing_kbps);
+    }
+
+    spdlog::info("WebRTC config updated (max peers: {})", config_.webrtc.max_peers);
+}
+
+// Peers keep the pacer and impairment they were created with, so the ticker
+// runs while the config or any remaining peer needs it
+void WebRtcServer::update_ticker() {
+    std::lock_guard<std::mutex> ticker_lock(ticker_mutex_);
+    bool needed;
+    {
+        std::lock_guard<std::mutex> lock(peers_mutex_);
+        needed = config_.webrtc.pacing.enabled || config_.webrtc.impairment.enabled;
+        for (auto& [id, peer] : peers_) {
+            needed = needed || peer->needs_ticks();
+        }
+    }
+
+    if (needed && running_.load() && !pacer_thread_.joinable()) {
+        ticker_running_.store(true);
+        pacer_thread_ = std::thread(&WebRtcServer::pacer_loop, this);
+    } else if (!needed && pacer_thread_.joinable()) {
+        // pacer_loop takes peers_mutex_, which is not held here
+        ticker_running_.store(false);
+        pacer_thread_.join();
+        spdlog::info("Pacing ticker stopped");
+    }
+}
+
 size_t WebRtcServer::peer_count() const {
     std::lock_guard<std::mutex> lock(peers_mutex_);
     return peers_.size();
 }
 
+std::vector<std::string> WebRtcServer::connected_peers() const {
+    std::lock_guard<std::mutex> lock(peers_mutex_);
+    std::vector<std::string> ids;
+    for (auto& [id, peer] : peers_) {
+        if (peer->is_connected()) ids.push_back(id);
+    }
+    return ids;
+}
+
+size_t WebRtcServer::pooled_count() const {
+    std::lock_guard<std::mutex> lock(peers_mutex_);
+    return pool_.size();
+}
+
 WebRtcServer::ServerStats WebRtcServer::get_stats() const {
     std::lock_guard<std::mutex> lock(peers_mutex_);
     ServerStats stats;
     stats.total_peers = peers_.size();
+    size_t rtt_samples = 0;
     for (auto& [id, peer] : peers_) {
         if (peer->is_connected()) {
             stats.connected_peers++;
         }
         auto ps = peer->get_stats();
         stats.total_bytes_sent += ps.bytes_sent;
+        stats.telemetry_sent += ps.telemetry_sent;
+        stats.telemetry_dropped += ps.telemetry_dropped;
+        stats.control_received += ps.control_received;
+        stats.control_forwarded += ps.control_forwarded;
+        stats.control_failed += ps.control_failed;
+        stats.renegotiations += ps.renegotiations;
+        if (ps.control_rtt_avg_ms > 0.0) {
+            stats.control_rtt_avg_ms += ps.control_rtt_avg_ms;
+            rtt_samples++;
+        }
     }
+    if (rtt_samples > 0) {
+        stats.control_rtt_avg_ms /= static_cast<double>(rtt_samples);
+    }
+
+    std::lock_guard<std::mutex> keyframe_lock(keyframe_mutex_);
+    stats.keyframe_requests = keyframe_requests_;
+    stats.keyframes_forced = keyframes_forced_;
     return stats;
 }
 
+std::unordered_map<std::string, PeerConnection::Stats> WebRtcServer::get_peer_stats() const {
+    std::lock_guard<std::mutex> lock(peers_mutex_);
+    std::unordered_map<std::string, PeerConnection::Stats> result;
+    for (auto& [id, peer] : peers_) {
+        result[id] = peer->get_stats();
+    }
+    return result;
+}
+
 void WebRtcServer::cleanup_loop() {
+    int tick = 0;
     while (running_.load()) {
+        bool audio_demand = false;
         {
             std::lock_guard<std::mutex> lock(peers_mutex_);
+
+            // Check for dead peers every 2 seconds
+            bool cleanup = (tick % 20 == 0);
             for (auto it = peers_.begin(); it != peers_.end();) {
-                if (it->second->is_closed()) {
+                if (cleanup && it->second->is_closed()) {
                     spdlog::info("Cleaning up disconnected peer: {}", it->first);
+                    peer_streams_.erase(it->first);
                     it = peers_.erase(it);
                 } else {
+                    it->second->control_tick();
+                    audio_demand = audio_demand || it->second->audio_active();
                     ++it;
                 }
             }
+
+            refill_pool();
+        }
+        flush_keyframe_request();
+        if (tick % 20 == 0) {
+            update_ticker();    // the last peer with a pacer may have gone
         }
 
-        // Check every 2 seconds
-        for (int i = 0; i < 20 && running_.load(); i++) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        // Start/stop the audio transcode as the first peer joins / last leaves
+        if (audio_demand != audio_demand_) {
+            audio_demand_ = audio_demand;
+            if (audio_demand_cb_) {
+                audio_demand_cb_(audio_demand);
+            }
+        }
+
+        tick++;
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+}
+
+void WebRtcServer::pacer_loop() {
+    // Short interval keeps the added per-packet delay small
+    constexpr auto interval = std::chrono::milliseconds(5);
+    // Impairment delays need finer release times to model jitter faithfully
+    constexpr auto impairment_interval = std::chrono::milliseconds(1);
+    while (running_.load() && ticker_running_.load()) {
+        bool impaired;
+        {
+            std::lock_guard<std::mutex> lock(peers_mutex_);
+            impaired = config_.webrtc.impairment.enabled;
+            for (auto& [id, peer] : peers_) {
+                peer->pace();
+            }
         }
+        std::this_thread::sleep_for(impaired ? impairment_interval : interval);
     }
 }
 
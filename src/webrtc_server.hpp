@@ -1,7 +1,11 @@
 #pragma once
 
 #include "config.hpp"
+#include "h264.hpp"
+#include "media_clock.hpp"
 #include "peer_connection.hpp"
+#include <chrono>
+#include <deque>
 #include <functional>
 #include <memory>
 #include <mutex>
@@ -9,6 +13,7 @@
 #include <string>
 #include <thread>
 #include <atomic>
+#include <vector>
 
 namespace ss {
 
@@ -21,8 +26,11 @@ public:
     WebRtcServer(const WebRtcServer&) = delete;
     WebRtcServer& operator=(const WebRtcServer&) = delete;
 
-    // Create a new peer connection, returns peer_id
-    std::string create_peer(SignalingCallback signaling_cb);
+    // Create a new peer connection (or take a pooled one), returns peer_id.
+    // `accepted_at` starts the peer's setup timeline.
+    std::string create_peer(SignalingCallback signaling_cb,
+                            std::chrono::steady_clock::time_point accepted_at =
+                                std::chrono::steady_clock::now());
 
     // Initiate offer for a peer (server sends offer to browser)
     void start_offer(const std::string& peer_id);
@@ -34,33 +42,166 @@ public:
 
     // Remove a peer
     void remove_peer(const std::string& peer_id);
-
-    // Broadcast H.264 NAL units to all connected peers
-    void broadcast_nal(const uint8_t* data, size_t size, uint64_t timestamp_us);
+    bool has_peer(const std::string& peer_id) const;
+
+    // Broadcast H.264 NAL units to all connected peers. `capture_us`: the
+    // frame's wall-clock capture time (µs since the Unix epoch, 0 = unknown),
+    // stamped on everything peers get at that point of the timeline.
+    void broadcast_nal(const uint8_t* data, size_t size, uint64_t timestamp_us,
+                       uint64_t capture_us = 0);
+
+    // The main stream's parameter sets changed, announced ahead of the
+    // access unit that carries them (`idr`: it is a keyframe). Frames before
+    // the next IDR need what peers do not have yet, so peers wait for it, the
+    // GOP cache is dropped and an IDR is requested. Peers whose negotiated
+    // profile-level-id the stream no longer fits are offered again; new peers
+    // are offered the stream's own.
+    void on_source_format(const h264::Sps& sps, bool idr);
+
+    // Send one ROI stream's H.264 to the peers routed to it
+    void broadcast_stream_nal(const std::string& stream, const uint8_t* data, size_t size,
+                              uint64_t timestamp_us);
+
+    // Same for a stream from another pipeline (the mosaic), whose clock is
+    // not the main stream's: its timestamps are anchored to the current
+    // media time on the first frame and again when they jump
+    void broadcast_foreign_nal(const std::string& stream, const uint8_t* data, size_t size,
+                               uint64_t timestamp_us);
+
+    // Route a peer to a ROI stream ("" = the main stream). It resumes at
+    // that stream's next IDR.
+    void set_peer_stream(const std::string& peer_id, const std::string& stream);
+
+    // Send Opus packets to peers that accepted audio
+    void broadcast_audio(const uint8_t* data, size_t size, uint64_t timestamp_us);
+
+    // Called when the first peer opens audio (true) or the last one leaves (false)
+    using AudioDemandCallback = std::function<void(bool active)>;
+    void set_audio_demand_callback(AudioDemandCallback cb) { audio_demand_cb_ = std::move(cb); }
+
+    // Asks the pipeline for an IDR; returns false if it could not
+    using KeyframeRequestCallback = std::function<bool()>;
+    void set_keyframe_request_callback(KeyframeRequestCallback cb) { keyframe_request_cb_ = std::move(cb); }
+
+    // Asks a ROI or per-peer stream's encoder for an IDR
+    using StreamKeyframeCallback = std::function<bool(const std::string& stream)>;
+    void set_stream_keyframe_callback(StreamKeyframeCallback cb) { stream_keyframe_cb_ = std::move(cb); }
+
+    // Keyframe wanted (browser PLI, new viewer under intra refresh). Requests
+    // are coalesced: one stays outstanding until the IDR arrives, and at most
+    // one per keyframe_min_interval_ms reaches the encoder.
+    void request_keyframe(const std::string& reason);
+
+    // Stamp a telemetry message with the current media time and send it
+    // to every peer's telemetry channel
+    void broadcast_telemetry(const std::string& message);
+
+    // Commands from peers' control channels are handed to this callback
+    void set_control_callback(ControlCallback cb) { control_cb_ = std::move(cb); }
+
+    // Send a reply on one peer's control channel
+    void send_control(const std::string& peer_id, const std::string& message);
 
     // Start cleanup loop (removes dead peers)
     void start();
     void stop();
 
+    // Apply reloaded settings: new peers use them, existing peers keep
+    // their negotiation (only the pacing rate is updated in place)
+    void update_config(const AppConfig& config);
+
     // Get connected peer count
     size_t peer_count() const;
 
+    // Ids of the peers with media flowing
+    std::vector<std::string> connected_peers() const;
+
+    // Idle peers waiting in the pool
+    size_t pooled_count() const;
+
     // Get all peer stats
     struct ServerStats {
         size_t total_peers = 0;
         size_t connected_peers = 0;
         uint64_t total_bytes_sent = 0;
+        uint64_t telemetry_sent = 0;
+        uint64_t telemetry_dropped = 0;
+        uint64_t control_received = 0;
+        uint64_t control_forwarded = 0;
+        uint64_t control_failed = 0;
+        double control_rtt_avg_ms = 0.0; // mean over peers with an RTT sample
+        uint64_t keyframe_requests = 0;  // PLIs and new-viewer requests
+        uint64_t keyframes_forced = 0;   // requests passed on to the pipeline
+        uint64_t renegotiations = 0;     // peers offered again after a format change
     };
     ServerStats get_stats() const;
 
+    // Per-peer stats, keyed by peer id
+    std::unordered_map<std::string, PeerConnection::Stats> get_peer_stats() const;
+
 private:
     void cleanup_loop();
+    void pacer_loop();
+    void apply_config(const AppConfig& config);
+    void update_ticker();
+    std::shared_ptr<PeerConnection> make_peer();
+    void refill_pool();
+    void send_stream_nal(const std::string& stream, const uint8_t* data, size_t size,
+                         uint64_t media_us);
+    void cache_frame(const uint8_t* data, size_t size, uint64_t media_us, bool idr);
+    void flush_keyframe_request();
+    void force_keyframe(const std::string& reason);
+    void on_pli(const std::string& peer_id);
 
     AppConfig config_;
+    MediaClock media_clock_;
     mutable std::mutex peers_mutex_;
     std::unordered_map<std::string, std::shared_ptr<PeerConnection>> peers_;
 
+    // Peers with their offer and candidates ready, handed out by create_peer
+    struct PooledPeer {
+        std::shared_ptr<PeerConnection> peer;
+        std::chrono::steady_clock::time_point created;
+    };
+    std::deque<PooledPeer> pool_;
+
+    // Peers watching a ROI or per-peer stream instead of the main one
+    // (peer id → stream)
+    std::unordered_map<std::string, std::string> peer_streams_;
+
+    // profile-level-id of the main stream, offered to new peers ("" = unknown)
+    std::string source_profile_;
+
+    // Foreign stream → media time minus its pipeline time
+    std::unordered_map<std::string, int64_t> foreign_offsets_;
+
+    // Current GOP (IDR first) for new peers, when gop_cache is on
+    struct CachedFrame {
+        std::vector<uint8_t> data;
+        uint64_t media_us = 0;
+    };
+    std::vector<CachedFrame> gop_;
+    size_t gop_bytes_ = 0;
+
+    ControlCallback control_cb_;
+    AudioDemandCallback audio_demand_cb_;
+    KeyframeRequestCallback keyframe_request_cb_;
+    StreamKeyframeCallback stream_keyframe_cb_;
+    bool audio_demand_ = false;
+
+    // Keyframe request coalescing (keyframe_mutex_ may be taken under peers_mutex_)
+    mutable std::mutex keyframe_mutex_;
+    std::atomic<int> keyframe_min_interval_ms_;
+    std::chrono::steady_clock::time_point last_keyframe_forced_;
+    bool keyframe_outstanding_ = false;  // forced, IDR not seen yet
+    bool keyframe_pending_ = false;      // wanted, waiting for the interval
+    uint64_t keyframe_requests_ = 0;
+    uint64_t keyframes_forced_ = 0;
+
     std::thread cleanup_thread_;
+    std::mutex ticker_mutex_;               // starts and joins pacer_thread_
+    std::thread pacer_thread_;
+    std::atomic<bool> ticker_running_{false};
     std::atomic<bool> running_{false};
 };
 
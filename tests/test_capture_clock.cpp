@@ -0,0 +1,121 @@
+// Camera capture times from RTCP sender reports (rtsp.capture_clock).
+
+#include "capture_clock.hpp"
+
+#include <gtest/gtest.h>
+
+namespace ss::test {
+
+namespace {
+
+using namespace std::chrono;
+
+constexpr uint32_t ssrc = 0x1234ABCD;
+constexpr uint64_t report_unix_us = 1'700'000'000'000'000ULL;
+
+RtspConfig config_with(const std::string& capture_clock) {
+    RtspConfig config;
+    config.capture_clock = capture_clock;
+    return config;
+}
+
+system_clock::time_point at_us(uint64_t unix_us) {
+    return system_clock::time_point(duration_cast<system_clock::duration>(microseconds(unix_us)));
+}
+
+} // namespace
+
+TEST(CaptureClock, NtpRoundTrip) {
+    uint64_t ntp = CaptureClock::unix_us_to_ntp(report_unix_us + 250'000);
+    EXPECT_EQ(ntp >> 32, report_unix_us / 1'000'000 + 2'208'988'800ULL);
+    EXPECT_NEAR(static_cast<double>(CaptureClock::ntp_to_unix_us(ntp)), report_unix_us + 250'000, 1.0);
+
+    // Before 1970: the camera has no wall clock
+    EXPECT_EQ(CaptureClock::ntp_to_unix_us(uint64_t{1000} << 32), 0u);
+}
+
+TEST(CaptureClock, OffReportsNothing) {
+    CaptureClock clock(config_with("off"));
+    EXPECT_FALSE(clock.enabled());
+    clock.on_sender_report(ssrc, CaptureClock::unix_us_to_ntp(report_unix_us), 90000);
+    clock.on_rtp(ssrc, 90000);
+
+    uint64_t capture_us = 0;
+    EXPECT_FALSE(clock.capture_time(90000, capture_us));
+    EXPECT_EQ(clock.stats().sender_reports, 0u);
+}
+
+TEST(CaptureClock, CameraUsesTheSenderReport) {
+    CaptureClock clock(config_with("camera"));
+    uint64_t capture_us = 0;
+
+    clock.on_rtp(ssrc, 90000, at_us(report_unix_us));
+    EXPECT_FALSE(clock.capture_time(90000, capture_us));
+
+    clock.on_sender_report(ssrc, CaptureClock::unix_us_to_ntp(report_unix_us), 90000);
+    clock.on_rtp(ssrc, 99000, at_us(report_unix_us + 150'000));
+    ASSERT_TRUE(clock.capture_time(99000, capture_us, at_us(report_unix_us + 180'000)));
+    EXPECT_NEAR(static_cast<double>(capture_us), report_unix_us + 100'000, 1.0);
+
+    auto stats = clock.stats();
+    EXPECT_TRUE(stats.synced);
+    EXPECT_EQ(stats.sender_reports, 1u);
+    EXPECT_NEAR(stats.delay_ms, 80.0, 0.01);
+}
+
+TEST(CaptureClock, RepeatedReportCountsOnce) {
+    CaptureClock clock(config_with("camera"));
+    uint64_t ntp = CaptureClock::unix_us_to_ntp(report_unix_us);
+    clock.on_sender_report(ssrc, ntp, 90000);
+    clock.on_sender_report(ssrc, ntp, 90000);
+    EXPECT_EQ(clock.stats().sender_reports, 1u);
+}
+
+TEST(CaptureClock, RtpTimestampsWrap) {
+    CaptureClock clock(config_with("camera"));
+    clock.on_sender_report(ssrc, CaptureClock::unix_us_to_ntp(report_unix_us), 0xFFFFFF00);
+    clock.on_rtp(ssrc, 0x00000100);
+
+    uint64_t capture_us = 0;
+    ASSERT_TRUE(clock.capture_time(0x00000100, capture_us));
+    // 512 ticks at 90 kHz after the report
+    EXPECT_NEAR(static_cast<double>(capture_us), report_unix_us + 5'688, 1.0);
+}
+
+TEST(CaptureClock, AlignedMovesOntoTheHostClock) {
+    CaptureClock clock(config_with("aligned"));
+    // The camera runs 2 s behind the host
+    uint64_t camera_report_us = report_unix_us - 2'000'000;
+    clock.on_sender_report(ssrc, CaptureClock::unix_us_to_ntp(camera_report_us), 0);
+
+    // Packets captured at the report time, in transit 30, 10 and 20 ms
+    for (uint64_t transit_us : {30'000, 10'000, 20'000}) {
+        clock.on_rtp(ssrc, 0, at_us(report_unix_us + transit_us));
+    }
+
+    uint64_t capture_us = 0;
+    ASSERT_TRUE(clock.capture_time(0, capture_us, at_us(report_unix_us + 40'000)));
+    // The fastest packet is taken to have no transit delay
+    EXPECT_NEAR(static_cast<double>(capture_us), report_unix_us + 10'000, 1.0);
+    EXPECT_NEAR(clock.stats().camera_offset_ms, 2'010.0, 0.01);
+}
+
+TEST(CaptureClock, AlignedWaitsForAPacket) {
+    CaptureClock clock(config_with("aligned"));
+    clock.on_sender_report(ssrc, CaptureClock::unix_us_to_ntp(report_unix_us), 0);
+
+    uint64_t capture_us = 0;
+    EXPECT_FALSE(clock.capture_time(0, capture_us));
+}
+
+TEST(CaptureClock, NewSsrcNeedsItsOwnReport) {
+    CaptureClock clock(config_with("camera"));
+    clock.on_sender_report(ssrc, CaptureClock::unix_us_to_ntp(report_unix_us), 0);
+    clock.on_rtp(ssrc + 1, 0);
+
+    uint64_t capture_us = 0;
+    EXPECT_FALSE(clock.capture_time(0, capture_us));
+    EXPECT_FALSE(clock.stats().synced);
+}
+
+} // namespace ss::test
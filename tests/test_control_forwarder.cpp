@@ -0,0 +1,165 @@
+// Command seq/ack tracking against a stand-in backend on a unix socket.
+
+#include "control_forwarder.hpp"
+
+#include <gtest/gtest.h>
+#include <nlohmann/json.hpp>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using json = nlohmann::json;
+
+namespace ss::test {
+
+namespace {
+
+// The robot backend: receives commands, sends replies to the forwarder
+class Backend {
+public:
+    explicit Backend(const std::string& path) : path_(path) {
+        fd_ = socket(AF_UNIX, SOCK_DGRAM, 0);
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+        unlink(path.c_str());
+        bind(fd_, (sockaddr*)&addr, sizeof(addr));
+
+        timeval tv{};
+        tv.tv_sec = 2;
+        setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    }
+
+    ~Backend() {
+        close(fd_);
+        unlink(path_.c_str());
+    }
+
+    json receive() {
+        std::string buf(64 * 1024, '\0');
+        ssize_t n = recv(fd_, buf.data(), buf.size(), 0);
+        if (n <= 0) return json();
+        return json::parse(buf.substr(0, static_cast<size_t>(n)), nullptr, false);
+    }
+
+    void reply(const std::string& to, const json& msg) {
+        sockaddr_un dest{};
+        dest.sun_family = AF_UNIX;
+        std::strncpy(dest.sun_path, to.c_str(), sizeof(dest.sun_path) - 1);
+        std::string datagram = msg.dump();
+        sendto(fd_, datagram.data(), datagram.size(), 0, (sockaddr*)&dest, sizeof(dest));
+    }
+
+private:
+    std::string path_;
+    int fd_ = -1;
+};
+
+class ControlForwarderTest : public ::testing::Test {
+protected:
+    ControlForwarderTest() {
+        std::string suffix = std::to_string(getpid());
+        config_.backend_path = "/tmp/stream-server-test-backend-" + suffix + ".sock";
+        config_.reply_path = "/tmp/stream-server-test-reply-" + suffix + ".sock";
+    }
+
+    void SetUp() override {
+        backend_ = std::make_unique<Backend>(config_.backend_path);
+        forwarder_ = std::make_unique<ControlForwarder>(config_);
+        forwarder_->set_reply_callback([this](const std::string& peer_id, const std::string& reply) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            replies_.emplace_back(peer_id, json::parse(reply));
+            cv_.notify_all();
+        });
+        ASSERT_TRUE(forwarder_->start());
+    }
+
+    void TearDown() override {
+        forwarder_.reset();
+        backend_.reset();
+    }
+
+    // Waits for the reply callback to have run `count` times
+    bool wait_for_replies(size_t count) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return cv_.wait_for(lock, std::chrono::seconds(2), [&] { return replies_.size() >= count; });
+    }
+
+    ControlConfig config_;
+    std::unique_ptr<Backend> backend_;
+    std::unique_ptr<ControlForwarder> forwarder_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<std::pair<std::string, json>> replies_;
+};
+
+} // namespace
+
+TEST_F(ControlForwarderTest, AcknowledgedCommandIsCounted) {
+    ASSERT_TRUE(forwarder_->forward("peer-a", 7, R"({"drive":1.5})"));
+
+    json sent = backend_->receive();
+    EXPECT_EQ(sent["peer"], "peer-a");
+    EXPECT_EQ(sent["seq"], 7);
+    EXPECT_EQ(sent["command"]["drive"], 1.5);
+
+    backend_->reply(config_.reply_path, {{"peer", "peer-a"}, {"seq", 7}, {"ok", true}});
+    ASSERT_TRUE(wait_for_replies(1));
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        EXPECT_EQ(replies_[0].first, "peer-a");
+        EXPECT_EQ(replies_[0].second["type"], "reply");
+        EXPECT_EQ(replies_[0].second["seq"], 7);
+        EXPECT_EQ(replies_[0].second["data"]["ok"], true);
+    }
+
+    auto stats = forwarder_->get_stats();
+    EXPECT_EQ(stats.forwarded, 1u);
+    EXPECT_EQ(stats.acked, 1u);
+    EXPECT_GE(stats.delivery_max_ms, stats.delivery_avg_ms);
+}
+
+TEST_F(ControlForwarderTest, NonJsonCommandIsForwardedAsText) {
+    ASSERT_TRUE(forwarder_->forward("peer-a", 1, "stop"));
+    EXPECT_EQ(backend_->receive()["command"], "stop");
+}
+
+TEST_F(ControlForwarderTest, CommandsWithoutSeqAreNotTracked) {
+    ASSERT_TRUE(forwarder_->forward("peer-a", -1, "{}"));
+    ASSERT_TRUE(forwarder_->forward("peer-a", -1, "{}"));
+    backend_->receive();
+    backend_->receive();
+
+    // Relayed, but a reply without a seq cannot say which command it is for
+    backend_->reply(config_.reply_path, {{"peer", "peer-a"}, {"seq", -1}});
+    ASSERT_TRUE(wait_for_replies(1));
+    EXPECT_EQ(forwarder_->get_stats().acked, 0u);
+}
+
+TEST_F(ControlForwarderTest, AckMatchesPeerAndSeq) {
+    ASSERT_TRUE(forwarder_->forward("peer-a", 3, "{}"));
+    backend_->receive();
+
+    // Another peer's seq 3, an unknown seq, then the real ack, and that one
+    // only once
+    backend_->reply(config_.reply_path, {{"peer", "peer-b"}, {"seq", 3}});
+    backend_->reply(config_.reply_path, {{"peer", "peer-a"}, {"seq", 4}});
+    backend_->reply(config_.reply_path, {{"peer", "peer-a"}, {"seq", 3}});
+    backend_->reply(config_.reply_path, {{"peer", "peer-a"}, {"seq", 3}});
+    ASSERT_TRUE(wait_for_replies(4));
+    EXPECT_EQ(forwarder_->get_stats().acked, 1u);
+}
+
+TEST(ControlForwarder, ForwardFailsWhenStopped) {
+    ControlForwarder forwarder(ControlConfig{});
+    EXPECT_FALSE(forwarder.forward("peer-a", 1, "{}"));
+}
+
+} // namespace ss::test
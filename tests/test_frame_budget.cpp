@@ -0,0 +1,35 @@
+// VBV and frame size limits from encoding.latency_budget_ms.
+
+#include "video_encoder.hpp"
+
+#include <gtest/gtest.h>
+
+namespace ss::test {
+
+TEST(FrameBudget, OffWithoutABudget) {
+    auto budget = frame_budget(0, 4000, 30);
+    EXPECT_EQ(budget.vbv_ms, 0);
+    EXPECT_EQ(budget.vbv_kbits, 0);
+    EXPECT_EQ(budget.max_frame_bytes, 0u);
+
+    EXPECT_EQ(frame_budget(100, 0, 30).vbv_kbits, 0);
+}
+
+TEST(FrameBudget, VbvHoldsTheBudget) {
+    auto budget = frame_budget(100, 4000, 30);
+    EXPECT_EQ(budget.vbv_ms, 100);
+    EXPECT_EQ(budget.vbv_kbits, 400);
+    // The budget plus one frame interval at 4 Mbps
+    EXPECT_EQ(budget.max_frame_bytes, 66'666u);
+}
+
+TEST(FrameBudget, KeepsAtLeastOneKbit) {
+    EXPECT_EQ(frame_budget(10, 50, 30).vbv_kbits, 1);
+}
+
+TEST(FrameBudget, ZeroFpsCountsAsOne) {
+    // One frame interval of a full second
+    EXPECT_EQ(frame_budget(100, 8, 0).max_frame_bytes, 1'100u);
+}
+
+} // namespace ss::test
@@ -0,0 +1,186 @@
+// SPS parsing and RFC 6184 profile-level-id matching.
+
+#include "h264.hpp"
+
+#include <gtest/gtest.h>
+#include <vector>
+
+namespace ss::test {
+
+namespace {
+
+// Writes an SPS bit by bit, then adds the NAL header and emulation
+// prevention bytes the way an encoder would
+class SpsWriter {
+public:
+    void bits(uint32_t value, int count) {
+        for (int i = count - 1; i >= 0; i--) bit((value >> i) & 1);
+    }
+
+    void ue(uint32_t value) {
+        uint32_t code = value + 1;
+        int length = 0;
+        while ((code >> length) > 1) length++;
+        bits(0, length);
+        bits(code, length + 1);
+    }
+
+    std::vector<uint8_t> nal() {
+        bit(1);     // rbsp_stop_one_bit
+        while (used_ != 0) bit(0);
+
+        std::vector<uint8_t> out{0x67};
+        int zeros = 0;
+        for (uint8_t byte : rbsp_) {
+            if (zeros == 2 && byte <= 3) {
+                out.push_back(3);
+                zeros = 0;
+            }
+            out.push_back(byte);
+            zeros = byte == 0 ? zeros + 1 : 0;
+        }
+        return out;
+    }
+
+private:
+    void bit(uint32_t value) {
+        if (used_ == 0) rbsp_.push_back(0);
+        rbsp_.back() |= static_cast<uint8_t>(value << (7 - used_));
+        used_ = (used_ + 1) % 8;
+    }
+
+    std::vector<uint8_t> rbsp_;
+    int used_ = 0;
+};
+
+// A progressive 4:2:0 SPS; High profile carries the chroma fields
+std::vector<uint8_t> make_sps(uint8_t profile_idc, uint8_t constraints, uint8_t level_idc,
+                              uint32_t width_mbs, uint32_t height_mbs, uint32_t crop_bottom = 0) {
+    SpsWriter w;
+    w.bits(profile_idc, 8);
+    w.bits(constraints, 8);
+    w.bits(level_idc, 8);
+    w.ue(0);                // seq_parameter_set_id
+    if (profile_idc == 100) {
+        w.ue(1);            // chroma_format_idc
+        w.ue(0);            // bit_depth_luma_minus8
+        w.ue(0);            // bit_depth_chroma_minus8
+        w.bits(0, 1);       // qpprime_y_zero_transform_bypass_flag
+        w.bits(0, 1);       // seq_scaling_matrix_present_flag
+    }
+    w.ue(0);                // log2_max_frame_num_minus4
+    w.ue(0);                // pic_order_cnt_type
+    w.ue(2);                // log2_max_pic_order_cnt_lsb_minus4
+    w.ue(1);                // max_num_ref_frames
+    w.bits(0, 1);           // gaps_in_frame_num_value_allowed_flag
+    w.ue(width_mbs - 1);
+    w.ue(height_mbs - 1);
+    w.bits(1, 1);           // frame_mbs_only_flag
+    w.bits(1, 1);           // direct_8x8_inference_flag
+    w.bits(crop_bottom ? 1 : 0, 1);
+    if (crop_bottom) {
+        w.ue(0);
+        w.ue(0);
+        w.ue(0);
+        w.ue(crop_bottom);
+    }
+    w.bits(0, 1);           // vui_parameters_present_flag
+    return w.nal();
+}
+
+h264::Sps sps_of(uint8_t profile_idc, uint8_t constraints, uint8_t level_idc) {
+    h264::Sps sps;
+    sps.profile_idc = profile_idc;
+    sps.constraint_flags = constraints;
+    sps.level_idc = level_idc;
+    return sps;
+}
+
+} // namespace
+
+// ─── parse_sps ─────────────────────────────────────────────────────────────────
+
+TEST(H264ParseSps, ConstrainedBaseline720p) {
+    auto nal = make_sps(0x42, 0xE0, 31, 80, 45);
+    h264::Sps sps;
+    ASSERT_TRUE(h264::parse_sps(nal.data(), nal.size(), sps));
+    EXPECT_EQ(sps.profile_idc, 0x42);
+    EXPECT_EQ(sps.constraint_flags, 0xE0);
+    EXPECT_EQ(sps.level_idc, 31);
+    EXPECT_EQ(sps.width, 1280);
+    EXPECT_EQ(sps.height, 720);
+    EXPECT_EQ(h264::profile_level_id(sps), "42e01f");
+}
+
+TEST(H264ParseSps, HighProfileCropsTo1080) {
+    // 1088 coded lines, 4 chroma rows (8 luma) cropped off the bottom
+    auto nal = make_sps(100, 0x00, 40, 120, 68, 4);
+    h264::Sps sps;
+    ASSERT_TRUE(h264::parse_sps(nal.data(), nal.size(), sps));
+    EXPECT_EQ(sps.width, 1920);
+    EXPECT_EQ(sps.height, 1080);
+    EXPECT_EQ(h264::profile_level_id(sps), "640028");
+}
+
+TEST(H264ParseSps, RejectsOtherNalTypesAndTruncation) {
+    auto nal = make_sps(0x42, 0xE0, 31, 80, 45);
+    h264::Sps sps;
+
+    auto pps = nal;
+    pps[0] = 0x68;
+    EXPECT_FALSE(h264::parse_sps(pps.data(), pps.size(), sps));
+    EXPECT_FALSE(h264::parse_sps(nal.data(), 5, sps));
+    EXPECT_FALSE(h264::parse_sps(nal.data(), 3, sps));
+}
+
+TEST(H264ParseSps, FindsSpsAheadOfTheSlices) {
+    auto sps_nal = make_sps(0x42, 0xE0, 31, 80, 45);
+    std::vector<uint8_t> au{0, 0, 0, 1, 0x09, 0xF0};
+    au.insert(au.end(), {0, 0, 0, 1});
+    au.insert(au.end(), sps_nal.begin(), sps_nal.end());
+    au.insert(au.end(), {0, 0, 1, 0x65, 0x88, 0x84});
+
+    const uint8_t* nal = nullptr;
+    size_t nal_size = 0;
+    ASSERT_TRUE(h264::find_nal(au.data(), au.size(), h264::NalSps, nal, nal_size));
+    EXPECT_EQ(nal_size, sps_nal.size());
+    EXPECT_TRUE(h264::contains_idr(au.data(), au.size()));
+    EXPECT_FALSE(h264::find_nal(au.data(), au.size(), h264::NalPps, nal, nal_size));
+}
+
+// ─── profile_compatible ────────────────────────────────────────────────────────
+
+TEST(H264ProfileCompatible, SameProfileUpToTheLevel) {
+    EXPECT_TRUE(h264::profile_compatible("42e01f", sps_of(0x42, 0xE0, 31)));
+    EXPECT_TRUE(h264::profile_compatible("42e01f", sps_of(0x42, 0xE0, 30)));
+    EXPECT_FALSE(h264::profile_compatible("42e01f", sps_of(0x42, 0xE0, 32)));
+}
+
+TEST(H264ProfileCompatible, SubsetProfiles) {
+    // Constrained Baseline decodes anywhere, High decoders take Main
+    EXPECT_TRUE(h264::profile_compatible("4d001f", sps_of(0x42, 0xE0, 31)));
+    EXPECT_TRUE(h264::profile_compatible("64001f", sps_of(0x4D, 0x00, 31)));
+    EXPECT_FALSE(h264::profile_compatible("42e01f", sps_of(0x64, 0x00, 31)));
+    EXPECT_FALSE(h264::profile_compatible("42e01f", sps_of(0x4D, 0x00, 31)));
+}
+
+TEST(H264ProfileCompatible, RejectsMalformedIds) {
+    EXPECT_FALSE(h264::profile_compatible("", sps_of(0x42, 0xE0, 31)));
+    EXPECT_FALSE(h264::profile_compatible("42e01", sps_of(0x42, 0xE0, 31)));
+    EXPECT_FALSE(h264::profile_compatible("42e0zz", sps_of(0x42, 0xE0, 31)));
+}
+
+TEST(H264ProfileCompatible, Level1bSitsBetween10And11) {
+    // Baseline signals 1b as level 1.1 with constraint_set3
+    EXPECT_TRUE(h264::profile_compatible("42e00b", sps_of(0x42, 0xF0, 11)));
+    EXPECT_FALSE(h264::profile_compatible("42e00a", sps_of(0x42, 0xF0, 11)));
+    EXPECT_FALSE(h264::profile_compatible("42f00b", sps_of(0x42, 0xE0, 11)));
+    EXPECT_TRUE(h264::profile_compatible("42f00b", sps_of(0x42, 0xE0, 10)));
+
+    // High signals it as level_idc 9
+    EXPECT_FALSE(h264::profile_compatible("64000a", sps_of(0x64, 0x00, 9)));
+    EXPECT_TRUE(h264::profile_compatible("64000b", sps_of(0x64, 0x00, 9)));
+    EXPECT_TRUE(h264::profile_compatible("640009", sps_of(0x64, 0x00, 10)));
+}
+
+} // namespace ss::test
@@ -0,0 +1,70 @@
+// Re-encode resolution ladder (encoding.scaling).
+
+#include "scaling_policy.hpp"
+
+#include <gtest/gtest.h>
+
+namespace ss::test {
+
+namespace {
+
+const Resolution r1080{1920, 1080};
+const Resolution r720{1280, 720};
+const Resolution r540{960, 540};
+const Resolution r360{640, 360};
+
+ScalingPolicy default_policy() {
+    return ScalingPolicy(ScalingConfig{});
+}
+
+} // namespace
+
+TEST(ScalingPolicy, Parse) {
+    Resolution r;
+    ASSERT_TRUE(ScalingPolicy::parse("1280x720", r));
+    EXPECT_EQ(r, r720);
+    EXPECT_FALSE(ScalingPolicy::parse("1281x720", r));     // odd width
+    EXPECT_FALSE(ScalingPolicy::parse("1280x720p", r));
+    EXPECT_FALSE(ScalingPolicy::parse("0x720", r));
+    EXPECT_FALSE(ScalingPolicy::parse("720p", r));
+}
+
+TEST(ScalingPolicy, RungsNeverUpscale) {
+    auto policy = default_policy();
+    EXPECT_EQ(policy.rungs(r1080), (std::vector<Resolution>{r1080, r720, r540, r360}));
+    EXPECT_EQ(policy.rungs(r720), (std::vector<Resolution>{r720, r540, r360}));
+
+    // The ladder is sorted and bad entries are dropped
+    ScalingConfig config;
+    config.ladder = {"640x360", "junk", "1280x720"};
+    EXPECT_EQ(ScalingPolicy(config).rungs(r1080), (std::vector<Resolution>{r1080, r720, r360}));
+}
+
+TEST(ScalingPolicy, BitsPerPixel) {
+    EXPECT_NEAR(ScalingPolicy::bits_per_pixel(4000, 30, r1080), 0.0643, 0.0001);
+    EXPECT_EQ(ScalingPolicy::bits_per_pixel(4000, 0, r1080), 0.0);
+    EXPECT_EQ(ScalingPolicy::bits_per_pixel(4000, 30, Resolution{}), 0.0);
+}
+
+TEST(ScalingPolicy, StepsDownWhenBitsRunShort) {
+    auto policy = default_policy();
+    EXPECT_EQ(policy.choose(4000, 30, r1080, Resolution{}), r1080);
+    EXPECT_EQ(policy.choose(2000, 30, r1080, r1080), r720);
+    // Lowest rung however little is left
+    EXPECT_EQ(policy.choose(100, 30, r1080, r1080), r360);
+}
+
+TEST(ScalingPolicy, StepsUpOnlyPastTheHigherThreshold) {
+    auto policy = default_policy();
+    // 3000 kbps keeps 1080p (0.048 bpp) but is not enough to return to it
+    EXPECT_EQ(policy.choose(3000, 30, r1080, r1080), r1080);
+    EXPECT_EQ(policy.choose(3000, 30, r1080, r720), r720);
+    EXPECT_EQ(policy.choose(5000, 30, r1080, r720), r1080);
+}
+
+TEST(ScalingPolicy, UnknownCurrentStartsFromTheSource) {
+    auto policy = default_policy();
+    EXPECT_EQ(policy.choose(4000, 30, r1080, Resolution{1024, 576}), r1080);
+}
+
+} // namespace ss::test
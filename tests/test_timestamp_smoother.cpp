@@ -0,0 +1,119 @@
+// Frame timestamp regeneration (rtsp.timestamps).
+
+#include "timestamp_smoother.hpp"
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace ss::test {
+
+namespace {
+
+constexpr uint64_t interval_us = 33'333;
+constexpr uint64_t start_us = 10'000'000;
+
+RtspConfig config_with(const std::string& timestamps) {
+    RtspConfig config;
+    config.timestamps = timestamps;
+    return config;
+}
+
+// Arrival times of a 30 fps stream delivered ±`jitter_us` off its cadence
+std::vector<uint64_t> jittered(size_t frames, uint64_t jitter_us) {
+    std::vector<uint64_t> out;
+    for (size_t i = 0; i < frames; i++) {
+        int64_t offset = (i % 2 ? 1 : -1) * static_cast<int64_t>(jitter_us);
+        out.push_back(static_cast<uint64_t>(static_cast<int64_t>(start_us + i * interval_us) + offset));
+    }
+    return out;
+}
+
+} // namespace
+
+TEST(TimestampSmoother, ArrivalPassesTimestampsThrough) {
+    TimestampSmoother smoother(config_with("arrival"));
+    for (uint64_t pts : jittered(60, 5'000)) {
+        EXPECT_EQ(smoother.on_frame(true, pts, interval_us), pts);
+    }
+    EXPECT_EQ(smoother.stats().mode, "arrival");
+}
+
+TEST(TimestampSmoother, UnknownModeFallsBackToArrival) {
+    TimestampSmoother smoother(config_with("bogus"));
+    EXPECT_EQ(smoother.stats().mode, "arrival");
+    EXPECT_EQ(smoother.on_frame(true, start_us, interval_us), start_us);
+}
+
+TEST(TimestampSmoother, NominalEvensOutJitter) {
+    TimestampSmoother smoother(config_with("nominal"));
+    uint64_t last = 0;
+    double worst_late_step = 0.0;
+    size_t frame = 0;
+    for (uint64_t pts : jittered(300, 5'000)) {
+        uint64_t out = smoother.on_frame(true, pts, interval_us);
+        if (frame++ > 200) {
+            worst_late_step = std::max(worst_late_step,
+                                       std::abs(static_cast<double>(out - last) - interval_us));
+        }
+        last = out;
+    }
+
+    auto stats = smoother.stats();
+    EXPECT_LT(stats.output_jitter_ms, stats.input_jitter_ms / 4);
+    EXPECT_LT(worst_late_step, 1'000.0);
+    EXPECT_NEAR(stats.interval_ms, interval_us / 1000.0, 0.5);
+}
+
+TEST(TimestampSmoother, NominalSkipsAnIntervalPerLostFrame) {
+    TimestampSmoother smoother(config_with("nominal"));
+    uint64_t last = 0;
+    for (int i = 0; i < 30; i++) last = smoother.on_frame(true, start_us + i * interval_us, interval_us);
+
+    // Two frames lost
+    uint64_t out = smoother.on_frame(true, start_us + 32 * interval_us, interval_us);
+    EXPECT_NEAR(static_cast<double>(out - last), 3.0 * interval_us, 500.0);
+}
+
+TEST(TimestampSmoother, RtpFollowsTheCameraClock) {
+    TimestampSmoother smoother(config_with("rtp"));
+    uint32_t rtp = 0xFFFF0000;     // wraps during the run
+    uint64_t last = 0;
+    double worst_step = 0.0;
+    auto arrivals = jittered(120, 6'000);
+    for (size_t i = 0; i < arrivals.size(); i++) {
+        smoother.on_rtp(arrivals[i], rtp);
+        uint64_t out = smoother.on_frame(true, arrivals[i], interval_us);
+        if (i > 0) worst_step = std::max(worst_step, std::abs(static_cast<double>(out - last) - interval_us));
+        last = out;
+        rtp += 3000;
+    }
+    // Each step is the camera's 3000 ticks, give or take the drift correction
+    EXPECT_LT(worst_step, interval_us * 0.05 + 1.0);
+
+    uint32_t found = 0;
+    ASSERT_TRUE(smoother.camera_rtp(arrivals.back() + 10, found));
+    EXPECT_EQ(found, rtp - 3000);
+}
+
+TEST(TimestampSmoother, ResyncsAfterAJump) {
+    TimestampSmoother smoother(config_with("nominal"));
+    for (int i = 0; i < 10; i++) smoother.on_frame(true, start_us + i * interval_us, interval_us);
+
+    uint64_t restarted = start_us + 60'000'000;
+    EXPECT_EQ(smoother.on_frame(true, restarted, interval_us), restarted);
+    EXPECT_EQ(smoother.stats().resyncs, 1u);
+}
+
+TEST(TimestampSmoother, ResetForgetsRtpHistory) {
+    TimestampSmoother smoother(config_with("rtp"));
+    smoother.on_rtp(start_us, 1000);
+    uint32_t found = 0;
+    EXPECT_TRUE(smoother.camera_rtp(start_us, found));
+
+    smoother.reset();
+    EXPECT_FALSE(smoother.camera_rtp(start_us, found));
+}
+
+} // namespace ss::test